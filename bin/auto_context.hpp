@@ -34,11 +34,36 @@
 
 #include <gtsvm.h>
 
+#include <string>
+#include <ostream>
+#include <iomanip>
 #include <stdexcept>
 
 
 
 
+//============================================================================
+//    ParseBackend function
+//============================================================================
+
+
+// backend is "cuda", "cpu" or "default"
+inline GTSVM_Backend const ParseBackend( std::string const& backend ) {
+
+	GTSVM_Backend result = GTSVM_BACKEND_DEFAULT;
+	if ( backend == "cuda" )
+		result = GTSVM_BACKEND_CUDA;
+	else if ( backend == "cpu" )
+		result = GTSVM_BACKEND_CPU;
+	else if ( backend != "default" )
+		throw std::runtime_error( "The backend parameter must be \"cuda\", \"cpu\" or \"default\"" );
+
+	return result;
+}
+
+
+
+
 //============================================================================
 //    AutoContext class
 //============================================================================
@@ -47,6 +72,7 @@
 struct AutoContext {
 
 	inline AutoContext();
+	inline AutoContext( std::string const& backend, unsigned int const threads );
 
 	inline ~AutoContext();
 
@@ -78,6 +104,21 @@ AutoContext::AutoContext() {
 }
 
 
+/*
+	backend is "cuda", "cpu" or "default", and threads is the number of
+	threads used by the CPU backend (zero means one per core)
+*/
+AutoContext::AutoContext( std::string const& backend, unsigned int const threads ) {
+
+	GTSVM_Backend const type = ParseBackend( backend );
+
+	if ( GTSVM_SetThreads( threads ) )
+		throw std::runtime_error( GTSVM_Error() );
+	if ( GTSVM_CreateWithBackend( &m_context, type ) )
+		throw std::runtime_error( GTSVM_Error() );
+}
+
+
 AutoContext::~AutoContext() {
 
 	if ( GTSVM_Destroy( m_context ) )
@@ -93,6 +134,148 @@ AutoContext::operator GTSVM_Context const() const {
 
 
 
+//============================================================================
+//    ParseClustering function
+//============================================================================
+
+
+// clustering is "greedy" or "minhash"
+inline GTSVM_Clustering const ParseClustering( std::string const& clustering ) {
+
+	GTSVM_Clustering result = GTSVM_CLUSTERING_GREEDY;
+	if ( clustering == "minhash" )
+		result = GTSVM_CLUSTERING_MINHASH;
+	else if ( clustering != "greedy" )
+		throw std::runtime_error( "The clustering parameter must be \"greedy\" or \"minhash\"" );
+
+	return result;
+}
+
+
+
+
+//============================================================================
+//    ParseColumnOrder function
+//============================================================================
+
+
+// columnOrder is "original" or "cooccurrence"
+inline GTSVM_ColumnOrder const ParseColumnOrder( std::string const& columnOrder ) {
+
+	GTSVM_ColumnOrder result = GTSVM_COLUMN_ORDER_ORIGINAL;
+	if ( columnOrder == "cooccurrence" )
+		result = GTSVM_COLUMN_ORDER_COOCCURRENCE;
+	else if ( columnOrder != "original" )
+		throw std::runtime_error( "The column_order parameter must be \"original\" or \"cooccurrence\"" );
+
+	return result;
+}
+
+
+
+
+//============================================================================
+//    ReportStatistics function
+//============================================================================
+
+
+/*
+	Writes the per-phase times and call counts, and the other performance
+	counters, of the given context to the given stream
+*/
+inline void ReportStatistics( std::ostream& stream, GTSVM_Context const context ) {
+
+	GTSVM_Statistics statistics;
+	if ( GTSVM_GetStatistics( context, &statistics ) )
+		throw std::runtime_error( GTSVM_Error() );
+
+	double total = 0;
+	for ( unsigned int ii = 0; ii < GTSVM_PHASES; ++ii )
+		total += statistics.seconds[ ii ];
+
+	stream << "Phase                       Seconds    Percent        Calls" << std::endl;
+	for ( unsigned int ii = 0; ii < GTSVM_PHASES; ++ii ) {
+
+		stream <<
+			std::left << std::setw( 20 ) << GTSVM_GetPhaseName( static_cast< GTSVM_Phase >( ii ) ) << std::right <<
+			std::fixed << std::setprecision( 6 ) <<
+			std::setw( 15 ) << statistics.seconds[ ii ] <<
+			std::setw( 10 ) << std::setprecision( 1 ) << ( ( total > 0 ) ? ( 100 * statistics.seconds[ ii ] / total ) : 0.0 ) << '%' <<
+			std::setw( 13 ) << statistics.calls[ ii ] <<
+			std::endl;
+	}
+	stream.unsetf( std::ios_base::floatfield );
+	stream << std::setprecision( 6 );
+
+	stream <<
+		"Bytes to device = " << statistics.bytesToDevice <<
+		", bytes from device = " << statistics.bytesFromDevice <<
+		", iterations = " << statistics.iterations <<
+		", progress failures = " << statistics.progressFailures <<
+		", shrinks = " << statistics.shrinks <<
+		", unshrinks = " << statistics.unshrinks <<
+		std::endl;
+}
+
+
+
+
+//============================================================================
+//    ReportMemoryUsage function
+//============================================================================
+
+
+/*
+	Writes the bytes held by each kind of buffer, the fraction of the device
+	bytes which are padding, and the number of columns which are nonzero in
+	each cluster, to the given stream
+*/
+inline void ReportMemoryUsage( std::ostream& stream, GTSVM_MemoryUsage const& usage ) {
+
+	double const megabyte = 1048576.0;
+
+	unsigned long long hostTotal    = 0;
+	unsigned long long deviceTotal  = 0;
+	unsigned long long paddingTotal = 0;
+
+	stream << "Buffer                Host MB   Device MB     Padding" << std::endl;
+	for ( unsigned int ii = 0; ii < GTSVM_BUFFERS; ++ii ) {
+
+		stream <<
+			std::left << std::setw( 16 ) << GTSVM_GetBufferName( static_cast< GTSVM_Buffer >( ii ) ) << std::right <<
+			std::fixed << std::setprecision( 3 ) <<
+			std::setw( 12 ) << usage.hostBytes[ ii ] / megabyte <<
+			std::setw( 12 ) << usage.deviceBytes[ ii ] / megabyte <<
+			std::setw( 11 ) << std::setprecision( 1 ) << ( ( usage.deviceBytes[ ii ] > 0 ) ? ( 100.0 * usage.paddingBytes[ ii ] / usage.deviceBytes[ ii ] ) : 0.0 ) << '%' <<
+			std::endl;
+
+		hostTotal    += usage.hostBytes[ ii ];
+		deviceTotal  += usage.deviceBytes[ ii ];
+		paddingTotal += usage.paddingBytes[ ii ];
+	}
+	stream <<
+		std::left << std::setw( 16 ) << "total" << std::right <<
+		std::setprecision( 3 ) <<
+		std::setw( 12 ) << hostTotal / megabyte <<
+		std::setw( 12 ) << deviceTotal / megabyte <<
+		std::setw( 11 ) << std::setprecision( 1 ) << ( ( deviceTotal > 0 ) ? ( 100.0 * paddingTotal / deviceTotal ) : 0.0 ) << '%' <<
+		std::endl;
+	stream.unsetf( std::ios_base::floatfield );
+	stream << std::setprecision( 6 );
+
+	stream <<
+		"Clusters = " << usage.clusters <<
+		", nonzero columns per cluster = " << ( ( usage.clusters > 0 ) ? ( static_cast< double >( usage.clusterNonzeros ) / usage.clusters ) : 0.0 ) <<
+		" (at most " << usage.maximumClusterNonzeros << ")" <<
+		std::endl;
+
+	if ( ! usage.deviceInitialized )
+		stream << "(device memory has not yet been allocated: these are the sizes which will be)" << std::endl;
+}
+
+
+
+
 #endif    /* __cplusplus */
 
 #endif    /* __AUTO_CONTEXT_HPP__ */
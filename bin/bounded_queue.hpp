@@ -0,0 +1,147 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file bounded_queue.hpp
+	\brief definition of BoundedQueue class
+*/
+
+
+
+
+#ifndef __BOUNDED_QUEUE_HPP__
+#define __BOUNDED_QUEUE_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <deque>
+#include <cstddef>
+
+
+
+
+//============================================================================
+//    BoundedQueue class
+//============================================================================
+
+
+/*
+	A first-in first-out queue, shared between threads, which holds at most
+	"capacity" items: Push blocks while it's full, and Pop while it's empty.
+	Once the queue is closed, Push fails, and Pop fails once the remaining
+	items have been removed. Either side closes the queue to tell the other
+	to stop.
+*/
+template< typename t_Type >
+struct BoundedQueue {
+
+	inline explicit BoundedQueue( size_t const capacity );
+
+
+	// returns false if the queue has been closed
+	inline bool const Push( t_Type const& item );
+
+	// returns false if the queue has been closed, and is empty
+	inline bool const Pop( t_Type* const pItem );
+
+	inline void Close();
+
+
+private:
+
+	size_t m_capacity;
+	bool m_closed;
+	std::deque< t_Type > m_items;
+
+	boost::mutex m_mutex;
+	boost::condition_variable m_notFull;
+	boost::condition_variable m_notEmpty;
+
+
+	inline BoundedQueue( BoundedQueue const& other );
+	inline BoundedQueue const& operator=( BoundedQueue const& other );
+};
+
+
+
+
+//============================================================================
+//    BoundedQueue inline methods
+//============================================================================
+
+
+template< typename t_Type >
+BoundedQueue< t_Type >::BoundedQueue( size_t const capacity ) :
+	m_capacity( ( capacity > 0 ) ? capacity : 1 ),
+	m_closed( false )
+{
+}
+
+
+template< typename t_Type >
+bool const BoundedQueue< t_Type >::Push( t_Type const& item ) {
+
+	boost::mutex::scoped_lock lock( m_mutex );
+	while ( ( ! m_closed ) && ( m_items.size() >= m_capacity ) )
+		m_notFull.wait( lock );
+	if ( m_closed )
+		return false;
+
+	m_items.push_back( item );
+	m_notEmpty.notify_one();
+	return true;
+}
+
+
+template< typename t_Type >
+bool const BoundedQueue< t_Type >::Pop( t_Type* const pItem ) {
+
+	boost::mutex::scoped_lock lock( m_mutex );
+	while ( ( ! m_closed ) && m_items.empty() )
+		m_notEmpty.wait( lock );
+	if ( m_items.empty() )
+		return false;
+
+	*pItem = m_items.front();
+	m_items.pop_front();
+	m_notFull.notify_one();
+	return true;
+}
+
+
+template< typename t_Type >
+void BoundedQueue< t_Type >::Close() {
+
+	boost::mutex::scoped_lock lock( m_mutex );
+	m_closed = true;
+	m_notFull.notify_all();
+	m_notEmpty.notify_all();
+}
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __BOUNDED_QUEUE_HPP__ */
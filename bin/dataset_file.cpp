@@ -0,0 +1,548 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file dataset_file.cpp
+	\brief implementation of dataset file functions, and ReadDataset function
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace {
+
+
+
+
+//============================================================================
+//    Helper functions
+//============================================================================
+
+
+template< typename t_Type >
+inline t_Type const* VectorData( std::vector< t_Type > const& vector ) {
+
+	return( vector.empty() ? NULL : &vector[ 0 ] );
+}
+
+
+inline boost::uint64_t const DatasetFileAlign( boost::uint64_t const offset ) {
+
+	return( ( offset + ( DATASET_FILE_ALIGNMENT - 1 ) ) & ~static_cast< boost::uint64_t >( DATASET_FILE_ALIGNMENT - 1 ) );
+}
+
+
+double const ElapsedSeconds( boost::posix_time::ptime const& start ) {
+
+	return( ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds() * 1e-6 );
+}
+
+
+void DatasetFileWrite( FILE* const file, boost::crc_32_type* const pCRC, void const* const data, size_t const size ) {
+
+	if ( size > 0 ) {
+
+		if ( fwrite( data, size, 1, file ) != 1 )
+			throw std::runtime_error( "Unable to write dataset file" );
+		pCRC->process_bytes( data, size );
+	}
+}
+
+
+void DatasetFilePad( FILE* const file, boost::crc_32_type* const pCRC, boost::uint64_t* const pOffset ) {
+
+	char const zeros[ DATASET_FILE_ALIGNMENT ] = { 0 };
+	boost::uint64_t const aligned = DatasetFileAlign( *pOffset );
+	DatasetFileWrite( file, pCRC, zeros, aligned - *pOffset );
+	*pOffset = aligned;
+}
+
+
+// writes the elements of an array, after converting them to type t_Type
+template< typename t_Type, typename t_Source >
+void DatasetFileWriteArray( FILE* const file, boost::crc_32_type* const pCRC, boost::uint64_t* const pOffset, t_Source const* const source, size_t const size ) {
+
+	size_t const blockSize = ( 1u << 16 );
+	std::vector< t_Type > block( std::min( size, blockSize ) );
+	for ( size_t ii = 0; ii < size; ii += blockSize ) {
+
+		size_t const count = std::min( size - ii, blockSize );
+		for ( size_t jj = 0; jj < count; ++jj )
+			block[ jj ] = static_cast< t_Type >( source[ ii + jj ] );
+		DatasetFileWrite( file, pCRC, &block[ 0 ], count * sizeof( t_Type ) );
+	}
+	*pOffset += size * sizeof( t_Type );
+}
+
+
+
+
+//============================================================================
+//    ShardQueue structure
+//============================================================================
+
+
+struct ShardQueue {
+
+	std::vector< std::string > const* pFiles;
+	std::vector< SVMLightDataset >* pShards;
+	unsigned int threads;
+	bool cache;
+
+	std::vector< std::string > errors;    // empty if the shard was read successfully
+	std::vector< unsigned char > failed;
+
+	size_t next;
+	boost::mutex mutex;
+};
+
+
+
+
+//============================================================================
+//    ReadShard function
+//============================================================================
+
+
+void ReadShard( SVMLightDataset* const pDataset, std::string const& filename, unsigned int const threads, bool const cache ) {
+
+	if ( IsDatasetFile( filename ) ) {
+
+		ReadDatasetFile( pDataset, filename, NULL );
+		return;
+	}
+
+	DatasetFileSource const source = GetDatasetFileSource( filename );
+	std::string const cacheFilename = filename + DATASET_FILE_CACHE_SUFFIX;
+
+	if ( cache && IsDatasetFile( cacheFilename ) ) {
+
+		// a stale or corrupt cache is simply replaced
+		try {
+
+			if ( ReadDatasetFile( pDataset, cacheFilename, &source ) )
+				return;
+		}
+		catch( std::runtime_error& ) {}
+	}
+
+	ReadSVMLight( pDataset, filename, threads );
+
+	if ( cache ) {
+
+		try {
+
+			WriteDatasetFile( *pDataset, cacheFilename, &source );
+		}
+		catch( std::runtime_error& error ) {
+
+			std::cerr << "Warning: unable to write dataset cache \"" << cacheFilename << "\": " << error.what() << std::endl;
+		}
+	}
+}
+
+
+
+
+//============================================================================
+//    ShardWorker function
+//============================================================================
+
+
+void ShardWorker( ShardQueue* const pQueue ) {
+
+	for ( ; ; ) {
+
+		size_t index;
+		{	boost::mutex::scoped_lock lock( pQueue->mutex );
+			index = pQueue->next++;
+		}
+		if ( index >= pQueue->pFiles->size() )
+			break;
+
+		try {
+
+			ReadShard( &( *pQueue->pShards )[ index ], ( *pQueue->pFiles )[ index ], pQueue->threads, pQueue->cache );
+		}
+		catch( std::exception& error ) {
+
+			pQueue->failed[ index ] = true;
+			pQueue->errors[ index ] = error.what();
+		}
+	}
+}
+
+
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    DatasetFile functions
+//============================================================================
+
+
+DatasetFileSource const GetDatasetFileSource( std::string const& filename ) {
+
+	struct stat status;
+	if ( stat( filename.c_str(), &status ) != 0 )
+		throw std::runtime_error( "Unable to open dataset file" );
+
+	DatasetFileSource source;
+	source.size = status.st_size;
+	source.modificationTime = status.st_mtime;
+	return source;
+}
+
+
+bool const IsDatasetFile( std::string const& filename ) {
+
+	FILE* file = fopen( filename.c_str(), "rb" );
+	if ( file == NULL )
+		return false;
+
+	char magic[ 8 ];
+	bool const result = (
+		( fread( magic, sizeof( magic ), 1, file ) == 1 ) &&
+		( std::memcmp( magic, DATASET_FILE_MAGIC, sizeof( magic ) ) == 0 )
+	);
+
+	fclose( file );
+	return result;
+}
+
+
+bool const ReadDatasetFile(
+	SVMLightDataset* const pDataset,
+	std::string const& filename,
+	DatasetFileSource const* const pSource
+)
+{
+	boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+
+	boost::interprocess::file_mapping mapping;
+	boost::interprocess::mapped_region region;
+	try {
+
+		boost::interprocess::file_mapping( filename.c_str(), boost::interprocess::read_only ).swap( mapping );
+		boost::interprocess::mapped_region( mapping, boost::interprocess::read_only ).swap( region );
+		region.advise( boost::interprocess::mapped_region::advice_sequential );
+	}
+	catch( boost::interprocess::interprocess_exception& error ) {
+
+		throw std::runtime_error( std::string( "Unable to map dataset file: " ) + error.what() );
+	}
+	char const* const data = static_cast< char const* >( region.get_address() );
+	size_t const size = region.get_size();
+
+	DatasetFileHeader header;
+	if ( size < sizeof( header ) )
+		throw std::runtime_error( "Dataset file is truncated" );
+	std::memcpy( &header, data, sizeof( header ) );
+
+	if ( std::memcmp( header.magic, DATASET_FILE_MAGIC, sizeof( header.magic ) ) != 0 )
+		throw std::runtime_error( "Not a dataset file" );
+	if ( header.version != DATASET_FILE_VERSION )
+		throw std::runtime_error( "Unsupported dataset file version" );
+	if ( header.byteOrder != DATASET_FILE_BYTE_ORDER )
+		throw std::runtime_error( "Dataset file has the wrong byte order" );
+	{	boost::crc_32_type crc;
+		crc.process_bytes( &header, offsetof( DatasetFileHeader, checksum ) );
+		if ( header.checksum != crc.checksum() )
+			throw std::runtime_error( "Dataset file header is corrupt" );
+	}
+
+	if ( ( pSource != NULL ) && ( ( header.source.size != pSource->size ) || ( header.source.modificationTime != pSource->modificationTime ) ) )
+		return false;
+
+	boost::uint64_t const rows = header.rows;
+	boost::uint64_t const nonzeros = header.nonzeros;
+	if ( nonzeros > std::numeric_limits< size_t >::max() / sizeof( size_t ) )
+		throw std::runtime_error( "Dataset file is truncated" );
+
+	boost::uint64_t const offsetsOffset = DatasetFileAlign( sizeof( header ) );
+	boost::uint64_t const labelsOffset  = DatasetFileAlign( offsetsOffset + ( rows + 1 ) * sizeof( boost::uint64_t ) );
+	boost::uint64_t const indicesOffset = DatasetFileAlign( labelsOffset + rows * sizeof( boost::int32_t ) );
+	boost::uint64_t const valuesOffset  = DatasetFileAlign( indicesOffset + nonzeros * sizeof( boost::uint32_t ) );
+	boost::uint64_t const end = valuesOffset + nonzeros * sizeof( float );
+	if ( end > size )
+		throw std::runtime_error( "Dataset file is truncated" );
+
+	{	boost::crc_32_type crc;
+		crc.process_bytes( data + sizeof( header ), end - sizeof( header ) );
+		if ( header.dataChecksum != crc.checksum() )
+			throw std::runtime_error( "Dataset file is corrupt" );
+	}
+
+	boost::uint64_t const* const offsets = reinterpret_cast< boost::uint64_t const* >( data + offsetsOffset );
+	boost::int32_t  const* const labels  = reinterpret_cast< boost::int32_t  const* >( data + labelsOffset  );
+	boost::uint32_t const* const indices = reinterpret_cast< boost::uint32_t const* >( data + indicesOffset );
+	float           const* const values  = reinterpret_cast< float           const* >( data + valuesOffset  );
+
+	if ( ( offsets[ 0 ] != 0 ) || ( offsets[ rows ] != nonzeros ) )
+		throw std::runtime_error( "Dataset file contains invalid offsets" );
+	for ( boost::uint64_t ii = 0; ii < rows; ++ii )
+		if ( offsets[ ii ] > offsets[ ii + 1 ] )
+			throw std::runtime_error( "Dataset file contains invalid offsets" );
+	for ( boost::uint64_t ii = 0; ii < nonzeros; ++ii )
+		if ( indices[ ii ] >= header.columns )
+			throw std::runtime_error( "Dataset file contains an out-of-range index" );
+
+	pDataset->rows = header.rows;
+	pDataset->columns = header.columns;
+	pDataset->labels.assign( labels, labels + rows );
+	pDataset->values.assign( values, values + nonzeros );
+	pDataset->indices.assign( indices, indices + nonzeros );
+	pDataset->offsets.assign( offsets, offsets + rows + 1 );
+
+	pDataset->bytes = size;
+	pDataset->seconds = ElapsedSeconds( start );
+
+	return true;
+}
+
+
+void WriteDatasetFile(
+	SVMLightDataset const& dataset,
+	std::string const& filename,
+	DatasetFileSource const* const pSource
+)
+{
+	BOOST_ASSERT( dataset.labels.size() == dataset.rows );
+	BOOST_ASSERT( dataset.offsets.size() == dataset.rows + 1 );
+	BOOST_ASSERT( dataset.indices.size() == dataset.values.size() );
+
+	DatasetFileHeader header;
+	std::memset( &header, 0, sizeof( header ) );
+	std::memcpy( header.magic, DATASET_FILE_MAGIC, sizeof( header.magic ) );
+	header.version = DATASET_FILE_VERSION;
+	header.byteOrder = DATASET_FILE_BYTE_ORDER;
+	header.rows = dataset.rows;
+	header.columns = dataset.columns;
+	header.nonzeros = dataset.values.size();
+	if ( pSource != NULL )
+		header.source = *pSource;
+
+	// write to a temporary file, and rename it only once it's complete, so that readers never see a partial file
+	std::string const temporary = filename + ".tmp";
+	FILE* file = fopen( temporary.c_str(), "wb" );
+	if ( file == NULL )
+		throw std::runtime_error( "Unable to open dataset file for writing" );
+
+	try {
+
+		boost::crc_32_type headerCRC;
+		boost::crc_32_type crc;
+		boost::uint64_t offset = 0;
+
+		DatasetFileWrite( file, &headerCRC, &header, sizeof( header ) );
+		offset += sizeof( header );
+
+		DatasetFilePad( file, &crc, &offset );
+		DatasetFileWriteArray< boost::uint64_t >( file, &crc, &offset, &dataset.offsets[ 0 ], dataset.offsets.size() );
+		DatasetFilePad( file, &crc, &offset );
+		DatasetFileWriteArray< boost::int32_t  >( file, &crc, &offset, VectorData( dataset.labels ), dataset.labels.size() );
+		DatasetFilePad( file, &crc, &offset );
+		DatasetFileWriteArray< boost::uint32_t >( file, &crc, &offset, VectorData( dataset.indices ), dataset.indices.size() );
+		DatasetFilePad( file, &crc, &offset );
+		DatasetFileWriteArray< float           >( file, &crc, &offset, VectorData( dataset.values ), dataset.values.size() );
+
+		header.dataChecksum = crc.checksum();
+		headerCRC.reset();
+		headerCRC.process_bytes( &header, offsetof( DatasetFileHeader, checksum ) );
+		header.checksum = headerCRC.checksum();
+
+		if ( fseek( file, 0, SEEK_SET ) != 0 )
+			throw std::runtime_error( "Unable to write dataset file" );
+		DatasetFileWrite( file, &headerCRC, &header, sizeof( header ) );
+	}
+	catch( ... ) {
+
+		fclose( file );
+		std::remove( temporary.c_str() );
+		throw;
+	}
+
+	if ( fclose( file ) != 0 ) {
+
+		std::remove( temporary.c_str() );
+		throw std::runtime_error( "Unable to write dataset file" );
+	}
+	if ( std::rename( temporary.c_str(), filename.c_str() ) != 0 ) {
+
+		std::remove( temporary.c_str() );
+		throw std::runtime_error( "Unable to rename temporary dataset file" );
+	}
+}
+
+
+
+
+//============================================================================
+//    ReadDataset function
+//============================================================================
+
+
+void ReadDataset(
+	SVMLightDataset* const pDataset,
+	std::string const& files,
+	unsigned int threads,
+	bool const cache
+)
+{
+	boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+
+	if ( threads == 0 )
+		threads = std::max( boost::thread::hardware_concurrency(), 1u );
+
+	std::vector< std::string > const filenames = ExpandDatasetFiles( files );
+	std::vector< SVMLightDataset > shards( filenames.size() );
+
+	// each worker reads one shard at a time, on its share of the threads
+	{	unsigned int const workers = static_cast< unsigned int >( std::min( filenames.size(), static_cast< size_t >( threads ) ) );
+
+		ShardQueue queue;
+		queue.pFiles = &filenames;
+		queue.pShards = &shards;
+		queue.threads = std::max( threads / workers, 1u );
+		queue.cache = cache;
+		queue.errors.resize( filenames.size() );
+		queue.failed.resize( filenames.size(), false );
+		queue.next = 0;
+
+		boost::thread_group group;
+		for ( unsigned int ii = 1; ii < workers; ++ii )
+			group.create_thread( boost::bind( &ShardWorker, &queue ) );
+		ShardWorker( &queue );
+		group.join_all();
+
+		for ( size_t ii = 0; ii < filenames.size(); ++ii )
+			if ( queue.failed[ ii ] )
+				throw std::runtime_error( queue.errors[ ii ] + " (in \"" + filenames[ ii ] + "\")" );
+	}
+
+	double bytes = 0;
+	if ( shards.size() == 1 ) {
+
+		bytes = shards[ 0 ].bytes;
+		std::swap( pDataset->rows, shards[ 0 ].rows );
+		std::swap( pDataset->columns, shards[ 0 ].columns );
+		pDataset->labels.swap( shards[ 0 ].labels );
+		pDataset->values.swap( shards[ 0 ].values );
+		pDataset->indices.swap( shards[ 0 ].indices );
+		pDataset->offsets.swap( shards[ 0 ].offsets );
+	}
+	else {
+
+		size_t rows = 0;
+		size_t nonzeros = 0;
+		pDataset->columns = 0;
+		for ( size_t ii = 0; ii < shards.size(); ++ii ) {
+
+			rows += shards[ ii ].rows;
+			nonzeros += shards[ ii ].values.size();
+			pDataset->columns = std::max( pDataset->columns, shards[ ii ].columns );
+		}
+		if ( rows > std::numeric_limits< unsigned int >::max() )
+			throw std::runtime_error( "Dataset contains too many rows" );
+		pDataset->rows = rows;
+
+		pDataset->labels.clear();
+		pDataset->values.clear();
+		pDataset->indices.clear();
+		pDataset->offsets.clear();
+		pDataset->labels.reserve( rows );
+		pDataset->values.reserve( nonzeros );
+		pDataset->indices.reserve( nonzeros );
+		pDataset->offsets.reserve( rows + 1 );
+		pDataset->offsets.push_back( 0 );
+
+		for ( size_t ii = 0; ii < shards.size(); ++ii ) {
+
+			SVMLightDataset& shard = shards[ ii ];
+			bytes += shard.bytes;
+
+			size_t const base = pDataset->values.size();
+			pDataset->labels.insert( pDataset->labels.end(), shard.labels.begin(), shard.labels.end() );
+			pDataset->values.insert( pDataset->values.end(), shard.values.begin(), shard.values.end() );
+			pDataset->indices.insert( pDataset->indices.end(), shard.indices.begin(), shard.indices.end() );
+			for ( size_t jj = 1; jj < shard.offsets.size(); ++jj )
+				pDataset->offsets.push_back( shard.offsets[ jj ] + base );
+
+			// free each shard's memory as soon as it has been copied
+			shard = SVMLightDataset();
+		}
+	}
+
+	pDataset->bytes = bytes;
+	pDataset->seconds = ElapsedSeconds( start );
+}
+
+
+std::vector< std::string > const ExpandDatasetFiles( std::string const& files ) {
+
+	std::vector< std::string > patterns;
+	boost::split( patterns, files, boost::is_any_of( "," ) );
+
+	std::vector< std::string > filenames;
+	for ( std::vector< std::string >::iterator ii = patterns.begin(); ii != patterns.end(); ++ii ) {
+
+		boost::trim( *ii );
+		if ( ii->empty() )
+			continue;
+
+		// patterns which match nothing are kept, so that opening them fails with the usual error
+		glob_t matches;
+		if ( glob( ii->c_str(), GLOB_NOCHECK, NULL, &matches ) != 0 ) {
+
+			globfree( &matches );
+			throw std::runtime_error( "Unable to expand dataset file pattern" );
+		}
+		filenames.insert( filenames.end(), matches.gl_pathv, matches.gl_pathv + matches.gl_pathc );
+		globfree( &matches );
+	}
+
+	// don't read a cache as well as the file of which it is a cache (e.g. if the pattern was "*")
+	std::set< std::string > const names( filenames.begin(), filenames.end() );
+	std::string const suffix( DATASET_FILE_CACHE_SUFFIX );
+	std::vector< std::string > result;
+	for ( std::vector< std::string >::const_iterator ii = filenames.begin(); ii != filenames.end(); ++ii ) {
+
+		if (
+			boost::ends_with( *ii, suffix ) &&
+			( names.find( ii->substr( 0, ii->size() - suffix.size() ) ) != names.end() )
+		)
+		{
+			continue;
+		}
+		result.push_back( *ii );
+	}
+
+	if ( result.empty() )
+		throw std::runtime_error( "You must provide a dataset file" );
+
+	return result;
+}
@@ -0,0 +1,162 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file dataset_file.hpp
+	\brief definition of the binary dataset file layout, and ReadDataset function
+*/
+
+
+
+
+#ifndef __DATASET_FILE_HPP__
+#define __DATASET_FILE_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include "svmlight_reader.hpp"
+
+#include <boost/static_assert.hpp>
+#include <boost/cstdint.hpp>
+
+#include <string>
+#include <vector>
+
+
+
+
+//============================================================================
+//    Dataset file layout
+//============================================================================
+
+
+/*
+	A binary dataset file is a DatasetFileHeader, followed by the rows + 1
+	boost::uint64_t offsets, the rows boost::int32_t labels, the nonzeros
+	boost::uint32_t indices, and the nonzeros float values, each starting at
+	a multiple of DATASET_FILE_ALIGNMENT bytes. Everything is stored in
+	little-endian order, which is checked by means of the byteOrder field.
+
+	A cache is a dataset file written next to the SVM-Light file from which
+	it was parsed, with DATASET_FILE_CACHE_SUFFIX appended to its name. It is
+	used only if the size and modification time of the SVM-Light file are
+	those recorded in its header. The tools only read and write caches when
+	asked to (by "--cache 1"), since the SVM-Light file's directory might be
+	read-only or shared. Dataset files written by gtsvm_convert have no
+	source, and zeros in these fields.
+*/
+
+
+#define DATASET_FILE_MAGIC "GTSVMDAT"
+#define DATASET_FILE_VERSION 1
+#define DATASET_FILE_BYTE_ORDER 0x01020304u
+#define DATASET_FILE_ALIGNMENT 64
+#define DATASET_FILE_CACHE_SUFFIX ".gtsvm_cache"
+
+
+struct DatasetFileSource {
+
+	boost::uint64_t size;
+	boost::int64_t modificationTime;
+};
+
+
+struct DatasetFileHeader {
+
+	char magic[ 8 ];
+	boost::uint32_t version;
+	boost::uint32_t byteOrder;
+
+	boost::uint32_t rows;
+	boost::uint32_t columns;
+	boost::uint64_t nonzeros;
+
+	DatasetFileSource source;
+
+	boost::uint32_t dataChecksum;    // CRC-32 of everything after the header
+	boost::uint32_t checksum;        // CRC-32 of everything above
+	boost::uint32_t reserved[ 2 ];
+};
+
+
+BOOST_STATIC_ASSERT( sizeof( DatasetFileHeader ) == 64 );
+
+
+
+
+//============================================================================
+//    DatasetFile functions
+//============================================================================
+
+
+DatasetFileSource const GetDatasetFileSource( std::string const& filename );
+
+bool const IsDatasetFile( std::string const& filename );
+
+
+/*
+	If pSource is non-NULL, and the file wasn't created from a source with
+	the given size and modification time, then returns false without
+	touching *pDataset. Throws if the file is not a valid dataset file.
+*/
+bool const ReadDatasetFile(
+	SVMLightDataset* const pDataset,
+	std::string const& filename,
+	DatasetFileSource const* const pSource
+);
+
+// if pSource is NULL, then the file is recorded as having no source
+void WriteDatasetFile(
+	SVMLightDataset const& dataset,
+	std::string const& filename,
+	DatasetFileSource const* const pSource
+);
+
+
+
+
+//============================================================================
+//    ReadDataset function
+//============================================================================
+
+
+/*
+	Splits "files" on commas, and expands each piece as a glob pattern. The
+	resulting shards (each either a dataset file, or an SVM-Light file) are
+	read concurrently, on a total of "threads" threads (zero means one per
+	core), and concatenated in order. If "cache" is true, then SVM-Light
+	files are read from, or written to, their caches.
+*/
+void ReadDataset(
+	SVMLightDataset* const pDataset,
+	std::string const& files,
+	unsigned int threads,
+	bool const cache
+);
+
+std::vector< std::string > const ExpandDatasetFiles( std::string const& files );
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __DATASET_FILE_HPP__ */
@@ -0,0 +1,429 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file gtsvm_bench.cpp
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+//============================================================================
+//    Helper functions
+//============================================================================
+
+
+namespace {
+
+
+double const ElapsedSeconds( boost::posix_time::ptime const& start ) {
+
+	return( ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds() * 1e-6 );
+}
+
+
+// JSON has no representation for infinities or NaNs
+std::string const JSONNumber( double const value ) {
+
+	if ( ! boost::math::isfinite( value ) )
+		return "null";
+	std::ostringstream stream;
+	stream.precision( std::numeric_limits< double >::digits10 );
+	stream << value;
+	return stream.str();
+}
+
+
+std::string const JSONString( std::string const& value ) {
+
+	std::string result( "\"" );
+	for ( std::string::const_iterator ii = value.begin(); ii != value.end(); ++ii ) {
+
+		if ( ( *ii == '"' ) || ( *ii == '\\' ) )
+			result += '\\';
+		if ( static_cast< unsigned char >( *ii ) >= 0x20 )
+			result += *ii;
+	}
+	result += '"';
+	return result;
+}
+
+
+void Subset( SVMLightDataset* const pSubset, SVMLightDataset const& dataset, unsigned int const begin, unsigned int const end ) {
+
+	size_t const offset = dataset.offsets[ begin ];
+
+	pSubset->rows = end - begin;
+	pSubset->columns = dataset.columns;
+	pSubset->labels.assign( dataset.labels.begin() + begin, dataset.labels.begin() + end );
+	pSubset->values.assign( dataset.values.begin() + offset, dataset.values.begin() + dataset.offsets[ end ] );
+	pSubset->indices.assign( dataset.indices.begin() + offset, dataset.indices.begin() + dataset.offsets[ end ] );
+	pSubset->offsets.resize( pSubset->rows + 1 );
+	for ( unsigned int ii = begin; ii <= end; ++ii )
+		pSubset->offsets[ ii - begin ] = dataset.offsets[ ii ] - offset;
+	pSubset->bytes = 0;
+	pSubset->seconds = 0;
+}
+
+
+void Densify( std::vector< float >* const pDense, SVMLightDataset const& dataset ) {
+
+	pDense->assign( static_cast< size_t >( dataset.rows ) * dataset.columns, 0 );
+	for ( unsigned int ii = 0; ii < dataset.rows; ++ii )
+		for ( size_t jj = dataset.offsets[ ii ]; jj < dataset.offsets[ ii + 1 ]; ++jj )
+			( *pDense )[ static_cast< size_t >( ii ) * dataset.columns + dataset.indices[ jj ] ] = dataset.values[ jj ];
+}
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    main function
+//============================================================================
+
+
+int main( int argc, char* argv[] ) {
+
+	int resultCode = EXIT_SUCCESS;
+
+	SyntheticDatasetParameters parameters;
+	unsigned int testRows;
+	float regularization;
+	float gamma = std::numeric_limits< float >::quiet_NaN();
+	unsigned int iterations;
+	std::string columnOrderName;
+	std::string clusteringName;
+	bool smallClusters;
+	unsigned int activeClusters;
+	bool dense;
+	std::string model;
+	std::string label;
+	std::string backend;
+	unsigned int threads;
+	unsigned int batchSize;
+	bool shrinking;
+
+	boost::program_options::options_description description( "Allowed options" );
+	description.add_options()
+		( "help,h", "display this help" )
+		( "rows,r", boost::program_options::value< unsigned int >( &parameters.rows )->default_value( 10000 ), "number of training rows" )
+		( "test_rows,t", boost::program_options::value< unsigned int >( &testRows )->default_value( 5000 ), "number of testing rows" )
+		( "columns,c", boost::program_options::value< unsigned int >( &parameters.columns )->default_value( 1000 ), "number of columns" )
+		( "density,d", boost::program_options::value< double >( &parameters.density )->default_value( 0.01 ), "fraction of the columns which are nonzero in each row (1 = dense)" )
+		( "classes,k", boost::program_options::value< unsigned int >( &parameters.classes )->default_value( 2 ), "number of classes" )
+		( "noise,p", boost::program_options::value< double >( &parameters.noise )->default_value( 0.05 ), "probability that each label is replaced with a random one" )
+		( "seed", boost::program_options::value< boost::uint32_t >( &parameters.seed )->default_value( 0 ), "random seed" )
+		( "regularization,C", boost::program_options::value< float >( &regularization )->default_value( 1 ), "regularization parameter" )
+		( "gamma,1", boost::program_options::value< float >( &gamma ), "Gaussian kernel parameter (default: one over the number of nonzeros in each row)" )
+		( "iterations,n", boost::program_options::value< unsigned int >( &iterations )->default_value( 4096 ), "number of optimization iterations" )
+		( "column_order", boost::program_options::value< std::string >( &columnOrderName )->default_value( "original" ), "order of the (used) columns: \"original\" or \"cooccurrence\"" )
+		( "clustering", boost::program_options::value< std::string >( &clusteringName )->default_value( "greedy" ), "clustering algorithm: \"greedy\" or \"minhash\"" )
+		( "small_clusters,s", boost::program_options::value< bool >( &smallClusters )->default_value( false ), "use size-16 instead of size-256 clusters?" )
+		( "active_clusters,a", boost::program_options::value< unsigned int >( &activeClusters )->default_value( 64 ), "number of \"active\" clusters" )
+		( "dense", boost::program_options::value< bool >( &dense )->default_value( false ), "use the dense, instead of sparse, initialization and classification functions?" )
+		( "model,m", boost::program_options::value< std::string >( &model )->default_value( "gtsvm_bench.mdl" ), "temporary model file, used to time saving and loading" )
+		( "label,l", boost::program_options::value< std::string >( &label )->default_value( "" ), "label included in the output (e.g. a commit hash)" )
+		( "backend", boost::program_options::value< std::string >( &backend )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used by the cpu backend (0 = one per core)" )
+		( "batch_size", boost::program_options::value< unsigned int >( &batchSize )->default_value( 16 ), "number of training vectors optimized over at each iteration: 8, 16, 32, 64 or 128 (only 16 on the cuda backend)" )
+		( "shrinking", boost::program_options::value< bool >( &shrinking )->default_value( false ), "shrink the active set while optimizing (binary problems only)?" )
+	;
+
+	try {
+
+		boost::program_options::variables_map variables;
+		boost::program_options::store( boost::program_options::command_line_parser( argc, argv ).options( description ).run(), variables );
+		boost::program_options::notify( variables );
+
+		if ( variables.count( "help" ) ) {
+
+			std::cout <<
+				"Times each step of training and classification on a synthetic dataset (see" << std::endl <<
+				"gtsvm_generate), using a Gaussian kernel, and writes the results to standard" << std::endl <<
+				"output as a single-line JSON object. Times are in seconds. The clustering time" << std::endl <<
+				"is the difference between the times taken to load the model with, and without," << std::endl <<
+				"re-clustering it." << std::endl <<
+				std::endl <<
+				"To choose a batch size, run this once for each of 8, 16, 32, 64 and 128 on data" << std::endl <<
+				"like yours, and compare the optimization times, and the objective values which" << std::endl <<
+				"they reached: larger batches do more work per iteration, but each pass over the" << std::endl <<
+				"training set is shared by more of them." << std::endl <<
+				std::endl <<
+				description << std::endl;
+		}
+		else {
+
+			if ( testRows < 1 )
+				throw std::runtime_error( "There must be at least one testing row" );
+
+			boost::posix_time::ptime start;
+
+			SVMLightDataset training;
+			SVMLightDataset testing;
+			double generateSeconds;
+			{	start = boost::posix_time::microsec_clock::universal_time();
+				SyntheticDatasetParameters allParameters( parameters );
+				allParameters.rows += testRows;
+				SVMLightDataset data;
+				GenerateSyntheticDataset( &data, allParameters );
+				generateSeconds = ElapsedSeconds( start );
+
+				Subset( &training, data, 0, parameters.rows );
+				Subset( &testing, data, parameters.rows, data.rows );
+			}
+			if ( ! variables.count( "gamma" ) )
+				gamma = static_cast< float >( training.rows ) / training.values.size();
+
+			std::vector< float > trainingDense;
+			std::vector< float > testingDense;
+			if ( dense ) {
+
+				Densify( &trainingDense, training );
+				Densify( &testingDense, testing );
+			}
+
+			GTSVM_ColumnOrder const columnOrder = ParseColumnOrder( columnOrderName );
+			GTSVM_Clustering const clustering = ParseClustering( clusteringName );
+
+			AutoContext context( backend, threads );
+			if ( GTSVM_SetBatchSize( context, batchSize ) )
+				throw std::runtime_error( GTSVM_Error() );
+			if ( GTSVM_SetShrinking( context, shrinking ) )
+				throw std::runtime_error( GTSVM_Error() );
+
+			start = boost::posix_time::microsec_clock::universal_time();
+			if ( dense ) {
+
+				if (
+					GTSVM_InitializeDense(
+						context,
+						&trainingDense[ 0 ],
+						GTSVM_TYPE_FLOAT,
+						&training.labels[ 0 ],
+						GTSVM_TYPE_INT32,
+						training.rows,
+						training.columns,
+						false,
+						( parameters.classes > 2 ),
+						regularization,
+						GTSVM_KERNEL_GAUSSIAN,
+						gamma,
+						0,
+						0,
+						false,
+						columnOrder,
+						clustering,
+						smallClusters,
+						activeClusters
+					)
+				)
+				{
+					throw std::runtime_error( GTSVM_Error() );
+				}
+			}
+			else {
+
+				if (
+					GTSVM_InitializeSparse(
+						context,
+						&training.values[ 0 ],
+						&training.indices[ 0 ],
+						&training.offsets[ 0 ],
+						GTSVM_TYPE_FLOAT,
+						&training.labels[ 0 ],
+						GTSVM_TYPE_INT32,
+						training.rows,
+						training.columns,
+						false,
+						( parameters.classes > 2 ),
+						regularization,
+						GTSVM_KERNEL_GAUSSIAN,
+						gamma,
+						0,
+						0,
+						false,
+						columnOrder,
+						clustering,
+						smallClusters,
+						activeClusters
+					)
+				)
+				{
+					throw std::runtime_error( GTSVM_Error() );
+				}
+			}
+			double const initializeSeconds = ElapsedSeconds( start );
+
+			double primal =  std::numeric_limits< double >::infinity();
+			double dual   = -std::numeric_limits< double >::infinity();
+			unsigned int const repetitions = 256;    // must be a multiple of the batch size
+			unsigned int performedIterations = 0;
+			start = boost::posix_time::microsec_clock::universal_time();
+			for ( ; performedIterations < iterations; performedIterations += repetitions ) {
+
+				if (
+					GTSVM_Optimize(
+						context,
+						&primal,
+						&dual,
+						repetitions
+					)
+				)
+				{
+					throw std::runtime_error( GTSVM_Error() );
+				}
+			}
+			double const optimizeSeconds = ElapsedSeconds( start );
+
+			start = boost::posix_time::microsec_clock::universal_time();
+			if ( GTSVM_Recalculate( context ) )
+				throw std::runtime_error( GTSVM_Error() );
+			double const recalculateSeconds = ElapsedSeconds( start );
+
+			start = boost::posix_time::microsec_clock::universal_time();
+			if ( GTSVM_Save( context, model.c_str() ) )
+				throw std::runtime_error( GTSVM_Error() );
+			double const saveSeconds = ElapsedSeconds( start );
+
+			start = boost::posix_time::microsec_clock::universal_time();
+			if ( GTSVM_Load( context, model.c_str(), clustering, smallClusters, activeClusters + 1 ) )
+				throw std::runtime_error( GTSVM_Error() );
+			double const reclusterSeconds = ElapsedSeconds( start );
+
+			start = boost::posix_time::microsec_clock::universal_time();
+			if ( GTSVM_Load( context, model.c_str(), clustering, smallClusters, activeClusters ) )
+				throw std::runtime_error( GTSVM_Error() );
+			double const loadSeconds = ElapsedSeconds( start );
+
+			std::remove( model.c_str() );
+
+			unsigned int classes;
+			if ( GTSVM_GetClasses( context, &classes ) )
+				throw std::runtime_error( GTSVM_Error() );
+
+			std::vector< double > result( static_cast< size_t >( testing.rows ) * classes );
+			start = boost::posix_time::microsec_clock::universal_time();
+			if ( dense ) {
+
+				if (
+					GTSVM_ClassifyDense(
+						context,
+						&result[ 0 ],
+						GTSVM_TYPE_DOUBLE,
+						&testingDense[ 0 ],
+						GTSVM_TYPE_FLOAT,
+						testing.rows,
+						testing.columns,
+						false
+					)
+				)
+				{
+					throw std::runtime_error( GTSVM_Error() );
+				}
+			}
+			else {
+
+				if (
+					GTSVM_ClassifySparse(
+						context,
+						&result[ 0 ],
+						GTSVM_TYPE_DOUBLE,
+						&testing.values[ 0 ],
+						&testing.indices[ 0 ],
+						&testing.offsets[ 0 ],
+						GTSVM_TYPE_FLOAT,
+						testing.rows,
+						testing.columns,
+						false
+					)
+				)
+				{
+					throw std::runtime_error( GTSVM_Error() );
+				}
+			}
+			double const classifySeconds = ElapsedSeconds( start );
+
+			unsigned int correct = 0;
+			for ( unsigned int ii = 0; ii < testing.rows; ++ii ) {
+
+				double const* const row = &result[ static_cast< size_t >( ii ) * classes ];
+				boost::int32_t predicted;
+				if ( classes == 1 )
+					predicted = ( ( row[ 0 ] >= 0 ) ? 1 : -1 );
+				else
+					predicted = std::max_element( row, row + classes ) - row;
+				if ( predicted == testing.labels[ ii ] )
+					++correct;
+			}
+
+			std::cout <<
+				"{\"label\":" << JSONString( label ) <<
+				",\"backend\":" << JSONString( backend ) <<
+				",\"threads\":" << threads <<
+				",\"batch_size\":" << batchSize <<
+				",\"shrinking\":" << ( shrinking ? "true" : "false" ) <<
+				",\"rows\":" << training.rows <<
+				",\"test_rows\":" << testing.rows <<
+				",\"columns\":" << training.columns <<
+				",\"density\":" << JSONNumber( parameters.density ) <<
+				",\"nonzeros\":" << training.values.size() <<
+				",\"classes\":" << parameters.classes <<
+				",\"noise\":" << JSONNumber( parameters.noise ) <<
+				",\"seed\":" << parameters.seed <<
+				",\"dense\":" << ( dense ? "true" : "false" ) <<
+				",\"column_order\":" << JSONString( columnOrderName ) <<
+				",\"clustering\":" << JSONString( clusteringName ) <<
+				",\"small_clusters\":" << ( smallClusters ? "true" : "false" ) <<
+				",\"active_clusters\":" << activeClusters <<
+				",\"regularization\":" << JSONNumber( regularization ) <<
+				",\"gamma\":" << JSONNumber( gamma ) <<
+				",\"iterations\":" << performedIterations <<
+				",\"seconds\":{" <<
+					"\"generate\":" << JSONNumber( generateSeconds ) <<
+					",\"initialize\":" << JSONNumber( initializeSeconds ) <<
+					",\"optimize\":" << JSONNumber( optimizeSeconds ) <<
+					",\"recalculate\":" << JSONNumber( recalculateSeconds ) <<
+					",\"save\":" << JSONNumber( saveSeconds ) <<
+					",\"load\":" << JSONNumber( loadSeconds ) <<
+					",\"cluster\":" << JSONNumber( std::max( reclusterSeconds - loadSeconds, 0.0 ) ) <<
+					",\"classify\":" << JSONNumber( classifySeconds ) <<
+				"}" <<
+				",\"optimize_iterations_per_second\":" << JSONNumber( performedIterations / optimizeSeconds ) <<
+				",\"classify_rows_per_second\":" << JSONNumber( testing.rows / classifySeconds ) <<
+				",\"primal\":" << JSONNumber( primal ) <<
+				",\"dual\":" << JSONNumber( dual ) <<
+				",\"test_accuracy\":" << JSONNumber( static_cast< double >( correct ) / testing.rows ) <<
+				"}" << std::endl;
+		}
+	}
+	catch( std::exception& error ) {
+
+		std::cerr << "Error: " << error.what() << std::endl << std::endl << description << std::endl;
+		resultCode = EXIT_FAILURE;
+	}
+
+	return resultCode;
+}
@@ -28,6 +28,217 @@
 
 
 
+//============================================================================
+//    Helper functions
+//============================================================================
+
+
+namespace {
+
+
+void Classify( double* const result, GTSVM_Context const context, unsigned int const classes, SVMLightDataset const& data ) {
+
+	if ( data.rows == 0 )
+		return;
+
+	if (
+		GTSVM_ClassifySparse(
+			context,
+			result,
+			GTSVM_TYPE_DOUBLE,
+			&data.values[ 0 ],
+			&data.indices[ 0 ],
+			&data.offsets[ 0 ],
+			GTSVM_TYPE_FLOAT,
+			data.rows,
+			data.columns,
+			false
+		)
+	)
+	{
+		throw std::runtime_error( GTSVM_Error() );
+	}
+}
+
+
+void WriteResults( std::ostream& stream, double const* const result, unsigned int const rows, unsigned int const classes ) {
+
+	for ( unsigned int ii = 0; ii < rows; ++ii ) {
+
+		stream << result[ ii * classes + 0 ];
+		for ( unsigned int jj = 1; jj < classes; ++jj )
+			stream << ", " << result[ ii * classes + jj ];
+		stream << std::endl;
+	}
+	if ( stream.fail() )
+		throw std::runtime_error( "Unable to write output file" );
+}
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    Streaming classification
+//============================================================================
+
+
+namespace {
+
+
+typedef boost::shared_ptr< SVMLightDataset > Chunk;
+
+
+struct Results {
+
+	boost::shared_array< double > values;
+	unsigned int rows;
+};
+
+
+/*
+	The three stages of the pipeline: parsing, classification and writing.
+	Each stage records its error (if any), and closes its queues, which
+	causes the other stages to finish.
+*/
+struct Pipeline {
+
+	Pipeline() : chunks( 2 ), results( 2 ), failed( false ), rows( 0 ), bytes( 0 ) {}
+
+	BoundedQueue< Chunk > chunks;
+	BoundedQueue< Results > results;
+
+	boost::mutex mutex;
+	bool failed;
+	std::string error;
+
+	size_t rows;
+	double bytes;
+
+	void Fail( std::exception const& exception ) {
+
+		boost::mutex::scoped_lock lock( mutex );
+		if ( ! failed ) {
+
+			failed = true;
+			error = exception.what();
+		}
+	}
+};
+
+
+void ParseStage( Pipeline* const pPipeline, std::vector< std::string > const* const pFilenames, size_t const chunkSize, unsigned int const threads ) {
+
+	try {
+
+		std::vector< std::string >::const_iterator ii    = pFilenames->begin();
+		std::vector< std::string >::const_iterator iiEnd = pFilenames->end();
+		for ( ; ii != iiEnd; ++ii ) {
+
+			if ( IsDatasetFile( *ii ) )
+				throw std::runtime_error( "Only SVM-Light files can be classified in streaming mode" );
+
+			SVMLightStream stream( *ii, chunkSize, threads );
+			for ( ; ; ) {
+
+				Chunk chunk( new SVMLightDataset );
+				if ( ! stream.Read( chunk.get() ) )
+					break;
+				pPipeline->bytes += chunk->bytes;
+				if ( ! pPipeline->chunks.Push( chunk ) )
+					return;
+			}
+		}
+	}
+	catch( std::exception& error ) {
+
+		pPipeline->Fail( error );
+	}
+	pPipeline->chunks.Close();
+}
+
+
+void WriteStage( Pipeline* const pPipeline, std::ostream* const pStream, unsigned int const classes ) {
+
+	try {
+
+		Results results;
+		while ( pPipeline->results.Pop( &results ) )
+			WriteResults( *pStream, results.values.get(), results.rows, classes );
+	}
+	catch( std::exception& error ) {
+
+		pPipeline->Fail( error );
+	}
+	pPipeline->results.Close();
+}
+
+
+}    // anonymous namespace
+
+
+/*
+	Parses, classifies and writes the dataset in chunks of about chunkSize
+	bytes. At most two parsed chunks and two chunks of results are queued
+	between the stages, so memory usage doesn't depend on the size of the
+	dataset.
+*/
+void StreamClassify(
+	std::ostream& stream,
+	GTSVM_Context const context,
+	unsigned int const classes,
+	std::vector< std::string > const& filenames,
+	size_t const chunkSize,
+	unsigned int const threads
+)
+{
+	boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+
+	Pipeline pipeline;
+	boost::thread parser( boost::bind( &ParseStage, &pipeline, &filenames, chunkSize, threads ) );
+	boost::thread writer( boost::bind( &WriteStage, &pipeline, &stream, classes ) );
+
+	try {
+
+		Chunk chunk;
+		while ( pipeline.chunks.Pop( &chunk ) ) {
+
+			Results results;
+			results.rows = chunk->rows;
+			results.values.reset( new double[ chunk->rows * classes ] );
+			Classify( results.values.get(), context, classes, *chunk );
+			pipeline.rows += chunk->rows;
+
+			chunk.reset();
+			if ( ! pipeline.results.Push( results ) )
+				break;
+		}
+	}
+	catch( std::exception& error ) {
+
+		pipeline.Fail( error );
+	}
+	pipeline.chunks.Close();
+	pipeline.results.Close();
+
+	parser.join();
+	writer.join();
+
+	if ( pipeline.failed )
+		throw std::runtime_error( pipeline.error );
+
+	double const seconds = ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds() * 1e-6;
+	double const megabytes = pipeline.bytes / ( 1 << 20 );
+	std::cout <<
+		"Classified " << pipeline.rows << " rows (" << megabytes << " MB) in " << seconds << " seconds (" <<
+		( ( seconds > 0 ) ? megabytes / seconds : 0 ) << " MB/s)" << std::endl;
+}
+
+
+
+
 //============================================================================
 //    main function
 //============================================================================
@@ -40,17 +251,31 @@ int main( int argc, char* argv[] ) {
 	std::string dataset;
 	std::string input;
 	std::string output;
+	std::string clusteringName;
 	bool smallClusters;
 	unsigned int activeClusters;
+	std::string backend;
+	unsigned int threads;
+	unsigned int batchSize;
+	bool cache;
+	bool stream;
+	unsigned int chunkMegabytes;
 
 	boost::program_options::options_description description( "Allowed options" );
 	description.add_options()
 		( "help,h", "display this help" )
-		( "file,f", boost::program_options::value< std::string >( &dataset ), "dataset file (SVM-Light format)" )
+		( "file,f", boost::program_options::value< std::string >( &dataset ), "dataset file(s), in SVM-Light or binary format (a comma-separated list of glob patterns)" )
 		( "input,i", boost::program_options::value< std::string >( &input ), "input model file" )
 		( "output,o", boost::program_options::value< std::string >( &output ), "output text file" )
+		( "clustering", boost::program_options::value< std::string >( &clusteringName )->default_value( "greedy" ), "clustering algorithm: \"greedy\" or \"minhash\"" )
 		( "small_clusters,s", boost::program_options::value< bool >( &smallClusters )->default_value( false ), "use size-16 instead of size-256 clusters?" )
 		( "active_clusters,a", boost::program_options::value< unsigned int >( &activeClusters )->default_value( 64 ), "number of \"active\" clusters" )
+		( "backend", boost::program_options::value< std::string >( &backend )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used to read the dataset, and by the cpu backend (0 = one per core)" )
+		( "batch_size", boost::program_options::value< unsigned int >( &batchSize )->default_value( 16 ), "number of vectors classified at a time: 8, 16, 32, 64 or 128 (only 16 on the cuda backend)" )
+		( "cache", boost::program_options::value< bool >( &cache )->default_value( false ), "read SVM-Light files from, and write them to, binary caches alongside them?" )
+		( "stream", boost::program_options::value< bool >( &stream )->default_value( false ), "classify the dataset one chunk at a time, using bounded memory?" )
+		( "chunk_size", boost::program_options::value< unsigned int >( &chunkMegabytes )->default_value( 16 ), "size of each chunk, in megabytes, in streaming mode" )
 	;
 
 	try {
@@ -78,6 +303,14 @@ int main( int argc, char* argv[] ) {
 				"be active at every point in the greedy clustering algorithm. We have found that" << std::endl <<
 				"64 works well, but increasing this number will improve the quality of the" << std::endl <<
 				"clustering (at the cost of more time being required to find it)." << std::endl <<
+				"Alternatively, clustering may be set to \"minhash\", which ignores" << std::endl <<
+				"active_clusters, and is much faster for data with very many columns, but may" << std::endl <<
+				"find clusters with more nonzero columns in total." << std::endl <<
+				std::endl <<
+				"In streaming mode, the dataset is parsed, classified, and written in chunks," << std::endl <<
+				"with these three steps overlapping, so that memory usage doesn't depend on the" << std::endl <<
+				"size of the dataset. Only SVM-Light files can be streamed, and their binary" << std::endl <<
+				"caches are neither read nor written." << std::endl <<
 				std::endl <<
 				description << std::endl;
 		}
@@ -90,89 +323,25 @@ int main( int argc, char* argv[] ) {
 			if ( ! variables.count( "output" ) )
 				throw std::runtime_error( "You must provide an output file" );
 
-			// load the dataset file
-			unsigned int rows    = 0;
-			unsigned int columns = 0;
-			std::vector< float  > values;
-			std::vector< size_t > indices;
-			std::vector< size_t > offsets;
-			{	unsigned int const bufferSize = ( 1u << 24 );
-				boost::shared_array< char > buffer( new char[ bufferSize ] );
-
-				const boost::regex spaceRegex( "[[:space:]]+" );
-				const boost::regex elementRegex( "^[[:space:]]*([[:digit:]]+):(-?[[:digit:]]+(\\.[[:digit:]]+)?([eE]-?[[:digit:]]+)?)[[:space:]]*$" );
-
-				offsets.push_back( 0 );
-
-				std::ifstream file( dataset.c_str() );
-				if ( file.fail() )
-					throw std::runtime_error( "Unable to open dataset file" );
-				while ( ! file.eof() ) {
-
-					file.getline( buffer.get(), bufferSize );
-					if ( file.fail() )
-						break;
-					std::string lineString( buffer.get() );
-
-					boost::sregex_token_iterator ii(
-						lineString.begin(),
-						lineString.end(),
-						spaceRegex,
-						-1
-					);
-					boost::sregex_token_iterator iiEnd;
-
-					if ( ii != iiEnd ) {    // ignore blank lines
-
-						std::string const signString = ii->str();
-						if ( ii == iiEnd )
-							throw std::runtime_error( "Failed to parse first element of dataset line" );
-						// we don't care about the value of the label, since we're classifying
-
-						int lastIndex = -1;
-						for ( ++ii; ii != iiEnd; ++ii ) {
-
-							std::string const elementString = ii->str();
-							boost::smatch elementMatch;
-							if ( ! boost::regex_match( elementString, elementMatch, elementRegex, boost::match_extra ) )
-								throw std::runtime_error( "Failed to parse element of dataset line" );
-
-							std::string const indexString = elementMatch[ 1 ].str();
-							int index = atoi( indexString.c_str() );
-							std::string const valueString = elementMatch[ 2 ].str();
-							float const value = static_cast< float >( atof( valueString.c_str() ) );
-							if ( index < 0 )
-								throw std::runtime_error( "Failed to parse element of dataset line: negative index encountered" );
-							if ( index <= lastIndex )
-								throw std::runtime_error( "Failed to parse element of dataset line: features must be listed in order of increasing index" );
-							lastIndex = index;
-
-							if ( value != 0 ) {
-
-								values.push_back( value );
-								indices.push_back( index );
-
-								if ( index + 1 > static_cast< int >( columns ) )
-									columns = index + 1;
-							}
-						}
-
-						BOOST_ASSERT( values.size() == indices.size() );
-
-						offsets.push_back( values.size() );
-					}
-				}
-				file.close();
-
-				rows = offsets.size() - 1;
+			// in streaming mode, the dataset is read later, one chunk at a time
+			SVMLightDataset data;
+			if ( ! stream ) {
+
+				ReadDataset( &data, dataset, threads, cache );
+				ReportSVMLight( std::cout, data );
 			}
 
-			AutoContext context;
+			GTSVM_Clustering const clustering = ParseClustering( clusteringName );
+
+			AutoContext context( backend, threads );
+			if ( GTSVM_SetBatchSize( context, batchSize ) )
+				throw std::runtime_error( GTSVM_Error() );
 
 			if (
 				GTSVM_Load(
 					context,
 					input.c_str(),
+					clustering,
 					false,
 					1
 				)
@@ -184,6 +353,7 @@ int main( int argc, char* argv[] ) {
 			if (
 				GTSVM_Shrink(
 					context,
+					clustering,
 					smallClusters,
 					activeClusters
 				)
@@ -203,37 +373,25 @@ int main( int argc, char* argv[] ) {
 				throw std::runtime_error( GTSVM_Error() );
 			}
 
-			boost::shared_array< double > result( new double[ rows * classes ] );
-			if (
-				GTSVM_ClassifySparse(
-					context,
-					result.get(),
-					GTSVM_TYPE_DOUBLE,
-					&values[ 0 ],
-					&indices[ 0 ],
-					&offsets[ 0 ],
-					GTSVM_TYPE_FLOAT,
-					rows,
-					columns,
-					false
-				)
-			)
-			{
-				throw std::runtime_error( GTSVM_Error() );
+			std::ofstream file( output.c_str() );
+			if ( file.fail() )
+				throw std::runtime_error( "Unable to open output file" );
+
+			if ( stream ) {
+
+				size_t const chunkSize = static_cast< size_t >( chunkMegabytes ) << 20;
+				StreamClassify( file, context, classes, ExpandDatasetFiles( dataset ), chunkSize, threads );
 			}
+			else {
 
-			{	std::ofstream file( output.c_str() );
-				if ( file.fail() )
-					throw std::runtime_error( "Unable to open output file" );
-				for ( unsigned int ii = 0; ii < rows; ++ii ) {
-
-					file << result[ ii * classes + 0 ];
-					for ( unsigned int jj = 1; jj < classes; ++jj )
-						file << ", " << result[ ii * classes + jj ];
-					file << std::endl;
-				}
-				file.close();
+				boost::shared_array< double > result( new double[ data.rows * classes ] );
+				Classify( result.get(), context, classes, data );
+				WriteResults( file, result.get(), data.rows, classes );
 			}
+
+			file.close();
+			if ( file.fail() )
+				throw std::runtime_error( "Unable to write output file" );
 		}
 	}
 	catch( std::exception& error ) {
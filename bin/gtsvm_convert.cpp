@@ -0,0 +1,93 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file gtsvm_convert.cpp
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+//============================================================================
+//    main function
+//============================================================================
+
+
+int main( int argc, char* argv[] ) {
+
+	int resultCode = EXIT_SUCCESS;
+
+	std::string dataset;
+	std::string output;
+	unsigned int threads;
+
+	boost::program_options::options_description description( "Allowed options" );
+	description.add_options()
+		( "help,h", "display this help" )
+		( "file,f", boost::program_options::value< std::string >( &dataset ), "dataset file(s), in SVM-Light or binary format (a comma-separated list of glob patterns)" )
+		( "output,o", boost::program_options::value< std::string >( &output ), "output binary dataset file" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used to read the dataset (0 = one per core)" )
+	;
+
+	try {
+
+		boost::program_options::variables_map variables;
+		boost::program_options::store( boost::program_options::command_line_parser( argc, argv ).options( description ).run(), variables );
+		boost::program_options::notify( variables );
+
+		if ( variables.count( "help" ) ) {
+
+			std::cout <<
+				"Converts a dataset (in SVM-Light format) to the binary format, which" << std::endl <<
+				"gtsvm_initialize and gtsvm_classify can read far more quickly. If an output" << std::endl <<
+				"file is given, then all of the input files are concatenated into it." << std::endl <<
+				"Otherwise, a cache is written alongside each input file, which the other tools" << std::endl <<
+				"will use in place of the input file (if run with --cache 1) for as long as the" << std::endl <<
+				"input file is not modified." << std::endl <<
+				std::endl <<
+				description << std::endl;
+		}
+		else {
+
+			if ( ! variables.count( "file" ) )
+				throw std::runtime_error( "You must provide a dataset file" );
+
+			SVMLightDataset data;
+			if ( variables.count( "output" ) ) {
+
+				ReadDataset( &data, dataset, threads, false );
+				WriteDatasetFile( data, output, NULL );
+			}
+			else
+				ReadDataset( &data, dataset, threads, true );
+			ReportSVMLight( std::cout, data );
+		}
+	}
+	catch( std::exception& error ) {
+
+		std::cerr << "Error: " << error.what() << std::endl << std::endl << description << std::endl;
+		resultCode = EXIT_FAILURE;
+	}
+
+	return resultCode;
+}
@@ -0,0 +1,99 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file gtsvm_generate.cpp
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+//============================================================================
+//    main function
+//============================================================================
+
+
+int main( int argc, char* argv[] ) {
+
+	int resultCode = EXIT_SUCCESS;
+
+	std::string output;
+	SyntheticDatasetParameters parameters;
+
+	boost::program_options::options_description description( "Allowed options" );
+	description.add_options()
+		( "help,h", "display this help" )
+		( "output,o", boost::program_options::value< std::string >( &output ), "output dataset file (SVM-Light format)" )
+		( "rows,r", boost::program_options::value< unsigned int >( &parameters.rows )->default_value( 10000 ), "number of rows" )
+		( "columns,c", boost::program_options::value< unsigned int >( &parameters.columns )->default_value( 1000 ), "number of columns" )
+		( "density,d", boost::program_options::value< double >( &parameters.density )->default_value( 0.01 ), "fraction of the columns which are nonzero in each row (1 = dense)" )
+		( "classes,k", boost::program_options::value< unsigned int >( &parameters.classes )->default_value( 2 ), "number of classes" )
+		( "noise,p", boost::program_options::value< double >( &parameters.noise )->default_value( 0 ), "probability that each label is replaced with a random one" )
+		( "seed", boost::program_options::value< boost::uint32_t >( &parameters.seed )->default_value( 0 ), "random seed" )
+	;
+
+	try {
+
+		boost::program_options::variables_map variables;
+		boost::program_options::store( boost::program_options::command_line_parser( argc, argv ).options( description ).run(), variables );
+		boost::program_options::notify( variables );
+
+		if ( variables.count( "help" ) ) {
+
+			std::cout <<
+				"Writes a reproducible synthetic dataset, in SVM-Light format. Each row has" << std::endl <<
+				"the same number of nonzeros, in random columns, with values uniform on [0,1)." << std::endl <<
+				"Rows are labeled by the largest of several random linear functions (or, for" << std::endl <<
+				"binary datasets, by the sign of one), after which a fraction of the labels" << std::endl <<
+				"(given by the noise parameter) are replaced with random ones. Binary datasets" << std::endl <<
+				"have labels +1 and -1, while multiclass datasets have labels 0,1,...,classes-1." << std::endl <<
+				"The same parameters always give the same dataset." << std::endl <<
+				std::endl <<
+				description << std::endl;
+		}
+		else {
+
+			if ( ! variables.count( "output" ) )
+				throw std::runtime_error( "You must provide an output file" );
+
+			SVMLightDataset data;
+			GenerateSyntheticDataset( &data, parameters );
+
+			std::ofstream file( output.c_str() );
+			if ( file.fail() )
+				throw std::runtime_error( "Unable to open output file" );
+			file.precision( std::numeric_limits< float >::digits10 + 3 );
+			WriteSVMLight( file, data );
+			file.close();
+			if ( file.fail() )
+				throw std::runtime_error( "Unable to write output file" );
+		}
+	}
+	catch( std::exception& error ) {
+
+		std::cerr << "Error: " << error.what() << std::endl << std::endl << description << std::endl;
+		resultCode = EXIT_FAILURE;
+	}
+
+	return resultCode;
+}
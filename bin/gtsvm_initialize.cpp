@@ -46,11 +46,15 @@ int main( int argc, char* argv[] ) {
 	float kernelParameter2 = std::numeric_limits< float >::quiet_NaN();
 	float kernelParameter3 = std::numeric_limits< float >::quiet_NaN();
 	bool biased;
+	std::string columnOrderName;
+	std::string backend;
+	unsigned int threads;
+	bool cache;
 
 	boost::program_options::options_description description( "Allowed options" );
 	description.add_options()
 		( "help,h", "display this help" )
-		( "file,f", boost::program_options::value< std::string >( &dataset ), "dataset file (SVM-Light format)" )
+		( "file,f", boost::program_options::value< std::string >( &dataset ), "dataset file(s), in SVM-Light or binary format (a comma-separated list of glob patterns)" )
 		( "output,o", boost::program_options::value< std::string >( &output ), "output model file" )
 		( "multiclass,m", boost::program_options::value< bool >( &multiclass )->default_value( false ), "is this a multiclass problem?" )
 		( "regularization,C", boost::program_options::value< float >( &regularization ), "regularization parameter" )
@@ -59,6 +63,10 @@ int main( int argc, char* argv[] ) {
 		( "parameter2,2", boost::program_options::value< float >( &kernelParameter2 ), "second kernel parameter" )
 		( "parameter3,3", boost::program_options::value< float >( &kernelParameter3 ), "third kernel parameter" )
 		( "biased,b", boost::program_options::value< bool >( &biased )->default_value( false ), "include an unregularized bias?" )
+		( "column_order", boost::program_options::value< std::string >( &columnOrderName )->default_value( "original" ), "order of the (used) columns: \"original\" or \"cooccurrence\"" )
+		( "backend", boost::program_options::value< std::string >( &backend )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used to read the dataset, and by the cpu backend (0 = one per core)" )
+		( "cache", boost::program_options::value< bool >( &cache )->default_value( false ), "read SVM-Light files from, and write them to, binary caches alongside them?" )
 	;
 	
 
@@ -85,6 +93,11 @@ int main( int argc, char* argv[] ) {
 				"the optimization problem is a multiclass problem, and whether it should include" << std::endl <<
 				"an unregularized bias." << std::endl <<
 				std::endl <<
+				"Columns which no training vector uses are dropped, and the remainder are" << std::endl <<
+				"renumbered, either in their original order or (with \"cooccurrence\") so that" << std::endl <<
+				"columns which appear in similar vectors are adjacent. The mapping is saved in" << std::endl <<
+				"the model, and applied to the vectors which are classified." << std::endl <<
+				std::endl <<
 				description << std::endl;
 		}
 		else {
@@ -133,101 +146,27 @@ int main( int argc, char* argv[] ) {
 				throw std::runtime_error( "The kernel parameter must be one of \"gaussian\", \"polynomial\" and \"sigmoid\"" );
 
 			// load the dataset file
-			unsigned int rows    = 0;
-			unsigned int columns = 0;
-			std::vector< boost::int32_t > labels;
-			std::vector< float   > values;
-			std::vector< size_t  > indices;
-			std::vector< size_t  > offsets;
-			{	unsigned int const bufferSize = ( 1u << 24 );
-				boost::shared_array< char > buffer( new char[ bufferSize ] );
-
-				const boost::regex spaceRegex( "[[:space:]]+" );
-				const boost::regex elementRegex( "^[[:space:]]*([[:digit:]]+):(-?[[:digit:]]+(\\.[[:digit:]]+)?([eE]-?[[:digit:]]+)?)[[:space:]]*$" );
-
-				offsets.push_back( 0 );
-
-				std::ifstream file( dataset.c_str() );
-				if ( file.fail() )
-					throw std::runtime_error( "Unable to open dataset file" );
-				while ( ! file.eof() ) {
-
-					file.getline( buffer.get(), bufferSize );
-					if ( file.fail() )
-						break;
-					std::string lineString( buffer.get() );
-
-					boost::sregex_token_iterator ii(
-						lineString.begin(),
-						lineString.end(),
-						spaceRegex,
-						-1
-					);
-					boost::sregex_token_iterator iiEnd;
-
-					if ( ii != iiEnd ) {    // ignore blank lines
-
-						std::string const labelString = ii->str();
-						if ( ii == iiEnd )
-							throw std::runtime_error( "Failed to parse first element of dataset line" );
-						int label = atoi( labelString.c_str() );
-
-						int lastIndex = -1;
-						for ( ++ii; ii != iiEnd; ++ii ) {
-
-							std::string const elementString = ii->str();
-							boost::smatch elementMatch;
-							if ( ! boost::regex_match( elementString, elementMatch, elementRegex, boost::match_extra ) )
-								throw std::runtime_error( "Failed to parse element of dataset line" );
-
-							std::string const indexString = elementMatch[ 1 ].str();
-							int index = atoi( indexString.c_str() );
-							std::string const valueString = elementMatch[ 2 ].str();
-							float const value = static_cast< float >( atof( valueString.c_str() ) );
-							if ( index < 0 )
-								throw std::runtime_error( "Failed to parse element of dataset line: negative index encountered" );
-							if ( index <= lastIndex )
-								throw std::runtime_error( "Failed to parse element of dataset line: features must be listed in order of increasing index" );
-							lastIndex = index;
-
-							if ( value != 0 ) {
-
-								values.push_back( value );
-								indices.push_back( index );
-
-								if ( index + 1 > static_cast< int >( columns ) )
-									columns = index + 1;
-							}
-						}
-
-						BOOST_ASSERT( values.size() == indices.size() );
-
-						labels.push_back( label );
-						offsets.push_back( values.size() );
-
-						BOOST_ASSERT( labels.size() + 1 == offsets.size() );
-					}
-				}
-				file.close();
-
-				rows = offsets.size() - 1;
-			}
+			SVMLightDataset data;
+			ReadDataset( &data, dataset, threads, cache );
+			ReportSVMLight( std::cout, data );
 
 			//std::cout <<  kernelParameter1  << std::endl;
 
-			AutoContext context;
+			GTSVM_ColumnOrder const columnOrder = ParseColumnOrder( columnOrderName );
+
+			AutoContext context( backend, threads );
 
 			if (
 				GTSVM_InitializeSparse(
 					context,
-					&values[ 0 ],
-					&indices[ 0 ],
-					&offsets[ 0 ],
+					&data.values[ 0 ],
+					&data.indices[ 0 ],
+					&data.offsets[ 0 ],
 					GTSVM_TYPE_FLOAT,
-					&labels[ 0 ],
+					&data.labels[ 0 ],
 					GTSVM_TYPE_INT32,
-					rows,
-					columns,
+					data.rows,
+					data.columns,
 					false,
 					multiclass,
 					regularization,
@@ -236,6 +175,8 @@ int main( int argc, char* argv[] ) {
 					kernelParameter2,
 					kernelParameter3,
 					biased,
+					columnOrder,
+					GTSVM_CLUSTERING_GREEDY,
 					false,
 					1
 				)
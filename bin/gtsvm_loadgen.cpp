@@ -0,0 +1,371 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file gtsvm_loadgen.cpp
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+//============================================================================
+//    Helper functions
+//============================================================================
+
+
+namespace {
+
+
+double const ElapsedSeconds( boost::posix_time::ptime const& start ) {
+
+	return( ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds() * 1e-6 );
+}
+
+
+// closes the socket when it goes out of scope
+struct AutoSocket {
+
+	explicit AutoSocket( std::string const& path ) : socket( ConnectUnixSocket( path ) ) {}
+	~AutoSocket() { ::close( socket ); }
+
+	int const socket;
+
+
+private:
+
+	AutoSocket( AutoSocket const& other );
+	AutoSocket const& operator=( AutoSocket const& other );
+};
+
+
+// sends the given rows of the dataset, and returns the number of classes
+unsigned int const Classify( int const socket, SVMLightDataset const& data, unsigned int const begin, unsigned int const end, std::vector< double >* const pResult ) {
+
+	WriteServeClassifyRequest( socket, data.values, data.indices, data.offsets, begin, end );
+
+	ServeResponseHeader header;
+	std::string text;
+	ReadServeResponse( socket, &header, pResult, &text );
+	if ( header.status != SERVE_STATUS_OK )
+		throw std::runtime_error( "Server error: " + text );
+	if ( header.rows != end - begin )
+		throw std::runtime_error( "The server returned the wrong number of rows" );
+
+	return header.classes;
+}
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    Load generation
+//============================================================================
+
+
+namespace {
+
+
+/*
+	If the reference is non-empty, then it contains the results of the serial
+	pass (classes per row), and every response is compared with it: a
+	response is a mismatch if any of its values differs by more than the
+	tolerance (relative to the larger of one and the reference value)
+*/
+struct Load {
+
+	Load( std::vector< double > const& reference, unsigned int const classes, double const tolerance ) :
+		reference( reference ),
+		classes( classes ),
+		tolerance( tolerance ),
+		failed( false ),
+		mismatches( 0 ),
+		largestDifference( 0 )
+	{
+	}
+
+	std::vector< double > const& reference;
+	unsigned int const classes;
+	double const tolerance;
+
+	boost::mutex mutex;
+	bool failed;
+	std::string error;
+	std::vector< double > latencies;
+	unsigned long long mismatches;
+	double largestDifference;
+
+	void Fail( std::exception const& exception ) {
+
+		boost::mutex::scoped_lock lock( mutex );
+		if ( ! failed ) {
+
+			failed = true;
+			error = exception.what();
+		}
+	}
+};
+
+
+/*
+	Sends "requests" requests of "rows" rows each, one after another, over
+	its own connection. Each connection starts at a different place in the
+	dataset, wrapping around at the end
+*/
+void ConnectionThread( Load* const pLoad, std::string const* const pSocketPath, SVMLightDataset const* const pData, unsigned int const connection, unsigned int const requests, unsigned int const rows ) {
+
+	try {
+
+		AutoSocket socket( *pSocketPath );
+
+		std::vector< double > latencies;
+		latencies.reserve( requests );
+		unsigned long long mismatches = 0;
+		double largestDifference = 0;
+		std::vector< double > result;
+		for ( unsigned int ii = 0; ii < requests; ++ii ) {
+
+			unsigned int const begin = ( static_cast< unsigned long long >( connection ) * requests + ii ) * rows % pData->rows;
+			unsigned int const end = std::min( begin + rows, pData->rows );
+
+			boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+			unsigned int const classes = Classify( socket.socket, *pData, begin, end, &result );
+			latencies.push_back( ElapsedSeconds( start ) );
+
+			if ( ! pLoad->reference.empty() ) {
+
+				if ( classes != pLoad->classes )
+					throw std::runtime_error( "The server returned the wrong number of classes" );
+
+				double const* const reference = &pLoad->reference[ static_cast< size_t >( begin ) * classes ];
+				bool mismatch = false;
+				for ( size_t jj = 0; jj < static_cast< size_t >( end - begin ) * classes; ++jj ) {
+
+					double const difference = std::fabs( result[ jj ] - reference[ jj ] ) / std::max( 1.0, std::fabs( reference[ jj ] ) );
+					if ( ! ( difference <= pLoad->tolerance ) ) {
+
+						mismatch = true;
+						if ( ! ( difference <= largestDifference ) )
+							largestDifference = difference;
+					}
+				}
+				if ( mismatch )
+					++mismatches;
+			}
+		}
+
+		boost::mutex::scoped_lock lock( pLoad->mutex );
+		pLoad->latencies.insert( pLoad->latencies.end(), latencies.begin(), latencies.end() );
+		pLoad->mismatches += mismatches;
+		if ( ! ( largestDifference <= pLoad->largestDifference ) )
+			pLoad->largestDifference = largestDifference;
+	}
+	catch( std::exception& error ) {
+
+		pLoad->Fail( error );
+	}
+}
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    main function
+//============================================================================
+
+
+int main( int argc, char* argv[] ) {
+
+	int resultCode = EXIT_SUCCESS;
+
+	std::string dataset;
+	std::string socketPath;
+	std::string output;
+	unsigned int connections;
+	unsigned int requests;
+	unsigned int rows;
+	unsigned int threads;
+	bool cache;
+	bool check;
+	double tolerance;
+	bool statistics;
+
+	boost::program_options::options_description description( "Allowed options" );
+	description.add_options()
+		( "help,h", "display this help" )
+		( "file,f", boost::program_options::value< std::string >( &dataset ), "dataset file(s), in SVM-Light or binary format (a comma-separated list of glob patterns)" )
+		( "socket", boost::program_options::value< std::string >( &socketPath ), "Unix domain socket on which gtsvm_serve is listening" )
+		( "output,o", boost::program_options::value< std::string >( &output ), "output text file, optional" )
+		( "connections,c", boost::program_options::value< unsigned int >( &connections )->default_value( 4 ), "number of concurrent connections" )
+		( "requests,n", boost::program_options::value< unsigned int >( &requests )->default_value( 1000 ), "number of requests sent over each connection" )
+		( "rows,r", boost::program_options::value< unsigned int >( &rows )->default_value( 1 ), "number of rows in each request" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used to read the dataset (0 = one per core)" )
+		( "cache", boost::program_options::value< bool >( &cache )->default_value( false ), "read SVM-Light files from, and write them to, binary caches alongside them?" )
+		( "check", boost::program_options::value< bool >( &check )->default_value( true ), "compare every response with the serial pass?" )
+		( "tolerance", boost::program_options::value< double >( &tolerance )->default_value( 1e-4 ), "largest relative difference from the serial pass which isn't a mismatch" )
+		( "statistics", boost::program_options::value< bool >( &statistics )->default_value( true ), "print the server's report afterwards?" )
+	;
+
+	try {
+
+		boost::program_options::variables_map variables;
+		boost::program_options::store( boost::program_options::command_line_parser( argc, argv ).options( description ).run(), variables );
+		boost::program_options::notify( variables );
+
+		if ( variables.count( "help" ) ) {
+
+			std::cout <<
+				"Generates load for gtsvm_serve: each of the connections sends the given number" << std::endl <<
+				"of requests, each containing the given number of consecutive rows of the" << std::endl <<
+				"dataset, waiting for each response before sending the next request. The" << std::endl <<
+				"throughput, and the latency percentiles seen by the clients, are then" << std::endl <<
+				"reported, followed by the server's own report." << std::endl <<
+				std::endl <<
+				"Unless check is false (and no output file is given), the whole dataset is first" << std::endl <<
+				"classified, in order, over a single connection. Every response to the" << std::endl <<
+				"concurrent requests is then compared with the results of this serial pass, and" << std::endl <<
+				"if any differ by more than the tolerance (relative to the larger of one and the" << std::endl <<
+				"serial result), then they're reported, and the exit status is nonzero. The" << std::endl <<
+				"tolerance isn't zero because, on the cpu backend, the order in which sums are" << std::endl <<
+				"accumulated depends on the server's thread count. If an output file is given," << std::endl <<
+				"then the results of the serial pass are written to it, in the same format as" << std::endl <<
+				"by gtsvm_classify, so that the two may be compared." << std::endl <<
+				std::endl <<
+				description << std::endl;
+		}
+		else {
+
+			if ( ! variables.count( "file" ) )
+				throw std::runtime_error( "You must provide a dataset file" );
+			if ( ! variables.count( "socket" ) )
+				throw std::runtime_error( "You must provide a socket path" );
+			if ( rows < 1 )
+				throw std::runtime_error( "Each request must contain at least one row" );
+
+			SVMLightDataset data;
+			ReadDataset( &data, dataset, threads, cache );
+			ReportSVMLight( std::cout, data );
+			if ( data.rows == 0 )
+				throw std::runtime_error( "The dataset is empty" );
+
+			std::vector< double > reference;
+			unsigned int classes = 0;
+			if ( check || variables.count( "output" ) ) {
+
+				AutoSocket socket( socketPath );
+				std::vector< double > result;
+				for ( unsigned int ii = 0; ii < data.rows; ii += rows ) {
+
+					unsigned int const end = std::min( ii + rows, data.rows );
+					unsigned int const resultClasses = Classify( socket.socket, data, ii, end, &result );
+					if ( ii == 0 ) {
+
+						classes = resultClasses;
+						reference.reserve( static_cast< size_t >( data.rows ) * classes );
+					}
+					else if ( resultClasses != classes )
+						throw std::runtime_error( "The server returned the wrong number of classes" );
+					reference.insert( reference.end(), result.begin(), result.begin() + ( end - ii ) * classes );
+				}
+
+				if ( variables.count( "output" ) ) {
+
+					std::ofstream file( output.c_str() );
+					if ( file.fail() )
+						throw std::runtime_error( "Unable to open output file" );
+
+					for ( unsigned int ii = 0; ii < data.rows; ++ii ) {
+
+						file << reference[ static_cast< size_t >( ii ) * classes + 0 ];
+						for ( unsigned int jj = 1; jj < classes; ++jj )
+							file << ", " << reference[ static_cast< size_t >( ii ) * classes + jj ];
+						file << std::endl;
+					}
+
+					file.close();
+					if ( file.fail() )
+						throw std::runtime_error( "Unable to write output file" );
+				}
+
+				if ( ! check )
+					reference.clear();
+			}
+
+			if ( ( connections > 0 ) && ( requests > 0 ) ) {
+
+				boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+
+				Load load( reference, classes, tolerance );
+				boost::thread_group connectionThreads;
+				for ( unsigned int ii = 0; ii < connections; ++ii )
+					connectionThreads.create_thread( boost::bind( &ConnectionThread, &load, &socketPath, &data, ii, requests, rows ) );
+				connectionThreads.join_all();
+
+				if ( load.failed )
+					throw std::runtime_error( load.error );
+
+				double const seconds = ElapsedSeconds( start );
+				std::cout <<
+					"Sent " << load.latencies.size() << " requests of " << rows << " rows over " << connections << " connections in " << seconds << " seconds (" <<
+					( ( seconds > 0 ) ? load.latencies.size() / seconds : 0 ) << " requests/s, " <<
+					( ( seconds > 0 ) ? load.latencies.size() * rows / seconds : 0 ) << " rows/s)" << std::endl;
+				ReportLatencies( std::cout, &load.latencies );
+
+				if ( check ) {
+
+					if ( load.mismatches > 0 ) {
+
+						std::cout << load.mismatches << " of " << load.latencies.size() << " responses differed from the serial pass, by up to " << load.largestDifference << " (relative)" << std::endl;
+						resultCode = EXIT_FAILURE;
+					}
+					else
+						std::cout << "Every response matched the serial pass" << std::endl;
+				}
+			}
+
+			if ( statistics ) {
+
+				AutoSocket socket( socketPath );
+				WriteServeStatisticsRequest( socket.socket );
+
+				ServeResponseHeader header;
+				std::vector< double > values;
+				std::string text;
+				ReadServeResponse( socket.socket, &header, &values, &text );
+				std::cout << std::endl << "Server:" << std::endl << text;
+			}
+		}
+	}
+	catch( std::exception& error ) {
+
+		std::cerr << "Error: " << error.what() << std::endl << std::endl << description << std::endl;
+		resultCode = EXIT_FAILURE;
+	}
+
+	return resultCode;
+}
@@ -41,8 +41,15 @@ int main( int argc, char* argv[] ) {
 	std::string output;
 	double epsilon = std::numeric_limits< double >::quiet_NaN();
 	unsigned int iterations;
+	std::string clusteringName;
 	bool smallClusters;
 	unsigned int activeClusters;
+	std::string backend;
+	unsigned int threads;
+	unsigned int batchSize;
+	bool shrinking;
+	bool memory;
+	bool statistics;
 
 	boost::program_options::options_description description( "Allowed options" );
 	description.add_options()
@@ -51,8 +58,15 @@ int main( int argc, char* argv[] ) {
 		( "output,o", boost::program_options::value< std::string >( &output ), "output model file (may be same as input)" )
 		( "epsilon,e", boost::program_options::value< double >( &epsilon ), "termination threshold" )
 		( "iterations,n", boost::program_options::value< unsigned int >( &iterations ), "maximum number of iterations" )
+		( "clustering", boost::program_options::value< std::string >( &clusteringName )->default_value( "greedy" ), "clustering algorithm: \"greedy\" or \"minhash\"" )
 		( "small_clusters,s", boost::program_options::value< bool >( &smallClusters )->default_value( false ), "use size-16 instead of size-256 clusters?" )
 		( "active_clusters,a", boost::program_options::value< unsigned int >( &activeClusters )->default_value( 64 ), "number of \"active\" clusters" )
+		( "backend", boost::program_options::value< std::string >( &backend )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used by the cpu backend (0 = one per core)" )
+		( "batch_size", boost::program_options::value< unsigned int >( &batchSize )->default_value( 16 ), "number of training vectors optimized over at each iteration: 8, 16, 32, 64 or 128 (only 16 on the cuda backend)" )
+		( "shrinking", boost::program_options::value< bool >( &shrinking )->default_value( false ), "shrink the active set while optimizing (binary problems only)?" )
+		( "statistics", boost::program_options::value< bool >( &statistics )->default_value( true ), "print per-phase performance counters?" )
+		( "memory", boost::program_options::value< bool >( &memory )->default_value( false ), "print the memory used by each buffer, before optimizing?" )
 	;
 
 	try {
@@ -77,6 +91,9 @@ int main( int argc, char* argv[] ) {
 				"be active at every point in the greedy clustering algorithm. We have found that" << std::endl <<
 				"64 works well, but increasing this number will improve the quality of the" << std::endl <<
 				"clustering (at the cost of more time being required to find it)." << std::endl <<
+				"Alternatively, clustering may be set to \"minhash\", which ignores" << std::endl <<
+				"active_clusters, and is much faster for data with very many columns, but may" << std::endl <<
+				"find clusters with more nonzero columns in total." << std::endl <<
 				std::endl <<
 				description << std::endl;
 		}
@@ -95,12 +112,19 @@ int main( int argc, char* argv[] ) {
 			if ( epsilon <= 0 )
 				throw std::runtime_error( "The epsilon parameter must be positive" );
 
-			AutoContext context;
+			GTSVM_Clustering const clustering = ParseClustering( clusteringName );
+
+			AutoContext context( backend, threads );
+			if ( GTSVM_SetBatchSize( context, batchSize ) )
+				throw std::runtime_error( GTSVM_Error() );
+			if ( GTSVM_SetShrinking( context, shrinking ) )
+				throw std::runtime_error( GTSVM_Error() );
 
 			if (
 				GTSVM_Load(
 					context,
 					input.c_str(),
+					clustering,
 					smallClusters,
 					activeClusters
 				)
@@ -109,7 +133,15 @@ int main( int argc, char* argv[] ) {
 				throw std::runtime_error( GTSVM_Error() );
 			}
 
-			{	unsigned int const repetitions = 256;    // must be a multiple of 16
+			if ( memory ) {
+
+				GTSVM_MemoryUsage usage;
+				if ( GTSVM_GetMemoryUsage( context, &usage ) )
+					throw std::runtime_error( GTSVM_Error() );
+				ReportMemoryUsage( std::cout, usage );
+			}
+
+			{	unsigned int const repetitions = 256;    // must be a multiple of the batch size
 
 				for ( unsigned int ii = 0; ii < iterations; ii += repetitions ) {
 
@@ -134,6 +166,9 @@ int main( int argc, char* argv[] ) {
 
 			if ( GTSVM_Save( context, output.c_str() ) )
 				throw std::runtime_error( GTSVM_Error() );
+
+			if ( statistics )
+				ReportStatistics( std::cout, context );
 		}
 	}
 	catch( std::exception& error ) {
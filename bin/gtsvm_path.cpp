@@ -0,0 +1,261 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file gtsvm_path.cpp
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+//============================================================================
+//    Helper functions
+//============================================================================
+
+
+namespace {
+
+
+double const ElapsedSeconds( boost::posix_time::ptime const& start ) {
+
+	return( ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds() * 1e-6 );
+}
+
+
+std::vector< float > const ParseList( std::string const& list, char const* const error ) {
+
+	std::vector< std::string > names;
+	boost::split( names, list, boost::is_any_of( "," ) );
+	std::vector< float > values;
+	for ( unsigned int ii = 0; ii < names.size(); ++ii ) {
+
+		std::istringstream stream( names[ ii ] );
+		float value = std::numeric_limits< float >::quiet_NaN();
+		if ( ! ( stream >> value ) || ! stream.eof() )
+			throw std::runtime_error( error );
+		values.push_back( value );
+	}
+	return values;
+}
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    main function
+//============================================================================
+
+
+int main( int argc, char* argv[] ) {
+
+	int resultCode = EXIT_SUCCESS;
+
+	std::string input;
+	std::string output;
+	std::string regularizationsList;
+	std::string kernelParameters1List;
+	double epsilon = std::numeric_limits< double >::quiet_NaN();
+	unsigned int iterations;
+	std::string clusteringName;
+	bool smallClusters;
+	unsigned int activeClusters;
+	std::string backend;
+	unsigned int threads;
+	unsigned int batchSize;
+	bool shrinking;
+	bool statistics;
+
+	boost::program_options::options_description description( "Allowed options" );
+	description.add_options()
+		( "help,h", "display this help" )
+		( "input,i", boost::program_options::value< std::string >( &input ), "input model file" )
+		( "output,o", boost::program_options::value< std::string >( &output ), "output model file prefix" )
+		( "regularization,C", boost::program_options::value< std::string >( &regularizationsList ), "regularization parameters (a comma-separated list)" )
+		( "parameter1,1", boost::program_options::value< std::string >( &kernelParameters1List ), "first kernel parameters (a comma-separated list), optional" )
+		( "epsilon,e", boost::program_options::value< double >( &epsilon ), "termination threshold" )
+		( "iterations,n", boost::program_options::value< unsigned int >( &iterations ), "maximum number of iterations, for each regularization parameter" )
+		( "clustering", boost::program_options::value< std::string >( &clusteringName )->default_value( "greedy" ), "clustering algorithm: \"greedy\" or \"minhash\"" )
+		( "small_clusters,s", boost::program_options::value< bool >( &smallClusters )->default_value( false ), "use size-16 instead of size-256 clusters?" )
+		( "active_clusters,a", boost::program_options::value< unsigned int >( &activeClusters )->default_value( 64 ), "number of \"active\" clusters" )
+		( "backend", boost::program_options::value< std::string >( &backend )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used by the cpu backend (0 = one per core)" )
+		( "batch_size", boost::program_options::value< unsigned int >( &batchSize )->default_value( 16 ), "number of training vectors optimized over at each iteration: 8, 16, 32, 64 or 128 (only 16 on the cuda backend)" )
+		( "shrinking", boost::program_options::value< bool >( &shrinking )->default_value( false ), "shrink the active set while optimizing (binary problems only)?" )
+		( "statistics", boost::program_options::value< bool >( &statistics )->default_value( true ), "print per-phase performance counters, after the last optimization?" )
+	;
+
+	try {
+
+		boost::program_options::variables_map variables;
+		boost::program_options::store( boost::program_options::command_line_parser( argc, argv ).options( description ).run(), variables );
+		boost::program_options::notify( variables );
+
+		if ( variables.count( "help" ) ) {
+
+			std::cout <<
+				"Optimizes the SVM problem contained in the input model file for each of a list" << std::endl <<
+				"of regularization parameters, in the order given, saving each result to" << std::endl <<
+				"\"<output>-C<regularization>\". Each optimization is warm-started from the" << std::endl <<
+				"previous solution, with the alphas clipped to the new bounds, so it's usually" << std::endl <<
+				"much faster than starting from scratch. Increasing the regularization" << std::endl <<
+				"parameter changes no alphas at all, so increasing lists work best. As in" << std::endl <<
+				"gtsvm_optimize, optimization for each regularization parameter continues until" << std::endl <<
+				"either the normalized duality gap is smaller than epsilon, or the maximum" << std::endl <<
+				"number of iterations has been exceeded." << std::endl <<
+				std::endl <<
+				"If a list of first kernel parameters (e.g. Gaussian widths) is also given," << std::endl <<
+				"then every combination is optimized, and saved to" << std::endl <<
+				"\"<output>-C<regularization>-p<parameter1>\". The grid is walked one kernel" << std::endl <<
+				"parameter at a time, traversing the regularization parameters alternately" << std::endl <<
+				"forwards and backwards, so that each optimization is warm-started from a" << std::endl <<
+				"neighbouring solution, and the clustering and training vectors on the" << std::endl <<
+				"device are reused throughout. The kernel type and its other parameters are" << std::endl <<
+				"those of the input model." << std::endl <<
+				std::endl <<
+				description << std::endl;
+		}
+		else {
+
+			if ( ! variables.count( "input" ) )
+				throw std::runtime_error( "You must provide an input file" );
+			if ( ! variables.count( "output" ) )
+				throw std::runtime_error( "You must provide an output file prefix" );
+			if ( ! variables.count( "regularization" ) )
+				throw std::runtime_error( "You must provide a list of regularization parameters" );
+			if ( ! variables.count( "epsilon" ) )
+				throw std::runtime_error( "You must provide a epsilon parameter" );
+			if ( boost::math::isinf( epsilon ) )
+				throw std::runtime_error( "The epsilon parameter must be finite" );
+			if ( boost::math::isnan( epsilon ) )
+				throw std::runtime_error( "The epsilon parameter cannot be NaN" );
+			if ( epsilon <= 0 )
+				throw std::runtime_error( "The epsilon parameter must be positive" );
+
+			std::vector< float > const regularizations = ParseList( regularizationsList, "The regularization parameters must be a comma-separated list of numbers" );
+			bool const sweepKernel = ( variables.count( "parameter1" ) != 0 );
+			std::vector< float > kernelParameters1;
+			if ( sweepKernel )
+				kernelParameters1 = ParseList( kernelParameters1List, "The first kernel parameters must be a comma-separated list of numbers" );
+
+			GTSVM_Clustering const clustering = ParseClustering( clusteringName );
+
+			AutoContext context( backend, threads );
+			if ( GTSVM_SetBatchSize( context, batchSize ) )
+				throw std::runtime_error( GTSVM_Error() );
+			if ( GTSVM_SetShrinking( context, shrinking ) )
+				throw std::runtime_error( GTSVM_Error() );
+
+			if (
+				GTSVM_Load(
+					context,
+					input.c_str(),
+					clustering,
+					smallClusters,
+					activeClusters
+				)
+			)
+			{
+				throw std::runtime_error( GTSVM_Error() );
+			}
+
+			GTSVM_Kernel kernel;
+			float kernelParameter2 = std::numeric_limits< float >::quiet_NaN();
+			float kernelParameter3 = std::numeric_limits< float >::quiet_NaN();
+			if ( GTSVM_GetKernel( context, &kernel ) )
+				throw std::runtime_error( GTSVM_Error() );
+			if ( GTSVM_GetKernelParameter2( context, &kernelParameter2 ) )
+				throw std::runtime_error( GTSVM_Error() );
+			if ( GTSVM_GetKernelParameter3( context, &kernelParameter3 ) )
+				throw std::runtime_error( GTSVM_Error() );
+
+			unsigned int const kernelSteps = ( sweepKernel ? kernelParameters1.size() : 1 );
+			for ( unsigned int kk = 0; kk < kernelSteps * regularizations.size(); ++kk ) {
+
+				unsigned int const kernelIndex = kk / regularizations.size();
+				unsigned int ii = kk % regularizations.size();
+				if ( kernelIndex & 1 )
+					ii = regularizations.size() - 1 - ii;
+
+				boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+
+				// the regularization parameter is changed first, so that any clipped alphas go into the kernel's recalculation of the responses
+				if ( GTSVM_SetRegularization( context, regularizations[ ii ] ) )
+					throw std::runtime_error( GTSVM_Error() );
+				if ( sweepKernel && ( ( kk % regularizations.size() ) == 0 ) ) {
+
+					if ( GTSVM_SetKernel( context, kernel, kernelParameters1[ kernelIndex ], kernelParameter2, kernelParameter3 ) )
+						throw std::runtime_error( GTSVM_Error() );
+				}
+
+				double primal =  std::numeric_limits< double >::infinity();
+				double dual   = -std::numeric_limits< double >::infinity();
+				unsigned int const repetitions = 256;    // must be a multiple of the batch size
+				unsigned int jj = 0;
+				for ( ; jj < iterations; jj += repetitions ) {
+
+					if (
+						GTSVM_Optimize(
+							context,
+							&primal,
+							&dual,
+							repetitions
+						)
+					)
+					{
+						throw std::runtime_error( GTSVM_Error() );
+					}
+					if ( 2 * ( primal - dual ) < epsilon * ( primal + dual ) ) {
+
+						jj += repetitions;
+						break;
+					}
+				}
+
+				std::ostringstream filename;
+				filename << output << "-C" << regularizations[ ii ];
+				if ( sweepKernel )
+					filename << "-p" << kernelParameters1[ kernelIndex ];
+				if ( GTSVM_Save( context, filename.str().c_str() ) )
+					throw std::runtime_error( GTSVM_Error() );
+
+				std::cout << "C = " << regularizations[ ii ];
+				if ( sweepKernel )
+					std::cout << ", parameter1 = " << kernelParameters1[ kernelIndex ];
+				std::cout << ", iterations = " << jj << ", primal = " << primal << ", dual = " << dual << ", seconds = " << ElapsedSeconds( start ) << ", saved to " << filename.str() << std::endl;
+			}
+
+			if ( statistics )
+				ReportStatistics( std::cout, context );
+		}
+	}
+	catch( std::exception& error ) {
+
+		std::cerr << "Error: " << error.what() << std::endl << std::endl << description << std::endl;
+		resultCode = EXIT_FAILURE;
+	}
+
+	return resultCode;
+}
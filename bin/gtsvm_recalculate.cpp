@@ -39,16 +39,24 @@ int main( int argc, char* argv[] ) {
 
 	std::string input;
 	std::string output;
+	std::string clusteringName;
 	bool smallClusters;
 	unsigned int activeClusters;
+	std::string backend;
+	unsigned int threads;
+	unsigned int batchSize;
 
 	boost::program_options::options_description description( "Allowed options" );
 	description.add_options()
 		( "help,h", "display this help" )
 		( "input,i", boost::program_options::value< std::string >( &input ), "input model file" )
 		( "output,o", boost::program_options::value< std::string >( &output ), "output model file (may be same as input)" )
+		( "clustering", boost::program_options::value< std::string >( &clusteringName )->default_value( "greedy" ), "clustering algorithm: \"greedy\" or \"minhash\"" )
 		( "small_clusters,s", boost::program_options::value< bool >( &smallClusters )->default_value( false ), "use size-16 instead of size-256 clusters?" )
 		( "active_clusters,a", boost::program_options::value< unsigned int >( &activeClusters )->default_value( 64 ), "number of \"active\" clusters" )
+		( "backend", boost::program_options::value< std::string >( &backend )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used by the cpu backend (0 = one per core)" )
+		( "batch_size", boost::program_options::value< unsigned int >( &batchSize )->default_value( 16 ), "number of training vectors whose responses are recalculated at a time: 8, 16, 32, 64 or 128 (only 16 on the cuda backend)" )
 	;
 
 	try {
@@ -72,6 +80,9 @@ int main( int argc, char* argv[] ) {
 				"be active at every point in the greedy clustering algorithm. We have found that" << std::endl <<
 				"64 works well, but increasing this number will improve the quality of the" << std::endl <<
 				"clustering (at the cost of more time being required to find it)." << std::endl <<
+				"Alternatively, clustering may be set to \"minhash\", which ignores" << std::endl <<
+				"active_clusters, and is much faster for data with very many columns, but may" << std::endl <<
+				"find clusters with more nonzero columns in total." << std::endl <<
 				std::endl <<
 				description << std::endl;
 		}
@@ -82,12 +93,17 @@ int main( int argc, char* argv[] ) {
 			if ( ! variables.count( "output" ) )
 				throw std::runtime_error( "You must provide an output file" );
 
-			AutoContext context;
+			GTSVM_Clustering const clustering = ParseClustering( clusteringName );
+
+			AutoContext context( backend, threads );
+			if ( GTSVM_SetBatchSize( context, batchSize ) )
+				throw std::runtime_error( GTSVM_Error() );
 
 			if (
 				GTSVM_Load(
 					context,
 					input.c_str(),
+					clustering,
 					smallClusters,
 					activeClusters
 				)
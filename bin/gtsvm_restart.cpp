@@ -45,6 +45,8 @@ int main( int argc, char* argv[] ) {
 	float kernelParameter2 = std::numeric_limits< float >::quiet_NaN();
 	float kernelParameter3 = std::numeric_limits< float >::quiet_NaN();
 	bool biased;
+	std::string backend;
+	unsigned int threads;
 
 	boost::program_options::options_description description( "Allowed options" );
 	description.add_options()
@@ -57,6 +59,8 @@ int main( int argc, char* argv[] ) {
 		( "parameter2,2", boost::program_options::value< float >( &kernelParameter2 ), "second kernel parameter" )
 		( "parameter3,3", boost::program_options::value< float >( &kernelParameter3 ), "third kernel parameter" )
 		( "biased,b", boost::program_options::value< bool >( &biased )->default_value( false ), "include an unregularized bias?" )
+		( "backend", boost::program_options::value< std::string >( &backend )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used by the cpu backend (0 = one per core)" )
 	;
 
 	try {
@@ -127,12 +131,13 @@ int main( int argc, char* argv[] ) {
 			else
 				throw std::runtime_error( "The kernel parameter must be one of \"gaussian\", \"polynomial\" and \"sigmoid\"" );
 
-			AutoContext context;
+			AutoContext context( backend, threads );
 
 			if (
 				GTSVM_Load(
 					context,
 					input.c_str(),
+					GTSVM_CLUSTERING_GREEDY,
 					false,
 					1
 				)
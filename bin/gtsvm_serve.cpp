@@ -0,0 +1,662 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file gtsvm_serve.cpp
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+//============================================================================
+//    Helper functions
+//============================================================================
+
+
+namespace {
+
+
+volatile sig_atomic_t g_stop = 0;
+
+
+void Stop( int ) {
+
+	g_stop = 1;
+}
+
+
+double const ElapsedSeconds( boost::posix_time::ptime const& start ) {
+
+	return( ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds() * 1e-6 );
+}
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    Request structure
+//============================================================================
+
+
+namespace {
+
+
+/*
+	One client's request, which is queued until a worker classifies it (as
+	part of a batch), and then waits for the connection's thread to send
+	back the results
+*/
+struct Request {
+
+	Request() : finished( false ) {}
+
+	ServeVectors vectors;
+	boost::posix_time::ptime arrival;
+
+	std::vector< double > result;
+	std::string error;
+
+	boost::mutex mutex;
+	boost::condition_variable condition;
+	bool finished;
+
+	void Finish() {
+
+		boost::mutex::scoped_lock lock( mutex );
+		finished = true;
+		condition.notify_one();
+	}
+
+	void Wait() {
+
+		boost::mutex::scoped_lock lock( mutex );
+		while ( ! finished )
+			condition.wait( lock );
+	}
+};
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    Batcher class
+//============================================================================
+
+
+namespace {
+
+
+/*
+	Coalesces the queued requests into batches of at most maximumRows rows
+	(a multiple of the context's batch size, so that the batches fill whole
+	tiles). A batch is taken as soon as there are enough rows to fill it, or
+	once its oldest request has waited for the deadline, whichever comes
+	first. Each connection has at most one request outstanding, so once every
+	connection is waiting for a response, nothing more can arrive, and the
+	batch is taken without waiting. Once the batcher is closed, Submit fails,
+	and Take fails once the remaining requests have been taken.
+*/
+struct Batcher {
+
+	Batcher( unsigned int const maximumRows, boost::posix_time::time_duration const& deadline ) :
+		m_maximumRows( maximumRows ),
+		m_deadline( deadline ),
+		m_closed( false ),
+		m_rows( 0 ),
+		m_connections( 0 ),
+		m_outstanding( 0 )
+	{
+	}
+
+	void Connect() {
+
+		boost::mutex::scoped_lock lock( m_mutex );
+		++m_connections;
+	}
+
+	void Disconnect() {
+
+		boost::mutex::scoped_lock lock( m_mutex );
+		--m_connections;
+		m_changed.notify_all();
+	}
+
+	bool const Submit( Request* const pRequest ) {
+
+		boost::mutex::scoped_lock lock( m_mutex );
+		if ( m_closed )
+			return false;
+
+		pRequest->arrival = boost::posix_time::microsec_clock::universal_time();
+		m_requests.push_back( pRequest );
+		m_rows += pRequest->vectors.lengths.size();
+		++m_outstanding;
+		m_changed.notify_all();
+		return true;
+	}
+
+	// called by the worker which took the requests, once it's finished with them
+	void Complete( size_t const requests ) {
+
+		boost::mutex::scoped_lock lock( m_mutex );
+		m_outstanding -= requests;
+	}
+
+	bool const Take( std::vector< Request* >* const pBatch ) {
+
+		boost::mutex::scoped_lock lock( m_mutex );
+		for ( ; ; ) {
+
+			while ( ( ! m_closed ) && m_requests.empty() )
+				m_changed.wait( lock );
+			if ( m_requests.empty() )
+				return false;
+
+			boost::posix_time::ptime const deadline = m_requests.front()->arrival + m_deadline;
+			while ( ( ! m_closed ) && ( ! m_requests.empty() ) && ( m_rows < m_maximumRows ) && ( m_outstanding < m_connections ) ) {
+
+				if ( ! m_changed.timed_wait( lock, deadline ) )
+					break;
+			}
+			// another worker might have taken everything meanwhile
+			if ( ! m_requests.empty() )
+				break;
+		}
+
+		pBatch->clear();
+		size_t rows = 0;
+		while (
+			( ! m_requests.empty() ) &&
+			( pBatch->empty() || ( rows + m_requests.front()->vectors.lengths.size() <= m_maximumRows ) )
+		)
+		{
+			rows += m_requests.front()->vectors.lengths.size();
+			pBatch->push_back( m_requests.front() );
+			m_requests.pop_front();
+		}
+		m_rows -= rows;
+
+		// what's left is another worker's
+		if ( ! m_requests.empty() )
+			m_changed.notify_all();
+		return true;
+	}
+
+	void Close() {
+
+		boost::mutex::scoped_lock lock( m_mutex );
+		m_closed = true;
+		m_changed.notify_all();
+	}
+
+
+private:
+
+	unsigned int const m_maximumRows;
+	boost::posix_time::time_duration const m_deadline;
+
+	boost::mutex m_mutex;
+	boost::condition_variable m_changed;
+	bool m_closed;
+	std::deque< Request* > m_requests;
+	size_t m_rows;
+	size_t m_connections;
+	size_t m_outstanding;    // submitted, but not yet completed
+};
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    ServeStatistics class
+//============================================================================
+
+
+namespace {
+
+
+/*
+	The latencies (from arrival to classification) of the most recent
+	requests, and a histogram of the number of tiles (batches of the
+	context's batch size) filled by each batch
+*/
+struct ServeStatistics {
+
+	ServeStatistics( unsigned int const tileRows, unsigned int const maximumRows ) :
+		m_start( boost::posix_time::microsec_clock::universal_time() ),
+		m_tileRows( tileRows ),
+		m_tiles( ( maximumRows + tileRows - 1 ) / tileRows + 1 ),
+		m_latencies( 1u << 16 ),
+		m_latencyCount( 0 ),
+		m_requests( 0 ),
+		m_rows( 0 ),
+		m_batches( 0 ),
+		m_errors( 0 ),
+		m_seconds( 0 )
+	{
+	}
+
+	void RecordBatch( std::vector< Request* > const& batch, size_t const rows, double const seconds ) {
+
+		boost::posix_time::ptime const now = boost::posix_time::microsec_clock::universal_time();
+
+		boost::mutex::scoped_lock lock( m_mutex );
+
+		// oversized requests are batched alone, and counted in the last bucket
+		unsigned int const tiles = std::min< size_t >( ( rows + m_tileRows - 1 ) / m_tileRows, m_tiles.size() - 1 );
+		++m_tiles[ tiles ];
+
+		for ( std::vector< Request* >::const_iterator ii = batch.begin(); ii != batch.end(); ++ii ) {
+
+			m_latencies[ m_latencyCount % m_latencies.size() ] = ( now - ( *ii )->arrival ).total_microseconds() * 1e-6;
+			++m_latencyCount;
+			if ( ! ( *ii )->error.empty() )
+				++m_errors;
+		}
+
+		m_requests += batch.size();
+		m_rows += rows;
+		++m_batches;
+		m_seconds += seconds;
+	}
+
+	std::string const Report() {
+
+		boost::mutex::scoped_lock lock( m_mutex );
+
+		std::ostringstream stream;
+
+		double const uptime = ElapsedSeconds( m_start );
+		stream <<
+			"Requests = " << m_requests << ", rows = " << m_rows << ", batches = " << m_batches << ", errors = " << m_errors <<
+			", rows per batch = " << ( ( m_batches > 0 ) ? static_cast< double >( m_rows ) / m_batches : 0.0 ) <<
+			", classification seconds = " << m_seconds << ", uptime seconds = " << uptime << std::endl;
+
+		std::vector< double > latencies( m_latencies.begin(), m_latencies.begin() + std::min< unsigned long long >( m_latencyCount, m_latencies.size() ) );
+		if ( m_latencyCount > m_latencies.size() )
+			stream << "Of the last " << m_latencies.size() << " requests:" << std::endl;
+		ReportLatencies( stream, &latencies );
+
+		stream << "Tiles of " << m_tileRows << " rows    Batches" << std::endl;
+		for ( unsigned int ii = 1; ii < m_tiles.size(); ++ii ) {
+
+			if ( m_tiles[ ii ] > 0 )
+				stream << std::setw( 19 ) << ii << std::setw( 11 ) << m_tiles[ ii ] << std::endl;
+		}
+
+		return stream.str();
+	}
+
+
+private:
+
+	boost::posix_time::ptime const m_start;
+	unsigned int const m_tileRows;
+
+	boost::mutex m_mutex;
+	std::vector< unsigned long long > m_tiles;
+	std::vector< double > m_latencies;    // a ring buffer
+	unsigned long long m_latencyCount;
+	unsigned long long m_requests;
+	unsigned long long m_rows;
+	unsigned long long m_batches;
+	unsigned long long m_errors;
+	double m_seconds;
+};
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    Worker and connection threads
+//============================================================================
+
+
+namespace {
+
+
+/*
+	Classifies batches with its own session, so that the workers don't wait
+	for each other while classifying
+*/
+void WorkerThread( GTSVM_Session const session, unsigned int const classes, Batcher* const pBatcher, ServeStatistics* const pStatistics ) {
+
+	std::vector< Request* > batch;
+	std::vector< float > values;
+	std::vector< size_t > indices;
+	std::vector< size_t > offsets;
+	std::vector< double > result;
+
+	while ( pBatcher->Take( &batch ) ) {
+
+		boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+
+		values.clear();
+		indices.clear();
+		offsets.assign( 1, 0 );
+		unsigned int columns = 0;
+		for ( std::vector< Request* >::const_iterator ii = batch.begin(); ii != batch.end(); ++ii ) {
+
+			ServeVectors const& vectors = ( *ii )->vectors;
+			values.insert( values.end(), vectors.values.begin(), vectors.values.end() );
+			for ( std::vector< boost::uint32_t >::const_iterator jj = vectors.indices.begin(); jj != vectors.indices.end(); ++jj ) {
+
+				indices.push_back( *jj );
+				columns = std::max( columns, *jj + 1 );
+			}
+			for ( std::vector< boost::uint32_t >::const_iterator jj = vectors.lengths.begin(); jj != vectors.lengths.end(); ++jj )
+				offsets.push_back( offsets.back() + *jj );
+		}
+		unsigned int const rows = offsets.size() - 1;
+
+		std::string error;
+		result.resize( static_cast< size_t >( rows ) * classes );
+		if (
+			( rows > 0 ) &&
+			GTSVM_ClassifySparseWithSession(
+				session,
+				&result[ 0 ],
+				GTSVM_TYPE_DOUBLE,
+				( values.empty() ? NULL : &values[ 0 ] ),
+				( indices.empty() ? NULL : &indices[ 0 ] ),
+				&offsets[ 0 ],
+				GTSVM_TYPE_FLOAT,
+				rows,
+				columns,
+				false
+			)
+		)
+		{
+			error = GTSVM_Error();
+		}
+
+		double const seconds = ElapsedSeconds( start );
+
+		// the statistics are recorded before the requests are released, since they're owned by the connections
+		unsigned int row = 0;
+		for ( std::vector< Request* >::const_iterator ii = batch.begin(); ii != batch.end(); ++ii ) {
+
+			unsigned int const requestRows = ( *ii )->vectors.lengths.size();
+			if ( error.empty() )
+				( *ii )->result.assign( result.begin() + static_cast< size_t >( row ) * classes, result.begin() + static_cast< size_t >( row + requestRows ) * classes );
+			else
+				( *ii )->error = error;
+			row += requestRows;
+		}
+		pStatistics->RecordBatch( batch, rows, seconds );
+		pBatcher->Complete( batch.size() );
+		for ( std::vector< Request* >::const_iterator ii = batch.begin(); ii != batch.end(); ++ii )
+			( *ii )->Finish();
+	}
+}
+
+
+// the sockets of the open connections, so that they can be shut down on exit
+struct Connections {
+
+	boost::mutex mutex;
+	boost::condition_variable closed;
+	std::set< int > sockets;
+};
+
+
+void ConnectionThread( int const socket, unsigned int const classes, Batcher* const pBatcher, ServeStatistics* const pStatistics, Connections* const pConnections ) {
+
+	pBatcher->Connect();
+	try {
+
+		ServeRequestHeader header;
+		Request request;
+		while ( ReadServeRequest( socket, &header, &request.vectors ) ) {
+
+			if ( header.type == SERVE_REQUEST_STATISTICS )
+				WriteServeResponse( socket, SERVE_STATUS_OK, 0, 0, NULL, pStatistics->Report() );
+			else {
+
+				request.result.clear();
+				request.error.clear();
+				request.finished = false;
+
+				if ( ! pBatcher->Submit( &request ) )
+					request.error = "The server is shutting down";
+				else
+					request.Wait();
+
+				if ( request.error.empty() )
+					WriteServeResponse( socket, SERVE_STATUS_OK, header.rows, classes, ( request.result.empty() ? NULL : &request.result[ 0 ] ), std::string() );
+				else
+					WriteServeResponse( socket, SERVE_STATUS_ERROR, 0, 0, NULL, request.error );
+			}
+		}
+	}
+	catch( std::exception& error ) {
+
+		// a malformed request ends the connection, but not the server
+		std::cerr << "Connection error: " << error.what() << std::endl;
+	}
+	pBatcher->Disconnect();
+
+	boost::mutex::scoped_lock lock( pConnections->mutex );
+	pConnections->sockets.erase( socket );
+	::close( socket );
+	pConnections->closed.notify_all();
+}
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    main function
+//============================================================================
+
+
+int main( int argc, char* argv[] ) {
+
+	int resultCode = EXIT_SUCCESS;
+
+	std::string input;
+	std::string socketPath;
+	std::string clusteringName;
+	bool smallClusters;
+	unsigned int activeClusters;
+	std::string backend;
+	unsigned int threads;
+	unsigned int batchSize;
+	unsigned int workers;
+	unsigned int maximumRows;
+	unsigned int deadline;
+	unsigned int reportInterval;
+	bool statistics;
+
+	boost::program_options::options_description description( "Allowed options" );
+	description.add_options()
+		( "help,h", "display this help" )
+		( "input,i", boost::program_options::value< std::string >( &input ), "input model file" )
+		( "socket", boost::program_options::value< std::string >( &socketPath ), "Unix domain socket to listen on" )
+		( "clustering", boost::program_options::value< std::string >( &clusteringName )->default_value( "greedy" ), "clustering algorithm: \"greedy\" or \"minhash\"" )
+		( "small_clusters,s", boost::program_options::value< bool >( &smallClusters )->default_value( false ), "use size-16 instead of size-256 clusters?" )
+		( "active_clusters,a", boost::program_options::value< unsigned int >( &activeClusters )->default_value( 64 ), "number of \"active\" clusters" )
+		( "backend", boost::program_options::value< std::string >( &backend )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used by the cpu backend (0 = one per core)" )
+		( "batch_size", boost::program_options::value< unsigned int >( &batchSize )->default_value( 16 ), "number of vectors classified at a time (the tile size): 8, 16, 32, 64 or 128 (only 16 on the cuda backend)" )
+		( "workers", boost::program_options::value< unsigned int >( &workers )->default_value( 1 ), "number of batches classified concurrently" )
+		( "max_batch", boost::program_options::value< unsigned int >( &maximumRows )->default_value( 256 ), "maximum number of rows coalesced into one batch (rounded up to a multiple of batch_size)" )
+		( "deadline", boost::program_options::value< unsigned int >( &deadline )->default_value( 2000 ), "longest time, in microseconds, that a request waits for others to share its batch" )
+		( "report_interval", boost::program_options::value< unsigned int >( &reportInterval )->default_value( 0 ), "seconds between reports written to standard output (0 = only on exit)" )
+		( "statistics", boost::program_options::value< bool >( &statistics )->default_value( true ), "print per-phase performance counters, on exit?" )
+	;
+
+	try {
+
+		boost::program_options::variables_map variables;
+		boost::program_options::store( boost::program_options::command_line_parser( argc, argv ).options( description ).run(), variables );
+		boost::program_options::notify( variables );
+
+		if ( variables.count( "help" ) ) {
+
+			std::cout <<
+				"Loads the model contained in the input file once, and then classifies the" << std::endl <<
+				"vectors sent to the given Unix domain socket, until interrupted (by SIGINT or" << std::endl <<
+				"SIGTERM). The protocol is described in serve_protocol.hpp, and gtsvm_loadgen is" << std::endl <<
+				"a client which generates load, and checks the responses against a serial pass." << std::endl <<
+				std::endl <<
+				"Concurrent requests are coalesced into batches of up to max_batch rows, which" << std::endl <<
+				"is rounded up to a whole number of tiles of batch_size rows. A batch is" << std::endl <<
+				"classified as soon as it's full, once every connection is waiting for a" << std::endl <<
+				"response (each connection has at most one request outstanding), or once its" << std::endl <<
+				"oldest request has waited for deadline microseconds, so the deadline bounds" << std::endl <<
+				"the latency added by batching." << std::endl <<
+				"Each of the workers classifies with its own session, so that batches may be" << std::endl <<
+				"classified concurrently with only one copy of the model." << std::endl <<
+				std::endl <<
+				"The server reports the number of requests, latency percentiles (from the" << std::endl <<
+				"arrival of each request until its batch has been classified), and a histogram" << std::endl <<
+				"of the number of tiles per batch, on exit, every report_interval seconds, and" << std::endl <<
+				"in response to a statistics request." << std::endl <<
+				std::endl <<
+				description << std::endl;
+		}
+		else {
+
+			if ( ! variables.count( "input" ) )
+				throw std::runtime_error( "You must provide an input file" );
+			if ( ! variables.count( "socket" ) )
+				throw std::runtime_error( "You must provide a socket path" );
+			if ( workers < 1 )
+				throw std::runtime_error( "There must be at least one worker" );
+
+			GTSVM_Clustering const clustering = ParseClustering( clusteringName );
+
+			AutoContext context( backend, threads );
+			if ( GTSVM_SetBatchSize( context, batchSize ) )
+				throw std::runtime_error( GTSVM_Error() );
+
+			// as in gtsvm_classify, the model is reclustered for classification (once, this time)
+			if ( GTSVM_Load( context, input.c_str(), clustering, false, 1 ) )
+				throw std::runtime_error( GTSVM_Error() );
+			if ( GTSVM_Shrink( context, clustering, smallClusters, activeClusters ) )
+				throw std::runtime_error( GTSVM_Error() );
+
+			unsigned int classes;
+			if ( GTSVM_GetClasses( context, &classes ) )
+				throw std::runtime_error( GTSVM_Error() );
+
+			if ( maximumRows < batchSize )
+				maximumRows = batchSize;
+			maximumRows = ( ( maximumRows + batchSize - 1 ) / batchSize ) * batchSize;
+
+			Batcher batcher( maximumRows, boost::posix_time::microseconds( deadline ) );
+			ServeStatistics serveStatistics( batchSize, maximumRows );
+
+			std::vector< GTSVM_Session > sessions( workers );
+			for ( unsigned int ii = 0; ii < workers; ++ii ) {
+
+				if ( GTSVM_CreateSession( context, &sessions[ ii ] ) )
+					throw std::runtime_error( GTSVM_Error() );
+			}
+
+			::signal( SIGINT, &Stop );
+			::signal( SIGTERM, &Stop );
+			::signal( SIGPIPE, SIG_IGN );
+
+			int const listener = ListenUnixSocket( socketPath );
+			std::cout << "Listening on " << socketPath << " (classes = " << classes << ", max_batch = " << maximumRows << ", workers = " << workers << ")" << std::endl;
+
+			boost::thread_group workerThreads;
+			for ( unsigned int ii = 0; ii < workers; ++ii )
+				workerThreads.create_thread( boost::bind( &WorkerThread, sessions[ ii ], classes, &batcher, &serveStatistics ) );
+
+			Connections connections;
+			boost::posix_time::ptime lastReport = boost::posix_time::microsec_clock::universal_time();
+			while ( ! g_stop ) {
+
+				pollfd poller;
+				poller.fd = listener;
+				poller.events = POLLIN;
+				poller.revents = 0;
+				if ( ( ::poll( &poller, 1, 250 ) > 0 ) && ( poller.revents & POLLIN ) ) {
+
+					int const socket = ::accept( listener, NULL, NULL );
+					if ( socket >= 0 ) {
+
+						// the connection threads are detached, and waited for by way of connections.sockets
+						boost::mutex::scoped_lock lock( connections.mutex );
+						connections.sockets.insert( socket );
+						boost::thread( boost::bind( &ConnectionThread, socket, classes, &batcher, &serveStatistics, &connections ) ).detach();
+					}
+				}
+
+				if ( ( reportInterval > 0 ) && ( ElapsedSeconds( lastReport ) >= reportInterval ) ) {
+
+					std::cout << serveStatistics.Report() << std::endl;
+					lastReport = boost::posix_time::microsec_clock::universal_time();
+				}
+			}
+
+			::close( listener );
+			::unlink( socketPath.c_str() );
+
+			// the queued requests are still classified, but the connections are then ended
+			batcher.Close();
+			workerThreads.join_all();
+			{	boost::mutex::scoped_lock lock( connections.mutex );
+				for ( std::set< int >::const_iterator ii = connections.sockets.begin(); ii != connections.sockets.end(); ++ii )
+					::shutdown( *ii, SHUT_RDWR );
+				while ( ! connections.sockets.empty() )
+					connections.closed.wait( lock );
+			}
+
+			for ( unsigned int ii = 0; ii < workers; ++ii ) {
+
+				if ( GTSVM_DestroySession( sessions[ ii ] ) )
+					throw std::runtime_error( GTSVM_Error() );
+			}
+
+			std::cout << serveStatistics.Report();
+			if ( statistics )
+				ReportStatistics( std::cout, context );
+		}
+	}
+	catch( std::exception& error ) {
+
+		std::cerr << "Error: " << error.what() << std::endl << std::endl << description << std::endl;
+		resultCode = EXIT_FAILURE;
+	}
+
+	return resultCode;
+}
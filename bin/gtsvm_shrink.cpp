@@ -39,16 +39,22 @@ int main( int argc, char* argv[] ) {
 
 	std::string input;
 	std::string output;
+	std::string clusteringName;
 	bool smallClusters;
 	unsigned int activeClusters;
+	std::string backend;
+	unsigned int threads;
 
 	boost::program_options::options_description description( "Allowed options" );
 	description.add_options()
 		( "help,h", "display this help" )
 		( "input,i", boost::program_options::value< std::string >( &input ), "input model file" )
 		( "output,o", boost::program_options::value< std::string >( &output ), "output text file" )
+		( "clustering", boost::program_options::value< std::string >( &clusteringName )->default_value( "greedy" ), "clustering algorithm: \"greedy\" or \"minhash\"" )
 		( "small_clusters,s", boost::program_options::value< bool >( &smallClusters )->default_value( false ), "use size-16 instead of size-256 clusters?" )
 		( "active_clusters,a", boost::program_options::value< unsigned int >( &activeClusters )->default_value( 64 ), "number of \"active\" clusters" )
+		( "backend", boost::program_options::value< std::string >( &backend )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used by the cpu backend (0 = one per core)" )
 	;
 
 	try {
@@ -74,12 +80,15 @@ int main( int argc, char* argv[] ) {
 			if ( ! variables.count( "output" ) )
 				throw std::runtime_error( "You must provide an output file" );
 
-			AutoContext context;
+			GTSVM_Clustering const clustering = ParseClustering( clusteringName );
+
+			AutoContext context( backend, threads );
 
 			if (
 				GTSVM_Load(
 					context,
 					input.c_str(),
+					clustering,
 					false,
 					1
 				)
@@ -91,6 +100,7 @@ int main( int argc, char* argv[] ) {
 			if (
 				GTSVM_Shrink(
 					context,
+					clustering,
 					smallClusters,
 					activeClusters
 				)
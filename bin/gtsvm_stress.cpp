@@ -0,0 +1,653 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file gtsvm_stress.cpp
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+//============================================================================
+//    Helper functions
+//============================================================================
+
+
+namespace {
+
+
+// everything the worker threads share, none of which they modify
+struct Fixture {
+
+	GTSVM_Backend backend;
+	GTSVM_Context context;
+	std::string model;
+	GTSVM_Clustering clustering;
+	bool smallClusters;
+	unsigned int activeClusters;
+	bool multiclass;
+	float regularization;
+	float gamma;
+	unsigned int rows;
+
+	SVMLightDataset testing;
+	unsigned int classes;
+	std::vector< double > reference;    // the results of a serial classification of the testing set
+	double tolerance;
+
+	unsigned int repetitions;
+
+	GTSVM_Context missingContext;
+	GTSVM_Context uninitializedContext;
+	GTSVM_Session missingSession;
+	std::string missingContextError;
+	std::string uninitializedContextError;
+	std::string missingSessionError;
+};
+
+
+// the outcome of one phase, summed over its threads
+struct Outcome {
+
+	Outcome() : calls( 0 ), failures( 0 ) {}
+
+	boost::mutex mutex;
+	unsigned long long calls;
+	unsigned long long failures;
+	std::string error;
+
+	void Add( unsigned long long const newCalls, unsigned long long const newFailures, std::string const& newError ) {
+
+		boost::mutex::scoped_lock lock( mutex );
+		calls += newCalls;
+		failures += newFailures;
+		if ( error.empty() )
+			error = newError;
+	}
+};
+
+
+// counts the calls and failures of one thread, and remembers the first failure
+struct Tally {
+
+	Tally() : calls( 0 ), failures( 0 ) {}
+
+	unsigned long long calls;
+	unsigned long long failures;
+	std::string error;
+
+	void Fail( std::string const& message ) {
+
+		if ( failures++ == 0 )
+			error = message;
+	}
+
+	// call with the result of a GTSVM function, returns true if it succeeded
+	bool const Check( bool const failed ) {
+
+		++calls;
+		if ( failed )
+			Fail( GTSVM_Error() );
+		return( ! failed );
+	}
+};
+
+
+// compares a classification of the testing set against the serial one
+void Compare( Tally* const pTally, Fixture const& fixture, std::vector< double > const& result, char const* const what ) {
+
+	unsigned int mismatches = 0;
+	double largest = 0;
+	for ( size_t ii = 0; ii < fixture.reference.size(); ++ii ) {
+
+		double const difference = std::fabs( result[ ii ] - fixture.reference[ ii ] ) / std::max( 1.0, std::fabs( fixture.reference[ ii ] ) );
+		if ( ! ( difference <= fixture.tolerance ) ) {
+
+			++mismatches;
+			if ( ! ( difference <= largest ) )
+				largest = difference;
+		}
+	}
+	if ( mismatches > 0 ) {
+
+		std::ostringstream stream;
+		stream << what << ": " << mismatches << " results differ from those of the serial classification, by up to " << largest << " (relative)";
+		pTally->Fail( stream.str() );
+	}
+}
+
+
+bool const Classify( Fixture const& fixture, GTSVM_Context const context, std::vector< double >* const pResult ) {
+
+	pResult->assign( fixture.reference.size(), std::numeric_limits< double >::quiet_NaN() );
+	return GTSVM_ClassifySparse(
+		context,
+		&( *pResult )[ 0 ],
+		GTSVM_TYPE_DOUBLE,
+		&fixture.testing.values[ 0 ],
+		&fixture.testing.indices[ 0 ],
+		&fixture.testing.offsets[ 0 ],
+		GTSVM_TYPE_FLOAT,
+		fixture.testing.rows,
+		fixture.testing.columns,
+		false
+	);
+}
+
+
+bool const ClassifyWithSession( Fixture const& fixture, GTSVM_Session const session, std::vector< double >* const pResult ) {
+
+	pResult->assign( fixture.reference.size(), std::numeric_limits< double >::quiet_NaN() );
+	return GTSVM_ClassifySparseWithSession(
+		session,
+		&( *pResult )[ 0 ],
+		GTSVM_TYPE_DOUBLE,
+		&fixture.testing.values[ 0 ],
+		&fixture.testing.indices[ 0 ],
+		&fixture.testing.offsets[ 0 ],
+		GTSVM_TYPE_FLOAT,
+		fixture.testing.rows,
+		fixture.testing.columns,
+		false
+	);
+}
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    Worker threads
+//============================================================================
+
+
+namespace {
+
+
+// classifies with the shared context itself, so calls take turns
+void SharedContextThread( Outcome* const pOutcome, Fixture const* const pFixture, unsigned int const worker ) {
+
+	Tally tally;
+	std::vector< double > result;
+	for ( unsigned int ii = 0; ii < pFixture->repetitions; ++ii )
+		if ( tally.Check( Classify( *pFixture, pFixture->context, &result ) ) )
+			Compare( &tally, *pFixture, result, "GTSVM_ClassifySparse" );
+	pOutcome->Add( tally.calls, tally.failures, tally.error );
+}
+
+
+// classifies with one session of the shared context, so calls run concurrently
+void SessionThread( Outcome* const pOutcome, Fixture const* const pFixture, unsigned int const worker ) {
+
+	Tally tally;
+	GTSVM_Session session;
+	if ( tally.Check( GTSVM_CreateSession( pFixture->context, &session ) ) ) {
+
+		std::vector< double > result;
+		for ( unsigned int ii = 0; ii < pFixture->repetitions; ++ii )
+			if ( tally.Check( ClassifyWithSession( *pFixture, session, &result ) ) )
+				Compare( &tally, *pFixture, result, "GTSVM_ClassifySparseWithSession" );
+
+		tally.Check( GTSVM_DestroySession( session ) );
+	}
+	pOutcome->Add( tally.calls, tally.failures, tally.error );
+}
+
+
+// loads its own copy of the model, and classifies with it
+void PrivateContextThread( Outcome* const pOutcome, Fixture const* const pFixture, unsigned int const worker ) {
+
+	Tally tally;
+	GTSVM_Context context;
+	if ( tally.Check( GTSVM_CreateWithBackend( &context, pFixture->backend ) ) ) {
+
+		if (
+			tally.Check(
+				GTSVM_Load(
+					context,
+					pFixture->model.c_str(),
+					pFixture->clustering,
+					pFixture->smallClusters,
+					pFixture->activeClusters
+				)
+			)
+		)
+		{
+			std::vector< double > result;
+			for ( unsigned int ii = 0; ii < pFixture->repetitions; ++ii )
+				if ( tally.Check( Classify( *pFixture, context, &result ) ) )
+					Compare( &tally, *pFixture, result, "GTSVM_ClassifySparse (private context)" );
+		}
+
+		tally.Check( GTSVM_Destroy( context ) );
+	}
+	pOutcome->Add( tally.calls, tally.failures, tally.error );
+}
+
+
+/*
+	Odd workers repeatedly create a context sharing the shared context's
+	training data, optimize it briefly, create a session on it, and destroy
+	the context before classifying with the session (which must keep the
+	model alive), while even workers classify with the shared context
+*/
+void ChurnThread( Outcome* const pOutcome, Fixture const* const pFixture, unsigned int const worker ) {
+
+	Tally tally;
+	std::vector< double > result;
+	for ( unsigned int ii = 0; ii < pFixture->repetitions; ++ii ) {
+
+		if ( ( worker & 1 ) == 0 ) {
+
+			if ( tally.Check( Classify( *pFixture, pFixture->context, &result ) ) )
+				Compare( &tally, *pFixture, result, "GTSVM_ClassifySparse (during churn)" );
+			continue;
+		}
+
+		GTSVM_Context context;
+		if ( ! tally.Check( GTSVM_CreateWithBackend( &context, pFixture->backend ) ) )
+			continue;
+
+		GTSVM_Session session;
+		bool haveSession = false;
+
+		if (
+			tally.Check(
+				GTSVM_InitializeShared(
+					context,
+					pFixture->context,
+					NULL,
+					GTSVM_TYPE_INT32,
+					pFixture->multiclass,
+					pFixture->regularization,
+					GTSVM_KERNEL_GAUSSIAN,
+					pFixture->gamma,
+					0,
+					0,
+					false
+				)
+			)
+		)
+		{
+			unsigned int rows = 0;
+			if ( tally.Check( GTSVM_GetRows( context, &rows ) ) && ( rows != pFixture->rows ) )
+				tally.Fail( "GTSVM_GetRows: a context sharing training data has the wrong number of rows" );
+
+			double primal;
+			double dual;
+			tally.Check( GTSVM_Optimize( context, &primal, &dual, 256 ) );
+
+			haveSession = tally.Check( GTSVM_CreateSession( context, &session ) );
+		}
+
+		tally.Check( GTSVM_Destroy( context ) );
+
+		if ( haveSession ) {
+
+			tally.Check( ClassifyWithSession( *pFixture, session, &result ) );
+			tally.Check( GTSVM_DestroySession( session ) );
+		}
+
+		unsigned int rows;
+		++tally.calls;
+		if ( ! GTSVM_GetRows( context, &rows ) )
+			tally.Fail( "GTSVM_GetRows: a destroyed context is still usable" );
+	}
+	pOutcome->Add( tally.calls, tally.failures, tally.error );
+}
+
+
+/*
+	Workers make calls which fail because the context doesn't exist, because
+	it hasn't been initialized, or because the session doesn't exist
+	(depending on the worker), and all of them make calls which succeed, so
+	each must see only its own errors
+*/
+void ErrorThread( Outcome* const pOutcome, Fixture const* const pFixture, unsigned int const worker ) {
+
+	Tally tally;
+	for ( unsigned int ii = 0; ii < pFixture->repetitions; ++ii ) {
+
+		std::string const* pExpected;
+		bool failed;
+		unsigned int rows;
+		switch( worker % 3 ) {
+
+			case 0: {
+
+				pExpected = &pFixture->missingContextError;
+				failed = GTSVM_GetRows( pFixture->missingContext, &rows );
+				break;
+			}
+
+			case 1: {
+
+				pExpected = &pFixture->uninitializedContextError;
+				failed = GTSVM_GetRows( pFixture->uninitializedContext, &rows );
+				break;
+			}
+
+			default: {
+
+				pExpected = &pFixture->missingSessionError;
+				failed = GTSVM_DestroySession( pFixture->missingSession );
+				break;
+			}
+		}
+		++tally.calls;
+
+		// give the other threads a chance to overwrite our error, if they could
+		boost::this_thread::yield();
+
+		if ( ! failed )
+			tally.Fail( "A call which should have failed succeeded" );
+		else if ( *pExpected != GTSVM_Error() )
+			tally.Fail( std::string( "GTSVM_Error returned \"" ) + GTSVM_Error() + "\" instead of \"" + *pExpected + "\"" );
+
+		if ( tally.Check( GTSVM_GetRows( pFixture->context, &rows ) ) ) {
+
+			boost::this_thread::yield();
+			if ( std::string( "No error" ) != GTSVM_Error() )
+				tally.Fail( std::string( "GTSVM_Error returned \"" ) + GTSVM_Error() + "\" after a successful call" );
+		}
+	}
+	pOutcome->Add( tally.calls, tally.failures, tally.error );
+}
+
+
+// changes the number of CPU backend threads until interrupted
+void SetThreadsThread( Outcome* const pOutcome, unsigned int const maximumThreads ) {
+
+	Tally tally;
+	try {
+
+		for ( unsigned int ii = 0; ; ++ii ) {
+
+			tally.Check( GTSVM_SetThreads( 1 + ( ii % maximumThreads ) ) );
+			boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ) );
+		}
+	}
+	catch( boost::thread_interrupted& ) {}
+	pOutcome->Add( tally.calls, tally.failures, tally.error );
+}
+
+
+typedef void ( *WorkerThread )( Outcome* const pOutcome, Fixture const* const pFixture, unsigned int const worker );
+
+
+/*
+	Runs the given worker on each of the threads, while another changes the
+	number of CPU backend threads, reports the outcome, and returns true if
+	nothing failed
+*/
+bool const RunPhase( std::ostream& stream, char const* const name, WorkerThread const worker, Fixture const& fixture, unsigned int const workers, unsigned int const maximumThreads ) {
+
+	Outcome outcome;
+	Outcome setThreadsOutcome;
+
+	boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+
+	boost::thread setThreadsThread( boost::bind( &SetThreadsThread, &setThreadsOutcome, maximumThreads ) );
+	boost::thread_group workerThreads;
+	for ( unsigned int ii = 0; ii < workers; ++ii )
+		workerThreads.create_thread( boost::bind( worker, &outcome, &fixture, ii ) );
+	workerThreads.join_all();
+	setThreadsThread.interrupt();
+	setThreadsThread.join();
+
+	double const seconds = ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds() * 1e-6;
+
+	stream <<
+		std::left << std::setw( 20 ) << name << std::right <<
+		std::setw( 10 ) << outcome.calls << " calls" <<
+		std::setw( 8 ) << outcome.failures << " failures" <<
+		std::setw( 8 ) << setThreadsOutcome.calls << " GTSVM_SetThreads calls" <<
+		std::setw( 10 ) << std::fixed << std::setprecision( 3 ) << seconds << " seconds" <<
+		std::endl;
+	stream.unsetf( std::ios_base::floatfield );
+	stream << std::setprecision( 6 );
+
+	if ( ! outcome.error.empty() )
+		stream << "    first failure: " << outcome.error << std::endl;
+	if ( ! setThreadsOutcome.error.empty() )
+		stream << "    first GTSVM_SetThreads failure: " << setThreadsOutcome.error << std::endl;
+
+	return( ( outcome.failures == 0 ) && ( setThreadsOutcome.failures == 0 ) );
+}
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    main function
+//============================================================================
+
+
+int main( int argc, char* argv[] ) {
+
+	int resultCode = EXIT_SUCCESS;
+
+	SyntheticDatasetParameters parameters;
+	unsigned int testRows;
+	float gamma = std::numeric_limits< float >::quiet_NaN();
+	unsigned int iterations;
+	std::string clusteringName;
+	unsigned int workers;
+	std::string backendName;
+	unsigned int threads;
+	unsigned int maximumThreads;
+
+	Fixture fixture;
+
+	boost::program_options::options_description description( "Allowed options" );
+	description.add_options()
+		( "help,h", "display this help" )
+		( "rows,r", boost::program_options::value< unsigned int >( &parameters.rows )->default_value( 2000 ), "number of training rows" )
+		( "test_rows,t", boost::program_options::value< unsigned int >( &testRows )->default_value( 500 ), "number of testing rows" )
+		( "columns,c", boost::program_options::value< unsigned int >( &parameters.columns )->default_value( 1000 ), "number of columns" )
+		( "density,d", boost::program_options::value< double >( &parameters.density )->default_value( 0.02 ), "fraction of the columns which are nonzero in each row (1 = dense)" )
+		( "classes,k", boost::program_options::value< unsigned int >( &parameters.classes )->default_value( 2 ), "number of classes" )
+		( "seed", boost::program_options::value< boost::uint32_t >( &parameters.seed )->default_value( 0 ), "random seed" )
+		( "regularization,C", boost::program_options::value< float >( &fixture.regularization )->default_value( 1 ), "regularization parameter" )
+		( "gamma,1", boost::program_options::value< float >( &gamma ), "Gaussian kernel parameter (default: one over the number of nonzeros in each row)" )
+		( "iterations,n", boost::program_options::value< unsigned int >( &iterations )->default_value( 2048 ), "number of optimization iterations of the shared model" )
+		( "clustering", boost::program_options::value< std::string >( &clusteringName )->default_value( "greedy" ), "clustering algorithm: \"greedy\" or \"minhash\"" )
+		( "small_clusters,s", boost::program_options::value< bool >( &fixture.smallClusters )->default_value( false ), "use size-16 instead of size-256 clusters?" )
+		( "active_clusters,a", boost::program_options::value< unsigned int >( &fixture.activeClusters )->default_value( 64 ), "number of \"active\" clusters" )
+		( "model,m", boost::program_options::value< std::string >( &fixture.model )->default_value( "gtsvm_stress.mdl" ), "temporary model file, loaded by the private contexts" )
+		( "workers,w", boost::program_options::value< unsigned int >( &workers )->default_value( 8 ), "number of concurrent threads calling the library" )
+		( "repetitions", boost::program_options::value< unsigned int >( &fixture.repetitions )->default_value( 20 ), "number of times each thread repeats its work in each phase" )
+		( "tolerance", boost::program_options::value< double >( &fixture.tolerance )->default_value( 1e-4 ), "largest relative difference from the serial classification which isn't a failure" )
+		( "backend", boost::program_options::value< std::string >( &backendName )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used by the cpu backend for the serial classification (0 = one per core)" )
+		( "maximum_threads", boost::program_options::value< unsigned int >( &maximumThreads )->default_value( 4 ), "the number of cpu backend threads is varied between one and this, during each phase" )
+	;
+
+	try {
+
+		boost::program_options::variables_map variables;
+		boost::program_options::store( boost::program_options::command_line_parser( argc, argv ).options( description ).run(), variables );
+		boost::program_options::notify( variables );
+
+		if ( variables.count( "help" ) ) {
+
+			std::cout <<
+				"Exercises the thread-safety of the library: trains a model on a synthetic" << std::endl <<
+				"dataset (see gtsvm_generate), classifies a testing set with it serially, and" << std::endl <<
+				"then runs the following phases, in each of which the given number of threads" << std::endl <<
+				"call the library at once, while another repeatedly changes the number of" << std::endl <<
+				"threads used by the cpu backend:" << std::endl <<
+				"	shared_context   each classifies with the model's context" << std::endl <<
+				"	sessions         each classifies with its own session of the model" << std::endl <<
+				"	private_contexts each loads the model into its own context, and" << std::endl <<
+				"	                 classifies with it" << std::endl <<
+				"	churn            half classify with the model's context, while the other" << std::endl <<
+				"	                 half create, optimize and destroy contexts sharing its" << std::endl <<
+				"	                 training data" << std::endl <<
+				"	errors           each makes calls which fail in its own way, interleaved" << std::endl <<
+				"	                 with calls which succeed, and checks GTSVM_Error" << std::endl <<
+				"Every classification must match the serial one, up to the tolerance: the cpu" << std::endl <<
+				"backend sums in an order which depends on its number of threads, so results" << std::endl <<
+				"differ in the last few bits as that changes (with threads and maximum_threads" << std::endl <<
+				"both one, they should match exactly, given a tolerance of zero). The outcome" << std::endl <<
+				"of each phase is reported, and the exit code is nonzero if anything failed." << std::endl <<
+				std::endl <<
+				description << std::endl;
+		}
+		else {
+
+			if ( testRows < 1 )
+				throw std::runtime_error( "There must be at least one testing row" );
+			if ( workers < 1 )
+				throw std::runtime_error( "There must be at least one worker" );
+			if ( maximumThreads < 1 )
+				throw std::runtime_error( "The maximum number of threads must be at least one" );
+
+			// the testing set is drawn with a different seed, so needn't share the training set's labeling
+			SVMLightDataset training;
+			GenerateSyntheticDataset( &training, parameters );
+			{	SyntheticDatasetParameters testingParameters( parameters );
+				testingParameters.rows = testRows;
+				testingParameters.seed = parameters.seed + 1;
+				GenerateSyntheticDataset( &fixture.testing, testingParameters );
+			}
+			if ( ! variables.count( "gamma" ) )
+				gamma = static_cast< float >( training.rows ) / training.values.size();
+
+			fixture.clustering = ParseClustering( clusteringName );
+			fixture.multiclass = ( parameters.classes > 2 );
+			fixture.gamma = gamma;
+			fixture.rows = training.rows;
+
+			fixture.backend = ParseBackend( backendName );
+			AutoContext context( backendName, threads );
+			fixture.context = context;
+			AutoContext uninitializedContext( backendName, threads );
+			fixture.uninitializedContext = uninitializedContext;
+
+			if (
+				GTSVM_InitializeSparse(
+					context,
+					&training.values[ 0 ],
+					&training.indices[ 0 ],
+					&training.offsets[ 0 ],
+					GTSVM_TYPE_FLOAT,
+					&training.labels[ 0 ],
+					GTSVM_TYPE_INT32,
+					training.rows,
+					training.columns,
+					false,
+					fixture.multiclass,
+					fixture.regularization,
+					GTSVM_KERNEL_GAUSSIAN,
+					gamma,
+					0,
+					0,
+					false,
+					GTSVM_COLUMN_ORDER_ORIGINAL,
+					fixture.clustering,
+					fixture.smallClusters,
+					fixture.activeClusters
+				)
+			)
+			{
+				throw std::runtime_error( GTSVM_Error() );
+			}
+
+			double primal =  std::numeric_limits< double >::infinity();
+			double dual   = -std::numeric_limits< double >::infinity();
+			unsigned int const repetitions = 256;    // must be a multiple of the batch size
+			for ( unsigned int ii = 0; ii < iterations; ii += repetitions )
+				if ( GTSVM_Optimize( context, &primal, &dual, repetitions ) )
+					throw std::runtime_error( GTSVM_Error() );
+			std::cout << "Trained on " << training.rows << " rows, primal = " << primal << ", dual = " << dual << std::endl;
+
+			if ( GTSVM_Save( context, fixture.model.c_str() ) )
+				throw std::runtime_error( GTSVM_Error() );
+
+			if ( GTSVM_GetClasses( context, &fixture.classes ) )
+				throw std::runtime_error( GTSVM_Error() );
+			fixture.reference.resize( static_cast< size_t >( fixture.testing.rows ) * fixture.classes );
+			if ( Classify( fixture, context, &fixture.reference ) )
+				throw std::runtime_error( GTSVM_Error() );
+
+			// contexts and a session which no longer exist or aren't initialized, and the errors which using them gives
+			{	GTSVM_Context missingContext;
+				if ( GTSVM_CreateWithBackend( &missingContext, fixture.backend ) )
+					throw std::runtime_error( GTSVM_Error() );
+				if ( GTSVM_Destroy( missingContext ) )
+					throw std::runtime_error( GTSVM_Error() );
+				fixture.missingContext = missingContext;
+
+				unsigned int rows;
+				if ( ! GTSVM_GetRows( missingContext, &rows ) )
+					throw std::runtime_error( "A destroyed context is still usable" );
+				fixture.missingContextError = GTSVM_Error();
+
+				if ( ! GTSVM_GetRows( uninitializedContext, &rows ) )
+					throw std::runtime_error( "An uninitialized context is usable" );
+				fixture.uninitializedContextError = GTSVM_Error();
+
+				GTSVM_Session missingSession;
+				if ( GTSVM_CreateSession( context, &missingSession ) )
+					throw std::runtime_error( GTSVM_Error() );
+				if ( GTSVM_DestroySession( missingSession ) )
+					throw std::runtime_error( GTSVM_Error() );
+				fixture.missingSession = missingSession;
+
+				if ( ! GTSVM_DestroySession( missingSession ) )
+					throw std::runtime_error( "A destroyed session still exists" );
+				fixture.missingSessionError = GTSVM_Error();
+			}
+
+			std::cout << "Classified " << fixture.testing.rows << " rows serially, stressing with " << workers << " threads:" << std::endl;
+
+			bool passed = true;
+			passed &= RunPhase( std::cout, "shared_context",   &SharedContextThread,  fixture, workers, maximumThreads );
+			passed &= RunPhase( std::cout, "sessions",         &SessionThread,        fixture, workers, maximumThreads );
+			passed &= RunPhase( std::cout, "private_contexts", &PrivateContextThread, fixture, workers, maximumThreads );
+			passed &= RunPhase( std::cout, "churn",            &ChurnThread,          fixture, workers, maximumThreads );
+			passed &= RunPhase( std::cout, "errors",           &ErrorThread,          fixture, workers, maximumThreads );
+
+			if ( GTSVM_SetThreads( threads ) )
+				throw std::runtime_error( GTSVM_Error() );
+			std::remove( fixture.model.c_str() );
+
+			std::cout << ( passed ? "Passed" : "FAILED" ) << std::endl;
+			if ( ! passed )
+				resultCode = EXIT_FAILURE;
+		}
+	}
+	catch( std::exception& error ) {
+
+		std::cerr << "Error: " << error.what() << std::endl << std::endl << description << std::endl;
+		resultCode = EXIT_FAILURE;
+	}
+
+	return resultCode;
+}
@@ -0,0 +1,264 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file gtsvm_train.cpp
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+//============================================================================
+//    main function
+//============================================================================
+
+
+int main( int argc, char* argv[] ) {
+
+	int resultCode = EXIT_SUCCESS;
+
+	std::string dataset;
+	std::string output;
+	bool multiclass;
+	float regularization = std::numeric_limits< float >::quiet_NaN();
+	std::string kernelName;
+	float kernelParameter1 = std::numeric_limits< float >::quiet_NaN();
+	float kernelParameter2 = std::numeric_limits< float >::quiet_NaN();
+	float kernelParameter3 = std::numeric_limits< float >::quiet_NaN();
+	bool biased;
+	double epsilon = std::numeric_limits< double >::quiet_NaN();
+	unsigned int iterations;
+	std::string columnOrderName;
+	std::string clusteringName;
+	bool smallClusters;
+	unsigned int activeClusters;
+	bool shrink;
+	std::string backend;
+	unsigned int threads;
+	unsigned int batchSize;
+	bool shrinking;
+	bool memory;
+	bool cache;
+
+	boost::program_options::options_description description( "Allowed options" );
+	description.add_options()
+		( "help,h", "display this help" )
+		( "file,f", boost::program_options::value< std::string >( &dataset ), "dataset file(s), in SVM-Light or binary format (a comma-separated list of glob patterns)" )
+		( "output,o", boost::program_options::value< std::string >( &output ), "output model file" )
+		( "multiclass,m", boost::program_options::value< bool >( &multiclass )->default_value( false ), "is this a multiclass problem?" )
+		( "regularization,C", boost::program_options::value< float >( &regularization ), "regularization parameter" )
+		( "kernel,k", boost::program_options::value< std::string >( &kernelName ), "kernel" )
+		( "parameter1,1", boost::program_options::value< float >( &kernelParameter1 ), "first kernel parameter" )
+		( "parameter2,2", boost::program_options::value< float >( &kernelParameter2 ), "second kernel parameter" )
+		( "parameter3,3", boost::program_options::value< float >( &kernelParameter3 ), "third kernel parameter" )
+		( "biased,b", boost::program_options::value< bool >( &biased )->default_value( false ), "include an unregularized bias?" )
+		( "epsilon,e", boost::program_options::value< double >( &epsilon ), "termination threshold" )
+		( "iterations,n", boost::program_options::value< unsigned int >( &iterations ), "maximum number of iterations" )
+		( "column_order", boost::program_options::value< std::string >( &columnOrderName )->default_value( "original" ), "order of the (used) columns: \"original\" or \"cooccurrence\"" )
+		( "clustering", boost::program_options::value< std::string >( &clusteringName )->default_value( "greedy" ), "clustering algorithm: \"greedy\" or \"minhash\"" )
+		( "small_clusters,s", boost::program_options::value< bool >( &smallClusters )->default_value( false ), "use size-16 instead of size-256 clusters?" )
+		( "active_clusters,a", boost::program_options::value< unsigned int >( &activeClusters )->default_value( 64 ), "number of \"active\" clusters" )
+		( "shrink", boost::program_options::value< bool >( &shrink )->default_value( false ), "remove the vectors with zero dual variables before saving?" )
+		( "backend", boost::program_options::value< std::string >( &backend )->default_value( "default" ), "execution backend: \"cuda\", \"cpu\" or \"default\"" )
+		( "threads", boost::program_options::value< unsigned int >( &threads )->default_value( 0 ), "number of threads used to read the dataset, and by the cpu backend (0 = one per core)" )
+		( "batch_size", boost::program_options::value< unsigned int >( &batchSize )->default_value( 16 ), "number of training vectors optimized over at each iteration: 8, 16, 32, 64 or 128 (only 16 on the cuda backend)" )
+		( "shrinking", boost::program_options::value< bool >( &shrinking )->default_value( false ), "shrink the active set while optimizing (binary problems only)?" )
+		( "cache", boost::program_options::value< bool >( &cache )->default_value( false ), "read SVM-Light files from, and write them to, binary caches alongside them?" )
+		( "memory", boost::program_options::value< bool >( &memory )->default_value( false ), "print the memory used by each buffer, before optimizing?" )
+	;
+	
+
+
+	try {
+
+		boost::program_options::variables_map variables;
+		boost::program_options::store( boost::program_options::command_line_parser( argc, argv ).options( description ).run(), variables );
+		boost::program_options::notify( variables );
+
+		if ( variables.count( "help" ) ) {
+
+			std::cout <<
+				"Trains a model on the given dataset (in SVM-Light format), and saves it to the" << std::endl <<
+				"output model file. This does, in one process, what gtsvm_initialize," << std::endl <<
+				"gtsvm_optimize and (optionally) gtsvm_shrink do in turn, but the dataset is" << std::endl <<
+				"parsed, clustered and saved only once. The parameters have the same meanings" << std::endl <<
+				"as those of these three tools (see their help)." << std::endl <<
+				std::endl <<
+				description << std::endl;
+		}
+		else {
+
+			if ( ! variables.count( "file" ) )
+				throw std::runtime_error( "You must provide a dataset file" );
+			if ( ! variables.count( "output" ) )
+				throw std::runtime_error( "You must provide an output file" );
+			if ( ! variables.count( "regularization" ) )
+				throw std::runtime_error( "You must provide a regularization parameter" );
+			if ( ! variables.count( "kernel" ) )
+				throw std::runtime_error( "You must provide a kernel parameter" );
+			if ( ! variables.count( "epsilon" ) )
+				throw std::runtime_error( "You must provide a epsilon parameter" );
+			if ( boost::math::isinf( epsilon ) )
+				throw std::runtime_error( "The epsilon parameter must be finite" );
+			if ( boost::math::isnan( epsilon ) )
+				throw std::runtime_error( "The epsilon parameter cannot be NaN" );
+			if ( epsilon <= 0 )
+				throw std::runtime_error( "The epsilon parameter must be positive" );
+			if ( ! variables.count( "iterations" ) )
+				throw std::runtime_error( "You must provide an iterations parameter" );
+
+			GTSVM_Kernel kernel;
+			if ( boost::iequals( kernelName, "gaussian" ) ) {
+
+				kernel = GTSVM_KERNEL_GAUSSIAN;
+				if ( ! variables.count( "parameter1" ) )
+					throw std::runtime_error( "You must provide parameter1 for the Gaussian kernel" );
+				if ( variables.count( "parameter2" ) )
+					throw std::runtime_error( "The Gaussian kernel does not require parameter2" );
+				if ( variables.count( "parameter3" ) )
+					throw std::runtime_error( "The Gaussian kernel does not require parameter3" );
+			}
+			else if ( boost::iequals( kernelName, "polynomial" ) ) {
+
+				kernel = GTSVM_KERNEL_POLYNOMIAL;
+				if ( ! variables.count( "parameter1" ) )
+					throw std::runtime_error( "You must provide parameter1 for the polynomial kernel" );
+				if ( ! variables.count( "parameter2" ) )
+					throw std::runtime_error( "You must provide parameter2 for the polynomial kernel" );
+				if ( ! variables.count( "parameter3" ) )
+					throw std::runtime_error( "You must provide parameter3 for the polynomial kernel" );
+			}
+			else if ( boost::iequals( kernelName, "sigmoid" ) ) {
+
+				kernel = GTSVM_KERNEL_SIGMOID;
+				if ( ! variables.count( "parameter1" ) )
+					throw std::runtime_error( "You must provide parameter1 for the sigmoid kernel" );
+				if ( ! variables.count( "parameter2" ) )
+					throw std::runtime_error( "You must provide parameter2 for the sigmoid kernel" );
+				if ( variables.count( "parameter3" ) )
+					throw std::runtime_error( "The sigmoid kernel does not require parameter3" );
+			}
+			else
+				throw std::runtime_error( "The kernel parameter must be one of \"gaussian\", \"polynomial\" and \"sigmoid\"" );
+
+			// load the dataset file
+			SVMLightDataset data;
+			ReadDataset( &data, dataset, threads, cache );
+			ReportSVMLight( std::cout, data );
+
+			GTSVM_ColumnOrder const columnOrder = ParseColumnOrder( columnOrderName );
+			GTSVM_Clustering const clustering = ParseClustering( clusteringName );
+
+			AutoContext context( backend, threads );
+			if ( GTSVM_SetBatchSize( context, batchSize ) )
+				throw std::runtime_error( GTSVM_Error() );
+			if ( GTSVM_SetShrinking( context, shrinking ) )
+				throw std::runtime_error( GTSVM_Error() );
+
+			if (
+				GTSVM_InitializeSparse(
+					context,
+					&data.values[ 0 ],
+					&data.indices[ 0 ],
+					&data.offsets[ 0 ],
+					GTSVM_TYPE_FLOAT,
+					&data.labels[ 0 ],
+					GTSVM_TYPE_INT32,
+					data.rows,
+					data.columns,
+					false,
+					multiclass,
+					regularization,
+					kernel,
+					kernelParameter1,
+					kernelParameter2,
+					kernelParameter3,
+					biased,
+					columnOrder,
+					clustering,
+					smallClusters,
+					activeClusters
+				)
+			)
+			{
+				throw std::runtime_error( GTSVM_Error() );
+			}
+
+			if ( memory ) {
+
+				GTSVM_MemoryUsage usage;
+				if ( GTSVM_GetMemoryUsage( context, &usage ) )
+					throw std::runtime_error( GTSVM_Error() );
+				ReportMemoryUsage( std::cout, usage );
+			}
+
+			{	unsigned int const repetitions = 256;    // must be a multiple of the batch size
+
+				for ( unsigned int ii = 0; ii < iterations; ii += repetitions ) {
+
+					double primal =  std::numeric_limits< double >::infinity();
+					double dual   = -std::numeric_limits< double >::infinity();
+					if (
+						GTSVM_Optimize(
+							context,
+							&primal,
+							&dual,
+							repetitions
+						)
+					)
+					{
+						throw std::runtime_error( GTSVM_Error() );
+					}
+					std::cout << "Iteration " << ( ii + 1 ) << '/' << iterations << ", primal = " << primal << ", dual = " << dual << std::endl;
+					if ( 2 * ( primal - dual ) < epsilon * ( primal + dual ) )
+						break;
+				}
+			}
+
+			if ( shrink ) {
+
+				if (
+					GTSVM_Shrink(
+						context,
+						clustering,
+						smallClusters,
+						activeClusters
+					)
+				)
+				{
+					throw std::runtime_error( GTSVM_Error() );
+				}
+			}
+
+			if ( GTSVM_Save( context, output.c_str() ) )
+				throw std::runtime_error( GTSVM_Error() );
+		}
+	}
+	catch( std::exception& error ) {
+
+		std::cerr << "Error: " << error.what() << std::endl << std::endl << description << std::endl;
+		resultCode = EXIT_FAILURE;
+	}
+
+	return resultCode;
+}
@@ -31,13 +31,27 @@
 
 
 #include "auto_context.hpp"
+#include "svmlight_reader.hpp"
+#include "dataset_file.hpp"
+#include "bounded_queue.hpp"
+#include "synthetic_dataset.hpp"
+#include "serve_protocol.hpp"
 
 
 #include <gtsvm.h>
 
 
-#include <boost/regex.hpp>
 #include <boost/program_options.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/crc.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <boost/random/normal_distribution.hpp>
 
 #include <boost/math/special_functions.hpp>
 #include <boost/algorithm/string.hpp>
@@ -50,9 +64,12 @@
 
 #include <string>
 #include <vector>
+#include <set>
+#include <deque>
 
 #include <sstream>
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 
 #include <stdexcept>
@@ -61,11 +78,21 @@
 #include <memory>
 
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
 #include <cstddef>
 #include <cmath>
 
 
 #include <math.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <errno.h>
 
 
 
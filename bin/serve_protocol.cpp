@@ -0,0 +1,336 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file serve_protocol.cpp
+	\brief implementation of the protocol spoken by gtsvm_serve and its clients
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace {
+
+
+
+
+//============================================================================
+//    Limits
+//============================================================================
+
+
+// larger requests are considered malformed, rather than risking a huge allocation
+unsigned int const g_maximumRows     = ( 1u << 20 );
+unsigned int const g_maximumNonzeros = ( 1u << 28 );
+unsigned int const g_maximumLength   = ( 1u << 24 );
+
+
+
+
+//============================================================================
+//    SocketAddress helper function
+//============================================================================
+
+
+sockaddr_un const SocketAddress( std::string const& path ) {
+
+	sockaddr_un address;
+	std::memset( &address, 0, sizeof( address ) );
+	address.sun_family = AF_UNIX;
+	if ( path.size() >= sizeof( address.sun_path ) )
+		throw std::runtime_error( "The socket path is too long" );
+	std::strcpy( address.sun_path, path.c_str() );
+	return address;
+}
+
+
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    Socket functions
+//============================================================================
+
+
+int ListenUnixSocket( std::string const& path ) {
+
+	sockaddr_un const address = SocketAddress( path );
+
+	// a socket left behind by a server which didn't exit cleanly would make bind() fail
+	struct stat status;
+	if ( ( ::stat( path.c_str(), &status ) == 0 ) && S_ISSOCK( status.st_mode ) )
+		::unlink( path.c_str() );
+
+	int const result = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+	if ( result < 0 )
+		throw std::runtime_error( "Unable to create socket" );
+
+	if (
+		( ::bind( result, reinterpret_cast< sockaddr const* >( &address ), sizeof( address ) ) != 0 ) ||
+		( ::listen( result, SOMAXCONN ) != 0 )
+	)
+	{
+		::close( result );
+		throw std::runtime_error( "Unable to listen on socket " + path );
+	}
+
+	return result;
+}
+
+
+int ConnectUnixSocket( std::string const& path ) {
+
+	sockaddr_un const address = SocketAddress( path );
+
+	int const result = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+	if ( result < 0 )
+		throw std::runtime_error( "Unable to create socket" );
+
+	if ( ::connect( result, reinterpret_cast< sockaddr const* >( &address ), sizeof( address ) ) != 0 ) {
+
+		::close( result );
+		throw std::runtime_error( "Unable to connect to socket " + path );
+	}
+
+	return result;
+}
+
+
+bool const ReadFully( int const socket, void* const buffer, size_t const size ) {
+
+	char* const begin = static_cast< char* >( buffer );
+	size_t done = 0;
+	while ( done < size ) {
+
+		ssize_t const count = ::recv( socket, begin + done, size - done, 0 );
+		if ( count > 0 )
+			done += count;
+		else if ( count == 0 ) {
+
+			if ( done == 0 )
+				return false;
+			throw std::runtime_error( "Connection closed partway through a message" );
+		}
+		else if ( errno != EINTR )
+			throw std::runtime_error( "Unable to read from socket" );
+	}
+	return true;
+}
+
+
+void WriteFully( int const socket, void const* const buffer, size_t const size ) {
+
+	char const* const begin = static_cast< char const* >( buffer );
+	size_t done = 0;
+	while ( done < size ) {
+
+		// a closed connection shouldn't raise SIGPIPE
+		ssize_t const count = ::send( socket, begin + done, size - done, MSG_NOSIGNAL );
+		if ( count >= 0 )
+			done += count;
+		else if ( errno != EINTR )
+			throw std::runtime_error( "Unable to write to socket" );
+	}
+}
+
+
+
+
+//============================================================================
+//    Message functions
+//============================================================================
+
+
+bool const ReadServeRequest( int const socket, ServeRequestHeader* const pHeader, ServeVectors* const pVectors ) {
+
+	if ( ! ReadFully( socket, pHeader, sizeof( *pHeader ) ) )
+		return false;
+	if ( pHeader->magic != SERVE_MAGIC )
+		throw std::runtime_error( "Malformed request" );
+
+	if ( pHeader->type == SERVE_REQUEST_CLASSIFY ) {
+
+		if ( ( pHeader->rows > g_maximumRows ) || ( pHeader->nonzeros > g_maximumNonzeros ) )
+			throw std::runtime_error( "Request is too large" );
+
+		pVectors->lengths.resize( pHeader->rows );
+		pVectors->indices.resize( pHeader->nonzeros );
+		pVectors->values.resize( pHeader->nonzeros );
+		if ( pHeader->rows > 0 )
+			ReadFully( socket, &pVectors->lengths[ 0 ], pHeader->rows * sizeof( boost::uint32_t ) );
+		if ( pHeader->nonzeros > 0 ) {
+
+			ReadFully( socket, &pVectors->indices[ 0 ], pHeader->nonzeros * sizeof( boost::uint32_t ) );
+			ReadFully( socket, &pVectors->values[ 0 ], pHeader->nonzeros * sizeof( float ) );
+		}
+
+		size_t nonzeros = 0;
+		for ( unsigned int ii = 0; ii < pHeader->rows; ++ii )
+			nonzeros += pVectors->lengths[ ii ];
+		if ( nonzeros != pHeader->nonzeros )
+			throw std::runtime_error( "Malformed request: the row lengths don't sum to the number of nonzeros" );
+	}
+	else if ( pHeader->type == SERVE_REQUEST_STATISTICS ) {
+
+		if ( ( pHeader->rows != 0 ) || ( pHeader->nonzeros != 0 ) )
+			throw std::runtime_error( "Malformed request" );
+	}
+	else
+		throw std::runtime_error( "Unknown request type" );
+
+	return true;
+}
+
+
+void WriteServeClassifyRequest(
+	int const socket,
+	std::vector< float > const& values,
+	std::vector< size_t > const& indices,
+	std::vector< size_t > const& offsets,
+	unsigned int const begin,
+	unsigned int const end
+)
+{
+	BOOST_ASSERT( begin <= end );
+	BOOST_ASSERT( end < offsets.size() );
+
+	size_t const nonzeroBegin = offsets[ begin ];
+	size_t const nonzeroEnd   = offsets[ end ];
+
+	ServeRequestHeader header;
+	header.magic    = SERVE_MAGIC;
+	header.type     = SERVE_REQUEST_CLASSIFY;
+	header.rows     = end - begin;
+	header.nonzeros = nonzeroEnd - nonzeroBegin;
+
+	std::vector< boost::uint32_t > lengths( header.rows );
+	for ( unsigned int ii = begin; ii < end; ++ii )
+		lengths[ ii - begin ] = offsets[ ii + 1 ] - offsets[ ii ];
+	std::vector< boost::uint32_t > const narrowIndices( indices.begin() + nonzeroBegin, indices.begin() + nonzeroEnd );
+
+	WriteFully( socket, &header, sizeof( header ) );
+	if ( header.rows > 0 )
+		WriteFully( socket, &lengths[ 0 ], header.rows * sizeof( boost::uint32_t ) );
+	if ( header.nonzeros > 0 ) {
+
+		WriteFully( socket, &narrowIndices[ 0 ], header.nonzeros * sizeof( boost::uint32_t ) );
+		WriteFully( socket, &values[ nonzeroBegin ], header.nonzeros * sizeof( float ) );
+	}
+}
+
+
+void WriteServeStatisticsRequest( int const socket ) {
+
+	ServeRequestHeader header;
+	header.magic    = SERVE_MAGIC;
+	header.type     = SERVE_REQUEST_STATISTICS;
+	header.rows     = 0;
+	header.nonzeros = 0;
+
+	WriteFully( socket, &header, sizeof( header ) );
+}
+
+
+void ReadServeResponse( int const socket, ServeResponseHeader* const pHeader, std::vector< double >* const pValues, std::string* const pText ) {
+
+	if ( ! ReadFully( socket, pHeader, sizeof( *pHeader ) ) )
+		throw std::runtime_error( "Connection closed by server" );
+	if ( pHeader->magic != SERVE_MAGIC )
+		throw std::runtime_error( "Malformed response" );
+	if ( ( pHeader->rows > g_maximumRows ) || ( pHeader->classes > g_maximumRows ) || ( pHeader->length > g_maximumLength ) )
+		throw std::runtime_error( "Response is too large" );
+
+	size_t const count = static_cast< size_t >( pHeader->rows ) * pHeader->classes;
+	pValues->resize( count );
+	if ( count > 0 )
+		ReadFully( socket, &( *pValues )[ 0 ], count * sizeof( double ) );
+
+	std::vector< char > text( pHeader->length );
+	if ( pHeader->length > 0 )
+		ReadFully( socket, &text[ 0 ], pHeader->length );
+	pText->assign( text.begin(), text.end() );
+}
+
+
+void WriteServeResponse(
+	int const socket,
+	ServeStatus const status,
+	unsigned int const rows,
+	unsigned int const classes,
+	double const* const values,
+	std::string const& text
+)
+{
+	ServeResponseHeader header;
+	header.magic   = SERVE_MAGIC;
+	header.status  = status;
+	header.rows    = rows;
+	header.classes = classes;
+	header.length  = text.size();
+
+	WriteFully( socket, &header, sizeof( header ) );
+	if ( rows * classes > 0 )
+		WriteFully( socket, values, static_cast< size_t >( rows ) * classes * sizeof( double ) );
+	if ( ! text.empty() )
+		WriteFully( socket, text.data(), text.size() );
+}
+
+
+
+
+//============================================================================
+//    ReportLatencies function
+//============================================================================
+
+
+void ReportLatencies( std::ostream& stream, std::vector< double >* const pLatencies ) {
+
+	stream << "Latencies (ms): count = " << pLatencies->size();
+	if ( ! pLatencies->empty() ) {
+
+		std::sort( pLatencies->begin(), pLatencies->end() );
+
+		double total = 0;
+		for ( std::vector< double >::const_iterator ii = pLatencies->begin(); ii != pLatencies->end(); ++ii )
+			total += *ii;
+
+		// nearest-rank percentiles
+		double const percentiles[] = { 50, 90, 99, 99.9 };
+		char const* const names[] = { "p50", "p90", "p99", "p99.9" };
+
+		stream << ", mean = " << 1000 * total / pLatencies->size();
+		for ( unsigned int ii = 0; ii < sizeof( percentiles ) / sizeof( percentiles[ 0 ] ); ++ii ) {
+
+			size_t rank = static_cast< size_t >( std::ceil( percentiles[ ii ] / 100 * pLatencies->size() ) );
+			if ( rank > 0 )
+				--rank;
+			stream << ", " << names[ ii ] << " = " << 1000 * ( *pLatencies )[ rank ];
+		}
+		stream << ", max = " << 1000 * pLatencies->back();
+	}
+	stream << std::endl;
+}
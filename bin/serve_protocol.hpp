@@ -0,0 +1,193 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file serve_protocol.hpp
+	\brief definition of the protocol spoken by gtsvm_serve and its clients
+*/
+
+
+
+
+#ifndef __SERVE_PROTOCOL_HPP__
+#define __SERVE_PROTOCOL_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include <boost/cstdint.hpp>
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
+
+
+
+
+//============================================================================
+//    Protocol
+//============================================================================
+
+
+/*
+	Clients connect to gtsvm_serve's Unix domain socket, and send any number
+	of requests, each of which is answered (in order) before the next is
+	read. Everything is in the host's byte order, since both ends are on the
+	same machine.
+
+	A request is a ServeRequestHeader. For SERVE_REQUEST_CLASSIFY, this is
+	followed by "rows" uint32 row lengths, then "nonzeros" uint32 (zero-based)
+	column indices, then "nonzeros" float values, the rows' nonzeros being
+	consecutive. For SERVE_REQUEST_STATISTICS, nothing follows, and rows and
+	nonzeros are zero.
+
+	A response is a ServeResponseHeader, followed by "rows" times "classes"
+	doubles (the decision values, one row at a time), and then "length" bytes
+	of text: the error message, if the status is SERVE_STATUS_ERROR, or the
+	server's report, for a SERVE_REQUEST_STATISTICS.
+*/
+
+
+enum {
+
+	SERVE_MAGIC = 0x47545356    // "GTSV"
+};
+
+
+enum ServeRequestType {
+
+	SERVE_REQUEST_CLASSIFY = 1,
+	SERVE_REQUEST_STATISTICS
+};
+
+
+enum ServeStatus {
+
+	SERVE_STATUS_OK = 0,
+	SERVE_STATUS_ERROR
+};
+
+
+struct ServeRequestHeader {
+
+	boost::uint32_t magic;
+	boost::uint32_t type;
+	boost::uint32_t rows;
+	boost::uint32_t nonzeros;
+};
+
+
+struct ServeResponseHeader {
+
+	boost::uint32_t magic;
+	boost::uint32_t status;
+	boost::uint32_t rows;
+	boost::uint32_t classes;
+	boost::uint32_t length;
+};
+
+
+// a SERVE_REQUEST_CLASSIFY request, in compressed sparse row format
+struct ServeVectors {
+
+	std::vector< boost::uint32_t > lengths;
+	std::vector< boost::uint32_t > indices;
+	std::vector< float > values;
+};
+
+
+
+
+//============================================================================
+//    Socket functions
+//============================================================================
+
+
+// removes any existing socket at the given path
+int ListenUnixSocket( std::string const& path );
+
+int ConnectUnixSocket( std::string const& path );
+
+
+/*
+	Returns false if the connection was closed before anything was read, and
+	throws if it's closed partway through, or on any other failure
+*/
+bool const ReadFully( int const socket, void* const buffer, size_t const size );
+
+void WriteFully( int const socket, void const* const buffer, size_t const size );
+
+
+
+
+//============================================================================
+//    Message functions
+//============================================================================
+
+
+// returns false if the connection was closed, and throws if the request is malformed
+bool const ReadServeRequest( int const socket, ServeRequestHeader* const pHeader, ServeVectors* const pVectors );
+
+// writes the given rows of a dataset in compressed sparse row format (as in SVMLightDataset)
+void WriteServeClassifyRequest(
+	int const socket,
+	std::vector< float > const& values,
+	std::vector< size_t > const& indices,
+	std::vector< size_t > const& offsets,
+	unsigned int const begin,
+	unsigned int const end
+);
+
+void WriteServeStatisticsRequest( int const socket );
+
+
+void ReadServeResponse( int const socket, ServeResponseHeader* const pHeader, std::vector< double >* const pValues, std::string* const pText );
+
+void WriteServeResponse(
+	int const socket,
+	ServeStatus const status,
+	unsigned int const rows,
+	unsigned int const classes,
+	double const* const values,
+	std::string const& text
+);
+
+
+
+
+//============================================================================
+//    ReportLatencies function
+//============================================================================
+
+
+/*
+	Writes the count, mean, median, 90th, 99th and 99.9th percentiles, and
+	maximum of the given latencies (in seconds, which are sorted in place) to
+	the given stream, in milliseconds
+*/
+void ReportLatencies( std::ostream& stream, std::vector< double >* const pLatencies );
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __SERVE_PROTOCOL_HPP__ */
@@ -0,0 +1,544 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file svmlight_reader.cpp
+	\brief implementation of ReadSVMLight function, and SVMLightStream class
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace {
+
+
+
+
+//============================================================================
+//    Chunk structure
+//============================================================================
+
+
+/*
+	The part of the dataset parsed by one thread. The offsets are relative to
+	the start of the chunk, and don't include the leading zero.
+*/
+struct Chunk {
+
+	char const* begin;
+	char const* end;
+
+	std::vector< boost::int32_t > labels;
+	std::vector< float > values;
+	std::vector< size_t > indices;
+	std::vector< size_t > offsets;
+	unsigned int columns;
+
+	bool failed;
+	std::string error;
+};
+
+
+
+
+//============================================================================
+//    Scanning helper functions
+//============================================================================
+
+
+inline bool const IsSpace( char const character ) {
+
+	return(
+		( character == ' '  ) ||
+		( character == '\t' ) ||
+		( character == '\r' ) ||
+		( character == '\v' ) ||
+		( character == '\f' )
+	);
+}
+
+
+inline bool const IsDigit( char const character ) {
+
+	return( ( character >= '0' ) && ( character <= '9' ) );
+}
+
+
+// same as atoi, but stops at "end"
+inline int const ScanLabel( char const* ii, char const* const iiEnd ) {
+
+	bool negative = false;
+	if ( ( ii != iiEnd ) && ( ( *ii == '-' ) || ( *ii == '+' ) ) ) {
+
+		negative = ( *ii == '-' );
+		++ii;
+	}
+
+	int result = 0;
+	for ( ; ( ii != iiEnd ) && IsDigit( *ii ); ++ii )
+		result = result * 10 + ( *ii - '0' );
+
+	return( negative ? -result : result );
+}
+
+
+/*
+	Scans a value matching -?[0-9]+(\.[0-9]+)?([eE]-?[0-9]+)? starting at
+	*pPosition, and advances *pPosition past it. Returns false if there's no
+	such value. The result is the same as that of atof: values with at most
+	15 significant digits and small exponents are calculated exactly, and
+	everything else is handed to strtod.
+*/
+inline bool const ScanValue( double* const pValue, char const** const pPosition, char const* const end ) {
+
+	static double const powers[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	char const* const begin = *pPosition;
+	char const* ii = begin;
+
+	bool const negative = ( ( ii != end ) && ( *ii == '-' ) );
+	if ( negative )
+		++ii;
+
+	boost::uint64_t mantissa = 0;
+	unsigned int digits = 0;
+	int exponent = 0;
+
+	if ( ( ii == end ) || ! IsDigit( *ii ) )
+		return false;
+	for ( ; ( ii != end ) && IsDigit( *ii ); ++ii ) {
+
+		if ( ( mantissa != 0 ) || ( *ii != '0' ) )
+			++digits;
+		if ( digits <= 15 )
+			mantissa = mantissa * 10 + ( *ii - '0' );
+		else
+			++exponent;
+	}
+
+	if ( ( ii != end ) && ( *ii == '.' ) ) {
+
+		++ii;
+		if ( ( ii == end ) || ! IsDigit( *ii ) )
+			return false;
+		for ( ; ( ii != end ) && IsDigit( *ii ); ++ii ) {
+
+			if ( ( mantissa != 0 ) || ( *ii != '0' ) )
+				++digits;
+			if ( digits <= 15 ) {
+
+				mantissa = mantissa * 10 + ( *ii - '0' );
+				--exponent;
+			}
+		}
+	}
+
+	if ( ( ii != end ) && ( ( *ii == 'e' ) || ( *ii == 'E' ) ) ) {
+
+		++ii;
+		bool const negativeExponent = ( ( ii != end ) && ( *ii == '-' ) );
+		if ( negativeExponent )
+			++ii;
+
+		if ( ( ii == end ) || ! IsDigit( *ii ) )
+			return false;
+		int explicitExponent = 0;
+		for ( ; ( ii != end ) && IsDigit( *ii ); ++ii )
+			if ( explicitExponent < 100000 )
+				explicitExponent = explicitExponent * 10 + ( *ii - '0' );
+
+		exponent += ( negativeExponent ? -explicitExponent : explicitExponent );
+	}
+
+	*pPosition = ii;
+
+	if ( ( digits <= 15 ) && ( exponent >= -22 ) && ( exponent <= 22 ) ) {
+
+		double value = static_cast< double >( mantissa );
+		if ( exponent < 0 )
+			value /= powers[ -exponent ];
+		else
+			value *= powers[ exponent ];
+		*pValue = ( negative ? -value : value );
+	}
+	else
+		*pValue = std::strtod( std::string( begin, ii ).c_str(), NULL );
+
+	return true;
+}
+
+
+
+
+//============================================================================
+//    ParseChunk function
+//============================================================================
+
+
+void ParseChunk( Chunk* const pChunk ) {
+
+	try {
+
+		char const* ii = pChunk->begin;
+		char const* const iiEnd = pChunk->end;
+		while ( ii != iiEnd ) {
+
+			char const* lineEnd = static_cast< char const* >( std::memchr( ii, '\n', iiEnd - ii ) );
+			if ( lineEnd == NULL )
+				lineEnd = iiEnd;
+
+			while ( ( ii != lineEnd ) && IsSpace( *ii ) )
+				++ii;
+
+			if ( ii != lineEnd ) {    // ignore blank lines
+
+				char const* const labelBegin = ii;
+				while ( ( ii != lineEnd ) && ! IsSpace( *ii ) )
+					++ii;
+				pChunk->labels.push_back( ScanLabel( labelBegin, ii ) );
+
+				int lastIndex = -1;
+				for ( ; ; ) {
+
+					while ( ( ii != lineEnd ) && IsSpace( *ii ) )
+						++ii;
+					if ( ii == lineEnd )
+						break;
+
+					if ( ! IsDigit( *ii ) ) {
+
+						if ( *ii == '-' )
+							throw std::runtime_error( "Failed to parse element of dataset line: negative index encountered" );
+						throw std::runtime_error( "Failed to parse element of dataset line" );
+					}
+					boost::uint64_t index = 0;
+					for ( ; ( ii != lineEnd ) && IsDigit( *ii ); ++ii )
+						if ( index <= static_cast< boost::uint64_t >( std::numeric_limits< int >::max() ) )
+							index = index * 10 + ( *ii - '0' );
+					if ( index > static_cast< boost::uint64_t >( std::numeric_limits< int >::max() ) )
+						throw std::runtime_error( "Failed to parse element of dataset line: index is too large" );
+
+					if ( ( ii == lineEnd ) || ( *ii != ':' ) )
+						throw std::runtime_error( "Failed to parse element of dataset line" );
+					++ii;
+
+					double value;
+					if ( ! ScanValue( &value, &ii, lineEnd ) )
+						throw std::runtime_error( "Failed to parse element of dataset line" );
+					if ( ( ii != lineEnd ) && ! IsSpace( *ii ) )
+						throw std::runtime_error( "Failed to parse element of dataset line" );
+
+					if ( static_cast< int >( index ) <= lastIndex )
+						throw std::runtime_error( "Failed to parse element of dataset line: features must be listed in order of increasing index" );
+					lastIndex = index;
+
+					float const floatValue = static_cast< float >( value );
+					if ( floatValue != 0 ) {
+
+						pChunk->values.push_back( floatValue );
+						pChunk->indices.push_back( index );
+
+						if ( index + 1 > pChunk->columns )
+							pChunk->columns = index + 1;
+					}
+				}
+
+				BOOST_ASSERT( pChunk->values.size() == pChunk->indices.size() );
+				pChunk->offsets.push_back( pChunk->values.size() );
+			}
+
+			ii = ( ( lineEnd == iiEnd ) ? iiEnd : lineEnd + 1 );
+		}
+	}
+	catch( std::exception& error ) {
+
+		pChunk->failed = true;
+		pChunk->error = error.what();
+	}
+}
+
+
+
+
+//============================================================================
+//    CopyChunk function
+//============================================================================
+
+
+void CopyChunk( SVMLightDataset* const pDataset, Chunk* const pChunk, size_t const rowOffset, size_t const nonzeroOffset ) {
+
+	std::copy( pChunk->labels.begin(),  pChunk->labels.end(),  pDataset->labels.begin()  + rowOffset     );
+	std::copy( pChunk->values.begin(),  pChunk->values.end(),  pDataset->values.begin()  + nonzeroOffset );
+	std::copy( pChunk->indices.begin(), pChunk->indices.end(), pDataset->indices.begin() + nonzeroOffset );
+
+	for ( size_t ii = 0; ii < pChunk->offsets.size(); ++ii )
+		pDataset->offsets[ rowOffset + ii + 1 ] = pChunk->offsets[ ii ] + nonzeroOffset;
+
+	// free this chunk's memory as soon as it has been copied
+	std::vector< boost::int32_t >().swap( pChunk->labels );
+	std::vector< float >().swap( pChunk->values );
+	std::vector< size_t >().swap( pChunk->indices );
+	std::vector< size_t >().swap( pChunk->offsets );
+}
+
+
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    ReadSVMLight function
+//============================================================================
+
+
+void ReadSVMLight(
+	SVMLightDataset* const pDataset,
+	std::string const& filename,
+	unsigned int const threads
+)
+{
+	boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+
+	size_t size = 0;
+	{	std::ifstream file( filename.c_str(), std::ios::in | std::ios::binary );
+		if ( file.fail() )
+			throw std::runtime_error( "Unable to open dataset file" );
+		file.seekg( 0, std::ios::end );
+		size = file.tellg();
+	}
+
+	boost::interprocess::file_mapping mapping;
+	boost::interprocess::mapped_region region;
+	char const* data = NULL;
+	if ( size > 0 ) {
+
+		try {
+
+			boost::interprocess::file_mapping( filename.c_str(), boost::interprocess::read_only ).swap( mapping );
+			boost::interprocess::mapped_region( mapping, boost::interprocess::read_only ).swap( region );
+			region.advise( boost::interprocess::mapped_region::advice_sequential );
+		}
+		catch( boost::interprocess::interprocess_exception& error ) {
+
+			throw std::runtime_error( std::string( "Unable to map dataset file: " ) + error.what() );
+		}
+		data = static_cast< char const* >( region.get_address() );
+	}
+
+	ParseSVMLight( pDataset, data, data + size, threads );
+
+	pDataset->bytes = size;
+	pDataset->seconds = ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds() * 1e-6;
+}
+
+
+
+
+//============================================================================
+//    ParseSVMLight function
+//============================================================================
+
+
+void ParseSVMLight(
+	SVMLightDataset* const pDataset,
+	char const* const data,
+	char const* const dataEnd,
+	unsigned int threads
+)
+{
+	if ( threads == 0 )
+		threads = std::max( boost::thread::hardware_concurrency(), 1u );
+
+	size_t const size = dataEnd - data;
+
+	// don't bother with chunks smaller than a megabyte
+	threads = static_cast< unsigned int >( std::min( static_cast< size_t >( threads ), std::max( size >> 20, static_cast< size_t >( 1 ) ) ) );
+
+	std::vector< Chunk > chunks( threads );
+	{	char const* begin = data;
+		for ( unsigned int ii = 0; ii < threads; ++ii ) {
+
+			char const* end = data + ( size / threads ) * ( ii + 1 );
+			if ( ii + 1 == threads )
+				end = data + size;
+			else {
+
+				if ( end < begin )
+					end = begin;
+				char const* const newline = static_cast< char const* >( std::memchr( end, '\n', ( data + size ) - end ) );
+				end = ( ( newline == NULL ) ? data + size : newline + 1 );
+			}
+
+			chunks[ ii ].begin = begin;
+			chunks[ ii ].end = end;
+			chunks[ ii ].columns = 0;
+			chunks[ ii ].failed = false;
+			begin = end;
+		}
+	}
+
+	{	boost::thread_group group;
+		for ( unsigned int ii = 1; ii < threads; ++ii )
+			group.create_thread( boost::bind( &ParseChunk, &chunks[ ii ] ) );
+		ParseChunk( &chunks[ 0 ] );
+		group.join_all();
+	}
+
+	// report the first error in the file, just as a sequential parser would
+	size_t rows = 0;
+	size_t nonzeros = 0;
+	pDataset->columns = 0;
+	for ( unsigned int ii = 0; ii < threads; ++ii ) {
+
+		if ( chunks[ ii ].failed )
+			throw std::runtime_error( chunks[ ii ].error );
+		rows += chunks[ ii ].labels.size();
+		nonzeros += chunks[ ii ].values.size();
+		pDataset->columns = std::max( pDataset->columns, chunks[ ii ].columns );
+	}
+	if ( rows > std::numeric_limits< unsigned int >::max() )
+		throw std::runtime_error( "Dataset file contains too many lines" );
+	pDataset->rows = rows;
+
+	pDataset->labels.resize( rows );
+	pDataset->values.resize( nonzeros );
+	pDataset->indices.resize( nonzeros );
+	pDataset->offsets.resize( rows + 1 );
+	pDataset->offsets[ 0 ] = 0;
+
+	{	boost::thread_group group;
+		size_t rowOffset = 0;
+		size_t nonzeroOffset = 0;
+		for ( unsigned int ii = 0; ii < threads; ++ii ) {
+
+			size_t const chunkRows = chunks[ ii ].labels.size();
+			size_t const chunkNonzeros = chunks[ ii ].values.size();
+			if ( ii > 0 )
+				group.create_thread( boost::bind( &CopyChunk, pDataset, &chunks[ ii ], rowOffset, nonzeroOffset ) );
+			rowOffset += chunkRows;
+			nonzeroOffset += chunkNonzeros;
+		}
+		CopyChunk( pDataset, &chunks[ 0 ], 0, 0 );
+		group.join_all();
+	}
+}
+
+
+
+
+//============================================================================
+//    SVMLightStream methods
+//============================================================================
+
+
+SVMLightStream::SVMLightStream( std::string const& filename, size_t const chunkSize, unsigned int const threads ) :
+	m_file( NULL ),
+	m_buffer( std::max( chunkSize, static_cast< size_t >( 1 ) ) ),
+	m_size( 0 ),
+	m_end( false ),
+	m_threads( threads )
+{
+	m_file = fopen( filename.c_str(), "rb" );
+	if ( m_file == NULL )
+		throw std::runtime_error( "Unable to open dataset file" );
+}
+
+
+SVMLightStream::~SVMLightStream() {
+
+	fclose( m_file );
+}
+
+
+bool const SVMLightStream::Read( SVMLightDataset* const pDataset ) {
+
+	boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+
+	// fill the buffer, and find the end of its last complete line, growing it only if one line doesn't fit
+	size_t cut = 0;
+	for ( ; ; ) {
+
+		if ( ! m_end ) {
+
+			m_size += fread( &m_buffer[ m_size ], 1, m_buffer.size() - m_size, m_file );
+			if ( m_size < m_buffer.size() ) {
+
+				if ( ferror( m_file ) )
+					throw std::runtime_error( "Unable to read dataset file" );
+				m_end = true;
+			}
+		}
+
+		if ( m_end ) {
+
+			cut = m_size;
+			break;
+		}
+
+		size_t ii = m_size;
+		for ( ; ( ii > 0 ) && ( m_buffer[ ii - 1 ] != '\n' ); --ii );
+		if ( ii > 0 ) {
+
+			cut = ii;
+			break;
+		}
+		m_buffer.resize( m_buffer.size() * 2 );
+	}
+
+	if ( cut == 0 )
+		return false;
+
+	char const* const data = &m_buffer[ 0 ];
+	ParseSVMLight( pDataset, data, data + cut, m_threads );
+
+	std::copy( m_buffer.begin() + cut, m_buffer.begin() + m_size, m_buffer.begin() );
+	m_size -= cut;
+
+	pDataset->bytes = cut;
+	pDataset->seconds = ( boost::posix_time::microsec_clock::universal_time() - start ).total_microseconds() * 1e-6;
+
+	return true;
+}
+
+
+
+
+//============================================================================
+//    ReportSVMLight function
+//============================================================================
+
+
+void ReportSVMLight( std::ostream& stream, SVMLightDataset const& dataset ) {
+
+	double const megabytes = dataset.bytes / ( 1 << 20 );
+	stream <<
+		"Read " << dataset.rows << " rows, " << dataset.values.size() << " nonzeros (" <<
+		megabytes << " MB) in " << dataset.seconds << " seconds (" <<
+		( ( dataset.seconds > 0 ) ? megabytes / dataset.seconds : 0 ) << " MB/s)" << std::endl;
+}
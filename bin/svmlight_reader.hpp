@@ -0,0 +1,147 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file svmlight_reader.hpp
+	\brief definition of ReadSVMLight function, and SVMLightStream class
+*/
+
+
+
+
+#ifndef __SVMLIGHT_READER_HPP__
+#define __SVMLIGHT_READER_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include <boost/cstdint.hpp>
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <cstdio>
+#include <cstddef>
+
+
+
+
+//============================================================================
+//    SVMLightDataset structure
+//============================================================================
+
+
+/*
+	A dataset in compressed sparse row format, suitable for passing to
+	GTSVM_InitializeSparse or GTSVM_ClassifySparse. Zero values are dropped.
+*/
+struct SVMLightDataset {
+
+	unsigned int rows;
+	unsigned int columns;
+
+	std::vector< boost::int32_t > labels;
+	std::vector< float > values;
+	std::vector< size_t > indices;
+	std::vector< size_t > offsets;    // rows + 1 of them
+
+	// how long parsing took, and how much was parsed
+	double bytes;
+	double seconds;
+};
+
+
+
+
+//============================================================================
+//    ReadSVMLight function
+//============================================================================
+
+
+/*
+	Maps the file, splits it into line-aligned chunks, and parses them on
+	"threads" threads (zero means one per core). Throws if the file can't be
+	read, or is malformed.
+*/
+void ReadSVMLight(
+	SVMLightDataset* const pDataset,
+	std::string const& filename,
+	unsigned int threads
+);
+
+
+// parses a buffer of SVM-Light data (which doesn't set bytes or seconds)
+void ParseSVMLight(
+	SVMLightDataset* const pDataset,
+	char const* const data,
+	char const* const dataEnd,
+	unsigned int threads
+);
+
+
+/*
+	Writes a one-line summary of the dataset, including the parsing
+	throughput, to the given stream
+*/
+void ReportSVMLight( std::ostream& stream, SVMLightDataset const& dataset );
+
+
+
+
+//============================================================================
+//    SVMLightStream class
+//============================================================================
+
+
+/*
+	Reads an SVM-Light file in pieces of about chunkSize bytes, each ending at
+	the end of a line, so that memory usage is independent of the size of the
+	file. Each piece is parsed on "threads" threads, as by ReadSVMLight.
+*/
+struct SVMLightStream {
+
+	SVMLightStream( std::string const& filename, size_t const chunkSize, unsigned int const threads );
+
+	~SVMLightStream();
+
+
+	// returns false at the end of the file
+	bool const Read( SVMLightDataset* const pDataset );
+
+
+private:
+
+	FILE* m_file;
+	std::vector< char > m_buffer;
+	size_t m_size;
+	bool m_end;
+	unsigned int m_threads;
+
+
+	SVMLightStream( SVMLightStream const& other );
+	SVMLightStream const& operator=( SVMLightStream const& other );
+};
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __SVMLIGHT_READER_HPP__ */
@@ -0,0 +1,134 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file synthetic_dataset.cpp
+	\brief implementation of GenerateSyntheticDataset and WriteSVMLight functions
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+//============================================================================
+//    Synthetic dataset functions
+//============================================================================
+
+
+void GenerateSyntheticDataset( SVMLightDataset* const pDataset, SyntheticDatasetParameters const& parameters ) {
+
+	if ( ( parameters.rows < 1 ) || ( parameters.columns < 1 ) )
+		throw std::runtime_error( "A synthetic dataset must have at least one row and column" );
+	if ( ! ( ( parameters.density > 0 ) && ( parameters.density <= 1 ) ) )
+		throw std::runtime_error( "The density must be in (0,1]" );
+	if ( parameters.classes < 2 )
+		throw std::runtime_error( "A synthetic dataset must have at least two classes" );
+	if ( ! ( ( parameters.noise >= 0 ) && ( parameters.noise <= 1 ) ) )
+		throw std::runtime_error( "The label noise must be in [0,1]" );
+
+	boost::random::mt19937 generator( parameters.seed );
+	boost::random::uniform_real_distribution< float > valueDistribution( 0, 1 );
+	boost::random::uniform_real_distribution< double > noiseDistribution( 0, 1 );
+	boost::random::normal_distribution< float > weightDistribution( 0, 1 );
+
+	bool const binary = ( parameters.classes == 2 );
+	unsigned int const functions = ( binary ? 1 : parameters.classes );
+	std::vector< float > weights( static_cast< size_t >( functions ) * parameters.columns );
+	for ( std::vector< float >::iterator ii = weights.begin(); ii != weights.end(); ++ii )
+		*ii = weightDistribution( generator );
+
+	unsigned int const rowNonzeros = std::max( 1u, std::min(
+		parameters.columns,
+		static_cast< unsigned int >( parameters.density * parameters.columns + 0.5 )
+	) );
+
+	pDataset->rows = parameters.rows;
+	pDataset->columns = parameters.columns;
+	pDataset->labels.resize( parameters.rows );
+	pDataset->values.resize( static_cast< size_t >( parameters.rows ) * rowNonzeros );
+	pDataset->indices.resize( static_cast< size_t >( parameters.rows ) * rowNonzeros );
+	pDataset->offsets.resize( parameters.rows + 1 );
+	pDataset->bytes = 0;
+	pDataset->seconds = 0;
+
+	// the first rowNonzeros elements of a partial Fisher-Yates shuffle are the columns of each row
+	std::vector< unsigned int > permutation( parameters.columns );
+	for ( unsigned int ii = 0; ii < parameters.columns; ++ii )
+		permutation[ ii ] = ii;
+
+	std::vector< double > scores( functions );
+	for ( unsigned int ii = 0; ii < parameters.rows; ++ii ) {
+
+		for ( unsigned int jj = 0; jj < rowNonzeros; ++jj ) {
+
+			boost::random::uniform_int_distribution< unsigned int > indexDistribution( jj, parameters.columns - 1 );
+			std::swap( permutation[ jj ], permutation[ indexDistribution( generator ) ] );
+		}
+		std::sort( permutation.begin(), permutation.begin() + rowNonzeros );
+
+		size_t const offset = static_cast< size_t >( ii ) * rowNonzeros;
+		pDataset->offsets[ ii ] = offset;
+
+		std::fill( scores.begin(), scores.end(), 0 );
+		for ( unsigned int jj = 0; jj < rowNonzeros; ++jj ) {
+
+			unsigned int const index = permutation[ jj ];
+			float const value = valueDistribution( generator );
+			pDataset->indices[ offset + jj ] = index;
+			pDataset->values[ offset + jj ] = value;
+
+			// centering the values keeps the classes roughly balanced
+			for ( unsigned int kk = 0; kk < functions; ++kk )
+				scores[ kk ] += weights[ static_cast< size_t >( kk ) * parameters.columns + index ] * ( value - 0.5 );
+		}
+
+		boost::int32_t label;
+		if ( binary )
+			label = ( ( scores[ 0 ] >= 0 ) ? 1 : -1 );
+		else
+			label = std::max_element( scores.begin(), scores.end() ) - scores.begin();
+
+		if ( noiseDistribution( generator ) < parameters.noise ) {
+
+			boost::random::uniform_int_distribution< unsigned int > labelDistribution( 0, parameters.classes - 1 );
+			label = labelDistribution( generator );
+			if ( binary )
+				label = ( ( label == 0 ) ? -1 : 1 );
+		}
+		pDataset->labels[ ii ] = label;
+	}
+	pDataset->offsets[ parameters.rows ] = pDataset->values.size();
+}
+
+
+void WriteSVMLight( std::ostream& stream, SVMLightDataset const& dataset ) {
+
+	for ( unsigned int ii = 0; ii < dataset.rows; ++ii ) {
+
+		stream << dataset.labels[ ii ];
+		for ( size_t jj = dataset.offsets[ ii ]; jj < dataset.offsets[ ii + 1 ]; ++jj )
+			stream << ' ' << ( dataset.indices[ jj ] + 1 ) << ':' << dataset.values[ jj ];
+		stream << '\n';
+	}
+	if ( stream.fail() )
+		throw std::runtime_error( "Unable to write dataset file" );
+}
@@ -0,0 +1,85 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file synthetic_dataset.hpp
+	\brief definition of GenerateSyntheticDataset and WriteSVMLight functions
+*/
+
+
+
+
+#ifndef __SYNTHETIC_DATASET_HPP__
+#define __SYNTHETIC_DATASET_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include "svmlight_reader.hpp"
+
+#include <boost/cstdint.hpp>
+
+#include <iosfwd>
+
+
+
+
+//============================================================================
+//    SyntheticDatasetParameters structure
+//============================================================================
+
+
+struct SyntheticDatasetParameters {
+
+	unsigned int rows;
+	unsigned int columns;
+	double density;       // fraction of the columns which are nonzero in each row (1 gives a dense dataset)
+	unsigned int classes; // 2 for a binary (+1/-1) dataset, otherwise labels are 0,1,...,classes-1
+	double noise;         // probability that a label is replaced with a random one
+	boost::uint32_t seed;
+};
+
+
+
+
+//============================================================================
+//    Synthetic dataset functions
+//============================================================================
+
+
+/*
+	Generates a reproducible dataset: every row has the same number of
+	nonzeros, in random columns, with values uniform on [0,1), and is labeled
+	by the largest of "classes" random linear functions of the row (or the
+	sign of one, for a binary dataset). The same parameters always give the
+	same dataset.
+*/
+void GenerateSyntheticDataset( SVMLightDataset* const pDataset, SyntheticDatasetParameters const& parameters );
+
+
+// writes the dataset in SVM-Light format, with one-based indices
+void WriteSVMLight( std::ostream& stream, SVMLightDataset const& dataset );
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __SYNTHETIC_DATASET_HPP__ */
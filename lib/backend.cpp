@@ -0,0 +1,76 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file backend.cpp
+	\brief implementation of Backend class
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace GTSVM {
+
+
+
+
+//============================================================================
+//    Backend methods
+//============================================================================
+
+
+Backend::~Backend() {
+}
+
+
+
+
+//============================================================================
+//    CreateBackend function
+//============================================================================
+
+
+boost::shared_ptr< Backend > CreateBackend( GTSVM_Backend const type ) {
+
+	boost::shared_ptr< Backend > result;
+
+	switch( type ) {
+
+		case GTSVM_BACKEND_DEFAULT:
+#ifdef GTSVM_NO_CUDA
+		case GTSVM_BACKEND_CPU: { result = CPU::CreateBackend(); break; }
+		case GTSVM_BACKEND_CUDA: throw std::runtime_error( "GTSVM was compiled without CUDA support" );
+#else    // GTSVM_NO_CUDA
+		case GTSVM_BACKEND_CUDA: { result = CUDA::CreateBackend(); break; }
+		case GTSVM_BACKEND_CPU: { result = CPU::CreateBackend(); break; }
+#endif    // GTSVM_NO_CUDA
+		default: throw std::runtime_error( "Unknown backend" );
+	}
+
+	return result;
+}
+
+
+
+
+}    // namespace GTSVM
@@ -0,0 +1,336 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file backend.hpp
+	\brief definition of Backend class
+*/
+
+
+
+
+#ifndef __BACKEND_HPP__
+#define __BACKEND_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include "gtsvm.h"
+#include "cuda_sparse_kernel.hpp"
+#include "cuda_helpers.hpp"
+
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+
+#include <utility>
+#include <cstddef>
+
+
+
+
+namespace GTSVM {
+
+
+
+
+//============================================================================
+//    Backend class
+//============================================================================
+
+
+/*
+	Everything that the SVM class does to "device" memory goes through one of
+	these: allocation, host<->device transfers, gathers, and the sparse kernel
+	launches. Every method throws on failure, using "what" (when it takes
+	one) as the message.
+
+	Uploads and downloads of large buffers should use the Begin/End pairs:
+	BeginUpload() returns a host buffer which the caller fills, and which
+	EndUpload() then copies to the device. Backends for which device memory
+	is host memory (IsHostMemory() returns true) hand back the device buffer
+	itself, so the staging copy disappears.
+*/
+struct Backend {
+
+	virtual ~Backend();
+
+
+	virtual GTSVM_Backend const GetType() const = 0;
+
+	virtual bool const IsHostMemory() const = 0;
+
+	// whether SparseRepackClusters() is implemented
+	virtual bool const CanRepackClusters() const = 0;
+
+	// whether the sparse kernels can be called with this logBatchSize
+	virtual bool const SupportsBatchSize( unsigned int const logBatchSize ) const = 0;
+
+
+	virtual void* HostMalloc( char const* const what, size_t const size ) = 0;
+	virtual void HostFree( char const* const what, void* const pointer ) = 0;
+
+	virtual void* DeviceMalloc( char const* const what, size_t const size ) = 0;
+	virtual void DeviceFree( char const* const what, void* const pointer ) = 0;
+
+	template< typename t_Type >
+	inline void HostAllocate( char const* const what, t_Type** const pPointer, size_t const size );
+	template< typename t_Type >
+	inline void DeviceAllocate( char const* const what, t_Type** const pPointer, size_t const size );
+
+	// device buffers which shadow a host buffer are the host buffer itself, if IsHostMemory()
+	template< typename t_Type >
+	inline void MirrorAllocate( char const* const what, t_Type* const hostPointer, t_Type** const pDevicePointer, size_t const size );
+	inline void MirrorFree( char const* const what, void* const hostPointer, void* const devicePointer );
+
+
+	virtual void CopyToDevice(
+		char const* const what,
+		void* const deviceDestination,
+		void const* const source,
+		size_t const size
+	) = 0;
+
+	virtual void CopyFromDevice(
+		char const* const what,
+		void* const destination,
+		void const* const deviceSource,
+		size_t const size
+	) = 0;
+
+	virtual void* BeginUpload( char const* const what, void* const deviceDestination, size_t const size ) = 0;
+	virtual void EndUpload( char const* const what, void* const deviceDestination, void* const buffer, size_t const size ) = 0;
+
+	virtual void const* BeginDownload( char const* const what, void const* const deviceSource, size_t const size ) = 0;
+	virtual void EndDownload( char const* const what, void const* const deviceSource, void const* const buffer ) = 0;
+
+
+	virtual void ArrayRead(
+		float* const deviceDestination,
+		float const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	) = 0;
+
+#ifdef CUDA_USE_DOUBLE
+	virtual void ArrayRead(
+		double* const deviceDestination,
+		double const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	) = 0;
+#endif    // CUDA_USE_DOUBLE
+
+	// deviceDestination[ deviceIndices[ ii ] ] = deviceValues[ ii ]
+	virtual void ArrayUpdate(
+		float* const deviceDestination,
+		float const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	) = 0;
+
+
+	virtual CUDA_FLOAT_DOUBLE const* SparseEvaluateKernel(
+		void* deviceWork1,
+		void* deviceWork2,
+		float const* const deviceBatchVectorsTranspose,
+		float const* const deviceBatchVectorNormsSquared,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const logBatchSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,    // in bytes
+		GTSVM_Kernel const kernel,
+		float const kernelParameter1,
+		float const kernelParameter2,
+		float const kernelParameter3
+	) = 0;
+
+	virtual void SparseUpdateKernel(
+		float const* const deviceBatchVectorsTranspose,
+		float const* const deviceBatchVectorNormsSquared,
+		float* const deviceBatchAlphas,
+		boost::uint32_t const* const deviceBatchIndices,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const logBatchSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		GTSVM_Kernel const kernel,
+		float const kernelParameter1,
+		float const kernelParameter2,
+		float const kernelParameter3
+	) = 0;
+
+	virtual std::pair< CUDA_FLOAT_DOUBLE const*, boost::uint32_t const* > SparseCalculateBias(
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		float const regularization
+	) = 0;
+
+	virtual std::pair< CUDA_FLOAT_DOUBLE const*, CUDA_FLOAT_DOUBLE const* > SparseCalculateObjectives(
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,
+		float const regularization,
+		float const bias
+	) = 0;
+
+	virtual void SparseKernelFindLargestScore(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	) = 0;
+
+	virtual void SparseKernelFindLargestPositiveGradient(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	) = 0;
+
+	virtual void SparseKernelFindLargestNegativeGradient(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	) = 0;
+
+	/*
+		fills in the clusters of a new layout, whose headers (and nonzero
+		indices) have already been uploaded, from the clusters of an old one:
+		the training vector in slot ii of the new layout is copied from slot
+		deviceSources[ ii ] of the old, and unused slots are zeroed. Only
+		called if CanRepackClusters()
+	*/
+	virtual void SparseRepackClusters(
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		CUDA::SparseKernelClusterHeader const* const deviceSourceClusterHeaders,
+		boost::uint32_t const* const deviceSources,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes
+	) = 0;
+};
+
+
+
+
+//============================================================================
+//    Backend inline methods
+//============================================================================
+
+
+template< typename t_Type >
+void Backend::HostAllocate( char const* const what, t_Type** const pPointer, size_t const size ) {
+
+	*pPointer = static_cast< t_Type* >( HostMalloc( what, size ) );
+}
+
+
+template< typename t_Type >
+void Backend::DeviceAllocate( char const* const what, t_Type** const pPointer, size_t const size ) {
+
+	*pPointer = static_cast< t_Type* >( DeviceMalloc( what, size ) );
+}
+
+
+template< typename t_Type >
+void Backend::MirrorAllocate( char const* const what, t_Type* const hostPointer, t_Type** const pDevicePointer, size_t const size ) {
+
+	if ( IsHostMemory() )
+		*pDevicePointer = hostPointer;
+	else
+		DeviceAllocate( what, pDevicePointer, size );
+}
+
+
+void Backend::MirrorFree( char const* const what, void* const hostPointer, void* const devicePointer ) {
+
+	if ( devicePointer != hostPointer )
+		DeviceFree( what, devicePointer );
+}
+
+
+
+
+//============================================================================
+//    CreateBackend function
+//============================================================================
+
+
+/*
+	GTSVM_BACKEND_DEFAULT is CUDA, unless it was not compiled in, in which
+	case it's the CPU
+*/
+boost::shared_ptr< Backend > CreateBackend( GTSVM_Backend const type );
+
+
+
+
+}    // namespace GTSVM
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __BACKEND_HPP__ */
@@ -0,0 +1,54 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file cpu.hpp
+	\brief Includes all CPU backend headers
+*/
+
+
+
+
+#ifndef __CPU_HPP__
+#define __CPU_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+/**
+	\namespace CPU
+	\brief CPU namespace
+*/
+
+
+
+
+#include "cpu_sparse_kernel.hpp"
+#include "cpu_array.hpp"
+
+#include "cpu_thread_pool.hpp"
+#include "cpu_backend.hpp"
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __CPU_HPP__ */
@@ -0,0 +1,274 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+	\file cpu_array.cpp
+	\brief CPU ArrayRead, ArrayUpdate and ArraySet functions
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace GTSVM {
+
+
+
+
+namespace CPU {
+
+
+
+
+//============================================================================
+//    ArrayReadHelper helper function
+//============================================================================
+
+
+template< typename t_Type >
+inline void ArrayReadHelper(
+	t_Type* const destination,
+	t_Type const* const source,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	// these arrays are tiny (one working set), so threading would not pay off
+	for ( unsigned int ii = 0; ii < size; ++ii )
+		destination[ ii ] = source[ indices[ ii ] ];
+}
+
+
+
+
+//============================================================================
+//    ArrayRead functions
+//============================================================================
+
+
+void BArrayRead(
+	bool* const destination,
+	bool const* const values,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArrayReadHelper( destination, values, indices, size );
+}
+
+
+void IArrayRead(
+	boost::uint32_t* const destination,
+	boost::uint32_t const* const values,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArrayReadHelper( destination, values, indices, size );
+}
+
+
+void FArrayRead(
+	float* const destination,
+	float const* const values,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArrayReadHelper( destination, values, indices, size );
+}
+
+
+#ifdef CUDA_USE_DOUBLE
+
+void DArrayRead(
+	double* const destination,
+	double const* const values,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArrayReadHelper( destination, values, indices, size );
+}
+
+#endif    // CUDA_USE_DOUBLE
+
+
+
+
+//============================================================================
+//    ArrayUpdateHelper helper function
+//============================================================================
+
+
+template< typename t_Type >
+inline void ArrayUpdateHelper(
+	t_Type* const destination,
+	t_Type const* const source,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	for ( unsigned int ii = 0; ii < size; ++ii )
+		destination[ indices[ ii ] ] = source[ ii ];
+}
+
+
+
+
+//============================================================================
+//    ArrayUpdate functions
+//============================================================================
+
+
+void BArrayUpdate(
+	bool* const destination,
+	bool const* const values,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArrayUpdateHelper( destination, values, indices, size );
+}
+
+
+void IArrayUpdate(
+	boost::uint32_t* const destination,
+	boost::uint32_t const* const values,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArrayUpdateHelper( destination, values, indices, size );
+}
+
+
+void FArrayUpdate(
+	float* const destination,
+	float const* const values,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArrayUpdateHelper( destination, values, indices, size );
+}
+
+
+#ifdef CUDA_USE_DOUBLE
+
+void DArrayUpdate(
+	double* const destination,
+	double const* const values,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArrayUpdateHelper( destination, values, indices, size );
+}
+
+#endif    // CUDA_USE_DOUBLE
+
+
+
+
+//============================================================================
+//    ArraySetHelper helper function
+//============================================================================
+
+
+template< typename t_Type >
+inline void ArraySetHelper(
+	t_Type* const destination,
+	t_Type const source,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	for ( unsigned int ii = 0; ii < size; ++ii )
+		destination[ indices[ ii ] ] = source;
+}
+
+
+
+
+//============================================================================
+//    ArraySet functions
+//============================================================================
+
+
+void BArraySet(
+	bool* const destination,
+	bool const source,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArraySetHelper( destination, source, indices, size );
+}
+
+
+void IArraySet(
+	boost::uint32_t* const destination,
+	boost::uint32_t const source,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArraySetHelper( destination, source, indices, size );
+}
+
+
+void FArraySet(
+	float* const destination,
+	float const source,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArraySetHelper( destination, source, indices, size );
+}
+
+
+#ifdef CUDA_USE_DOUBLE
+
+void DArraySet(
+	double* const destination,
+	double const source,
+	boost::uint32_t const* const indices,
+	unsigned int const size
+)
+{
+	ArraySetHelper( destination, source, indices, size );
+}
+
+#endif    // CUDA_USE_DOUBLE
+
+
+
+
+}    // namespace CPU
+
+
+
+
+}    // namespace GTSVM
@@ -0,0 +1,455 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file cpu_backend.cpp
+	\brief Multithreaded CPU implementation of the Backend interface
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace GTSVM {
+
+
+
+
+namespace CPU {
+
+
+
+
+namespace {
+
+
+
+
+//============================================================================
+//    Backend class
+//============================================================================
+
+
+/*
+	"Device" memory is ordinary host memory, so transfers between two copies of
+	the same buffer are no-ops, and uploads and downloads are done in place.
+*/
+struct Backend : public GTSVM::Backend {
+
+	GTSVM_Backend const GetType() const {
+
+		return GTSVM_BACKEND_CPU;
+	}
+
+	bool const IsHostMemory() const {
+
+		return true;
+	}
+
+	bool const CanRepackClusters() const {
+
+		return true;
+	}
+
+	bool const SupportsBatchSize( unsigned int const logBatchSize ) const {
+
+		return( ( logBatchSize >= 3 ) && ( logBatchSize <= 7 ) );
+	}
+
+
+	void* HostMalloc( char const* const what, size_t const size ) {
+
+		void* const result = std::malloc( std::max( size, static_cast< size_t >( 1 ) ) );
+		if ( result == NULL )
+			throw std::runtime_error( what );
+		return result;
+	}
+
+	void HostFree( char const* const what, void* const pointer ) {
+
+		std::free( pointer );
+	}
+
+	void* DeviceMalloc( char const* const what, size_t const size ) {
+
+		return HostMalloc( what, size );
+	}
+
+	void DeviceFree( char const* const what, void* const pointer ) {
+
+		HostFree( what, pointer );
+	}
+
+
+	void CopyToDevice(
+		char const* const what,
+		void* const deviceDestination,
+		void const* const source,
+		size_t const size
+	)
+	{
+		if ( deviceDestination != source )
+			std::memcpy( deviceDestination, source, size );
+	}
+
+	void CopyFromDevice(
+		char const* const what,
+		void* const destination,
+		void const* const deviceSource,
+		size_t const size
+	)
+	{
+		if ( destination != deviceSource )
+			std::memcpy( destination, deviceSource, size );
+	}
+
+	void* BeginUpload( char const* const what, void* const deviceDestination, size_t const size ) {
+
+		return deviceDestination;
+	}
+
+	void EndUpload( char const* const what, void* const deviceDestination, void* const buffer, size_t const size ) {
+
+		BOOST_ASSERT( buffer == deviceDestination );
+	}
+
+	void const* BeginDownload( char const* const what, void const* const deviceSource, size_t const size ) {
+
+		return deviceSource;
+	}
+
+	void EndDownload( char const* const what, void const* const deviceSource, void const* const buffer ) {
+
+		BOOST_ASSERT( buffer == deviceSource );
+	}
+
+
+	void ArrayRead(
+		float* const deviceDestination,
+		float const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	)
+	{
+		CPU::FArrayRead( deviceDestination, deviceValues, deviceIndices, size );
+	}
+
+#ifdef CUDA_USE_DOUBLE
+	void ArrayRead(
+		double* const deviceDestination,
+		double const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	)
+	{
+		CPU::DArrayRead( deviceDestination, deviceValues, deviceIndices, size );
+	}
+#endif    // CUDA_USE_DOUBLE
+
+	void ArrayUpdate(
+		float* const deviceDestination,
+		float const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	)
+	{
+		CPU::FArrayUpdate( deviceDestination, deviceValues, deviceIndices, size );
+	}
+
+
+	CUDA_FLOAT_DOUBLE const* SparseEvaluateKernel(
+		void* deviceWork1,
+		void* deviceWork2,
+		float const* const deviceBatchVectorsTranspose,
+		float const* const deviceBatchVectorNormsSquared,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const logBatchSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,    // in bytes
+		GTSVM_Kernel const kernel,
+		float const kernelParameter1,
+		float const kernelParameter2,
+		float const kernelParameter3
+	)
+	{
+		return CPU::SparseEvaluateKernel(
+			deviceWork1,
+			deviceWork2,
+			deviceBatchVectorsTranspose,
+			deviceBatchVectorNormsSquared,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			logBatchSize,
+			clusters,
+			classes,
+			workSize,
+			kernel,
+			kernelParameter1,
+			kernelParameter2,
+			kernelParameter3
+		);
+	}
+
+
+	void SparseUpdateKernel(
+		float const* const deviceBatchVectorsTranspose,
+		float const* const deviceBatchVectorNormsSquared,
+		float* const deviceBatchAlphas,
+		boost::uint32_t const* const deviceBatchIndices,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const logBatchSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		GTSVM_Kernel const kernel,
+		float const kernelParameter1,
+		float const kernelParameter2,
+		float const kernelParameter3
+	)
+	{
+		CPU::SparseUpdateKernel(
+			deviceBatchVectorsTranspose,
+			deviceBatchVectorNormsSquared,
+			deviceBatchAlphas,
+			deviceBatchIndices,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			logBatchSize,
+			clusters,
+			classes,
+			kernel,
+			kernelParameter1,
+			kernelParameter2,
+			kernelParameter3
+		);
+	}
+
+
+	std::pair< CUDA_FLOAT_DOUBLE const*, boost::uint32_t const* > SparseCalculateBias(
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		float const regularization
+	)
+	{
+		return CPU::SparseCalculateBias(
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			workSize,
+			regularization
+		);
+	}
+
+
+	std::pair< CUDA_FLOAT_DOUBLE const*, CUDA_FLOAT_DOUBLE const* > SparseCalculateObjectives(
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,
+		float const regularization,
+		float const bias
+	)
+	{
+		return CPU::SparseCalculateObjectives(
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			classes,
+			workSize,
+			regularization,
+			bias
+		);
+	}
+
+
+	void SparseKernelFindLargestScore(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	)
+	{
+		CPU::SparseKernelFindLargestScore(
+			destinationKeys,
+			destinationValues,
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			classes,
+			workSize,
+			resultSize,
+			destinationSize,
+			regularization
+		);
+	}
+
+
+	void SparseKernelFindLargestPositiveGradient(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	)
+	{
+		CPU::SparseKernelFindLargestPositiveGradient(
+			destinationKeys,
+			destinationValues,
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			workSize,
+			resultSize,
+			destinationSize,
+			regularization
+		);
+	}
+
+
+	void SparseKernelFindLargestNegativeGradient(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	)
+	{
+		CPU::SparseKernelFindLargestNegativeGradient(
+			destinationKeys,
+			destinationValues,
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			workSize,
+			resultSize,
+			destinationSize,
+			regularization
+		);
+	}
+
+
+	void SparseRepackClusters(
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		CUDA::SparseKernelClusterHeader const* const deviceSourceClusterHeaders,
+		boost::uint32_t const* const deviceSources,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes
+	)
+	{
+		CPU::SparseRepackClusters(
+			deviceClusterHeaders,
+			deviceSourceClusterHeaders,
+			deviceSources,
+			logMaximumClusterSize,
+			clusters,
+			classes
+		);
+	}
+};
+
+
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    CreateBackend function
+//============================================================================
+
+
+boost::shared_ptr< GTSVM::Backend > CreateBackend() {
+
+	return boost::shared_ptr< GTSVM::Backend >( new Backend );
+}
+
+
+
+
+}    // namespace CPU
+
+
+
+
+}    // namespace GTSVM
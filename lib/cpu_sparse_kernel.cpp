@@ -0,0 +1,1407 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+	\file cpu_sparse_kernel.cpp
+	\brief Multithreaded CPU implementations of the CUDA sparse kernel functions
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace GTSVM {
+
+
+
+
+namespace CPU {
+
+
+
+
+namespace {
+
+
+
+
+//============================================================================
+//    Kernel functors
+//============================================================================
+
+
+template< int t_Kernel >
+struct Kernel { };
+
+
+template<>
+struct Kernel< GTSVM_KERNEL_GAUSSIAN > {
+
+	static inline CUDA_FLOAT_DOUBLE Calculate(
+		float innerProduct,
+		float normSquared1,
+		float normSquared2,
+		float kernelParameter1,
+		float kernelParameter2,
+		float kernelParameter3
+	)
+	{
+		return std::exp( kernelParameter1 * ( 2 * innerProduct - normSquared1 - normSquared2 ) );
+	}
+};
+
+
+template<>
+struct Kernel< GTSVM_KERNEL_POLYNOMIAL > {
+
+	static inline CUDA_FLOAT_DOUBLE Calculate(
+		float innerProduct,
+		float normSquared1,
+		float normSquared2,
+		float kernelParameter1,
+		float kernelParameter2,
+		float kernelParameter3
+	)
+	{
+		return std::pow( kernelParameter1 * innerProduct + kernelParameter2, kernelParameter3 );
+	}
+};
+
+
+template<>
+struct Kernel< GTSVM_KERNEL_SIGMOID > {
+
+	static inline CUDA_FLOAT_DOUBLE Calculate(
+		float innerProduct,
+		float normSquared1,
+		float normSquared2,
+		float kernelParameter1,
+		float kernelParameter2,
+		float kernelParameter3
+	)
+	{
+		CUDA_FLOAT_DOUBLE const exponent = std::exp( 2 * ( kernelParameter1 * innerProduct + kernelParameter2 ) );
+		return( ( exponent - 1 ) / ( exponent + 1 ) );
+	}
+};
+
+
+
+
+//============================================================================
+//    ChunkCount helper function
+//============================================================================
+
+
+/*
+	the clusters are divided into contiguous chunks, each of which is one task
+	for the thread pool. We use a few chunks per thread, since clusters vary in
+	their number of nonzeros, but no more than will fit in the work buffer
+*/
+unsigned int const ChunkCount(
+	unsigned int const units,
+	size_t const workSize,
+	size_t const bytesPerChunk
+)
+{
+	unsigned int chunks = GetThreadPool()->GetThreads() * 4;
+	if ( chunks > units )
+		chunks = units;
+	if ( ( bytesPerChunk > 0 ) && ( chunks > workSize / bytesPerChunk ) )
+		chunks = workSize / bytesPerChunk;
+	return chunks;
+}
+
+
+inline unsigned int const ChunkBegin(
+	unsigned int const chunk,
+	unsigned int const chunks,
+	unsigned int const units
+)
+{
+	return static_cast< unsigned int >( ( static_cast< boost::uint64_t >( units ) * chunk ) / chunks );
+}
+
+
+
+
+//============================================================================
+//    CalculateClusterKernels helper functions
+//============================================================================
+
+
+template< unsigned int t_LogBatchSize, int t_Kernel >
+void CalculateClusterKernelsHelper(
+	CUDA_FLOAT_DOUBLE* const kernels,
+	float const* const innerProducts,
+	SparseKernelClusterHeader const& clusterHeader,
+	float const* const batchVectorNormsSquared,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3
+)
+{
+	for ( unsigned int ii = 0; ii < clusterHeader.size; ++ii ) {
+
+		float const trainingVectorNormSquared = clusterHeader.vectorNormsSquared[ ii ];
+		for ( unsigned int jj = 0; jj < ( 1u << t_LogBatchSize ); ++jj ) {
+
+			kernels[ ( ii << t_LogBatchSize ) + jj ] = Kernel< t_Kernel >::Calculate(
+				innerProducts[ ( ii << t_LogBatchSize ) + jj ],
+				trainingVectorNormSquared,
+				batchVectorNormsSquared[ jj ],
+				kernelParameter1,
+				kernelParameter2,
+				kernelParameter3
+			);
+		}
+	}
+}
+
+
+/*
+	fills kernels[ ( ii << t_LogBatchSize ) + jj ] with the kernel between the
+	iith vector in the cluster and the jjth batch vector. The inner products
+	are accumulated in single precision, in the same order as in the CUDA
+	kernels. Both scratch buffers must have room for 256 << t_LogBatchSize
+	elements.
+*/
+template< unsigned int t_LogBatchSize >
+void CalculateClusterKernels(
+	CUDA_FLOAT_DOUBLE* const kernels,
+	float* const innerProducts,
+	float const* const batchVectorsTranspose,
+	float const* const batchVectorNormsSquared,
+	SparseKernelClusterHeader const& clusterHeader,
+	unsigned int const logMaximumClusterSize,
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3
+)
+{
+	BOOST_ASSERT( clusterHeader.size <= ( 1u << logMaximumClusterSize ) );
+
+	std::fill( innerProducts, innerProducts + ( clusterHeader.size << t_LogBatchSize ), 0.0f );
+
+	for ( unsigned int ii = 0; ii < clusterHeader.nonzeros; ++ii ) {
+
+		float const* const batchValues = batchVectorsTranspose + ( clusterHeader.nonzeroIndices[ ii ] << t_LogBatchSize );
+
+		// the batch is sparse, so most of its rows are zero
+		bool nonzero = false;
+		for ( unsigned int jj = 0; jj < ( 1u << t_LogBatchSize ); ++jj )
+			nonzero |= ( batchValues[ jj ] != 0 );
+		if ( ! nonzero )
+			continue;
+
+		float const* const trainingValues = clusterHeader.vectorsTranspose + ( ii << logMaximumClusterSize );
+		for ( unsigned int jj = 0; jj < clusterHeader.size; ++jj ) {
+
+			float const trainingValue = trainingValues[ jj ];
+			if ( trainingValue != 0 ) {
+
+				float* const accumulators = innerProducts + ( jj << t_LogBatchSize );
+				for ( unsigned int kk = 0; kk < ( 1u << t_LogBatchSize ); ++kk )
+					accumulators[ kk ] += trainingValue * batchValues[ kk ];
+			}
+		}
+	}
+
+	switch( kernel ) {
+		case GTSVM_KERNEL_GAUSSIAN:   CalculateClusterKernelsHelper< t_LogBatchSize, GTSVM_KERNEL_GAUSSIAN   >( kernels, innerProducts, clusterHeader, batchVectorNormsSquared, kernelParameter1, kernelParameter2, kernelParameter3 ); break;
+		case GTSVM_KERNEL_POLYNOMIAL: CalculateClusterKernelsHelper< t_LogBatchSize, GTSVM_KERNEL_POLYNOMIAL >( kernels, innerProducts, clusterHeader, batchVectorNormsSquared, kernelParameter1, kernelParameter2, kernelParameter3 ); break;
+		case GTSVM_KERNEL_SIGMOID:    CalculateClusterKernelsHelper< t_LogBatchSize, GTSVM_KERNEL_SIGMOID    >( kernels, innerProducts, clusterHeader, batchVectorNormsSquared, kernelParameter1, kernelParameter2, kernelParameter3 ); break;
+		default: BOOST_ASSERT( false );
+	}
+}
+
+
+
+
+//============================================================================
+//    SparseEvaluateKernelTask functor
+//============================================================================
+
+
+struct SparseEvaluateKernelTask {
+
+	void operator()( unsigned int const chunk ) const {
+
+		switch( logBatchSize ) {
+			case 3: Run< 3 >( chunk ); break;
+			case 4: Run< 4 >( chunk ); break;
+			case 5: Run< 5 >( chunk ); break;
+			case 6: Run< 6 >( chunk ); break;
+			case 7: Run< 7 >( chunk ); break;
+			default: BOOST_ASSERT( false );
+		}
+	}
+
+
+	template< unsigned int t_LogBatchSize >
+	void Run( unsigned int const chunk ) const {
+
+		std::vector< CUDA_FLOAT_DOUBLE > kernels( 256 << t_LogBatchSize );
+		std::vector< float > innerProducts( 256 << t_LogBatchSize );
+
+		CUDA_FLOAT_DOUBLE* const result = destination + chunk * ( classes << t_LogBatchSize );
+		std::fill( result, result + ( classes << t_LogBatchSize ), 0 );
+
+		unsigned int const begin = ChunkBegin( chunk,     chunks, clusters );
+		unsigned int const end   = ChunkBegin( chunk + 1, chunks, clusters );
+		for ( unsigned int ii = begin; ii < end; ++ii ) {
+
+			SparseKernelClusterHeader const& clusterHeader = clusterHeaders[ ii ];
+
+			CalculateClusterKernels< t_LogBatchSize >(
+				&kernels[ 0 ],
+				&innerProducts[ 0 ],
+				batchVectorsTranspose,
+				batchVectorNormsSquared,
+				clusterHeader,
+				logMaximumClusterSize,
+				kernel,
+				kernelParameter1,
+				kernelParameter2,
+				kernelParameter3
+			);
+
+			for ( unsigned int jj = 0; jj < classes; ++jj ) {
+
+				float const* const alphas = clusterHeader.alphas + ( jj << logMaximumClusterSize );
+				CUDA_FLOAT_DOUBLE* const classResult = result + ( jj << t_LogBatchSize );
+
+				for ( unsigned int kk = 0; kk < clusterHeader.size; ++kk ) {
+
+					float const alpha = alphas[ kk ];
+					if ( alpha != 0 ) {
+
+						CUDA_FLOAT_DOUBLE const* const kernelRow = &kernels[ kk << t_LogBatchSize ];
+						for ( unsigned int ll = 0; ll < ( 1u << t_LogBatchSize ); ++ll )
+							classResult[ ll ] += alpha * kernelRow[ ll ];
+					}
+				}
+			}
+		}
+	}
+
+
+	CUDA_FLOAT_DOUBLE* destination;
+	float const* batchVectorsTranspose;
+	float const* batchVectorNormsSquared;
+	SparseKernelClusterHeader const* clusterHeaders;
+	unsigned int logMaximumClusterSize;
+	unsigned int logBatchSize;
+	unsigned int clusters;
+	unsigned int classes;
+	unsigned int chunks;
+	GTSVM_Kernel kernel;
+	float kernelParameter1;
+	float kernelParameter2;
+	float kernelParameter3;
+};
+
+
+
+
+//============================================================================
+//    SparseUpdateKernelTask functor
+//============================================================================
+
+
+struct SparseUpdateKernelTask {
+
+	void operator()( unsigned int const chunk ) const {
+
+		switch( logBatchSize ) {
+			case 3: Run< 3 >( chunk ); break;
+			case 4: Run< 4 >( chunk ); break;
+			case 5: Run< 5 >( chunk ); break;
+			case 6: Run< 6 >( chunk ); break;
+			case 7: Run< 7 >( chunk ); break;
+			default: BOOST_ASSERT( false );
+		}
+	}
+
+
+	template< unsigned int t_LogBatchSize >
+	void Run( unsigned int const chunk ) const {
+
+		std::vector< CUDA_FLOAT_DOUBLE > kernels( 256 << t_LogBatchSize );
+		std::vector< float > innerProducts( 256 << t_LogBatchSize );
+
+		unsigned int const begin = ChunkBegin( chunk,     chunks, clusters );
+		unsigned int const end   = ChunkBegin( chunk + 1, chunks, clusters );
+		for ( unsigned int ii = begin; ii < end; ++ii ) {
+
+			SparseKernelClusterHeader const& clusterHeader = clusterHeaders[ ii ];
+
+			CalculateClusterKernels< t_LogBatchSize >(
+				&kernels[ 0 ],
+				&innerProducts[ 0 ],
+				batchVectorsTranspose,
+				batchVectorNormsSquared,
+				clusterHeader,
+				logMaximumClusterSize,
+				kernel,
+				kernelParameter1,
+				kernelParameter2,
+				kernelParameter3
+			);
+
+			for ( unsigned int jj = 0; jj < classes; ++jj ) {
+
+				float const* const deltas = batchDeltaAlphas + ( jj << t_LogBatchSize );
+				CUDA_FLOAT_DOUBLE* const responses = clusterHeader.responses + ( jj << logMaximumClusterSize );
+
+				for ( unsigned int kk = 0; kk < clusterHeader.size; ++kk ) {
+
+					CUDA_FLOAT_DOUBLE const* const kernelRow = &kernels[ kk << t_LogBatchSize ];
+					CUDA_FLOAT_DOUBLE sum = 0;
+					for ( unsigned int ll = 0; ll < ( 1u << t_LogBatchSize ); ++ll )
+						sum += deltas[ ll ] * kernelRow[ ll ];
+					responses[ kk ] += sum;
+				}
+			}
+		}
+	}
+
+
+	float const* batchVectorsTranspose;
+	float const* batchVectorNormsSquared;
+	float const* batchDeltaAlphas;
+	SparseKernelClusterHeader const* clusterHeaders;
+	unsigned int logMaximumClusterSize;
+	unsigned int logBatchSize;
+	unsigned int clusters;
+	unsigned int classes;
+	unsigned int chunks;
+	GTSVM_Kernel kernel;
+	float kernelParameter1;
+	float kernelParameter2;
+	float kernelParameter3;
+};
+
+
+
+
+//============================================================================
+//    SparseCalculateBiasTask functor
+//============================================================================
+
+
+struct SparseCalculateBiasTask {
+
+	void operator()( unsigned int const chunk ) const {
+
+		CUDA_FLOAT_DOUBLE numerator = 0;
+		boost::uint32_t denominator = 0;
+
+		unsigned int const begin = ChunkBegin( chunk,     chunks, clusters );
+		unsigned int const end   = ChunkBegin( chunk + 1, chunks, clusters );
+		for ( unsigned int ii = begin; ii < end; ++ii ) {
+
+			SparseKernelClusterHeader const& clusterHeader = clusterHeaders[ ii ];
+
+			for ( unsigned int jj = 0; jj < clusterHeader.size; ++jj ) {
+
+				CUDA_FLOAT_DOUBLE const response = clusterHeader.responses[ jj ];
+				boost::int32_t const label = clusterHeader.labels[ jj ];
+				float const alpha = std::fabs( clusterHeader.alphas[ jj ] );
+
+				if ( ( alpha > 0 ) && ( alpha < regularization ) ) {
+
+					numerator += ( ( label > 0 ) ? 1 : -1 ) - response;
+					++denominator;
+				}
+			}
+		}
+
+		numeratorDestination[   chunk ] = numerator;
+		denominatorDestination[ chunk ] = denominator;
+	}
+
+
+	CUDA_FLOAT_DOUBLE* numeratorDestination;
+	boost::uint32_t* denominatorDestination;
+	SparseKernelClusterHeader const* clusterHeaders;
+	unsigned int clusters;
+	unsigned int chunks;
+	float regularization;
+};
+
+
+
+
+//============================================================================
+//    SparseCalculateObjectivesTask functor
+//============================================================================
+
+
+struct SparseCalculateObjectivesTask {
+
+	void operator()( unsigned int const chunk ) const {
+
+		CUDA_FLOAT_DOUBLE primalSum = 0;
+		CUDA_FLOAT_DOUBLE dualSum = 0;
+
+		unsigned int const begin = ChunkBegin( chunk,     chunks, clusters );
+		unsigned int const end   = ChunkBegin( chunk + 1, chunks, clusters );
+		for ( unsigned int ii = begin; ii < end; ++ii ) {
+
+			SparseKernelClusterHeader const& clusterHeader = clusterHeaders[ ii ];
+
+			for ( unsigned int jj = 0; jj < clusterHeader.size; ++jj ) {
+
+				if ( classes == 1 ) {
+
+					CUDA_FLOAT_DOUBLE const response = clusterHeader.responses[ jj ];
+					boost::int32_t const label = clusterHeader.labels[ jj ];
+					float const alpha = clusterHeader.alphas[ jj ];
+
+					CUDA_FLOAT_DOUBLE hinge;
+					if ( label > 0 )
+						hinge = 1 - ( response + bias );
+					else
+						hinge = 1 + ( response + bias );
+					if ( hinge < 0 )
+						hinge = 0;
+
+					CUDA_FLOAT_DOUBLE const weight = 0.5 * alpha * response;
+
+					primalSum += weight + regularization * hinge;
+					dualSum += std::fabs( alpha ) - weight;
+				}
+				else {
+
+					boost::int32_t const label = clusterHeader.labels[ jj ];
+					CUDA_FLOAT_DOUBLE const* pResponse = &clusterHeader.responses[ jj ];
+					float const* pAlpha = &clusterHeader.alphas[ jj ];
+
+					CUDA_FLOAT_DOUBLE hinge  = -std::numeric_limits< CUDA_FLOAT_DOUBLE >::infinity();
+					CUDA_FLOAT_DOUBLE weight = 0;
+					CUDA_FLOAT_DOUBLE hingeShift = 0;
+					float trueAlpha = 0;
+
+					for ( unsigned int kk = 0; kk < classes; ++kk, pResponse += ( 1u << logMaximumClusterSize ), pAlpha += ( 1u << logMaximumClusterSize ) ) {
+
+						CUDA_FLOAT_DOUBLE const response = *pResponse;
+						float const alpha = *pAlpha;
+
+						weight += alpha * response;
+
+						float innerHinge = response;
+						if ( static_cast< boost::int32_t >( kk ) == label ) {
+
+							trueAlpha = alpha;
+							hingeShift = 1 - response;
+							innerHinge -= 1;
+						}
+						if ( innerHinge > hinge )
+							hinge = innerHinge;
+					}
+					hinge += hingeShift;
+					weight *= 0.5;
+
+					primalSum += weight + regularization * hinge;
+					dualSum += trueAlpha - weight;
+				}
+			}
+		}
+
+		primalDestination[ chunk ] = primalSum;
+		dualDestination[   chunk ] = dualSum;
+	}
+
+
+	CUDA_FLOAT_DOUBLE* primalDestination;
+	CUDA_FLOAT_DOUBLE* dualDestination;
+	SparseKernelClusterHeader const* clusterHeaders;
+	unsigned int logMaximumClusterSize;
+	unsigned int clusters;
+	unsigned int classes;
+	unsigned int chunks;
+	float regularization;
+	float bias;
+};
+
+
+
+
+//============================================================================
+//    Score functors
+//============================================================================
+
+
+struct ScoreScore {
+
+	inline float const operator()(
+		SparseKernelClusterHeader const& clusterHeader,
+		unsigned int const index,
+		unsigned int const logMaximumClusterSize
+	) const
+	{
+		float score = -std::numeric_limits< float >::infinity();
+
+#ifndef SECOND_ORDER
+		if ( classes == 1 ) {
+
+			CUDA_FLOAT_DOUBLE const response = clusterHeader.responses[ index ];
+			boost::int32_t const label = clusterHeader.labels[ index ];
+			float const alpha = std::fabs( clusterHeader.alphas[ index ] );
+
+			float gradient = 0;
+			if ( label > 0 )
+				gradient = 1 - response;
+			else
+				gradient = 1 + response;
+
+			score = std::fabs( gradient );
+			if (
+				( ( gradient > 0 ) && ( ! ( alpha < regularization ) ) ) ||
+				( ( gradient < 0 ) && ( ! ( alpha >              0 ) ) )
+			)
+			{
+				score = -score;
+			}
+		}
+		else {
+
+			boost::int32_t const label = clusterHeader.labels[ index ];
+			CUDA_FLOAT_DOUBLE const* pResponse = &clusterHeader.responses[ index ];
+			float const* pAlpha = &clusterHeader.alphas[ index ];
+
+			CUDA_FLOAT_DOUBLE maximumGradient = -std::numeric_limits< CUDA_FLOAT_DOUBLE >::infinity();
+			CUDA_FLOAT_DOUBLE minimumGradient =  std::numeric_limits< CUDA_FLOAT_DOUBLE >::infinity();
+
+			for ( unsigned int kk = 0; kk < classes; ++kk, pResponse += ( 1u << logMaximumClusterSize ), pAlpha += ( 1u << logMaximumClusterSize ) ) {
+
+				CUDA_FLOAT_DOUBLE const response = *pResponse;
+				float const alpha = *pAlpha;
+
+				float gradient = -response;
+				float bound = 0;
+				if ( static_cast< boost::int32_t >( kk ) == label ) {
+
+					gradient += 1;
+					bound = regularization;
+				}
+
+				if ( ( alpha < bound ) && ( gradient > maximumGradient ) )
+					maximumGradient = gradient;
+				if ( gradient < minimumGradient )
+					minimumGradient = gradient;
+			}
+
+			score = maximumGradient - minimumGradient;
+		}
+#else    // SECOND_ORDER
+		if ( classes == 1 ) {
+
+			CUDA_FLOAT_DOUBLE const response = clusterHeader.responses[ index ];
+			boost::int32_t const label = clusterHeader.labels[ index ];
+			float const alpha = std::fabs( clusterHeader.alphas[ index ] );
+			float const scale = clusterHeader.vectorKernelNormsSquared[ index ];
+
+			float gradient = 0;
+			if ( label > 0 )
+				gradient = 1 - response;
+			else
+				gradient = 1 + response;
+
+			float newAlpha = alpha + gradient / scale;
+			if ( newAlpha > regularization )
+				newAlpha = regularization;
+			else if ( newAlpha < 0 )
+				newAlpha = 0;
+
+			float delta = newAlpha - alpha;
+			score = ( gradient - 0.5 * delta * scale ) * delta;
+		}
+		else {
+
+			boost::int32_t const label = clusterHeader.labels[ index ];
+			float const scale = clusterHeader.vectorKernelNormsSquared[ index ];
+			CUDA_FLOAT_DOUBLE const* pResponse = &clusterHeader.responses[ index ];
+			float const* pAlpha = &clusterHeader.alphas[ index ];
+
+			CUDA_FLOAT_DOUBLE minimumGradient = std::numeric_limits< CUDA_FLOAT_DOUBLE >::infinity();
+
+			for ( unsigned int kk = 0; kk < classes; ++kk, pResponse += ( 1u << logMaximumClusterSize ) ) {
+
+				float gradient = -*pResponse;
+				if ( static_cast< boost::int32_t >( kk ) == label )
+					gradient += 1;
+
+				if ( gradient < minimumGradient )
+					minimumGradient = gradient;
+			}
+			pResponse -= ( classes << logMaximumClusterSize );
+
+			for ( unsigned int kk = 0; kk < classes; ++kk, pResponse += ( 1u << logMaximumClusterSize ), pAlpha += ( 1u << logMaximumClusterSize ) ) {
+
+				CUDA_FLOAT_DOUBLE const response = *pResponse;
+				float const alpha = *pAlpha;
+
+				float gradient = -response;
+				float bound = 0;
+				if ( static_cast< boost::int32_t >( kk ) == label ) {
+
+					gradient += 1;
+					bound = regularization;
+				}
+
+				float delta = 0.5 * ( gradient - minimumGradient ) / scale;
+				if ( delta > 0 ) {
+
+					if ( delta > bound - alpha )
+						delta = bound - alpha;
+
+					float const newScore = ( ( gradient - minimumGradient ) - delta * scale ) * delta;
+					if ( newScore > score )
+						score = newScore;
+				}
+			}
+		}
+#endif    // SECOND_ORDER
+
+		return score;
+	}
+
+
+	unsigned int classes;
+	float regularization;
+};
+
+
+struct PositiveGradientScore {
+
+	inline float const operator()(
+		SparseKernelClusterHeader const& clusterHeader,
+		unsigned int const index,
+		unsigned int const logMaximumClusterSize
+	) const
+	{
+		float score = -std::numeric_limits< float >::infinity();
+
+		CUDA_FLOAT_DOUBLE const response = clusterHeader.responses[ index ];
+		boost::int32_t const label = clusterHeader.labels[ index ];
+		float const alpha = clusterHeader.alphas[ index ];
+
+		if ( label > 0 ) {
+
+			float const gradient = 1 - response;
+			if ( alpha < regularization )
+				score = gradient;
+		}
+		else {
+
+			float const gradient = -1 - response;
+			if ( alpha < -0 )
+				score = gradient;
+		}
+
+		return score;
+	}
+
+
+	float regularization;
+};
+
+
+struct NegativeGradientScore {
+
+	inline float const operator()(
+		SparseKernelClusterHeader const& clusterHeader,
+		unsigned int const index,
+		unsigned int const logMaximumClusterSize
+	) const
+	{
+		float score = -std::numeric_limits< float >::infinity();
+
+		CUDA_FLOAT_DOUBLE const response = clusterHeader.responses[ index ];
+		boost::int32_t const label = clusterHeader.labels[ index ];
+		float const alpha = clusterHeader.alphas[ index ];
+
+		if ( label > 0 ) {
+
+			float const gradient = 1 - response;
+			if ( alpha > 0 )
+				score = -gradient;
+		}
+		else {
+
+			float const gradient = -1 - response;
+			if ( alpha > -regularization )
+				score = -gradient;
+		}
+
+		return score;
+	}
+
+
+	float regularization;
+};
+
+
+
+
+//============================================================================
+//    FindLargestTask functor
+//============================================================================
+
+
+/*
+	each chunk writes its resultSize largest (key,value) pairs, in no
+	particular order, to the destination arrays. Unused slots get a value of
+	-1, which is never a valid training vector index
+*/
+template< typename t_Score >
+struct FindLargestTask {
+
+	void operator()( unsigned int const chunk ) const {
+
+		typedef std::pair< float, boost::uint32_t > Pair;
+
+		std::vector< Pair > heap;
+		heap.reserve( resultSize + 1 );
+
+		unsigned int const begin = ChunkBegin( chunk,     chunks, clusters );
+		unsigned int const end   = ChunkBegin( chunk + 1, chunks, clusters );
+		for ( unsigned int ii = begin; ii < end; ++ii ) {
+
+			SparseKernelClusterHeader const& clusterHeader = clusterHeaders[ ii ];
+
+			for ( unsigned int jj = 0; jj < clusterHeader.size; ++jj ) {
+
+				float const key = score( clusterHeader, jj, logMaximumClusterSize );
+
+				// heap is a min-heap containing the largest keys found so far
+				if ( heap.size() < resultSize ) {
+
+					heap.push_back( Pair( key, ( ii << logMaximumClusterSize ) + jj ) );
+					std::push_heap( heap.begin(), heap.end(), std::greater< Pair >() );
+				}
+				else if ( key > heap.front().first ) {
+
+					std::pop_heap( heap.begin(), heap.end(), std::greater< Pair >() );
+					heap.back() = Pair( key, ( ii << logMaximumClusterSize ) + jj );
+					std::push_heap( heap.begin(), heap.end(), std::greater< Pair >() );
+				}
+			}
+		}
+
+		float* const keys = destinationKeys + chunk * resultSize;
+		boost::uint32_t* const values = destinationValues + chunk * resultSize;
+		for ( unsigned int ii = 0; ii < resultSize; ++ii ) {
+
+			if ( ii < heap.size() ) {
+
+				keys[   ii ] = heap[ ii ].first;
+				values[ ii ] = heap[ ii ].second;
+			}
+			else {
+
+				keys[   ii ] = -std::numeric_limits< float >::infinity();
+				values[ ii ] = static_cast< boost::uint32_t >( -1 );
+			}
+		}
+	}
+
+
+	float* destinationKeys;
+	boost::uint32_t* destinationValues;
+	SparseKernelClusterHeader const* clusterHeaders;
+	unsigned int logMaximumClusterSize;
+	unsigned int clusters;
+	unsigned int resultSize;
+	unsigned int chunks;
+	t_Score score;
+};
+
+
+
+
+//============================================================================
+//    FindLargestHelper helper function
+//============================================================================
+
+
+template< typename t_Score >
+void FindLargestHelper(
+	std::string const& name,
+	t_Score const& score,
+	float* const destinationKeys,
+	boost::uint32_t* const destinationValues,
+	void* deviceWork1,
+	void* deviceWork2,
+	SparseKernelClusterHeader const* const deviceClusterHeaders,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const clusters,
+	unsigned int const workSize,
+	unsigned int const resultSize,
+	unsigned int const destinationSize
+)
+{
+	if ( ( resultSize < 1 ) || ( resultSize > 256 ) )
+		throw std::runtime_error( name + ": result size must be between 1 and 256" );
+	if ( resultSize > destinationSize )
+		throw std::runtime_error( name + ": destination is too small!" );
+
+	unsigned int const chunks = ChunkCount( clusters, workSize, resultSize * std::max( sizeof( float ), sizeof( boost::uint32_t ) ) );
+	if ( chunks < 1 )
+		throw std::runtime_error( name + ": work buffer is too small!" );
+
+	FindLargestTask< t_Score > task;
+	task.destinationKeys       = static_cast< float* >( deviceWork1 );
+	task.destinationValues     = static_cast< boost::uint32_t* >( deviceWork2 );
+	task.clusterHeaders        = deviceClusterHeaders;
+	task.logMaximumClusterSize = logMaximumClusterSize;
+	task.clusters              = clusters;
+	task.resultSize            = resultSize;
+	task.chunks                = chunks;
+	task.score                 = score;
+	GetThreadPool()->Run( chunks, task );
+
+	std::set< std::pair< float, boost::uint32_t > > maxima;
+	for ( unsigned int ii = 0; ii < chunks * resultSize; ++ii ) {
+
+		float const key = task.destinationKeys[ ii ];
+		boost::uint32_t const value = task.destinationValues[ ii ];
+		if ( value == static_cast< boost::uint32_t >( -1 ) )
+			continue;
+
+		if ( ( maxima.size() < resultSize ) || ( key > maxima.begin()->first ) )
+			maxima.insert( std::pair< float, boost::uint32_t >( key, value ) );
+		while ( maxima.size() > resultSize )
+			maxima.erase( maxima.begin() );
+	}
+	if ( maxima.size() != resultSize )
+		throw std::runtime_error( name + ": did not find the desired number of maxima" );
+	{	unsigned int index = 0;
+		std::set< std::pair< float, boost::uint32_t > >::const_iterator ii    = maxima.begin();
+		std::set< std::pair< float, boost::uint32_t > >::const_iterator iiEnd = maxima.end();
+		for ( ; ii != iiEnd; ++ii, ++index ) {
+
+			destinationKeys[   index ] = ii->first;
+			destinationValues[ index ] = ii->second;
+		}
+	}
+}
+
+
+
+//============================================================================
+//    SparseRepackClustersTask functor
+//============================================================================
+
+
+struct SparseRepackClustersTask {
+
+	void operator()( unsigned int const chunk ) const {
+
+		unsigned int const maximumClusterSize = ( 1u << logMaximumClusterSize );
+
+		unsigned int const begin = ChunkBegin( chunk,     chunks, clusters );
+		unsigned int const end   = ChunkBegin( chunk + 1, chunks, clusters );
+		for ( unsigned int ii = begin; ii < end; ++ii ) {
+
+			SparseKernelClusterHeader const& clusterHeader = clusterHeaders[ ii ];
+
+			for ( unsigned int jj = 0; jj < clusterHeader.size; ++jj ) {
+
+				unsigned int const source = sources[ ( ii << logMaximumClusterSize ) + jj ];
+				SparseKernelClusterHeader const& sourceHeader = sourceClusterHeaders[ source >> logMaximumClusterSize ];
+				unsigned int const index = ( source & ( maximumClusterSize - 1 ) );
+
+				clusterHeader.labels[ jj ] = sourceHeader.labels[ index ];
+				clusterHeader.vectorNormsSquared[ jj ] = sourceHeader.vectorNormsSquared[ index ];
+				clusterHeader.vectorKernelNormsSquared[ jj ] = sourceHeader.vectorKernelNormsSquared[ index ];
+				for ( unsigned int kk = 0; kk < classes; ++kk ) {
+
+					clusterHeader.responses[ ( kk << logMaximumClusterSize ) + jj ] = sourceHeader.responses[ ( kk << logMaximumClusterSize ) + index ];
+					clusterHeader.alphas[ ( kk << logMaximumClusterSize ) + jj ] = sourceHeader.alphas[ ( kk << logMaximumClusterSize ) + index ];
+				}
+
+				// both lists of nonzero indices are sorted, and the source's contains every nonzero of this training vector
+				unsigned int mm = 0;
+				for ( unsigned int kk = 0; kk < clusterHeader.nonzeros; ++kk ) {
+
+					boost::uint32_t const column = clusterHeader.nonzeroIndices[ kk ];
+					while ( ( mm < sourceHeader.nonzeros ) && ( sourceHeader.nonzeroIndices[ mm ] < column ) )
+						++mm;
+
+					float value = 0;
+					if ( ( mm < sourceHeader.nonzeros ) && ( sourceHeader.nonzeroIndices[ mm ] == column ) )
+						value = sourceHeader.vectorsTranspose[ ( mm << logMaximumClusterSize ) + index ];
+					clusterHeader.vectorsTranspose[ ( kk << logMaximumClusterSize ) + jj ] = value;
+				}
+			}
+
+			for ( unsigned int jj = clusterHeader.size; jj < maximumClusterSize; ++jj ) {
+
+				clusterHeader.labels[ jj ] = 0;
+				clusterHeader.vectorNormsSquared[ jj ] = 0;
+				clusterHeader.vectorKernelNormsSquared[ jj ] = 0;
+				for ( unsigned int kk = 0; kk < classes; ++kk ) {
+
+					clusterHeader.responses[ ( kk << logMaximumClusterSize ) + jj ] = 0;
+					clusterHeader.alphas[ ( kk << logMaximumClusterSize ) + jj ] = 0;
+				}
+				for ( unsigned int kk = 0; kk < clusterHeader.nonzeros; ++kk )
+					clusterHeader.vectorsTranspose[ ( kk << logMaximumClusterSize ) + jj ] = 0;
+			}
+		}
+	}
+
+
+	SparseKernelClusterHeader const* clusterHeaders;
+	SparseKernelClusterHeader const* sourceClusterHeaders;
+	boost::uint32_t const* sources;
+	unsigned int logMaximumClusterSize;
+	unsigned int clusters;
+	unsigned int classes;
+	unsigned int chunks;
+};
+
+
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    SparseEvaluateKernel function
+//============================================================================
+
+
+CUDA_FLOAT_DOUBLE const* SparseEvaluateKernel(
+	void* deviceWork1,
+	void* deviceWork2,
+	float const* const deviceBatchVectorsTranspose,
+	float const* const deviceBatchVectorNormsSquared,
+	SparseKernelClusterHeader const* const deviceClusterHeaders,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const logBatchSize,
+	unsigned int const clusters,
+	unsigned int const classes,
+	unsigned int const workSize,    // in bytes
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3
+)
+{
+	// we accept exactly the same arguments as the CUDA implementation
+	if ( logMaximumClusterSize == 4 ) {
+
+		if ( classes != 1 )
+			throw std::runtime_error( "SparseEvaluateKernel: multiclass only implemented for size-256 clusters" );
+	}
+	else if ( logMaximumClusterSize != 8 )
+		throw std::runtime_error( "SparseEvaluateKernel: maximum cluster size must be 16 or 256!" );
+
+	if ( ( logBatchSize < 3 ) || ( logBatchSize > 7 ) )
+		throw std::runtime_error( "SparseEvaluateKernel: batch size must be 8, 16, 32, 64 or 128!" );
+
+	if ( ( kernel != GTSVM_KERNEL_GAUSSIAN ) && ( kernel != GTSVM_KERNEL_POLYNOMIAL ) && ( kernel != GTSVM_KERNEL_SIGMOID ) )
+		throw std::runtime_error( "SparseEvaluateKernel: unknown kernel" );
+
+	unsigned int const chunks = ChunkCount( clusters, workSize, ( classes << logBatchSize ) * sizeof( CUDA_FLOAT_DOUBLE ) );
+	if ( ( chunks < 1 ) || ( workSize < ( classes << logBatchSize ) * sizeof( CUDA_FLOAT_DOUBLE ) ) )
+		throw std::runtime_error( "SparseEvaluateKernel: work buffer is too small!" );
+
+	SparseEvaluateKernelTask task;
+	task.destination             = static_cast< CUDA_FLOAT_DOUBLE* >( deviceWork1 );
+	task.batchVectorsTranspose   = deviceBatchVectorsTranspose;
+	task.batchVectorNormsSquared = deviceBatchVectorNormsSquared;
+	task.clusterHeaders          = deviceClusterHeaders;
+	task.logMaximumClusterSize   = logMaximumClusterSize;
+	task.logBatchSize            = logBatchSize;
+	task.clusters                = clusters;
+	task.classes                 = classes;
+	task.chunks                  = chunks;
+	task.kernel                  = kernel;
+	task.kernelParameter1        = kernelParameter1;
+	task.kernelParameter2        = kernelParameter2;
+	task.kernelParameter3        = kernelParameter3;
+	GetThreadPool()->Run( chunks, task );
+
+	CUDA_FLOAT_DOUBLE* const result = static_cast< CUDA_FLOAT_DOUBLE* >( deviceWork2 );
+	std::fill( result, result + ( classes << logBatchSize ), 0 );
+	for ( unsigned int ii = 0; ii < chunks; ++ii ) {
+
+		CUDA_FLOAT_DOUBLE const* const partial = task.destination + ii * ( classes << logBatchSize );
+		for ( unsigned int jj = 0; jj < ( classes << logBatchSize ); ++jj )
+			result[ jj ] += partial[ jj ];
+	}
+
+	return result;
+}
+
+
+
+
+//============================================================================
+//    SparseUpdateKernel function
+//============================================================================
+
+
+void SparseUpdateKernel(
+	float const* const deviceBatchVectorsTranspose,
+	float const* const deviceBatchVectorNormsSquared,
+	float* const deviceBatchAlphas,
+	boost::uint32_t const* const deviceBatchIndices,
+	SparseKernelClusterHeader const* const deviceClusterHeaders,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const logBatchSize,
+	unsigned int const clusters,
+	unsigned int const classes,
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3
+)
+{
+	if ( ( logBatchSize < 3 ) || ( logBatchSize > 7 ) )
+		throw std::runtime_error( "SparseUpdateKernel: batch size must be 8, 16, 32, 64 or 128!" );
+
+	// update trainingAlphas, and put the change in the alphas into deviceBatchAlphas
+	for ( unsigned int ii = 0; ii < ( 1u << logBatchSize ); ++ii ) {
+
+		unsigned int const cluster = ( deviceBatchIndices[ ii ] >> logMaximumClusterSize );
+		unsigned int const index = ( deviceBatchIndices[ ii ] & ( ( 1u << logMaximumClusterSize ) - 1 ) );
+
+		float* const trainingAlphas = deviceClusterHeaders[ cluster ].alphas;
+
+		for ( unsigned int jj = 0; jj < classes; ++jj ) {
+
+			float const oldAlpha = trainingAlphas[ index + ( jj << logMaximumClusterSize ) ];
+			float const newAlpha = deviceBatchAlphas[ ii + ( jj << logBatchSize ) ];
+			trainingAlphas[ index + ( jj << logMaximumClusterSize ) ] = newAlpha;
+			deviceBatchAlphas[ ii + ( jj << logBatchSize ) ] = newAlpha - oldAlpha;
+		}
+	}
+
+	if ( logMaximumClusterSize == 4 ) {
+
+		if ( classes != 1 )
+			throw std::runtime_error( "SparseUpdateKernel: multiclass only implemented for size-256 clusters" );
+	}
+	else if ( logMaximumClusterSize != 8 )
+		throw std::runtime_error( "SparseUpdateKernel: maximum cluster size must be 16 or 256!" );
+
+	if ( ( kernel != GTSVM_KERNEL_GAUSSIAN ) && ( kernel != GTSVM_KERNEL_POLYNOMIAL ) && ( kernel != GTSVM_KERNEL_SIGMOID ) )
+		throw std::runtime_error( "SparseUpdateKernel: unknown kernel" );
+
+	// the clusters' responses are disjoint, so no work buffer is needed
+	unsigned int const chunks = ChunkCount( clusters, 0, 0 );
+
+	SparseUpdateKernelTask task;
+	task.batchVectorsTranspose   = deviceBatchVectorsTranspose;
+	task.batchVectorNormsSquared = deviceBatchVectorNormsSquared;
+	task.batchDeltaAlphas        = deviceBatchAlphas;
+	task.clusterHeaders          = deviceClusterHeaders;
+	task.logMaximumClusterSize   = logMaximumClusterSize;
+	task.logBatchSize            = logBatchSize;
+	task.clusters                = clusters;
+	task.classes                 = classes;
+	task.chunks                  = chunks;
+	task.kernel                  = kernel;
+	task.kernelParameter1        = kernelParameter1;
+	task.kernelParameter2        = kernelParameter2;
+	task.kernelParameter3        = kernelParameter3;
+	GetThreadPool()->Run( chunks, task );
+}
+
+
+
+
+//============================================================================
+//    SparseCalculateBias function
+//============================================================================
+
+
+std::pair< CUDA_FLOAT_DOUBLE const*, boost::uint32_t const* > SparseCalculateBias(
+	void* deviceWork1,
+	void* deviceWork2,
+	void* deviceWork3,
+	void* deviceWork4,
+	SparseKernelClusterHeader const* const deviceClusterHeaders,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const clusters,
+	unsigned int const workSize,
+	float const regularization
+)
+{
+	unsigned int const chunks = ChunkCount( clusters, workSize, std::max( sizeof( CUDA_FLOAT_DOUBLE ), sizeof( boost::uint32_t ) ) );
+	if ( chunks < 1 )
+		throw std::runtime_error( "SparseCalculateBias: work buffer is too small!" );
+
+	SparseCalculateBiasTask task;
+	task.numeratorDestination   = static_cast< CUDA_FLOAT_DOUBLE* >( deviceWork1 );
+	task.denominatorDestination = static_cast< boost::uint32_t* >( deviceWork3 );
+	task.clusterHeaders         = deviceClusterHeaders;
+	task.clusters               = clusters;
+	task.chunks                 = chunks;
+	task.regularization         = regularization;
+	GetThreadPool()->Run( chunks, task );
+
+	CUDA_FLOAT_DOUBLE* const pNumerator = static_cast< CUDA_FLOAT_DOUBLE* >( deviceWork2 );
+	boost::uint32_t* const pDenominator = static_cast< boost::uint32_t* >( deviceWork4 );
+	*pNumerator   = 0;
+	*pDenominator = 0;
+	for ( unsigned int ii = 0; ii < chunks; ++ii ) {
+
+		*pNumerator   += task.numeratorDestination[   ii ];
+		*pDenominator += task.denominatorDestination[ ii ];
+	}
+
+	return std::pair< CUDA_FLOAT_DOUBLE const*, boost::uint32_t const* >( pNumerator, pDenominator );
+}
+
+
+
+
+//============================================================================
+//    SparseCalculateObjectives function
+//============================================================================
+
+
+std::pair< CUDA_FLOAT_DOUBLE const*, CUDA_FLOAT_DOUBLE const* > SparseCalculateObjectives(
+	void* deviceWork1,
+	void* deviceWork2,
+	void* deviceWork3,
+	void* deviceWork4,
+	SparseKernelClusterHeader const* const deviceClusterHeaders,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const clusters,
+	unsigned int const classes,
+	unsigned int const workSize,
+	float const regularization,
+	float const bias
+)
+{
+	unsigned int const chunks = ChunkCount( clusters, workSize, sizeof( CUDA_FLOAT_DOUBLE ) );
+	if ( chunks < 1 )
+		throw std::runtime_error( "SparseCalculateObjectives: work buffer is too small!" );
+
+	SparseCalculateObjectivesTask task;
+	task.primalDestination     = static_cast< CUDA_FLOAT_DOUBLE* >( deviceWork1 );
+	task.dualDestination       = static_cast< CUDA_FLOAT_DOUBLE* >( deviceWork3 );
+	task.clusterHeaders        = deviceClusterHeaders;
+	task.logMaximumClusterSize = logMaximumClusterSize;
+	task.clusters              = clusters;
+	task.classes               = classes;
+	task.chunks                = chunks;
+	task.regularization        = regularization;
+	task.bias                  = bias;
+	GetThreadPool()->Run( chunks, task );
+
+	CUDA_FLOAT_DOUBLE* const pPrimal = static_cast< CUDA_FLOAT_DOUBLE* >( deviceWork2 );
+	CUDA_FLOAT_DOUBLE* const pDual   = static_cast< CUDA_FLOAT_DOUBLE* >( deviceWork4 );
+	*pPrimal = 0;
+	*pDual   = 0;
+	for ( unsigned int ii = 0; ii < chunks; ++ii ) {
+
+		*pPrimal += task.primalDestination[ ii ];
+		*pDual   += task.dualDestination[   ii ];
+	}
+
+	return std::pair< CUDA_FLOAT_DOUBLE const*, CUDA_FLOAT_DOUBLE const* >( pPrimal, pDual );
+}
+
+
+
+
+//============================================================================
+//    SparseKernelFindLargestScore function
+//============================================================================
+
+
+void SparseKernelFindLargestScore(
+	float* const destinationKeys,
+	boost::uint32_t* const destinationValues,
+	void* deviceWork1,
+	void* deviceWork2,
+	void* deviceWork3,
+	void* deviceWork4,
+	SparseKernelClusterHeader const* const deviceClusterHeaders,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const clusters,
+	unsigned int const classes,
+	unsigned int const workSize,
+	unsigned int const resultSize,
+	unsigned int const destinationSize,
+	float const regularization
+)
+{
+	ScoreScore score;
+	score.classes        = classes;
+	score.regularization = regularization;
+
+	FindLargestHelper(
+		"SparseKernelFindLargestScore",
+		score,
+		destinationKeys,
+		destinationValues,
+		deviceWork1,
+		deviceWork2,
+		deviceClusterHeaders,
+		logMaximumClusterSize,
+		clusters,
+		workSize,
+		resultSize,
+		destinationSize
+	);
+}
+
+
+
+
+//============================================================================
+//    SparseKernelFindLargestPositiveGradient function
+//============================================================================
+
+
+void SparseKernelFindLargestPositiveGradient(
+	float* const destinationKeys,
+	boost::uint32_t* const destinationValues,
+	void* deviceWork1,
+	void* deviceWork2,
+	void* deviceWork3,
+	void* deviceWork4,
+	SparseKernelClusterHeader const* const deviceClusterHeaders,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const clusters,
+	unsigned int const workSize,
+	unsigned int const resultSize,
+	unsigned int const destinationSize,
+	float const regularization
+)
+{
+	PositiveGradientScore score;
+	score.regularization = regularization;
+
+	FindLargestHelper(
+		"SparseKernelFindLargestPositiveGradient",
+		score,
+		destinationKeys,
+		destinationValues,
+		deviceWork1,
+		deviceWork2,
+		deviceClusterHeaders,
+		logMaximumClusterSize,
+		clusters,
+		workSize,
+		resultSize,
+		destinationSize
+	);
+}
+
+
+
+
+//============================================================================
+//    SparseKernelFindLargestNegativeGradient function
+//============================================================================
+
+
+void SparseKernelFindLargestNegativeGradient(
+	float* const destinationKeys,
+	boost::uint32_t* const destinationValues,
+	void* deviceWork1,
+	void* deviceWork2,
+	void* deviceWork3,
+	void* deviceWork4,
+	SparseKernelClusterHeader const* const deviceClusterHeaders,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const clusters,
+	unsigned int const workSize,
+	unsigned int const resultSize,
+	unsigned int const destinationSize,
+	float const regularization
+)
+{
+	NegativeGradientScore score;
+	score.regularization = regularization;
+
+	FindLargestHelper(
+		"SparseKernelFindLargestNegativeGradient",
+		score,
+		destinationKeys,
+		destinationValues,
+		deviceWork1,
+		deviceWork2,
+		deviceClusterHeaders,
+		logMaximumClusterSize,
+		clusters,
+		workSize,
+		resultSize,
+		destinationSize
+	);
+}
+
+
+
+
+//============================================================================
+//    SparseRepackClusters function
+//============================================================================
+
+
+void SparseRepackClusters(
+	SparseKernelClusterHeader const* const deviceClusterHeaders,
+	SparseKernelClusterHeader const* const deviceSourceClusterHeaders,
+	boost::uint32_t const* const deviceSources,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const clusters,
+	unsigned int const classes
+)
+{
+	// each cluster is written by only one task, so no work buffer is needed
+	unsigned int const chunks = ChunkCount( clusters, 0, 0 );
+
+	SparseRepackClustersTask task;
+	task.clusterHeaders        = deviceClusterHeaders;
+	task.sourceClusterHeaders  = deviceSourceClusterHeaders;
+	task.sources               = deviceSources;
+	task.logMaximumClusterSize = logMaximumClusterSize;
+	task.clusters              = clusters;
+	task.classes               = classes;
+	task.chunks                = chunks;
+	GetThreadPool()->Run( chunks, task );
+}
+
+
+
+
+}    // namespace CPU
+
+
+
+
+}    // namespace GTSVM
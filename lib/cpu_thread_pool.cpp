@@ -0,0 +1,254 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+/**
+	\file cpu_thread_pool.cpp
+	\brief implementation of ThreadPool class
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace GTSVM {
+
+
+
+
+namespace CPU {
+
+
+
+
+//============================================================================
+//    ThreadPool::Batch structure
+//============================================================================
+
+
+struct ThreadPool::Batch {
+
+	boost::function< void ( unsigned int ) > const* task;
+	unsigned int tasks;
+	unsigned int next;
+	unsigned int remaining;
+
+	bool failed;
+	std::string error;
+};
+
+
+
+
+//============================================================================
+//    ThreadPool methods
+//============================================================================
+
+
+ThreadPool::ThreadPool( unsigned int const threads ) :
+	m_threads( threads ),
+	m_stop( false )
+{
+	if ( m_threads < 1 ) {
+
+		m_threads = boost::thread::hardware_concurrency();
+		if ( m_threads < 1 )
+			m_threads = 1;
+	}
+
+	// the thread which calls Run() does its share of the work
+	for ( unsigned int ii = 1; ii < m_threads; ++ii )
+		m_workers.create_thread( boost::bind( &ThreadPool::Worker, this ) );
+}
+
+
+ThreadPool::~ThreadPool() {
+
+	// the last user might be an interrupted thread, but the workers must still be joined
+	boost::this_thread::disable_interruption const disableInterruption;
+
+	{	boost::lock_guard< boost::mutex > lock( m_mutex );
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	m_workers.join_all();
+}
+
+
+void ThreadPool::Run( unsigned int const tasks, boost::function< void ( unsigned int ) > const& task ) {
+
+	if ( tasks < 1 )
+		return;
+
+	// no need to involve the workers
+	if ( ( tasks == 1 ) || ( m_threads <= 1 ) ) {
+
+		for ( unsigned int ii = 0; ii < tasks; ++ii )
+			task( ii );
+		return;
+	}
+
+	// the batch lives on our stack, so we can't leave (by being interrupted) until the workers are finished with it
+	boost::this_thread::disable_interruption const disableInterruption;
+
+	Batch batch;
+	batch.task      = &task;
+	batch.tasks     = tasks;
+	batch.next      = 0;
+	batch.remaining = tasks;
+	batch.failed    = false;
+
+	boost::unique_lock< boost::mutex > lock( m_mutex );
+
+	m_queue.push_back( &batch );
+	m_condition.notify_all();
+
+	while ( batch.next < batch.tasks ) {
+
+		unsigned int const index = batch.next++;
+		if ( batch.next >= batch.tasks )
+			m_queue.erase( std::find( m_queue.begin(), m_queue.end(), &batch ) );
+
+		lock.unlock();
+		Execute( &batch, index );
+		lock.lock();
+	}
+
+	while ( batch.remaining > 0 )
+		m_condition.wait( lock );
+
+	if ( batch.failed )
+		throw std::runtime_error( batch.error );
+}
+
+
+void ThreadPool::Worker() {
+
+	boost::unique_lock< boost::mutex > lock( m_mutex );
+
+	for ( ; ; ) {
+
+		while ( ( ! m_stop ) && m_queue.empty() )
+			m_condition.wait( lock );
+		if ( m_stop )
+			break;
+
+		Batch* const batch = m_queue.front();
+		unsigned int const index = batch->next++;
+		if ( batch->next >= batch->tasks )
+			m_queue.pop_front();
+
+		lock.unlock();
+		Execute( batch, index );
+		lock.lock();
+	}
+}
+
+
+void ThreadPool::Execute( Batch* const batch, unsigned int const index ) {
+
+	bool failed = false;
+	std::string error;
+	try {
+
+		( *batch->task )( index );
+	}
+	catch( std::exception& exception ) {
+
+		failed = true;
+		error = exception.what();
+	}
+	catch( ... ) {
+
+		failed = true;
+		error = "ThreadPool: unknown exception";
+	}
+
+	boost::lock_guard< boost::mutex > lock( m_mutex );
+
+	if ( failed && ( ! batch->failed ) ) {
+
+		batch->failed = true;
+		batch->error = error;
+	}
+
+	// the waiting Run() call is sharing the condition variable with the workers
+	if ( --batch->remaining == 0 )
+		m_condition.notify_all();
+}
+
+
+
+
+//============================================================================
+//    process-wide thread pool
+//============================================================================
+
+
+namespace {
+
+
+boost::mutex g_threadPoolMutex;
+boost::shared_ptr< ThreadPool > g_threadPool;
+
+
+}    // anonymous namespace
+
+
+boost::shared_ptr< ThreadPool > const GetThreadPool() {
+
+	boost::lock_guard< boost::mutex > lock( g_threadPoolMutex );
+
+	if ( ! g_threadPool )
+		g_threadPool.reset( new ThreadPool( 0 ) );
+
+	return g_threadPool;
+}
+
+
+void SetThreads( unsigned int const threads ) {
+
+	boost::lock_guard< boost::mutex > lock( g_threadPoolMutex );
+
+	unsigned int desiredThreads = threads;
+	if ( desiredThreads < 1 ) {
+
+		desiredThreads = boost::thread::hardware_concurrency();
+		if ( desiredThreads < 1 )
+			desiredThreads = 1;
+	}
+
+	if ( ( ! g_threadPool ) || ( g_threadPool->GetThreads() != desiredThreads ) ) {
+
+		g_threadPool.reset( new ThreadPool( desiredThreads ) );
+	}
+}
+
+
+
+
+}    // namespace CPU
+
+
+
+
+}    // namespace GTSVM
@@ -0,0 +1,150 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file cpu_thread_pool.hpp
+	\brief definition of ThreadPool class
+*/
+
+
+
+
+#ifndef __CPU_THREAD_POOL_HPP__
+#define __CPU_THREAD_POOL_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <deque>
+
+
+
+
+namespace GTSVM {
+
+
+
+
+namespace CPU {
+
+
+
+
+//============================================================================
+//    ThreadPool class
+//============================================================================
+
+
+/*
+	A fixed set of worker threads which execute "tasks", each of which is
+	identified by an index in [0,tasks). Run() blocks until every task has
+	finished, with the calling thread helping out, so it is safe to call Run()
+	from several threads at once, and from inside of a task. If any task
+	throws, Run() throws a std::runtime_error containing the first message.
+	Neither Run() nor the destructor may be interrupted (by
+	boost::thread::interrupt()).
+*/
+struct ThreadPool {
+
+	explicit ThreadPool( unsigned int const threads );
+	~ThreadPool();
+
+
+	inline unsigned int const GetThreads() const;
+
+	void Run( unsigned int const tasks, boost::function< void ( unsigned int ) > const& task );
+
+
+private:
+
+	struct Batch;
+
+	void Worker();
+	void Execute( Batch* const batch, unsigned int const index );
+
+
+	unsigned int m_threads;
+
+	boost::mutex m_mutex;
+	boost::condition_variable m_condition;
+	std::deque< Batch* > m_queue;
+	bool m_stop;
+
+	boost::thread_group m_workers;
+
+
+	inline ThreadPool( ThreadPool const& other );
+	inline ThreadPool const& operator=( ThreadPool const& other );
+};
+
+
+
+
+//============================================================================
+//    ThreadPool inline methods
+//============================================================================
+
+
+unsigned int const ThreadPool::GetThreads() const {
+
+	return m_threads;
+}
+
+
+
+
+//============================================================================
+//    process-wide thread pool
+//============================================================================
+
+
+/*
+	the CPU kernels share one pool, in the same way that the CUDA kernels share
+	one device. Passing zero to SetThreads() selects the number of hardware
+	threads. Callers hold on to the returned pool for as long as they use it, so
+	changing the number of threads while another thread is inside of Run() is
+	permitted: the old pool is destroyed once its last user has finished.
+*/
+boost::shared_ptr< ThreadPool > const GetThreadPool();
+
+void SetThreads( unsigned int const threads );
+
+
+
+
+}    // namespace CPU
+
+
+
+
+}    // namespace GTSVM
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __CPU_THREAD_POOL_HPP__ */
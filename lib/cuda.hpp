@@ -45,8 +45,11 @@
 #include "cuda_find_largest.hpp"
 #include "cuda_partial_sum.hpp"
 #include "cuda_array.hpp"
+#include "cuda_backend.hpp"
 
+#ifndef GTSVM_NO_CUDA
 #include "cuda_exception.hpp"
+#endif    /* GTSVM_NO_CUDA */
 #include "cuda_helpers.hpp"
 
 
@@ -0,0 +1,474 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file cuda_backend.cpp
+	\brief CUDA implementation of the Backend interface
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace GTSVM {
+
+
+
+
+namespace CUDA {
+
+
+
+
+namespace {
+
+
+
+
+//============================================================================
+//    Backend class
+//============================================================================
+
+
+/*
+	Host buffers are pinned (allocated with cudaMallocHost), and uploads and
+	downloads are staged through a pinned buffer of the same size.
+*/
+struct Backend : public GTSVM::Backend {
+
+	GTSVM_Backend const GetType() const {
+
+		return GTSVM_BACKEND_CUDA;
+	}
+
+	bool const IsHostMemory() const {
+
+		return false;
+	}
+
+	// there's no CUDA kernel for this, so the SVM re-initializes the device instead
+	bool const CanRepackClusters() const {
+
+		return false;
+	}
+
+	// the CUDA kernels are tiled for batches of 16
+	bool const SupportsBatchSize( unsigned int const logBatchSize ) const {
+
+		return( logBatchSize == 4 );
+	}
+
+
+	void* HostMalloc( char const* const what, size_t const size ) {
+
+		void* result = NULL;
+		CUDA_VERIFY( what, cudaMallocHost( &result, size ) );
+		return result;
+	}
+
+	void HostFree( char const* const what, void* const pointer ) {
+
+		CUDA_VERIFY( what, cudaFreeHost( pointer ) );
+	}
+
+	void* DeviceMalloc( char const* const what, size_t const size ) {
+
+		void* result = NULL;
+		CUDA_VERIFY( what, cudaMalloc( &result, size ) );
+		return result;
+	}
+
+	void DeviceFree( char const* const what, void* const pointer ) {
+
+		CUDA_VERIFY( what, cudaFree( pointer ) );
+	}
+
+
+	void CopyToDevice(
+		char const* const what,
+		void* const deviceDestination,
+		void const* const source,
+		size_t const size
+	)
+	{
+		CUDA_VERIFY( what, cudaMemcpy( deviceDestination, source, size, cudaMemcpyHostToDevice ) );
+	}
+
+	void CopyFromDevice(
+		char const* const what,
+		void* const destination,
+		void const* const deviceSource,
+		size_t const size
+	)
+	{
+		CUDA_VERIFY( what, cudaMemcpy( destination, deviceSource, size, cudaMemcpyDeviceToHost ) );
+	}
+
+	void* BeginUpload( char const* const what, void* const deviceDestination, size_t const size ) {
+
+		return HostMalloc( what, size );
+	}
+
+	void EndUpload( char const* const what, void* const deviceDestination, void* const buffer, size_t const size ) {
+
+		try {
+
+			CopyToDevice( what, deviceDestination, buffer, size );
+		}
+		catch( ... ) {
+
+			cudaFreeHost( buffer );
+			throw;
+		}
+		HostFree( what, buffer );
+	}
+
+	void const* BeginDownload( char const* const what, void const* const deviceSource, size_t const size ) {
+
+		void* const buffer = HostMalloc( what, size );
+		try {
+
+			CopyFromDevice( what, buffer, deviceSource, size );
+		}
+		catch( ... ) {
+
+			cudaFreeHost( buffer );
+			throw;
+		}
+		return buffer;
+	}
+
+	void EndDownload( char const* const what, void const* const deviceSource, void const* const buffer ) {
+
+		HostFree( what, const_cast< void* >( buffer ) );
+	}
+
+
+	void ArrayRead(
+		float* const deviceDestination,
+		float const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	)
+	{
+		CUDA::FArrayRead( deviceDestination, deviceValues, deviceIndices, size );
+	}
+
+#ifdef CUDA_USE_DOUBLE
+	void ArrayRead(
+		double* const deviceDestination,
+		double const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	)
+	{
+		CUDA::DArrayRead( deviceDestination, deviceValues, deviceIndices, size );
+	}
+#endif    // CUDA_USE_DOUBLE
+
+	void ArrayUpdate(
+		float* const deviceDestination,
+		float const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	)
+	{
+		CUDA::FArrayUpdate( deviceDestination, deviceValues, deviceIndices, size );
+	}
+
+
+	CUDA_FLOAT_DOUBLE const* SparseEvaluateKernel(
+		void* deviceWork1,
+		void* deviceWork2,
+		float const* const deviceBatchVectorsTranspose,
+		float const* const deviceBatchVectorNormsSquared,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const logBatchSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,    // in bytes
+		GTSVM_Kernel const kernel,
+		float const kernelParameter1,
+		float const kernelParameter2,
+		float const kernelParameter3
+	)
+	{
+		// SVM::SetBatchSize() has already refused anything else
+		if ( ! SupportsBatchSize( logBatchSize ) )
+			throw std::runtime_error( "The CUDA backend only supports a batch size of 16" );
+
+		return CUDA::SparseEvaluateKernel(
+			deviceWork1,
+			deviceWork2,
+			deviceBatchVectorsTranspose,
+			deviceBatchVectorNormsSquared,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			classes,
+			workSize,
+			kernel,
+			kernelParameter1,
+			kernelParameter2,
+			kernelParameter3
+		);
+	}
+
+
+	void SparseUpdateKernel(
+		float const* const deviceBatchVectorsTranspose,
+		float const* const deviceBatchVectorNormsSquared,
+		float* const deviceBatchAlphas,
+		boost::uint32_t const* const deviceBatchIndices,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const logBatchSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		GTSVM_Kernel const kernel,
+		float const kernelParameter1,
+		float const kernelParameter2,
+		float const kernelParameter3
+	)
+	{
+		// SVM::SetBatchSize() has already refused anything else
+		if ( ! SupportsBatchSize( logBatchSize ) )
+			throw std::runtime_error( "The CUDA backend only supports a batch size of 16" );
+
+		CUDA::SparseUpdateKernel(
+			deviceBatchVectorsTranspose,
+			deviceBatchVectorNormsSquared,
+			deviceBatchAlphas,
+			deviceBatchIndices,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			classes,
+			kernel,
+			kernelParameter1,
+			kernelParameter2,
+			kernelParameter3
+		);
+	}
+
+
+	std::pair< CUDA_FLOAT_DOUBLE const*, boost::uint32_t const* > SparseCalculateBias(
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		float const regularization
+	)
+	{
+		return CUDA::SparseCalculateBias(
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			workSize,
+			regularization
+		);
+	}
+
+
+	std::pair< CUDA_FLOAT_DOUBLE const*, CUDA_FLOAT_DOUBLE const* > SparseCalculateObjectives(
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,
+		float const regularization,
+		float const bias
+	)
+	{
+		return CUDA::SparseCalculateObjectives(
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			classes,
+			workSize,
+			regularization,
+			bias
+		);
+	}
+
+
+	void SparseKernelFindLargestScore(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	)
+	{
+		CUDA::SparseKernelFindLargestScore(
+			destinationKeys,
+			destinationValues,
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			classes,
+			workSize,
+			resultSize,
+			destinationSize,
+			regularization
+		);
+	}
+
+
+	void SparseKernelFindLargestPositiveGradient(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	)
+	{
+		CUDA::SparseKernelFindLargestPositiveGradient(
+			destinationKeys,
+			destinationValues,
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			workSize,
+			resultSize,
+			destinationSize,
+			regularization
+		);
+	}
+
+
+	void SparseKernelFindLargestNegativeGradient(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	)
+	{
+		CUDA::SparseKernelFindLargestNegativeGradient(
+			destinationKeys,
+			destinationValues,
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			workSize,
+			resultSize,
+			destinationSize,
+			regularization
+		);
+	}
+
+
+	void SparseRepackClusters(
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		CUDA::SparseKernelClusterHeader const* const deviceSourceClusterHeaders,
+		boost::uint32_t const* const deviceSources,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes
+	)
+	{
+		throw std::runtime_error( "The CUDA backend cannot repack clusters" );
+	}
+};
+
+
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    CreateBackend function
+//============================================================================
+
+
+boost::shared_ptr< GTSVM::Backend > CreateBackend() {
+
+	return boost::shared_ptr< GTSVM::Backend >( new Backend );
+}
+
+
+
+
+}    // namespace CUDA
+
+
+
+
+}    // namespace GTSVM
@@ -39,30 +39,253 @@ namespace {
 //============================================================================
 
 
-typedef std::map< GTSVM_Context, boost::shared_ptr< GTSVM::SVM > > ContextMap;
+struct ContextEntry;
+typedef std::map< GTSVM_Context, boost::shared_ptr< ContextEntry > > ContextMap;
 
+struct SessionEntry;
+typedef std::map< GTSVM_Session, boost::shared_ptr< SessionEntry > > SessionMap;
+
+// the registry is only locked while looking up, adding or removing contexts and sessions
+boost::shared_mutex g_registryMutex;
 ContextMap g_contextMap;
 GTSVM_Context g_nextContext = 0;
+SessionMap g_sessionMap;
+GTSVM_Session g_nextSession = 0;
+
+
+
+
+//============================================================================
+//    ContextEntry structure
+//============================================================================
+
 
-bool g_error = false;
-std::string g_errorString;
+struct ContextEntry {
+
+	explicit inline ContextEntry( GTSVM_Backend const backend ) : svm( backend ) { }
+
+	GTSVM::SVM svm;
+	boost::shared_mutex mutex;    // held exclusively by calls on this context, and shared by classifications with its sessions
+};
 
 
 
 
 //============================================================================
-//    SAVE_EXCEPTIONS macros
+//    SessionEntry structure
+//============================================================================
+
+
+struct SessionEntry {
+
+	inline SessionEntry( boost::shared_ptr< ContextEntry > const& context, boost::shared_ptr< GTSVM::Session > const& session ) :
+		context( context ),
+		session( session )
+	{
+	}
+
+	boost::shared_ptr< ContextEntry > const context;    // outlives the context's destruction, for as long as the session exists
+	boost::shared_ptr< GTSVM::Session > const session;
+	boost::mutex mutex;    // serializes calls on this session
+};
+
+
+
+
+//============================================================================
+//    ContextLock class
+//============================================================================
+
+
+/*
+	Finds a context and holds its lock for as long as this object exists. The
+	context itself is kept alive too, so if another thread destroys it
+	meanwhile, then it's only actually destroyed once we're finished with it
+*/
+struct ContextLock {
+
+	explicit inline ContextLock( GTSVM_Context const context );
+
+	inline GTSVM::SVM* operator->() const;
+	inline GTSVM::SVM& operator*() const;
+
+	inline boost::shared_ptr< ContextEntry > const& GetEntry() const;
+
+
+private:
+
+	static inline boost::shared_ptr< ContextEntry > const Find( GTSVM_Context const context );
+
+	boost::shared_ptr< ContextEntry > const m_entry;
+	boost::unique_lock< boost::shared_mutex > const m_lock;    // must follow m_entry, so that it's released first
+};
+
+
+ContextLock::ContextLock( GTSVM_Context const context ) :
+	m_entry( Find( context ) ),
+	m_lock( m_entry->mutex )
+{
+}
+
+
+GTSVM::SVM* ContextLock::operator->() const {
+
+	return &m_entry->svm;
+}
+
+
+GTSVM::SVM& ContextLock::operator*() const {
+
+	return m_entry->svm;
+}
+
+
+boost::shared_ptr< ContextEntry > const& ContextLock::GetEntry() const {
+
+	return m_entry;
+}
+
+
+boost::shared_ptr< ContextEntry > const ContextLock::Find( GTSVM_Context const context ) {
+
+	boost::shared_lock< boost::shared_mutex > lock( g_registryMutex );
+
+	ContextMap::const_iterator const pContext = g_contextMap.find( context );
+	if ( pContext == g_contextMap.end() )
+		throw std::runtime_error( "Context does not exist" );
+	return pContext->second;
+}
+
+
+
+
+//============================================================================
+//    SessionLock class
+//============================================================================
+
+
+/*
+	Finds a session, and holds its lock, along with a shared lock on its
+	context, so that any number of sessions may classify with one context at
+	once. Classifying with a context which isn't initialized on the device
+	initializes it, though, so in that case the context is locked exclusively
+	instead
+*/
+struct SessionLock {
+
+	explicit inline SessionLock( GTSVM_Session const session );
+
+	inline GTSVM::SVM* operator->() const;
+	inline GTSVM::Session& GetSession() const;
+
+
+private:
+
+	static inline boost::shared_ptr< SessionEntry > const Find( GTSVM_Session const session );
+
+	boost::shared_ptr< SessionEntry > const m_entry;
+	boost::unique_lock< boost::mutex > const m_lock;
+	boost::shared_lock< boost::shared_mutex > m_sharedContextLock;
+	boost::unique_lock< boost::shared_mutex > m_uniqueContextLock;
+};
+
+
+SessionLock::SessionLock( GTSVM_Session const session ) :
+	m_entry( Find( session ) ),
+	m_lock( m_entry->mutex ),
+	m_sharedContextLock( m_entry->context->mutex ),
+	m_uniqueContextLock( m_entry->context->mutex, boost::defer_lock )
+{
+	if ( ! m_entry->context->svm.IsInitializedDevice() ) {
+
+		m_sharedContextLock.unlock();
+		m_uniqueContextLock.lock();
+	}
+}
+
+
+GTSVM::SVM* SessionLock::operator->() const {
+
+	return &m_entry->context->svm;
+}
+
+
+GTSVM::Session& SessionLock::GetSession() const {
+
+	return *m_entry->session;
+}
+
+
+boost::shared_ptr< SessionEntry > const SessionLock::Find( GTSVM_Session const session ) {
+
+	boost::shared_lock< boost::shared_mutex > lock( g_registryMutex );
+
+	SessionMap::const_iterator const pSession = g_sessionMap.find( session );
+	if ( pSession == g_sessionMap.end() )
+		throw std::runtime_error( "Session does not exist" );
+	return pSession->second;
+}
+
+
+
+
 //============================================================================
+//    ErrorState structure
+//============================================================================
+
 
+// each thread has its own, so that concurrent calls don't see each other's errors
+struct ErrorState {
 
-template< typename t_Exception >
-inline void CatchSaveExceptionsFunction( t_Exception const& error ) {
+	inline ErrorState() : error( false ) { }
 
-	g_error = true;
-	g_errorString = error.What();
+	bool error;
+	std::string message;
+};
+
+
+boost::thread_specific_ptr< ErrorState > g_errorState;
+
+
+inline ErrorState& GetErrorState() {
+
+	ErrorState* result = g_errorState.get();
+	if ( result == NULL ) {
+
+		result = new ErrorState;
+		g_errorState.reset( result );
+	}
+	return *result;
+}
+
+
+inline void ClearError() {
+
+	GetErrorState().error = false;
+}
+
+
+inline bool const GetError() {
+
+	return GetErrorState().error;
+}
+
+
+inline void SetError( char const* const message ) {
+
+	ErrorState& state = GetErrorState();
+	state.error = true;
+	state.message = message;
 }
 
 
+
+
+//============================================================================
+//    SAVE_EXCEPTIONS macros
+//============================================================================
+
+
 #define TRY_SAVE_EXCEPTIONS  \
 	try {
 
@@ -70,12 +293,10 @@ inline void CatchSaveExceptionsFunction( t_Exception const& error ) {
 #define CATCH_SAVE_EXCEPTIONS  \
 	}  \
 	catch( std::exception& error ) {  \
-		g_error = true;  \
-		g_errorString = error.what();  \
+		SetError( error.what() );  \
 	}  \
 	catch( ... ) {  \
-		g_error = true;  \
-		g_errorString = "Unknown error";  \
+		SetError( "Unknown error" );  \
 	}
 
 
@@ -93,9 +314,11 @@ inline void CatchSaveExceptionsFunction( t_Exception const& error ) {
 
 extern "C" char const* GTSVM_Error() {
 
+	ErrorState const& state = GetErrorState();
+
 	char const* result = "No error";
-	if ( g_error )
-		result = g_errorString.c_str();
+	if ( state.error )
+		result = state.message.c_str();
 	return result;
 }
 
@@ -109,20 +332,98 @@ extern "C" char const* GTSVM_Error() {
 
 extern "C" bool GTSVM_Create( GTSVM_Context* const pContext ) {
 
-	g_error = false;
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		// the context is constructed outside of the lock, since this may be slow (e.g. initializing CUDA)
+		boost::shared_ptr< ContextEntry > const entry( new ContextEntry( GTSVM_BACKEND_DEFAULT ) );
+
+		boost::unique_lock< boost::shared_mutex > lock( g_registryMutex );
+		if ( g_nextContext + 1 == 0 )
+			throw std::runtime_error( "Too many contexts created" );
+
+		*pContext = g_nextContext;
+		g_contextMap.insert( std::pair< GTSVM_Context, boost::shared_ptr< ContextEntry > >( g_nextContext, entry ) );
+		++g_nextContext;
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_CreateWithBackend function
+//============================================================================
+
+
+extern "C" bool GTSVM_CreateWithBackend(
+	GTSVM_Context* const pContext,
+	GTSVM_Backend const backend
+)
+{
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
+		boost::shared_ptr< ContextEntry > const entry( new ContextEntry( backend ) );
+
+		boost::unique_lock< boost::shared_mutex > lock( g_registryMutex );
 		if ( g_nextContext + 1 == 0 )
 			throw std::runtime_error( "Too many contexts created" );
 
 		*pContext = g_nextContext;
-		g_contextMap.insert( std::pair< GTSVM_Context, boost::shared_ptr< GTSVM::SVM > >( g_nextContext, boost::shared_ptr< GTSVM::SVM >( new GTSVM::SVM ) ) );
+		g_contextMap.insert( std::pair< GTSVM_Context, boost::shared_ptr< ContextEntry > >( g_nextContext, entry ) );
 		++g_nextContext;
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_SetThreads function
+//============================================================================
+
+
+extern "C" bool GTSVM_SetThreads( unsigned int const threads ) {
+
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		GTSVM::CPU::SetThreads( threads );
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_SetTraceFile function
+//============================================================================
+
+
+extern "C" bool GTSVM_SetTraceFile( char const* const filename ) {
+
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		GTSVM::SetTraceFile( filename );
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
 }
 
 
@@ -135,18 +436,24 @@ extern "C" bool GTSVM_Create( GTSVM_Context* const pContext ) {
 
 extern "C" bool GTSVM_Destroy( GTSVM_Context const context ) {
 
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
-		g_contextMap.erase( pContext );
+		// if another thread is using the context, then whichever finishes last destroys it
+		boost::shared_ptr< ContextEntry > entry;
+		{	boost::unique_lock< boost::shared_mutex > lock( g_registryMutex );
+
+			ContextMap::iterator pContext = g_contextMap.find( context );
+			if ( pContext == g_contextMap.end() )
+				throw std::runtime_error( "Context does not exist" );
+			entry = pContext->second;
+			g_contextMap.erase( pContext );
+		}
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -175,19 +482,19 @@ extern "C" bool GTSVM_InitializeSparse(
 	float const kernelParameter2,
 	float const kernelParameter3,
 	bool const biased,
+	GTSVM_ColumnOrder const columnOrder,
+	GTSVM_Clustering const clustering,
 	bool const smallClusters,
 	unsigned int const activeClusters
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->InitializeSparse(
+		pContext->InitializeSparse(
 			trainingVectors,
 			trainingVectorIndices,
 			trainingVectorOffsets,
@@ -204,13 +511,15 @@ extern "C" bool GTSVM_InitializeSparse(
 			kernelParameter2,
 			kernelParameter3,
 			biased,
+			columnOrder,
+			clustering,
 			smallClusters,
 			activeClusters
 		);
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -237,19 +546,19 @@ extern "C" bool GTSVM_InitializeDense(
 	float const kernelParameter2,
 	float const kernelParameter3,
 	bool const biased,
+	GTSVM_ColumnOrder const columnOrder,
+	GTSVM_Clustering const clustering,
 	bool const smallClusters,
 	unsigned int const activeClusters
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->InitializeDense(
+		pContext->InitializeDense(
 			trainingVectors,
 			trainingVectorsType,
 			trainingLabels,
@@ -264,13 +573,68 @@ extern "C" bool GTSVM_InitializeDense(
 			kernelParameter2,
 			kernelParameter3,
 			biased,
+			columnOrder,
+			clustering,
 			smallClusters,
 			activeClusters
 		);
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_InitializeShared function
+//============================================================================
+
+
+extern "C" bool GTSVM_InitializeShared(
+	GTSVM_Context const context,
+	GTSVM_Context const source,
+	void const* const trainingLabels,    // may be NULL
+	GTSVM_Type const trainingLabelsType,
+	bool const multiclass,
+	float const regularization,
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3,
+	bool const biased
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		if ( context == source )
+			throw std::runtime_error( "A context cannot share its own training data" );
+
+		// contexts are always locked in the same order, so that two threads sharing in opposite directions can't deadlock
+		ContextLock const first(  std::min( context, source ) );
+		ContextLock const second( std::max( context, source ) );
+		ContextLock const& pContext = ( ( context < source ) ? first  : second );
+		ContextLock const& pSource  = ( ( context < source ) ? second : first  );
+
+		pContext->InitializeShared(
+			*pSource,
+			trainingLabels,
+			trainingLabelsType,
+			multiclass,
+			regularization,
+			kernel,
+			kernelParameter1,
+			kernelParameter2,
+			kernelParameter3,
+			biased
+		);
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
 }
 
 
@@ -284,27 +648,27 @@ extern "C" bool GTSVM_InitializeDense(
 extern "C" bool GTSVM_Load(
 	GTSVM_Context const context,
 	char const* const filename,
+	GTSVM_Clustering const clustering,
 	bool const smallClusters,
 	unsigned int const activeClusters
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->Load(
+		pContext->Load(
 			filename,
+			clustering,
 			smallClusters,
 			activeClusters
 		);
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -320,19 +684,17 @@ extern "C" bool GTSVM_Save(
 	char const* const filename
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->Save( filename );
+		pContext->Save( filename );
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -345,26 +707,26 @@ extern "C" bool GTSVM_Save(
 
 extern "C" bool GTSVM_Shrink(
 	GTSVM_Context const context,
+	GTSVM_Clustering const clustering,
 	bool const smallClusters,
 	unsigned int const activeClusters
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->Shrink(
+		pContext->Shrink(
+			clustering,
 			smallClusters,
 			activeClusters
 		);
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -377,19 +739,17 @@ extern "C" bool GTSVM_Shrink(
 
 extern "C" bool GTSVM_DeinitializeDevice( GTSVM_Context const context ) {
 
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->DeinitializeDevice();
+		pContext->DeinitializeDevice();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -402,271 +762,303 @@ extern "C" bool GTSVM_DeinitializeDevice( GTSVM_Context const context ) {
 
 extern "C" bool GTSVM_Deinitialize( GTSVM_Context const context ) {
 
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->Deinitialize();
+		pContext->Deinitialize();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
 
 
 //============================================================================
-//    GTSVM_GetRows function
+//    GTSVM_SetBatchSize function
 //============================================================================
 
 
-extern "C" bool GTSVM_GetRows(
+extern "C" bool GTSVM_SetBatchSize(
 	GTSVM_Context const context,
-	unsigned int* const result
+	unsigned int const batchSize
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetRows();
+		pContext->SetBatchSize( batchSize );
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
 
 
 //============================================================================
-//    GTSVM_GetColumns function
+//    GTSVM_GetBatchSize function
 //============================================================================
 
 
-extern "C" bool GTSVM_GetColumns(
+extern "C" bool GTSVM_GetBatchSize(
 	GTSVM_Context const context,
 	unsigned int* const result
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetColumns();
+		*result = pContext->GetBatchSize();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
 
 
 //============================================================================
-//    GTSVM_GetClasses function
+//    GTSVM_GetRows function
 //============================================================================
 
 
-extern "C" bool GTSVM_GetClasses(
+extern "C" bool GTSVM_GetRows(
 	GTSVM_Context const context,
 	unsigned int* const result
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetClasses();
+		*result = pContext->GetRows();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
 
 
 //============================================================================
-//    GTSVM_GetNonzeros function
+//    GTSVM_GetColumns function
 //============================================================================
 
 
-extern "C" bool GTSVM_GetNonzeros(
+extern "C" bool GTSVM_GetColumns(
 	GTSVM_Context const context,
 	unsigned int* const result
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetNonzeros();
+		*result = pContext->GetColumns();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
 
 
 //============================================================================
-//    GTSVM_GetRegularization function
+//    GTSVM_GetClasses function
 //============================================================================
 
 
-extern "C" bool GTSVM_GetRegularization(
+extern "C" bool GTSVM_GetClasses(
 	GTSVM_Context const context,
-	float* const result
+	unsigned int* const result
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetRegularization();
+		*result = pContext->GetClasses();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
 
 
 //============================================================================
-//    GTSVM_GetKernel function
+//    GTSVM_GetNonzeros function
 //============================================================================
 
 
-extern "C" bool GTSVM_GetKernel (
+extern "C" bool GTSVM_GetNonzeros(
 	GTSVM_Context const context,
-	GTSVM_Kernel* const result
+	unsigned int* const result
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetKernel();
+		*result = pContext->GetNonzeros();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
 
 
 //============================================================================
-//    GTSVM_GetKernelParameter1 function
+//    GTSVM_GetRegularization function
 //============================================================================
 
 
-extern "C" bool GTSVM_GetKernelParameter1 (
+extern "C" bool GTSVM_GetRegularization(
 	GTSVM_Context const context,
 	float* const result
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetKernelParameter1();
+		*result = pContext->GetRegularization();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
 
 
 //============================================================================
-//    GTSVM_GetKernelParameter2 function
+//    GTSVM_GetKernel function
 //============================================================================
 
 
-extern "C" bool GTSVM_GetKernelParameter2 (
+extern "C" bool GTSVM_GetKernel (
 	GTSVM_Context const context,
-	float* const result
+	GTSVM_Kernel* const result
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetKernelParameter2();
+		*result = pContext->GetKernel();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
 
 
 //============================================================================
-//    GTSVM_GetKernelParameter3 function
+//    GTSVM_GetKernelParameter1 function
 //============================================================================
 
 
-extern "C" bool GTSVM_GetKernelParameter3 (
+extern "C" bool GTSVM_GetKernelParameter1 (
+	GTSVM_Context const context,
+	float* const result
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		*result = pContext->GetKernelParameter1();
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_GetKernelParameter2 function
+//============================================================================
+
+
+extern "C" bool GTSVM_GetKernelParameter2 (
 	GTSVM_Context const context,
 	float* const result
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetKernelParameter3();
+		*result = pContext->GetKernelParameter2();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_GetKernelParameter3 function
+//============================================================================
+
+
+extern "C" bool GTSVM_GetKernelParameter3 (
+	GTSVM_Context const context,
+	float* const result
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		*result = pContext->GetKernelParameter3();
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
 }
 
 
@@ -682,19 +1074,17 @@ extern "C" bool GTSVM_GetBiased(
 	bool* const result
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetBiased();
+		*result = pContext->GetBiased();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -710,19 +1100,17 @@ extern "C" bool GTSVM_GetBias(
 	double* const result
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		*result = pContext->second->GetBias();
+		*result = pContext->GetBias();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -742,15 +1130,13 @@ extern "C" bool GTSVM_GetTrainingVectorsSparse(
 	bool const columnMajor
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->GetTrainingVectorsSparse(
+		pContext->GetTrainingVectorsSparse(
 			trainingVectors,
 			trainingVectorIndices,
 			trainingVectorOffsets,
@@ -760,7 +1146,7 @@ extern "C" bool GTSVM_GetTrainingVectorsSparse(
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -778,15 +1164,13 @@ extern "C" bool GTSVM_GetTrainingVectorsDense(
 	bool const columnMajor
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->GetTrainingVectorsDense(
+		pContext->GetTrainingVectorsDense(
 			trainingVectors,
 			trainingVectorsType,
 			columnMajor
@@ -794,7 +1178,7 @@ extern "C" bool GTSVM_GetTrainingVectorsDense(
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -811,22 +1195,20 @@ extern "C" bool GTSVM_GetTrainingLabels(
 	GTSVM_Type const trainingLabelsType
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->GetTrainingLabels(
+		pContext->GetTrainingLabels(
 			trainingLabels,
 			trainingLabelsType
 		);
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -844,15 +1226,13 @@ extern "C" bool GTSVM_GetTrainingResponses(
 	bool const columnMajor
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->GetTrainingResponses(
+		pContext->GetTrainingResponses(
 			trainingResponses,
 			trainingResponsesType,
 			columnMajor
@@ -860,7 +1240,7 @@ extern "C" bool GTSVM_GetTrainingResponses(
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -878,15 +1258,13 @@ extern "C" bool GTSVM_GetAlphas(
 	bool const columnMajor
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->GetAlphas(
+		pContext->GetAlphas(
 			trainingAlphas,
 			trainingAlphasType,
 			columnMajor
@@ -894,7 +1272,7 @@ extern "C" bool GTSVM_GetAlphas(
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -912,15 +1290,13 @@ extern "C" bool GTSVM_SetAlphas(
 	bool const columnMajor
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->SetAlphas(
+		pContext->SetAlphas(
 			trainingAlphas,
 			trainingAlphasType,
 			columnMajor
@@ -928,7 +1304,7 @@ extern "C" bool GTSVM_SetAlphas(
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -941,19 +1317,17 @@ extern "C" bool GTSVM_SetAlphas(
 
 extern "C" bool GTSVM_Recalculate( GTSVM_Context const context ) {
 
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->Recalculate();
+		pContext->Recalculate();
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -974,15 +1348,13 @@ extern "C" bool GTSVM_Restart(
 	bool const biased
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->Restart(
+		pContext->Restart(
 			regularization,
 			kernel,
 			kernelParameter1,
@@ -993,7 +1365,62 @@ extern "C" bool GTSVM_Restart(
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_SetRegularization function
+//============================================================================
+
+
+extern "C" bool GTSVM_SetRegularization(
+	GTSVM_Context const context,
+	float const regularization
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		pContext->SetRegularization( regularization );
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_SetKernel function
+//============================================================================
+
+
+extern "C" bool GTSVM_SetKernel(
+	GTSVM_Context const context,
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		pContext->SetKernel( kernel, kernelParameter1, kernelParameter2, kernelParameter3 );
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
 }
 
 
@@ -1011,21 +1438,71 @@ extern "C" bool GTSVM_Optimize(
 	unsigned int const iterations
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		std::pair< CUDA_FLOAT_DOUBLE, CUDA_FLOAT_DOUBLE > const result = pContext->second->Optimize( iterations );
+		std::pair< CUDA_FLOAT_DOUBLE, CUDA_FLOAT_DOUBLE > const result = pContext->Optimize( iterations );
 		*pPrimal = result.first;
 		*pDual   = result.second;
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_SetShrinking function
+//============================================================================
+
+
+extern "C" bool GTSVM_SetShrinking(
+	GTSVM_Context const context,
+	bool const shrinking
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		pContext->SetShrinking( shrinking );
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_Unshrink function
+//============================================================================
+
+
+extern "C" bool GTSVM_Unshrink(
+	GTSVM_Context const context,
+	bool* const pShrunk
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		*pShrunk = pContext->Unshrink();
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
 }
 
 
@@ -1049,15 +1526,13 @@ extern "C" bool GTSVM_ClassifySparse(
 	bool const columnMajor
 )
 {
-	g_error = false;
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		ContextLock const pContext( context );
 
-		pContext->second->ClassifySparse(
+		pContext->ClassifySparse(
 			result,
 			resultType,
 			vectors,
@@ -1071,7 +1546,7 @@ extern "C" bool GTSVM_ClassifySparse(
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
 
 
@@ -1093,15 +1568,320 @@ extern "C" bool GTSVM_ClassifyDense(
 	bool const columnMajor
 )
 {
-	g_error = false;
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		pContext->ClassifyDense(
+			result,
+			resultType,
+			vectors,
+			vectorsType,
+			rows,
+			columns,
+			columnMajor
+		);
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_GetStatistics function
+//============================================================================
+
+
+extern "C" bool GTSVM_GetStatistics(
+	GTSVM_Context const context,
+	GTSVM_Statistics* const pStatistics
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		*pStatistics = pContext->GetStatistics();
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_ResetStatistics function
+//============================================================================
+
+
+extern "C" bool GTSVM_ResetStatistics( GTSVM_Context const context ) {
+
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		pContext->ResetStatistics();
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_GetPhaseName function
+//============================================================================
+
+
+extern "C" char const* GTSVM_GetPhaseName( GTSVM_Phase const phase ) {
+
+	char const* result = NULL;
+	switch( phase ) {
+		case GTSVM_PHASE_SELECTION:            { result = "selection";            break; }
+		case GTSVM_PHASE_ASSEMBLY:             { result = "assembly";             break; }
+		case GTSVM_PHASE_SOLVE:                { result = "solve";                break; }
+		case GTSVM_PHASE_TRANSFER:             { result = "transfer";             break; }
+		case GTSVM_PHASE_EVALUATE_KERNEL:      { result = "evaluate_kernel";      break; }
+		case GTSVM_PHASE_UPDATE_KERNEL:        { result = "update_kernel";        break; }
+		case GTSVM_PHASE_CALCULATE_OBJECTIVES: { result = "calculate_objectives"; break; }
+		case GTSVM_PHASE_CLUSTERING:           { result = "clustering";           break; }
+		case GTSVM_PHASE_SHRINKING:            { result = "shrinking";            break; }
+		default: break;
+	}
+	return result;
+}
+
+
+
+
+//============================================================================
+//    GTSVM_GetMemoryUsage function
+//============================================================================
+
+
+extern "C" bool GTSVM_GetMemoryUsage(
+	GTSVM_Context const context,
+	GTSVM_MemoryUsage* const pUsage
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		pContext->GetMemoryUsage( pUsage );
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_PredictMemoryUsage function
+//============================================================================
+
+
+extern "C" bool GTSVM_PredictMemoryUsage(
+	GTSVM_Context const context,
+	GTSVM_MemoryUsage* const pUsage,
+	GTSVM_Clustering const clustering,
+	bool const smallClusters,
+	unsigned int const activeClusters
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		ContextLock const pContext( context );
+
+		pContext->PredictMemoryUsage( pUsage, clustering, smallClusters, activeClusters );
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_GetBufferName function
+//============================================================================
+
+
+extern "C" char const* GTSVM_GetBufferName( GTSVM_Buffer const buffer ) {
+
+	char const* result = NULL;
+	switch( buffer ) {
+		case GTSVM_BUFFER_TRAINING_VECTORS: { result = "training_vectors"; break; }
+		case GTSVM_BUFFER_NONZERO_INDICES:  { result = "nonzero_indices";  break; }
+		case GTSVM_BUFFER_CLUSTERS:         { result = "clusters";         break; }
+		case GTSVM_BUFFER_LABELS:           { result = "labels";           break; }
+		case GTSVM_BUFFER_NORMS:            { result = "norms";            break; }
+		case GTSVM_BUFFER_RESPONSES:        { result = "responses";        break; }
+		case GTSVM_BUFFER_ALPHAS:           { result = "alphas";           break; }
+		case GTSVM_BUFFER_BATCH:            { result = "batch";            break; }
+		case GTSVM_BUFFER_WORK:             { result = "work";             break; }
+		case GTSVM_BUFFER_COLUMNS:          { result = "columns";          break; }
+		default: break;
+	}
+	return result;
+}
+
+
+
+
+//============================================================================
+//    GTSVM_CreateSession function
+//============================================================================
+
+
+extern "C" bool GTSVM_CreateSession(
+	GTSVM_Context const context,
+	GTSVM_Session* const pSession
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		boost::shared_ptr< SessionEntry > entry;
+		{	ContextLock const pContext( context );
+			entry.reset( new SessionEntry( pContext.GetEntry(), pContext->CreateSession() ) );
+		}
+
+		boost::unique_lock< boost::shared_mutex > lock( g_registryMutex );
+		if ( g_nextSession + 1 == 0 )
+			throw std::runtime_error( "Too many sessions created" );
+
+		*pSession = g_nextSession;
+		g_sessionMap.insert( std::pair< GTSVM_Session, boost::shared_ptr< SessionEntry > >( g_nextSession, entry ) );
+		++g_nextSession;
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_DestroySession function
+//============================================================================
+
+
+extern "C" bool GTSVM_DestroySession( GTSVM_Session const session ) {
+
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		boost::shared_ptr< SessionEntry > entry;
+		{	boost::unique_lock< boost::shared_mutex > lock( g_registryMutex );
+
+			SessionMap::iterator pSession = g_sessionMap.find( session );
+			if ( pSession == g_sessionMap.end() )
+				throw std::runtime_error( "Session does not exist" );
+			entry = pSession->second;
+			g_sessionMap.erase( pSession );
+		}
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_ClassifySparseWithSession function
+//============================================================================
+
+
+extern "C" bool GTSVM_ClassifySparseWithSession(
+	GTSVM_Session const session,
+	void* const result,
+	GTSVM_Type const resultType,
+	void const* const vectors,    // order depends on columnMajor flag
+	size_t const* const vectorIndices,
+	size_t const* const vectorOffsets,
+	GTSVM_Type const vectorsType,
+	unsigned int const rows,
+	unsigned int const columns,
+	bool const columnMajor
+)
+{
+	ClearError();
+
+	TRY_SAVE_EXCEPTIONS
+
+		SessionLock const pSession( session );
+
+		pSession->ClassifySparse(
+			pSession.GetSession(),
+			result,
+			resultType,
+			vectors,
+			vectorIndices,
+			vectorOffsets,
+			vectorsType,
+			rows,
+			columns,
+			columnMajor
+		);
+
+	CATCH_SAVE_EXCEPTIONS
+
+	return GetError();
+}
+
+
+
+
+//============================================================================
+//    GTSVM_ClassifyDenseWithSession function
+//============================================================================
+
+
+extern "C" bool GTSVM_ClassifyDenseWithSession(
+	GTSVM_Session const session,
+	void* const result,
+	GTSVM_Type const resultType,
+	void const* const vectors,    // order depends on columnMajor flag
+	GTSVM_Type const vectorsType,
+	unsigned int const rows,
+	unsigned int const columns,
+	bool const columnMajor
+)
+{
+	ClearError();
 
 	TRY_SAVE_EXCEPTIONS
 
-		ContextMap::const_iterator pContext = g_contextMap.find( context );
-		if ( pContext == g_contextMap.end() )
-			throw std::runtime_error( "Context does not exist" );
+		SessionLock const pSession( session );
 
-		pContext->second->ClassifyDense(
+		pSession->ClassifyDense(
+			pSession.GetSession(),
 			result,
 			resultType,
 			vectors,
@@ -1113,5 +1893,5 @@ extern "C" bool GTSVM_ClassifyDense(
 
 	CATCH_SAVE_EXCEPTIONS
 
-	return g_error;
+	return GetError();
 }
@@ -47,11 +47,34 @@ extern "C" {
 ============================================================================*/
 
 
+/*
+	every function may be called from any thread. Calls on distinct contexts
+	run concurrently, while calls on the same context are serialized (so
+	e.g. several threads may classify with one context safely, but they'll
+	take turns doing so, unless each uses its own GTSVM_Session). Destroying
+	a context which another thread is using is safe: the other call finishes
+	first, and later calls fail
+*/
 typedef unsigned int GTSVM_Context;
 
 
 
 
+/*============================================================================
+	GTSVM_Session typedef
+============================================================================*/
+
+
+/*
+	a session holds the buffers needed to classify with a context, so that
+	several threads, each with its own session, may classify with one context
+	at once, rather than one at a time. See GTSVM_CreateSession
+*/
+typedef unsigned int GTSVM_Session;
+
+
+
+
 /*============================================================================
 	GTSVM_Type enumeration
 ============================================================================*/
@@ -99,11 +122,198 @@ typedef enum {
 
 
 
+/*============================================================================
+	GTSVM_Backend enumeration
+============================================================================*/
+
+
+typedef enum {
+
+	GTSVM_BACKEND_DEFAULT = 0,    /* CUDA, unless it was not compiled in */
+
+	GTSVM_BACKEND_CUDA,
+	GTSVM_BACKEND_CPU             /* multithreaded, see GTSVM_SetThreads */
+
+} GTSVM_Backend;
+
+
+
+
+/*============================================================================
+	GTSVM_ColumnOrder enumeration
+============================================================================*/
+
+
+/*
+	Columns which are zero in every training vector are dropped when a
+	context is initialized, and the rest are renumbered, so that the work
+	done for each batch depends on the number of columns which are actually
+	used, rather than on the largest column index. Vectors passed to
+	GTSVM_ClassifySparse and GTSVM_ClassifyDense, and returned by
+	GTSVM_GetTrainingVectorsSparse and GTSVM_GetTrainingVectorsDense, still
+	use the original column indices. The COOCCURRENCE order numbers columns
+	which are nonzero in similar training vectors consecutively, so that
+	each cluster's nonzero columns lie close together.
+*/
+typedef enum {
+
+	GTSVM_COLUMN_ORDER_ORIGINAL = 0,
+	GTSVM_COLUMN_ORDER_COOCCURRENCE
+
+} GTSVM_ColumnOrder;
+
+
+
+
+/*============================================================================
+	GTSVM_Clustering enumeration
+============================================================================*/
+
+
+/*
+	How training vectors are grouped into clusters of 16 or 256 rows. Every
+	row of a cluster stores a value for every column which is nonzero in any
+	row of the cluster, so clusters of rows with similar nonzero columns are
+	cheaper to work with. The greedy algorithm adds each row to the cheapest
+	of activeClusters open clusters, which takes time proportional to the
+	number of rows, times activeClusters. The MinHash algorithm sorts the
+	rows by MinHash signatures of their sets of nonzero columns, so that rows
+	with many nonzero columns in common are adjacent, and packs them into
+	clusters in this order. It takes near-linear time, and ignores
+	activeClusters.
+*/
+typedef enum {
+
+	GTSVM_CLUSTERING_GREEDY = 0,
+	GTSVM_CLUSTERING_MINHASH
+
+} GTSVM_Clustering;
+
+
+
+
+/*============================================================================
+	GTSVM_Phase enumeration
+============================================================================*/
+
+
+typedef enum {
+
+	GTSVM_PHASE_SELECTION = 0,           /* choosing each batch (SparseKernelFindLargest*)          */
+	GTSVM_PHASE_ASSEMBLY,                /* building each batch, and its kernel submatrix, on host  */
+	GTSVM_PHASE_SOLVE,                   /* optimizing over each batch, on host                     */
+	GTSVM_PHASE_TRANSFER,                /* host<->device copies, and gathers of batch responses    */
+	GTSVM_PHASE_EVALUATE_KERNEL,         /* SparseEvaluateKernel                                    */
+	GTSVM_PHASE_UPDATE_KERNEL,           /* SparseUpdateKernel                                      */
+	GTSVM_PHASE_CALCULATE_OBJECTIVES,    /* SparseCalculateObjectives and SparseCalculateBias       */
+	GTSVM_PHASE_CLUSTERING,              /* ClusterTrainingVectors                                  */
+	GTSVM_PHASE_SHRINKING,               /* choosing, and re-packing, the active set                */
+
+	GTSVM_PHASES
+
+} GTSVM_Phase;
+
+
+
+
+/*============================================================================
+	GTSVM_Statistics structure
+============================================================================*/
+
+
+/*
+	Cumulative counters, kept by every context since it was created, or since
+	GTSVM_ResetStatistics was last called. The phases don't overlap. With the
+	CUDA backend, kernel launches return before the kernel finishes, so the
+	time spent waiting for them is attributed to the next transfer.
+*/
+typedef struct {
+
+	double seconds[ GTSVM_PHASES ];
+	unsigned long long calls[ GTSVM_PHASES ];
+
+	unsigned long long bytesToDevice;
+	unsigned long long bytesFromDevice;
+
+	unsigned long long iterations;          /* as counted by GTSVM_Optimize */
+	unsigned long long progressFailures;    /* batches which didn't change any dual variable */
+	unsigned long long shrinks;             /* times the active set was re-packed */
+	unsigned long long unshrinks;           /* times the full problem was restored */
+
+} GTSVM_Statistics;
+
+
+
+
+/*============================================================================
+	GTSVM_Buffer enumeration
+============================================================================*/
+
+
+typedef enum {
+
+	GTSVM_BUFFER_TRAINING_VECTORS = 0,    /* sparse rows on host, each cluster's nonzero columns transposed on device */
+	GTSVM_BUFFER_NONZERO_INDICES,         /* the columns which are nonzero in each cluster                           */
+	GTSVM_BUFFER_CLUSTERS,                /* cluster membership on host, cluster headers on device                   */
+	GTSVM_BUFFER_LABELS,
+	GTSVM_BUFFER_NORMS,                   /* squared norms, and kernel squared norms                                 */
+	GTSVM_BUFFER_RESPONSES,
+	GTSVM_BUFFER_ALPHAS,
+	GTSVM_BUFFER_BATCH,                   /* the current working set, and the kernel submatrix over it               */
+	GTSVM_BUFFER_WORK,                    /* scratch space for reductions and searches                               */
+	GTSVM_BUFFER_COLUMNS,                 /* the original index of each column, and vice versa                       */
+
+	GTSVM_BUFFERS
+
+} GTSVM_Buffer;
+
+
+
+
+/*============================================================================
+	GTSVM_MemoryUsage structure
+============================================================================*/
+
+
+/*
+	The bytes held by each kind of buffer. Device buffers are padded so that
+	every cluster has a full 16 or 256 rows, and, for the training vectors,
+	so that every row of a cluster stores a value for every column which is
+	nonzero in any row of the cluster. paddingBytes counts these unused
+	bytes, which are included in deviceBytes. With a backend which works in
+	host memory, the device buffers are host memory too, but buffers which
+	would merely mirror a host buffer are shared with it, and counted once.
+	The time taken to evaluate kernels against every training vector is
+	roughly proportional to clusterNonzeros times the cluster size.
+*/
+typedef struct {
+
+	unsigned long long hostBytes[ GTSVM_BUFFERS ];
+	unsigned long long deviceBytes[ GTSVM_BUFFERS ];
+	unsigned long long paddingBytes[ GTSVM_BUFFERS ];
+
+	unsigned long long clusters;
+	unsigned long long clusterNonzeros;           /* the total, over clusters, of the number of columns nonzero in any row of the cluster */
+	unsigned long long maximumClusterNonzeros;    /* the largest number of columns nonzero in any row of a single cluster                */
+
+	bool deviceInitialized;    /* if false, then deviceBytes are what optimization or classification will allocate */
+
+} GTSVM_MemoryUsage;
+
+
+
+
 /*============================================================================
 	GTSVM_Error function
 ============================================================================*/
 
 
+/*
+	returns the error message of the last failed call made by the calling
+	thread. Each thread has its own error state, so a failure on one thread
+	is never reported by (or overwritten by) calls on another. The result is
+	valid until the calling thread's next call
+*/
 extern char const* GTSVM_Error();
 
 
@@ -119,6 +329,53 @@ extern bool GTSVM_Create( GTSVM_Context* const pContext );
 
 
 
+/*============================================================================
+	GTSVM_CreateWithBackend function
+============================================================================*/
+
+
+extern bool GTSVM_CreateWithBackend(
+	GTSVM_Context* const pContext,
+	GTSVM_Backend const backend
+);
+
+
+
+
+/*============================================================================
+	GTSVM_SetThreads function
+============================================================================*/
+
+
+/*
+	sets the number of threads used by the CPU backend (0 = one per core). The
+	threads are shared by every context, and calls already in progress finish
+	on the old threads
+*/
+extern bool GTSVM_SetThreads( unsigned int const threads );
+
+
+
+
+/*============================================================================
+	GTSVM_SetTraceFile function
+============================================================================*/
+
+
+/*
+	Starts recording a timeline of every context's work (optimization
+	iterations, classification batches, device initialization, clustering,
+	loading and saving) as a Chrome trace, viewable in chrome://tracing or
+	Perfetto, or stops recording if filename is NULL or empty. The trace is
+	written out by a background thread as it's recorded, and completed when
+	recording stops, or when the process exits. Setting the GTSVM_TRACE_FILE
+	environment variable starts recording at load time.
+*/
+extern bool GTSVM_SetTraceFile( char const* const filename );
+
+
+
+
 /*============================================================================
 	GTSVM_Destroy function
 ============================================================================*/
@@ -152,6 +409,8 @@ extern bool GTSVM_InitializeSparse(
 	float const kernelParameter2,
 	float const kernelParameter3,
 	bool const biased,
+	GTSVM_ColumnOrder const columnOrder,
+	GTSVM_Clustering const clustering,
 	bool const smallClusters,
 	unsigned int const activeClusters
 );
@@ -180,6 +439,8 @@ extern bool GTSVM_InitializeDense(
 	float const kernelParameter2,
 	float const kernelParameter3,
 	bool const biased,
+	GTSVM_ColumnOrder const columnOrder,
+	GTSVM_Clustering const clustering,
 	bool const smallClusters,
 	unsigned int const activeClusters
 );
@@ -187,6 +448,43 @@ extern bool GTSVM_InitializeDense(
 
 
 
+/*============================================================================
+	GTSVM_InitializeShared function
+============================================================================*/
+
+
+/*
+	initializes context to train on the same data as source, which must
+	already be initialized (by any of the other initialization functions).
+	The training vectors, their squared norms, the column numbering and the
+	clustering are shared by reference, rather than copied, so training many
+	models (e.g. over a grid of parameters) on the same data costs memory
+	mostly for the per-model alphas, responses and kernel norms. If
+	trainingLabels is NULL, then source's labels are shared too (and
+	multiclass is ignored), otherwise they're replaced by the given labels
+	(e.g. one class against the rest). Shared data is never modified: a
+	context which shrinks, or is reinitialized, gets its own copy of whatever
+	it changes, and the data lives until every context using it has been
+	destroyed. The two contexts remain otherwise independent, and the same
+	source may be shared by any number of contexts
+*/
+extern bool GTSVM_InitializeShared(
+	GTSVM_Context const context,
+	GTSVM_Context const source,
+	void const* const trainingLabels,    /* may be NULL */
+	GTSVM_Type const trainingLabelsType,
+	bool const multiclass,
+	float const regularization,
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3,
+	bool const biased
+);
+
+
+
+
 /*============================================================================
 	GTSVM_Load function
 ============================================================================*/
@@ -195,6 +493,7 @@ extern bool GTSVM_InitializeDense(
 extern bool GTSVM_Load(
 	GTSVM_Context const context,
 	char const* const filename,
+	GTSVM_Clustering const clustering,
 	bool const smallClusters,
 	unsigned int const activeClusters
 );
@@ -222,6 +521,7 @@ extern bool GTSVM_Save(
 
 extern bool GTSVM_Shrink(
 	GTSVM_Context const context,
+	GTSVM_Clustering const clustering,
 	bool const smallClusters,
 	unsigned int const activeClusters
 );
@@ -249,6 +549,39 @@ extern bool GTSVM_Deinitialize( GTSVM_Context const context );
 
 
 
+/*============================================================================
+	GTSVM_SetBatchSize function
+============================================================================*/
+
+
+/*
+	sets the number of training vectors optimized over at each iteration: 8,
+	16 (the default), 32, 64 or 128. Larger batches make fewer passes over
+	the training set per iteration, at the cost of more work per batch. The
+	CUDA backend only supports 16. If the batch size changes, then the
+	device is deinitialized
+*/
+extern bool GTSVM_SetBatchSize(
+	GTSVM_Context const context,
+	unsigned int const batchSize
+);
+
+
+
+
+/*============================================================================
+	GTSVM_GetBatchSize function
+============================================================================*/
+
+
+extern bool GTSVM_GetBatchSize(
+	GTSVM_Context const context,
+	unsigned int* const result
+);
+
+
+
+
 /*============================================================================
 	GTSVM_GetRows function
 ============================================================================*/
@@ -511,6 +844,50 @@ extern bool GTSVM_Restart(
 
 
 
+/*============================================================================
+	GTSVM_SetRegularization function
+============================================================================*/
+
+
+/*
+	changes the regularization parameter, keeping the current solution as a
+	warm start (unlike GTSVM_Restart, which starts over). Alphas outside the
+	new bounds are clipped (and, for biased problems, others are reduced to
+	keep the bias constraint satisfied), and the responses are only updated
+	for the alphas which changed. GTSVM_Optimize should be called afterwards
+*/
+extern bool GTSVM_SetRegularization(
+	GTSVM_Context const context,
+	float const regularization
+);
+
+
+
+
+/*============================================================================
+	GTSVM_SetKernel function
+============================================================================*/
+
+
+/*
+	changes the kernel and its parameters, keeping the current alphas as a
+	warm start (unlike GTSVM_Restart, which starts over). This is intended for
+	sweeping over kernel parameters (e.g. the width of a Gaussian kernel):
+	the clustering and the training vectors on the device are reused, and
+	the alphas of a nearby parameter are usually a much better starting point
+	than zero. GTSVM_Optimize should be called afterwards
+*/
+extern bool GTSVM_SetKernel(
+	GTSVM_Context const context,
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3
+);
+
+
+
+
 /*============================================================================
 	GTSVM_Optimize function
 ============================================================================*/
@@ -526,6 +903,43 @@ extern bool GTSVM_Optimize(
 
 
 
+/*============================================================================
+	GTSVM_SetShrinking function
+============================================================================*/
+
+
+/*
+	enables or disables (the default) shrinking of the active set by
+	GTSVM_Optimize, for binary problems. The primal and dual objectives
+	returned by GTSVM_Optimize are always those of the full problem, since the
+	responses of the shrunk training vectors are brought up-to-date before
+	they're calculated
+*/
+extern bool GTSVM_SetShrinking(
+	GTSVM_Context const context,
+	bool const shrinking
+);
+
+
+
+
+/*============================================================================
+	GTSVM_Unshrink function
+============================================================================*/
+
+
+/*
+	restores the full problem, so that every training vector is optimized
+	over again. *pShrunk is set to whether anything had been shrunk
+*/
+extern bool GTSVM_Unshrink(
+	GTSVM_Context const context,
+	bool* const pShrunk
+);
+
+
+
+
 /*============================================================================
 	GTSVM_ClassifySparse function
 ============================================================================*/
@@ -566,6 +980,165 @@ extern bool GTSVM_ClassifyDense(
 
 
 
+/*============================================================================
+	GTSVM_CreateSession function
+============================================================================*/
+
+
+/*
+	creates a session for classifying with context, which must be initialized
+	(it's also initialized on the device, if it isn't already). Creating a
+	session is cheap: it only allocates room for one batch, and the work space
+	of one kernel evaluation, so a model may be loaded once, and classified
+	with by one session per thread. Classifications with sessions of the same
+	context run concurrently, but wait for (and hold off) any other call on
+	that context, so the model should be left alone while serving. A session
+	remains usable if the context is changed (its buffers are reallocated if
+	necessary), and keeps the model alive if the context is destroyed. A
+	session's transfers are not included in the context's statistics
+*/
+extern bool GTSVM_CreateSession(
+	GTSVM_Context const context,
+	GTSVM_Session* const pSession
+);
+
+
+
+
+/*============================================================================
+	GTSVM_DestroySession function
+============================================================================*/
+
+
+extern bool GTSVM_DestroySession( GTSVM_Session const session );
+
+
+
+
+/*============================================================================
+	GTSVM_ClassifySparseWithSession function
+============================================================================*/
+
+
+/* like GTSVM_ClassifySparse, with the session's context */
+extern bool GTSVM_ClassifySparseWithSession(
+	GTSVM_Session const session,
+	void* const result,
+	GTSVM_Type const resultType,
+	void const* const vectors,    /* order depends on columnMajor flag */
+	size_t const* const vectorIndices,
+	size_t const* const vectorOffsets,
+	GTSVM_Type const vectorsType,
+	unsigned int const rows,
+	unsigned int const columns,
+	bool const columnMajor
+);
+
+
+
+
+/*============================================================================
+	GTSVM_ClassifyDenseWithSession function
+============================================================================*/
+
+
+/* like GTSVM_ClassifyDense, with the session's context */
+extern bool GTSVM_ClassifyDenseWithSession(
+	GTSVM_Session const session,
+	void* const result,
+	GTSVM_Type const resultType,
+	void const* const vectors,    /* order depends on columnMajor flag */
+	GTSVM_Type const vectorsType,
+	unsigned int const rows,
+	unsigned int const columns,
+	bool const columnMajor
+);
+
+
+
+
+/*============================================================================
+	GTSVM_GetStatistics function
+============================================================================*/
+
+
+extern bool GTSVM_GetStatistics(
+	GTSVM_Context const context,
+	GTSVM_Statistics* const pStatistics
+);
+
+
+
+
+/*============================================================================
+	GTSVM_ResetStatistics function
+============================================================================*/
+
+
+extern bool GTSVM_ResetStatistics( GTSVM_Context const context );
+
+
+
+
+/*============================================================================
+	GTSVM_GetPhaseName function
+============================================================================*/
+
+
+/* returns NULL for an unknown phase */
+extern char const* GTSVM_GetPhaseName( GTSVM_Phase const phase );
+
+
+
+
+/*============================================================================
+	GTSVM_GetMemoryUsage function
+============================================================================*/
+
+
+extern bool GTSVM_GetMemoryUsage(
+	GTSVM_Context const context,
+	GTSVM_MemoryUsage* const pUsage
+);
+
+
+
+
+/*============================================================================
+	GTSVM_PredictMemoryUsage function
+============================================================================*/
+
+
+/*
+	Finds the memory usage which the context would have, if it were
+	clustered with the given clustering, smallClusters and activeClusters
+	parameters (e.g. by GTSVM_Shrink or GTSVM_Load), without changing it.
+	This runs the clustering algorithm, so takes about as long as
+	initialization. Comparing the clusterNonzeros of the results is a cheap
+	way of comparing clustering algorithms.
+*/
+extern bool GTSVM_PredictMemoryUsage(
+	GTSVM_Context const context,
+	GTSVM_MemoryUsage* const pUsage,
+	GTSVM_Clustering const clustering,
+	bool const smallClusters,
+	unsigned int const activeClusters
+);
+
+
+
+
+/*============================================================================
+	GTSVM_GetBufferName function
+============================================================================*/
+
+
+/* returns NULL for an unknown buffer */
+extern char const* GTSVM_GetBufferName( GTSVM_Buffer const buffer );
+
+
+
+
 #ifdef __cplusplus
 }    /* extern "C" */
 #endif    /* __cplusplus */
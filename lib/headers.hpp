@@ -38,12 +38,20 @@
 
 
 
+#ifndef GTSVM_NO_CUDA
 #include <cuda_runtime.h>
+#endif    /* GTSVM_NO_CUDA */
 
 
 #include "gtsvm.h"
+#include "sparse_matrix.hpp"
+#include "model_file.hpp"
 #include "svm.hpp"
+#include "backend.hpp"
+#include "statistics.hpp"
+#include "trace.hpp"
 #include "cuda.hpp"
+#include "cpu.hpp"
 #include "helpers.hpp"
 
 
@@ -57,6 +65,15 @@
 #include <boost/static_assert.hpp>
 #include <boost/cstdint.hpp>
 #include <boost/version.hpp>
+#include <boost/crc.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
 
 
 #include <string>
@@ -76,10 +93,14 @@
 
 #include <cstdlib>
 #include <cstddef>
+#include <cstring>
 #include <cmath>
+#include <cstdio>
 
 
 #include <math.h>
+#include <time.h>
+#include <unistd.h>
 
 
 
@@ -355,6 +355,27 @@ inline unsigned int HighBit( boost::uint64_t number ) {
 
 
 
+//============================================================================
+//    LowBit helper functions
+//============================================================================
+
+
+// the index of the lowest set bit (the number must be nonzero)
+inline unsigned int LowBit( boost::uint32_t const number ) {
+
+	return HighBit( static_cast< boost::uint32_t >( number & ( ~number + 1 ) ) );
+}
+
+
+// the index of the lowest set bit (the number must be nonzero)
+inline unsigned int LowBit( boost::uint64_t const number ) {
+
+	return HighBit( static_cast< boost::uint64_t >( number & ( ~number + 1 ) ) );
+}
+
+
+
+
 }    // namespace GTSVM
 
 
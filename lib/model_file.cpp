@@ -0,0 +1,90 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file model_file.cpp
+	\brief implementation of model file helpers, and MappedFile class
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace GTSVM {
+
+
+
+
+//============================================================================
+//    ModelFile functions
+//============================================================================
+
+
+bool const IsModelFileVersion2( char const* const filename ) {
+
+	FILE* file = fopen( filename, "rb" );
+	if ( file == NULL )
+		throw std::runtime_error( "Unable to open file" );
+
+	char magic[ 8 ];
+	bool const result = (
+		( fread( magic, sizeof( magic ), 1, file ) == 1 ) &&
+		( std::memcmp( magic, MODEL_FILE_MAGIC, sizeof( magic ) ) == 0 )
+	);
+
+	fclose( file );
+	return result;
+}
+
+
+boost::uint32_t const ModelFileChecksum( void const* const data, size_t const size ) {
+
+	boost::crc_32_type crc;
+	crc.process_bytes( data, size );
+	return crc.checksum();
+}
+
+
+
+
+//============================================================================
+//    MappedFile methods
+//============================================================================
+
+
+MappedFile::MappedFile( char const* const filename ) {
+
+	try {
+
+		boost::interprocess::file_mapping( filename, boost::interprocess::read_only ).swap( m_mapping );
+		boost::interprocess::mapped_region( m_mapping, boost::interprocess::copy_on_write ).swap( m_region );
+	}
+	catch( boost::interprocess::interprocess_exception& error ) {
+
+		throw std::runtime_error( std::string( "Unable to map file: " ) + error.what() );
+	}
+}
+
+
+
+
+}    // namespace GTSVM
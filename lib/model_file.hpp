@@ -0,0 +1,268 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file model_file.hpp
+	\brief definition of the version 2 model file layout, and MappedFile class
+*/
+
+
+
+
+#ifndef __MODEL_FILE_HPP__
+#define __MODEL_FILE_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/cstdint.hpp>
+
+#include <cstddef>
+
+
+
+
+namespace GTSVM {
+
+
+
+
+//============================================================================
+//    Model file layout
+//============================================================================
+
+
+/*
+	A version 2 or 3 model file is a ModelFileHeader, followed by the
+	sections which it describes. Every section starts at a multiple of
+	MODEL_FILE_ALIGNMENT bytes, so that a mapped file can be used in place.
+	Everything is stored in little-endian order, which is checked (but not
+	converted) by means of the byteOrder field.
+
+	Version 3 files add the COLUMN_INDICES section: the training vectors'
+	column indices are renumbered (see GTSVM_ColumnOrder), and the header's
+	columns field counts the original columns. Version 2 files have no such
+	section, and are read as if every column were used, in its original
+	order.
+
+	Version 1 files have no header: they start with the number of rows, and
+	store each training vector's nonzeros one (index,value) pair at a time.
+*/
+
+
+#define MODEL_FILE_MAGIC "GTSVMMDL"
+#define MODEL_FILE_VERSION 3
+#define MODEL_FILE_BYTE_ORDER 0x01020304u
+#define MODEL_FILE_ALIGNMENT 64
+#define MODEL_FILE_MAXIMUM_SECTIONS 16
+
+
+enum ModelFileSectionType {
+	MODEL_FILE_SECTION_OFFSETS = 0,               // boost::uint64_t[ rows ], into INDICES and VALUES
+	MODEL_FILE_SECTION_SIZES,                     // boost::uint32_t[ rows ]
+	MODEL_FILE_SECTION_INDICES,                   // boost::uint32_t[ nonzeros ]
+	MODEL_FILE_SECTION_VALUES,                    // float[ nonzeros ]
+	MODEL_FILE_SECTION_LABELS,                    // boost::int32_t[ rows ]
+	MODEL_FILE_SECTION_NORMS,                     // float[ rows ]
+	MODEL_FILE_SECTION_KERNEL_NORMS,              // float[ rows ]
+	MODEL_FILE_SECTION_RESPONSES,                 // double[ rows * classes ]
+	MODEL_FILE_SECTION_ALPHAS,                    // float[ rows * classes ]
+	MODEL_FILE_SECTION_CLUSTER_SIZES,             // boost::uint32_t[ clusters ]
+	MODEL_FILE_SECTION_CLUSTER_INDICES,           // boost::uint32_t[ rows ], the rows of each cluster in turn
+	MODEL_FILE_SECTION_CLUSTER_NONZERO_SIZES,     // boost::uint32_t[ clusters ]
+	MODEL_FILE_SECTION_CLUSTER_NONZERO_INDICES,   // boost::uint32_t[ sum of CLUSTER_NONZERO_SIZES ]
+	MODEL_FILE_SECTION_COLUMN_INDICES,            // boost::uint32_t[ used columns ], the original index of each column
+	MODEL_FILE_SECTIONS
+};
+
+
+struct ModelFileSection {
+
+	boost::uint64_t offset;      // from the start of the file
+	boost::uint64_t size;        // in bytes
+	boost::uint32_t checksum;    // CRC-32 of the contents
+	boost::uint32_t reserved;
+};
+
+
+struct ModelFileHeader {
+
+	char magic[ 8 ];
+	boost::uint32_t version;
+	boost::uint32_t byteOrder;
+
+	boost::uint32_t rows;
+	boost::uint32_t columns;
+	boost::uint32_t classes;
+	boost::int32_t kernel;
+	boost::uint64_t nonzeros;
+
+	float regularization;
+	float kernelParameter1;
+	float kernelParameter2;
+	float kernelParameter3;
+	double bias;
+	boost::uint8_t biased;
+
+	// the clustering settings which produced the CLUSTER_ sections, which are only present if activeClusters is nonzero
+	boost::uint8_t smallClusters;
+	boost::uint8_t clustering;    // a GTSVM_Clustering (zero, i.e. greedy, in files written before there was a choice)
+	boost::uint8_t reserved1;
+	boost::uint32_t activeClusters;
+
+	// unused sections have zero offsets and sizes
+	ModelFileSection sections[ MODEL_FILE_MAXIMUM_SECTIONS ];
+
+	boost::uint32_t checksum;    // CRC-32 of everything above
+	boost::uint32_t reserved2;
+};
+
+
+BOOST_STATIC_ASSERT( sizeof( ModelFileSection ) == 24 );
+BOOST_STATIC_ASSERT( sizeof( ModelFileHeader ) == 72 + 24 * MODEL_FILE_MAXIMUM_SECTIONS + 8 );
+BOOST_STATIC_ASSERT( MODEL_FILE_SECTIONS <= MODEL_FILE_MAXIMUM_SECTIONS );
+
+
+
+
+//============================================================================
+//    ModelFile functions
+//============================================================================
+
+
+inline boost::uint64_t const ModelFileAlign( boost::uint64_t const offset );
+
+bool const IsModelFileVersion2( char const* const filename );
+
+boost::uint32_t const ModelFileChecksum( void const* const data, size_t const size );
+
+
+
+
+//============================================================================
+//    MappedFile class
+//============================================================================
+
+
+/*
+	A private (copy-on-write) read/write mapping of an entire file: writes
+	to the mapped memory are never seen by the file, or by other mappings.
+*/
+struct MappedFile {
+
+	explicit MappedFile( char const* const filename );
+
+
+	inline void* GetData() const;
+	inline size_t const GetSize() const;
+
+
+private:
+
+	boost::interprocess::file_mapping m_mapping;
+	boost::interprocess::mapped_region m_region;
+};
+
+
+
+
+//============================================================================
+//    MappedFileDeleter class
+//============================================================================
+
+
+/*
+	Used as the "deleter" of smart pointers into a MappedFile: it deletes
+	nothing, but keeps the mapping alive for as long as the pointer is
+*/
+struct MappedFileDeleter {
+
+	inline explicit MappedFileDeleter( boost::shared_ptr< MappedFile > const& file );
+
+	inline void operator()( void const* ) const;
+
+
+private:
+
+	boost::shared_ptr< MappedFile > m_file;
+};
+
+
+
+
+//============================================================================
+//    ModelFile inline functions
+//============================================================================
+
+
+boost::uint64_t const ModelFileAlign( boost::uint64_t const offset ) {
+
+	return( ( offset + ( MODEL_FILE_ALIGNMENT - 1 ) ) & ~static_cast< boost::uint64_t >( MODEL_FILE_ALIGNMENT - 1 ) );
+}
+
+
+
+
+//============================================================================
+//    MappedFile inline methods
+//============================================================================
+
+
+void* MappedFile::GetData() const {
+
+	return m_region.get_address();
+}
+
+
+size_t const MappedFile::GetSize() const {
+
+	return m_region.get_size();
+}
+
+
+
+
+//============================================================================
+//    MappedFileDeleter inline methods
+//============================================================================
+
+
+MappedFileDeleter::MappedFileDeleter( boost::shared_ptr< MappedFile > const& file ) : m_file( file ) {
+}
+
+
+void MappedFileDeleter::operator()( void const* ) const {
+}
+
+
+
+
+}    // namespace GTSVM
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __MODEL_FILE_HPP__ */
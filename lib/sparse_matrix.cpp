@@ -0,0 +1,258 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file sparse_matrix.cpp
+	\brief implementation of SparseMatrix class
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace GTSVM {
+
+
+
+
+//============================================================================
+//    SparseMatrix methods
+//============================================================================
+
+
+void SparseMatrix::Clear() {
+
+	std::vector< boost::uint64_t >().swap( m_offsets );
+	std::vector< boost::uint32_t >().swap( m_sizes );
+	std::vector< boost::uint32_t >().swap( m_indices );
+	std::vector< float >().swap( m_values );
+	m_rowBegin = 0;
+
+	m_owner.reset();
+	UpdatePointers();
+}
+
+
+void SparseMatrix::Swap( SparseMatrix& other ) {
+
+	m_offsets.swap( other.m_offsets );
+	m_sizes.swap( other.m_sizes );
+	m_indices.swap( other.m_indices );
+	m_values.swap( other.m_values );
+	std::swap( m_rowBegin, other.m_rowBegin );
+
+	m_owner.swap( other.m_owner );
+	std::swap( m_rows,     other.m_rows     );
+	std::swap( m_nonzeros, other.m_nonzeros );
+	std::swap( m_pOffsets, other.m_pOffsets );
+	std::swap( m_pSizes,   other.m_pSizes   );
+	std::swap( m_pIndices, other.m_pIndices );
+	std::swap( m_pValues,  other.m_pValues  );
+}
+
+
+void SparseMatrix::Map(
+	size_t const rows,
+	size_t const nonzeros,
+	boost::uint64_t const* const offsets,
+	boost::uint32_t const* const sizes,
+	boost::uint32_t const* const indices,
+	float const* const values,
+	boost::shared_ptr< void const > const& owner
+)
+{
+	BOOST_ASSERT( owner.get() != NULL );
+
+	Clear();
+
+	m_owner = owner;
+	m_rows = rows;
+	m_nonzeros = nonzeros;
+	m_pOffsets = offsets;
+	m_pSizes = sizes;
+	m_pIndices = indices;
+	m_pValues = values;
+}
+
+
+void SparseMatrix::Share( SparseMatrix* const pOther ) {
+
+	BOOST_ASSERT( pOther != this );
+	BOOST_ASSERT( m_rowBegin == m_indices.size() );
+
+	if ( ! IsMapped() ) {
+
+		// swapping vectors doesn't move their contents, so our pointers (and anything the device was given) stay valid
+		boost::shared_ptr< SparseMatrix > owner( new SparseMatrix );
+		owner->Swap( *this );
+		Map( owner->m_rows, owner->m_nonzeros, owner->m_pOffsets, owner->m_pSizes, owner->m_pIndices, owner->m_pValues, owner );
+	}
+
+	pOther->Map( m_rows, m_nonzeros, m_pOffsets, m_pSizes, m_pIndices, m_pValues, m_owner );
+}
+
+
+void SparseMatrix::Reserve( size_t const rows, size_t const nonzeros ) {
+
+	BOOST_ASSERT( ! IsMapped() );
+
+	m_offsets.reserve( rows );
+	m_sizes.reserve( rows );
+	m_indices.reserve( nonzeros );
+	m_values.reserve( nonzeros );
+}
+
+
+void SparseMatrix::Compact() {
+
+	BOOST_ASSERT( m_rowBegin == m_indices.size() );
+
+	if ( IsMapped() )
+		return;
+
+	// the usual swap trick: copies have exactly the capacity they need
+	if ( m_offsets.capacity() > m_offsets.size() )
+		std::vector< boost::uint64_t >( m_offsets ).swap( m_offsets );
+	if ( m_sizes.capacity() > m_sizes.size() )
+		std::vector< boost::uint32_t >( m_sizes ).swap( m_sizes );
+	if ( m_indices.capacity() > m_indices.size() )
+		std::vector< boost::uint32_t >( m_indices ).swap( m_indices );
+	if ( m_values.capacity() > m_values.size() )
+		std::vector< float >( m_values ).swap( m_values );
+
+	UpdatePointers();
+}
+
+
+void SparseMatrix::AppendRow( SparseMatrix const& other, size_t const row ) {
+
+	boost::uint32_t const* const indices = other.GetIndices( row );
+	float const* const values = other.GetValues( row );
+	boost::uint32_t const size = other.GetSize( row );
+
+	BOOST_ASSERT( ! IsMapped() );
+
+	m_indices.insert( m_indices.end(), indices, indices + size );
+	m_values.insert( m_values.end(), values, values + size );
+	EndRow();
+}
+
+
+void SparseMatrix::Permute( std::vector< std::vector< unsigned int > > const& order ) {
+
+	BOOST_ASSERT( m_rowBegin == m_indices.size() );
+
+	if ( IsMapped() )
+		return;
+
+	std::vector< boost::uint64_t > offsets( m_offsets.size() );
+	{	size_t offset = 0;
+		std::vector< std::vector< unsigned int > >::const_iterator ii    = order.begin();
+		std::vector< std::vector< unsigned int > >::const_iterator iiEnd = order.end();
+		for ( ; ii != iiEnd; ++ii ) {
+
+			std::vector< unsigned int >::const_iterator jj    = ii->begin();
+			std::vector< unsigned int >::const_iterator jjEnd = ii->end();
+			for ( ; jj != jjEnd; ++jj ) {
+
+				BOOST_ASSERT( *jj < m_offsets.size() );
+				offsets[ *jj ] = offset;
+				offset += m_sizes[ *jj ];
+			}
+		}
+		if ( offset != m_indices.size() )
+			throw std::runtime_error( "SparseMatrix::Permute requires a permutation of the rows" );
+	}
+
+	// the indices and values are moved one after the other, so that we never need more than one extra array
+	{	std::vector< boost::uint32_t > indices( m_indices.size() );
+		for ( size_t ii = 0; ii < m_offsets.size(); ++ii )
+			std::copy( m_indices.begin() + m_offsets[ ii ], m_indices.begin() + m_offsets[ ii ] + m_sizes[ ii ], indices.begin() + offsets[ ii ] );
+		m_indices.swap( indices );
+	}
+	{	std::vector< float > values( m_values.size() );
+		for ( size_t ii = 0; ii < m_offsets.size(); ++ii )
+			std::copy( m_values.begin() + m_offsets[ ii ], m_values.begin() + m_offsets[ ii ] + m_sizes[ ii ], values.begin() + offsets[ ii ] );
+		m_values.swap( values );
+	}
+	m_offsets.swap( offsets );
+
+	UpdatePointers();
+}
+
+
+void SparseMatrix::Renumber( std::vector< boost::uint32_t > const& columns ) {
+
+	BOOST_ASSERT( m_rowBegin == m_indices.size() );
+
+	if ( IsMapped() )
+		throw std::runtime_error( "SparseMatrix::Renumber cannot change a mapped matrix" );
+
+	std::vector< std::pair< boost::uint32_t, float > > row;
+	for ( size_t ii = 0; ii < m_offsets.size(); ++ii ) {
+
+		boost::uint32_t* const indices = &m_indices[ 0 ] + m_offsets[ ii ];
+		float* const values = &m_values[ 0 ] + m_offsets[ ii ];
+		boost::uint32_t const size = m_sizes[ ii ];
+
+		bool sorted = true;
+		for ( boost::uint32_t jj = 0; jj < size; ++jj ) {
+
+			if ( ( indices[ jj ] >= columns.size() ) || ( columns[ indices[ jj ] ] == static_cast< boost::uint32_t >( -1 ) ) )
+				throw std::runtime_error( "SparseMatrix::Renumber was given an incomplete renumbering" );
+			indices[ jj ] = columns[ indices[ jj ] ];
+			if ( ( jj > 0 ) && ( indices[ jj ] < indices[ jj - 1 ] ) )
+				sorted = false;
+		}
+
+		if ( ! sorted ) {
+
+			row.clear();
+			for ( boost::uint32_t jj = 0; jj < size; ++jj )
+				row.push_back( std::pair< boost::uint32_t, float >( indices[ jj ], values[ jj ] ) );
+			std::sort( row.begin(), row.end() );
+			for ( boost::uint32_t jj = 0; jj < size; ++jj ) {
+
+				indices[ jj ] = row[ jj ].first;
+				values[  jj ] = row[ jj ].second;
+			}
+		}
+	}
+}
+
+
+void SparseMatrix::UpdatePointers() {
+
+	BOOST_ASSERT( ! IsMapped() );
+
+	m_rows = m_offsets.size();
+	m_nonzeros = m_rowBegin;
+	m_pOffsets = ( m_offsets.empty() ? NULL : &m_offsets[ 0 ] );
+	m_pSizes   = ( m_sizes.empty()   ? NULL : &m_sizes[   0 ] );
+	m_pIndices = ( m_indices.empty() ? NULL : &m_indices[ 0 ] );
+	m_pValues  = ( m_values.empty()  ? NULL : &m_values[  0 ] );
+}
+
+
+
+
+}    // namespace GTSVM
@@ -0,0 +1,351 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file sparse_matrix.hpp
+	\brief definition of SparseMatrix class
+*/
+
+
+
+
+#ifndef __SPARSE_MATRIX_HPP__
+#define __SPARSE_MATRIX_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include <boost/shared_ptr.hpp>
+#include <boost/assert.hpp>
+#include <boost/cstdint.hpp>
+
+#include <vector>
+#include <cstddef>
+
+
+
+
+namespace GTSVM {
+
+
+
+
+//============================================================================
+//    SparseMatrix class
+//============================================================================
+
+
+/*
+	Compressed sparse rows, with all of the nonzero indices in one array and
+	all of the nonzero values in another. Each row's nonzeros are contiguous,
+	but the rows themselves needn't be stored in order: Permute() rearranges
+	the storage (e.g. into cluster order) without changing how rows are
+	addressed.
+
+	Matrices are built one row at a time, by calling Append() for each
+	nonzero of a row, followed by EndRow(). Alternatively, Map() makes a
+	read-only matrix out of arrays owned by someone else (e.g. a mapped model
+	file), and Share() makes another matrix a read-only view of this one's
+	storage. A mapped matrix keeps its storage order: Permute() does nothing.
+*/
+struct SparseMatrix {
+
+	struct const_iterator;
+
+
+	inline SparseMatrix();
+
+
+	void Clear();
+	void Swap( SparseMatrix& other );
+
+	void Map(
+		size_t const rows,
+		size_t const nonzeros,
+		boost::uint64_t const* const offsets,
+		boost::uint32_t const* const sizes,
+		boost::uint32_t const* const indices,
+		float const* const values,
+		boost::shared_ptr< void const > const& owner    // kept alive until the matrix is cleared
+	);
+	/*
+		Maps *pOther onto our storage. If we own it, then it's first moved to
+		the heap, and we become mapped too, so that the storage lives until
+		both matrices have been cleared
+	*/
+	void Share( SparseMatrix* const pOther );
+
+	void Reserve( size_t const rows, size_t const nonzeros );
+	void Compact();
+
+	inline void Append( boost::uint32_t const index, float const value );
+	inline void EndRow();
+
+	void AppendRow( SparseMatrix const& other, size_t const row );
+
+	// the concatenation of the order vectors must be a permutation of the rows
+	void Permute( std::vector< std::vector< unsigned int > > const& order );
+
+	// replaces every index with columns[ index ] (which mustn't be -1), and sorts each row by the new indices
+	void Renumber( std::vector< boost::uint32_t > const& columns );
+
+
+	inline bool const IsMapped() const;
+
+	inline size_t const GetRows() const;
+	inline size_t const GetNonzeros() const;
+
+	// arrays in storage order, for saving
+	inline boost::uint64_t const* GetOffsets() const;
+	inline boost::uint32_t const* GetSizes() const;
+	inline boost::uint32_t const* GetAllIndices() const;
+	inline float const* GetAllValues() const;
+
+	inline boost::uint32_t const GetSize( size_t const row ) const;
+	inline boost::uint32_t const* GetIndices( size_t const row ) const;
+	inline float const* GetValues( size_t const row ) const;
+
+	inline const_iterator const Begin( size_t const row ) const;
+	inline const_iterator const End( size_t const row ) const;
+
+
+private:
+
+	// points the arrays below at the owned vectors
+	void UpdatePointers();
+
+
+	std::vector< boost::uint64_t > m_offsets;
+	std::vector< boost::uint32_t > m_sizes;
+
+	std::vector< boost::uint32_t > m_indices;
+	std::vector< float > m_values;
+
+	size_t m_rowBegin;
+
+	boost::shared_ptr< void const > m_owner;
+
+	size_t m_rows;
+	size_t m_nonzeros;
+	boost::uint64_t const* m_pOffsets;
+	boost::uint32_t const* m_pSizes;
+	boost::uint32_t const* m_pIndices;
+	float const* m_pValues;
+};
+
+
+
+
+//============================================================================
+//    SparseMatrix::const_iterator class
+//============================================================================
+
+
+struct SparseMatrix::const_iterator {
+
+	inline const_iterator( boost::uint32_t const* const index, float const* const value );
+
+
+	inline boost::uint32_t const Index() const;
+	inline float const Value() const;
+
+
+	inline const_iterator& operator++();
+
+	inline bool const operator==( const_iterator const& other ) const;
+	inline bool const operator!=( const_iterator const& other ) const;
+
+
+private:
+
+	boost::uint32_t const* m_index;
+	float const* m_value;
+};
+
+
+
+
+//============================================================================
+//    SparseMatrix inline methods
+//============================================================================
+
+
+SparseMatrix::SparseMatrix() :
+	m_rowBegin( 0 ),
+	m_rows( 0 ),
+	m_nonzeros( 0 ),
+	m_pOffsets( NULL ),
+	m_pSizes( NULL ),
+	m_pIndices( NULL ),
+	m_pValues( NULL )
+{
+}
+
+
+void SparseMatrix::Append( boost::uint32_t const index, float const value ) {
+
+	BOOST_ASSERT( ! IsMapped() );
+
+	m_indices.push_back( index );
+	m_values.push_back( value );
+}
+
+
+void SparseMatrix::EndRow() {
+
+	m_offsets.push_back( m_rowBegin );
+	m_sizes.push_back( m_indices.size() - m_rowBegin );
+	m_rowBegin = m_indices.size();
+	UpdatePointers();
+}
+
+
+bool const SparseMatrix::IsMapped() const {
+
+	return( m_owner.get() != NULL );
+}
+
+
+size_t const SparseMatrix::GetRows() const {
+
+	return m_rows;
+}
+
+
+size_t const SparseMatrix::GetNonzeros() const {
+
+	return m_nonzeros;
+}
+
+
+boost::uint64_t const* SparseMatrix::GetOffsets() const {
+
+	return m_pOffsets;
+}
+
+
+boost::uint32_t const* SparseMatrix::GetSizes() const {
+
+	return m_pSizes;
+}
+
+
+boost::uint32_t const* SparseMatrix::GetAllIndices() const {
+
+	return m_pIndices;
+}
+
+
+float const* SparseMatrix::GetAllValues() const {
+
+	return m_pValues;
+}
+
+
+boost::uint32_t const SparseMatrix::GetSize( size_t const row ) const {
+
+	BOOST_ASSERT( row < m_rows );
+	return m_pSizes[ row ];
+}
+
+
+boost::uint32_t const* SparseMatrix::GetIndices( size_t const row ) const {
+
+	BOOST_ASSERT( row < m_rows );
+	return m_pIndices + m_pOffsets[ row ];
+}
+
+
+float const* SparseMatrix::GetValues( size_t const row ) const {
+
+	BOOST_ASSERT( row < m_rows );
+	return m_pValues + m_pOffsets[ row ];
+}
+
+
+SparseMatrix::const_iterator const SparseMatrix::Begin( size_t const row ) const {
+
+	return const_iterator( GetIndices( row ), GetValues( row ) );
+}
+
+
+SparseMatrix::const_iterator const SparseMatrix::End( size_t const row ) const {
+
+	boost::uint32_t const size = GetSize( row );
+	return const_iterator( GetIndices( row ) + size, GetValues( row ) + size );
+}
+
+
+
+
+//============================================================================
+//    SparseMatrix::const_iterator inline methods
+//============================================================================
+
+
+SparseMatrix::const_iterator::const_iterator( boost::uint32_t const* const index, float const* const value ) :
+	m_index( index ),
+	m_value( value )
+{
+}
+
+
+boost::uint32_t const SparseMatrix::const_iterator::Index() const {
+
+	return *m_index;
+}
+
+
+float const SparseMatrix::const_iterator::Value() const {
+
+	return *m_value;
+}
+
+
+SparseMatrix::const_iterator& SparseMatrix::const_iterator::operator++() {
+
+	++m_index;
+	++m_value;
+	return *this;
+}
+
+
+bool const SparseMatrix::const_iterator::operator==( const_iterator const& other ) const {
+
+	return( m_index == other.m_index );
+}
+
+
+bool const SparseMatrix::const_iterator::operator!=( const_iterator const& other ) const {
+
+	return( m_index != other.m_index );
+}
+
+
+
+
+}    // namespace GTSVM
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __SPARSE_MATRIX_HPP__ */
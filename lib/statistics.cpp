@@ -0,0 +1,508 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file statistics.cpp
+	\brief implementation of statistics functions, and StatisticsBackend class
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace GTSVM {
+
+
+
+
+namespace {
+
+
+
+
+//============================================================================
+//    StatisticsBackend class
+//============================================================================
+
+
+/*
+	Bytes are only counted if they actually move: host-memory backends copy
+	nothing when the source and destination are the same buffer, nor to upload
+	or download in place.
+*/
+struct StatisticsBackend : public Backend {
+
+	StatisticsBackend( boost::shared_ptr< Backend > const& backend, GTSVM_Statistics* const pStatistics ) :
+		m_backend( backend ),
+		m_pStatistics( pStatistics )
+	{
+	}
+
+
+	GTSVM_Backend const GetType() const {
+
+		return m_backend->GetType();
+	}
+
+	bool const IsHostMemory() const {
+
+		return m_backend->IsHostMemory();
+	}
+
+	bool const CanRepackClusters() const {
+
+		return m_backend->CanRepackClusters();
+	}
+
+	bool const SupportsBatchSize( unsigned int const logBatchSize ) const {
+
+		return m_backend->SupportsBatchSize( logBatchSize );
+	}
+
+
+	void* HostMalloc( char const* const what, size_t const size ) {
+
+		return m_backend->HostMalloc( what, size );
+	}
+
+	void HostFree( char const* const what, void* const pointer ) {
+
+		m_backend->HostFree( what, pointer );
+	}
+
+	void* DeviceMalloc( char const* const what, size_t const size ) {
+
+		return m_backend->DeviceMalloc( what, size );
+	}
+
+	void DeviceFree( char const* const what, void* const pointer ) {
+
+		m_backend->DeviceFree( what, pointer );
+	}
+
+
+	void CopyToDevice(
+		char const* const what,
+		void* const deviceDestination,
+		void const* const source,
+		size_t const size
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_TRANSFER );
+		m_backend->CopyToDevice( what, deviceDestination, source, size );
+		if ( deviceDestination != source )
+			m_pStatistics->bytesToDevice += size;
+	}
+
+	void CopyFromDevice(
+		char const* const what,
+		void* const destination,
+		void const* const deviceSource,
+		size_t const size
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_TRANSFER );
+		m_backend->CopyFromDevice( what, destination, deviceSource, size );
+		if ( destination != deviceSource )
+			m_pStatistics->bytesFromDevice += size;
+	}
+
+	void* BeginUpload( char const* const what, void* const deviceDestination, size_t const size ) {
+
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_TRANSFER );
+		return m_backend->BeginUpload( what, deviceDestination, size );
+	}
+
+	void EndUpload( char const* const what, void* const deviceDestination, void* const buffer, size_t const size ) {
+
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_TRANSFER );
+		m_backend->EndUpload( what, deviceDestination, buffer, size );
+		if ( deviceDestination != buffer )
+			m_pStatistics->bytesToDevice += size;
+	}
+
+	void const* BeginDownload( char const* const what, void const* const deviceSource, size_t const size ) {
+
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_TRANSFER );
+		void const* const buffer = m_backend->BeginDownload( what, deviceSource, size );
+		if ( buffer != deviceSource )
+			m_pStatistics->bytesFromDevice += size;
+		return buffer;
+	}
+
+	void EndDownload( char const* const what, void const* const deviceSource, void const* const buffer ) {
+
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_TRANSFER );
+		m_backend->EndDownload( what, deviceSource, buffer );
+	}
+
+
+	void ArrayRead(
+		float* const deviceDestination,
+		float const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_TRANSFER );
+		m_backend->ArrayRead( deviceDestination, deviceValues, deviceIndices, size );
+	}
+
+#ifdef CUDA_USE_DOUBLE
+	void ArrayRead(
+		double* const deviceDestination,
+		double const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_TRANSFER );
+		m_backend->ArrayRead( deviceDestination, deviceValues, deviceIndices, size );
+	}
+#endif    // CUDA_USE_DOUBLE
+
+	void ArrayUpdate(
+		float* const deviceDestination,
+		float const* const deviceValues,
+		boost::uint32_t const* const deviceIndices,
+		unsigned int const size
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_TRANSFER );
+		m_backend->ArrayUpdate( deviceDestination, deviceValues, deviceIndices, size );
+	}
+
+
+	CUDA_FLOAT_DOUBLE const* SparseEvaluateKernel(
+		void* deviceWork1,
+		void* deviceWork2,
+		float const* const deviceBatchVectorsTranspose,
+		float const* const deviceBatchVectorNormsSquared,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const logBatchSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,
+		GTSVM_Kernel const kernel,
+		float const kernelParameter1,
+		float const kernelParameter2,
+		float const kernelParameter3
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_EVALUATE_KERNEL );
+		return m_backend->SparseEvaluateKernel(
+			deviceWork1,
+			deviceWork2,
+			deviceBatchVectorsTranspose,
+			deviceBatchVectorNormsSquared,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			logBatchSize,
+			clusters,
+			classes,
+			workSize,
+			kernel,
+			kernelParameter1,
+			kernelParameter2,
+			kernelParameter3
+		);
+	}
+
+	void SparseUpdateKernel(
+		float const* const deviceBatchVectorsTranspose,
+		float const* const deviceBatchVectorNormsSquared,
+		float* const deviceBatchAlphas,
+		boost::uint32_t const* const deviceBatchIndices,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const logBatchSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		GTSVM_Kernel const kernel,
+		float const kernelParameter1,
+		float const kernelParameter2,
+		float const kernelParameter3
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_UPDATE_KERNEL );
+		m_backend->SparseUpdateKernel(
+			deviceBatchVectorsTranspose,
+			deviceBatchVectorNormsSquared,
+			deviceBatchAlphas,
+			deviceBatchIndices,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			logBatchSize,
+			clusters,
+			classes,
+			kernel,
+			kernelParameter1,
+			kernelParameter2,
+			kernelParameter3
+		);
+	}
+
+	std::pair< CUDA_FLOAT_DOUBLE const*, boost::uint32_t const* > SparseCalculateBias(
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		float const regularization
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_CALCULATE_OBJECTIVES );
+		return m_backend->SparseCalculateBias(
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			workSize,
+			regularization
+		);
+	}
+
+	std::pair< CUDA_FLOAT_DOUBLE const*, CUDA_FLOAT_DOUBLE const* > SparseCalculateObjectives(
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,
+		float const regularization,
+		float const bias
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_CALCULATE_OBJECTIVES );
+		return m_backend->SparseCalculateObjectives(
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			classes,
+			workSize,
+			regularization,
+			bias
+		);
+	}
+
+	void SparseKernelFindLargestScore(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_SELECTION );
+		m_backend->SparseKernelFindLargestScore(
+			destinationKeys,
+			destinationValues,
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			classes,
+			workSize,
+			resultSize,
+			destinationSize,
+			regularization
+		);
+	}
+
+	void SparseKernelFindLargestPositiveGradient(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_SELECTION );
+		m_backend->SparseKernelFindLargestPositiveGradient(
+			destinationKeys,
+			destinationValues,
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			workSize,
+			resultSize,
+			destinationSize,
+			regularization
+		);
+	}
+
+	void SparseKernelFindLargestNegativeGradient(
+		float* const destinationKeys,
+		boost::uint32_t* const destinationValues,
+		void* deviceWork1,
+		void* deviceWork2,
+		void* deviceWork3,
+		void* deviceWork4,
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const workSize,
+		unsigned int const resultSize,
+		unsigned int const destinationSize,
+		float const regularization
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_SELECTION );
+		m_backend->SparseKernelFindLargestNegativeGradient(
+			destinationKeys,
+			destinationValues,
+			deviceWork1,
+			deviceWork2,
+			deviceWork3,
+			deviceWork4,
+			deviceClusterHeaders,
+			logMaximumClusterSize,
+			clusters,
+			workSize,
+			resultSize,
+			destinationSize,
+			regularization
+		);
+	}
+
+	void SparseRepackClusters(
+		CUDA::SparseKernelClusterHeader const* const deviceClusterHeaders,
+		CUDA::SparseKernelClusterHeader const* const deviceSourceClusterHeaders,
+		boost::uint32_t const* const deviceSources,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const clusters,
+		unsigned int const classes
+	)
+	{
+		PhaseTimer timer( m_pStatistics, GTSVM_PHASE_SHRINKING );
+		m_backend->SparseRepackClusters(
+			deviceClusterHeaders,
+			deviceSourceClusterHeaders,
+			deviceSources,
+			logMaximumClusterSize,
+			clusters,
+			classes
+		);
+	}
+
+
+private:
+
+	boost::shared_ptr< Backend > m_backend;
+	GTSVM_Statistics* m_pStatistics;
+
+
+	StatisticsBackend( StatisticsBackend const& other );
+	StatisticsBackend const& operator=( StatisticsBackend const& other );
+};
+
+
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    MonotonicSeconds function
+//============================================================================
+
+
+double const MonotonicSeconds() {
+
+	timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return( now.tv_sec + now.tv_nsec * 1e-9 );
+}
+
+
+
+
+//============================================================================
+//    ResetStatistics function
+//============================================================================
+
+
+void ResetStatistics( GTSVM_Statistics* const pStatistics ) {
+
+	std::memset( pStatistics, 0, sizeof( GTSVM_Statistics ) );
+}
+
+
+
+
+//============================================================================
+//    CreateStatisticsBackend function
+//============================================================================
+
+
+boost::shared_ptr< Backend > CreateStatisticsBackend(
+	boost::shared_ptr< Backend > const& backend,
+	GTSVM_Statistics* const pStatistics
+)
+{
+	return boost::shared_ptr< Backend >( new StatisticsBackend( backend, pStatistics ) );
+}
+
+
+
+
+}    // namespace GTSVM
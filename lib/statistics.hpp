@@ -0,0 +1,179 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file statistics.hpp
+	\brief definition of PhaseTimer class, and CreateStatisticsBackend function
+*/
+
+
+
+
+#ifndef __STATISTICS_HPP__
+#define __STATISTICS_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include "gtsvm.h"
+#include "backend.hpp"
+
+#include <boost/shared_ptr.hpp>
+
+
+
+
+namespace GTSVM {
+
+
+
+
+//============================================================================
+//    MonotonicSeconds function
+//============================================================================
+
+
+double const MonotonicSeconds();
+
+
+
+
+//============================================================================
+//    ResetStatistics function
+//============================================================================
+
+
+void ResetStatistics( GTSVM_Statistics* const pStatistics );
+
+
+
+
+//============================================================================
+//    PhaseTimer class
+//============================================================================
+
+
+/*
+	Charges the time between Start() and Stop() (or destruction, if it's still
+	running) to the given phase, and counts one call to it
+*/
+struct PhaseTimer {
+
+	inline explicit PhaseTimer( GTSVM_Statistics* const pStatistics );
+	inline PhaseTimer( GTSVM_Statistics* const pStatistics, GTSVM_Phase const phase );
+	inline ~PhaseTimer();
+
+
+	inline void Start( GTSVM_Phase const phase );
+	inline void Stop();
+
+
+private:
+
+	GTSVM_Statistics* m_pStatistics;
+	GTSVM_Phase m_phase;
+	bool m_running;
+	double m_start;
+
+
+	PhaseTimer( PhaseTimer const& other );
+	PhaseTimer const& operator=( PhaseTimer const& other );
+};
+
+
+
+
+//============================================================================
+//    CreateStatisticsBackend function
+//============================================================================
+
+
+/*
+	Wraps a backend, forwarding every call to it, and charging the time spent
+	in each kernel launch, transfer and gather to the corresponding phase of
+	*pStatistics, which must outlive the result
+*/
+boost::shared_ptr< Backend > CreateStatisticsBackend(
+	boost::shared_ptr< Backend > const& backend,
+	GTSVM_Statistics* const pStatistics
+);
+
+
+
+
+//============================================================================
+//    PhaseTimer inline methods
+//============================================================================
+
+
+PhaseTimer::PhaseTimer( GTSVM_Statistics* const pStatistics ) :
+	m_pStatistics( pStatistics ),
+	m_phase( GTSVM_PHASE_SELECTION ),
+	m_running( false ),
+	m_start( 0 )
+{
+}
+
+
+PhaseTimer::PhaseTimer( GTSVM_Statistics* const pStatistics, GTSVM_Phase const phase ) :
+	m_pStatistics( pStatistics ),
+	m_phase( phase ),
+	m_running( true ),
+	m_start( MonotonicSeconds() )
+{
+}
+
+
+PhaseTimer::~PhaseTimer() {
+
+	Stop();
+}
+
+
+void PhaseTimer::Start( GTSVM_Phase const phase ) {
+
+	Stop();
+	m_phase = phase;
+	m_running = true;
+	m_start = MonotonicSeconds();
+}
+
+
+void PhaseTimer::Stop() {
+
+	if ( m_running ) {
+
+		m_pStatistics->seconds[ m_phase ] += MonotonicSeconds() - m_start;
+		++m_pStatistics->calls[ m_phase ];
+		m_running = false;
+	}
+}
+
+
+
+
+}    // namespace GTSVM
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __STATISTICS_HPP__ */
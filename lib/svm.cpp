@@ -233,8 +233,11 @@ static inline void SVM_Memcpy2d( t_Type* const destination, void const* const so
 //============================================================================
 
 
-template< typename t_DestinationType, typename t_SourceType >
-static inline void SVM_SparseMemcpy2d_Helper( std::vector< std::pair< unsigned int, t_DestinationType > >* const destination, t_SourceType const* const source, size_t const rows, size_t const columns, bool const transpose ) {
+template< typename t_SourceType >
+static inline void SVM_SparseMemcpy2d_Helper( SparseMatrix* const destination, t_SourceType const* const source, size_t const rows, size_t const columns, bool const transpose ) {
+
+	destination->Clear();
+	destination->Reserve( rows, 0 );
 
 	if ( transpose ) {
 
@@ -243,11 +246,12 @@ static inline void SVM_SparseMemcpy2d_Helper( std::vector< std::pair< unsigned i
 			unsigned int index = ii;
 			for ( unsigned int jj = 0; jj < columns; ++jj ) {
 
-				t_DestinationType const value = SVM_ConvertHelper< t_DestinationType >::Convert( source[ index ] );
+				float const value = SVM_ConvertHelper< float >::Convert( source[ index ] );
 				if ( value != 0 )
-					destination[ ii ].push_back( std::pair< unsigned int, t_DestinationType >( jj, value ) );
+					destination->Append( jj, value );
 				index += rows;
 			}
+			destination->EndRow();
 		}
 	}
 	else {
@@ -257,18 +261,21 @@ static inline void SVM_SparseMemcpy2d_Helper( std::vector< std::pair< unsigned i
 
 			for ( unsigned int jj = 0; jj < columns; ++jj ) {
 
-				t_DestinationType const value = SVM_ConvertHelper< t_DestinationType >::Convert( source[ index ] );
+				float const value = SVM_ConvertHelper< float >::Convert( source[ index ] );
 				if ( value != 0 )
-					destination[ ii ].push_back( std::pair< unsigned int, t_DestinationType >( jj, value ) );
+					destination->Append( jj, value );
 				++index;
 			}
+			destination->EndRow();
 		}
 	}
+
+	// we don't know the number of nonzeros in advance, so give back the slack
+	destination->Compact();
 }
 
 
-template< typename t_Type >
-static inline void SVM_SparseMemcpy2d( std::vector< std::pair< unsigned int, t_Type > >* const destination, void const* const source, GTSVM_Type const type, size_t const rows, size_t const columns, bool const transpose = false ) {
+static inline void SVM_SparseMemcpy2d( SparseMatrix* const destination, void const* const source, GTSVM_Type const type, size_t const rows, size_t const columns, bool const transpose = false ) {
 
 	switch( type ) {
 		case GTSVM_TYPE_BOOL:   SVM_SparseMemcpy2d_Helper( destination, reinterpret_cast< bool const*            >( source ), rows, columns, transpose ); break;
@@ -294,8 +301,11 @@ static inline void SVM_SparseMemcpy2d( std::vector< std::pair< unsigned int, t_T
 //============================================================================
 
 
-template< typename t_DestinationType, typename t_SourceType >
-static inline void SVM_SparseSparseMemcpy2d_Helper( std::vector< std::pair< unsigned int, t_DestinationType > >* const destination, t_SourceType const* const source, size_t const* const sourceIndices, size_t const* const sourceOffsets, size_t const rows, size_t const columns, bool const transpose ) {
+template< typename t_SourceType >
+static inline void SVM_SparseSparseMemcpy2d_Helper( SparseMatrix* const destination, t_SourceType const* const source, size_t const* const sourceIndices, size_t const* const sourceOffsets, size_t const rows, size_t const columns, bool const transpose ) {
+
+	destination->Clear();
+	destination->Reserve( rows, sourceOffsets[ transpose ? columns : rows ] );
 
 	if ( transpose ) {
 
@@ -320,15 +330,16 @@ static inline void SVM_SparseSparseMemcpy2d_Helper( std::vector< std::pair< unsi
 				if ( row != ii )
 					break;
 
-				t_DestinationType const value = SVM_ConvertHelper< t_DestinationType >::Convert( source[ indices[ column ] ] );
+				float const value = SVM_ConvertHelper< float >::Convert( source[ indices[ column ] ] );
 				if ( value != 0 )
-					destination[ ii ].push_back( std::pair< unsigned int, t_DestinationType >( column, value ) );
+					destination->Append( column, value );
 
 				queue.pop();
 				++indices[ column ];
 				if ( indices[ column ] < sourceOffsets[ column + 1 ] )
 					queue.push( std::pair< int, int >( -static_cast< int >( sourceIndices[ indices[ column ] ] ), -static_cast< int >( column ) ) );
 			}
+			destination->EndRow();
 		}
 	}
 	else {
@@ -337,17 +348,17 @@ static inline void SVM_SparseSparseMemcpy2d_Helper( std::vector< std::pair< unsi
 
 			for ( unsigned int jj = sourceOffsets[ ii ]; jj < sourceOffsets[ ii + 1 ]; ++jj ) {
 
-				t_DestinationType const value = SVM_ConvertHelper< t_DestinationType >::Convert( source[ jj ] );
+				float const value = SVM_ConvertHelper< float >::Convert( source[ jj ] );
 				if ( value != 0 )
-					destination[ ii ].push_back( std::pair< unsigned int, t_DestinationType >( sourceIndices[ jj ], value ) );
+					destination->Append( sourceIndices[ jj ], value );
 			}
+			destination->EndRow();
 		}
 	}
 }
 
 
-template< typename t_Type >
-static inline void SVM_SparseSparseMemcpy2d( std::vector< std::pair< unsigned int, t_Type > >* const destination, void const* const source, size_t const* const sourceIndices, size_t const* const sourceOffsets, GTSVM_Type const type, size_t const rows, size_t const columns, bool const transpose = false ) {
+static inline void SVM_SparseSparseMemcpy2d( SparseMatrix* const destination, void const* const source, size_t const* const sourceIndices, size_t const* const sourceOffsets, GTSVM_Type const type, size_t const rows, size_t const columns, bool const transpose = false ) {
 
 	switch( type ) {
 		case GTSVM_TYPE_BOOL:   SVM_SparseSparseMemcpy2d_Helper( destination, reinterpret_cast< bool const*            >( source ), sourceIndices, sourceOffsets, rows, columns, transpose ); break;
@@ -464,8 +475,8 @@ static inline void SVM_ReverseMemcpy2d( void* const destination, GTSVM_Type cons
 //============================================================================
 
 
-template< typename t_DestinationType, typename t_SourceType >
-static inline void SVM_SparseReverseMemcpy2d_Helper( t_DestinationType* const destination, std::vector< std::pair< unsigned int, t_SourceType > > const* const source, size_t const rows, size_t const columns, bool const transpose ) {
+template< typename t_DestinationType >
+static inline void SVM_SparseReverseMemcpy2d_Helper( t_DestinationType* const destination, SparseMatrix const& source, size_t const rows, size_t const columns, bool const transpose ) {
 
 	if ( transpose ) {
 
@@ -474,17 +485,17 @@ static inline void SVM_SparseReverseMemcpy2d_Helper( t_DestinationType* const de
 			unsigned int index = ii;
 
 			unsigned int kk = 0;
-			typename std::vector< std::pair< unsigned int, t_SourceType > >::const_iterator jj    = source[ ii ].begin();
-			typename std::vector< std::pair< unsigned int, t_SourceType > >::const_iterator jjEnd = source[ ii ].end();
+			SparseMatrix::const_iterator jj    = source.Begin( ii );
+			SparseMatrix::const_iterator jjEnd = source.End( ii );
 			for ( ; jj != jjEnd; ++jj ) {
 
-				BOOST_ASSERT( jj->first < columns );
-				for ( ; kk < jj->first; ++kk ) {
+				BOOST_ASSERT( jj.Index() < columns );
+				for ( ; kk < jj.Index(); ++kk ) {
 
 					destination[ index ] = 0;
 					index += rows;
 				}
-				destination[ index ] = SVM_ConvertHelper< t_DestinationType >::Convert( jj->second );
+				destination[ index ] = SVM_ConvertHelper< t_DestinationType >::Convert( jj.Value() );
 				index += rows;
 				++kk;
 			}
@@ -501,17 +512,17 @@ static inline void SVM_SparseReverseMemcpy2d_Helper( t_DestinationType* const de
 		for ( unsigned int ii = 0; ii < rows; ++ii ) {
 
 			unsigned int kk = 0;
-			typename std::vector< std::pair< unsigned int, t_SourceType > >::const_iterator jj    = source[ ii ].begin();
-			typename std::vector< std::pair< unsigned int, t_SourceType > >::const_iterator jjEnd = source[ ii ].end();
+			SparseMatrix::const_iterator jj    = source.Begin( ii );
+			SparseMatrix::const_iterator jjEnd = source.End( ii );
 			for ( ; jj != jjEnd; ++jj ) {
 
-				BOOST_ASSERT( jj->first < columns );
-				for ( ; kk < jj->first; ++kk ) {
+				BOOST_ASSERT( jj.Index() < columns );
+				for ( ; kk < jj.Index(); ++kk ) {
 
 					destination[ index ] = 0;
 					++index;
 				}
-				destination[ index ] = SVM_ConvertHelper< t_DestinationType >::Convert( jj->second );
+				destination[ index ] = SVM_ConvertHelper< t_DestinationType >::Convert( jj.Value() );
 				++index;
 				++kk;
 			}
@@ -525,8 +536,7 @@ static inline void SVM_SparseReverseMemcpy2d_Helper( t_DestinationType* const de
 }
 
 
-template< typename t_Type >
-static inline void SVM_SparseReverseMemcpy2d( void* const destination, GTSVM_Type const type, std::vector< std::pair< unsigned int, t_Type > > const* const source, size_t const rows, size_t const columns, bool const transpose = false ) {
+static inline void SVM_SparseReverseMemcpy2d( void* const destination, GTSVM_Type const type, SparseMatrix const& source, size_t const rows, size_t const columns, bool const transpose = false ) {
 
 	switch( type ) {
 		case GTSVM_TYPE_BOOL:   SVM_SparseReverseMemcpy2d_Helper( reinterpret_cast< bool*            >( destination ), source, rows, columns, transpose ); break;
@@ -552,8 +562,8 @@ static inline void SVM_SparseReverseMemcpy2d( void* const destination, GTSVM_Typ
 //============================================================================
 
 
-template< typename t_DestinationType, typename t_SourceType >
-static inline void SVM_SparseSparseReverseMemcpy2d_Helper( t_DestinationType* const destination, size_t* const destinationIndices, size_t* const destinationOffsets, std::vector< std::pair< unsigned int, t_SourceType > > const* const source, size_t const rows, size_t const columns, bool const transpose ) {
+template< typename t_DestinationType >
+static inline void SVM_SparseSparseReverseMemcpy2d_Helper( t_DestinationType* const destination, size_t* const destinationIndices, size_t* const destinationOffsets, SparseMatrix const& source, size_t const rows, size_t const columns, bool const transpose ) {
 
 	if ( transpose ) {
 
@@ -562,8 +572,8 @@ static inline void SVM_SparseSparseReverseMemcpy2d_Helper( t_DestinationType* co
 
 		std::priority_queue< std::pair< int, int > > queue;
 		for ( unsigned int ii = 0; ii < rows; ++ii )
-			if ( indices[ ii ] < source[ ii ].size() )
-				queue.push( std::pair< int, int >( -static_cast< int >( source[ ii ][ indices[ ii ] ].first ), -static_cast< int >( ii ) ) );
+			if ( indices[ ii ] < source.GetSize( ii ) )
+				queue.push( std::pair< int, int >( -static_cast< int >( source.GetIndices( ii )[ indices[ ii ] ] ), -static_cast< int >( ii ) ) );
 
 		unsigned int index = 0;
 		for ( unsigned int ii = 0; ii < columns; ++ii ) {
@@ -580,14 +590,14 @@ static inline void SVM_SparseSparseReverseMemcpy2d_Helper( t_DestinationType* co
 				if ( column != ii )
 					break;
 
-				destination[        index ] = SVM_ConvertHelper< t_DestinationType >::Convert( source[ row ][ indices[ row ] ].second );
+				destination[        index ] = SVM_ConvertHelper< t_DestinationType >::Convert( source.GetValues( row )[ indices[ row ] ] );
 				destinationIndices[ index ] = row;
 				++index;
 
 				queue.pop();
 				++indices[ row ];
-				if ( indices[ row ] < source[ row ].size() )
-					queue.push( std::pair< int, int >( -static_cast< int >( source[ row ][ indices[ row ] ].first ), -static_cast< int >( row ) ) );
+				if ( indices[ row ] < source.GetSize( row ) )
+					queue.push( std::pair< int, int >( -static_cast< int >( source.GetIndices( row )[ indices[ row ] ] ), -static_cast< int >( row ) ) );
 			}
 		}
 		destinationOffsets[ columns ] = index;
@@ -599,13 +609,13 @@ static inline void SVM_SparseSparseReverseMemcpy2d_Helper( t_DestinationType* co
 
 			destinationOffsets[ ii ] = index;
 
-			typename std::vector< std::pair< unsigned int, t_SourceType > >::const_iterator jj    = source[ ii ].begin();
-			typename std::vector< std::pair< unsigned int, t_SourceType > >::const_iterator jjEnd = source[ ii ].end();
+			SparseMatrix::const_iterator jj    = source.Begin( ii );
+			SparseMatrix::const_iterator jjEnd = source.End( ii );
 			for ( ; jj != jjEnd; ++jj ) {
 
-				BOOST_ASSERT( jj->first < columns );
-				destination[        index ] = SVM_ConvertHelper< t_DestinationType >::Convert( jj->second );
-				destinationIndices[ index ] = jj->first;
+				BOOST_ASSERT( jj.Index() < columns );
+				destination[        index ] = SVM_ConvertHelper< t_DestinationType >::Convert( jj.Value() );
+				destinationIndices[ index ] = jj.Index();
 				++index;
 			}
 		}
@@ -614,8 +624,7 @@ static inline void SVM_SparseSparseReverseMemcpy2d_Helper( t_DestinationType* co
 }
 
 
-template< typename t_Type >
-static inline void SVM_SparseSparseReverseMemcpy2d( void* const destination, size_t* const destinationIndices, size_t* const destinationOffsets, GTSVM_Type const type, std::vector< std::pair< unsigned int, t_Type > > const* const source, size_t const rows, size_t const columns, bool const transpose = false ) {
+static inline void SVM_SparseSparseReverseMemcpy2d( void* const destination, size_t* const destinationIndices, size_t* const destinationOffsets, GTSVM_Type const type, SparseMatrix const& source, size_t const rows, size_t const columns, bool const transpose = false ) {
 
 	switch( type ) {
 		case GTSVM_TYPE_BOOL:   SVM_SparseSparseReverseMemcpy2d_Helper( reinterpret_cast< bool*            >( destination ), destinationIndices, destinationOffsets, source, rows, columns, transpose ); break;
@@ -677,2050 +686,4351 @@ static inline void SVM_MemcpyStride( t_Type* const destination, size_t const des
 
 
 
-}    // anonymous namespace
+//============================================================================
+//    SVM_ModelFileSectionSizes helper function
+//============================================================================
+
+
+static inline void SVM_ModelFileSectionSizes( size_t* const sizes, size_t const rows, size_t const classes, size_t const nonzeros ) {
+
+	sizes[ MODEL_FILE_SECTION_OFFSETS      ] = rows * sizeof( boost::uint64_t );
+	sizes[ MODEL_FILE_SECTION_SIZES        ] = rows * sizeof( boost::uint32_t );
+	sizes[ MODEL_FILE_SECTION_INDICES      ] = nonzeros * sizeof( boost::uint32_t );
+	sizes[ MODEL_FILE_SECTION_VALUES       ] = nonzeros * sizeof( float );
+	sizes[ MODEL_FILE_SECTION_LABELS       ] = rows * sizeof( boost::int32_t );
+	sizes[ MODEL_FILE_SECTION_NORMS        ] = rows * sizeof( float );
+	sizes[ MODEL_FILE_SECTION_KERNEL_NORMS ] = rows * sizeof( float );
+	sizes[ MODEL_FILE_SECTION_RESPONSES    ] = rows * classes * sizeof( double );
+	sizes[ MODEL_FILE_SECTION_ALPHAS       ] = rows * classes * sizeof( float );
+}
 
 
 
 
 //============================================================================
-//    SVM methods
+//    SVM_VectorData helper function
 //============================================================================
 
 
-SVM::SVM() :
-	m_constructed( true ),
-	m_initializedHost( false ),
-	m_initializedDevice( false ),
-	m_updatedResponses( true ),
-	m_foundKeys( NULL ),
-	m_foundValues( NULL ),
-	m_batchVectorsTranspose( NULL ),
-	m_batchVectorNormsSquared( NULL ),
-	m_batchResponses( NULL ),
-	m_batchAlphas( NULL ),
-	m_batchIndices( NULL ),
-	m_deviceBatchVectorsTranspose( NULL ),
-	m_deviceBatchVectorNormsSquared( NULL ),
-	m_deviceBatchResponses( NULL ),
-	m_deviceBatchAlphas( NULL ),
-	m_deviceBatchIndices( NULL ),
-	m_deviceTrainingLabels( NULL ),
-	m_deviceTrainingVectorNormsSquared( NULL ),
-	m_deviceTrainingVectorKernelNormsSquared( NULL ),
-	m_deviceTrainingResponses( NULL ),
-	m_deviceTrainingAlphas( NULL ),
-	m_deviceNonzeroIndices( NULL ),
-	m_deviceTrainingVectorsTranspose( NULL ),
-	m_deviceClusterHeaders( NULL ),
-	m_deviceClusterSizeSums( NULL )
-{
-	for ( unsigned int ii = 0; ii < ARRAYLENGTH( m_deviceWork ); ++ii )
-		m_deviceWork[ ii ] = NULL;
-
-	try {
+template< typename t_Type >
+static inline t_Type const* SVM_VectorData( std::vector< t_Type > const& vector ) {
 
-		m_foundSize = 4096;
-		CUDA_VERIFY(
-			"Failed to allocate space for found keys on host",
-			cudaMallocHost( &m_foundKeys, m_foundSize * sizeof( float ) )
-		);
-		CUDA_VERIFY(
-			"Failed to allocate space for found values on host",
-			cudaMallocHost( &m_foundValues, m_foundSize * sizeof( boost::uint32_t ) )
-		);
+	return( vector.empty() ? NULL : &vector[ 0 ] );
+}
 
-		CUDA_VERIFY(
-			"Failed to allocate space for batch squared norms on host",
-			cudaMallocHost( &m_batchVectorNormsSquared, 16 * sizeof( float ) )
-		);
-		CUDA_VERIFY(
-			"Failed to allocate space for batch squared norms on device",
-			cudaMalloc( reinterpret_cast< void** >( &m_deviceBatchVectorNormsSquared ), 16 * sizeof( float ) )
-		);
 
-		m_batchSubmatrix = boost::shared_array< double >( new double[ 256 ] );
-	}
-	catch( ... ) {
 
-		Cleanup();    // try to keep this structure in a valid state, if possible
-		throw;
-	}
-}
 
+//============================================================================
+//    SVM_WriteZeros helper function
+//============================================================================
 
-SVM::~SVM() {
 
-	Cleanup();
-}
+static inline void SVM_WriteZeros( FILE* const file, size_t const size ) {
 
+	char const zeros[ MODEL_FILE_ALIGNMENT ] = { 0 };
+	BOOST_ASSERT( size <= sizeof( zeros ) );
 
-void SVM::InitializeSparse(
-	void const* const trainingVectors,    // order depends on columnMajor flag
-	size_t const* const trainingVectorIndices,
-	size_t const* const trainingVectorOffsets,
-	GTSVM_Type trainingVectorsType,
-	void const* const trainingLabels,
-	GTSVM_Type trainingLabelsType,
-	boost::uint32_t const rows,
-	boost::uint32_t const columns,
-	bool const columnMajor,
-	bool const multiclass,
-	float const regularization,
-	GTSVM_Kernel const kernel,
-	float const kernelParameter1,
-	float const kernelParameter2,
-	float const kernelParameter3,
-	bool const biased,
-	bool const smallClusters,
-	unsigned int const activeClusters
-)
-{
-	if ( ! m_constructed )
-		throw std::runtime_error( "SVM has not been successfully constructed" );
-	if ( m_initializedHost )
-		Deinitialize();
-	BOOST_ASSERT( ! m_initializedDevice );
-	BOOST_ASSERT( ! m_initializedHost );
-	m_initializedHost = true;
+	if ( fwrite( zeros, 1, size, file ) != size )
+		throw std::runtime_error( "Unable to write model file padding" );
+}
 
-	try {
 
-		m_rows = rows;
-		m_columns = columns;
 
-		m_trainingVectors = boost::shared_array< SparseVector >( new SparseVector[ m_rows ] );
-		m_trainingLabels = boost::shared_array< boost::int32_t >( new boost::int32_t[ m_rows ] );
-		SVM_SparseSparseMemcpy2d( m_trainingVectors.get(), trainingVectors, trainingVectorIndices, trainingVectorOffsets, trainingVectorsType, m_rows, m_columns, columnMajor );
-		SVM_Memcpy( m_trainingLabels.get(), trainingLabels, 0, trainingLabelsType, m_rows );
 
-		if ( multiclass ) {
+//============================================================================
+//    SVM_DensityWord helper structure
+//============================================================================
 
-			int maximumLabel = 0;
-			for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
 
-				int const label = m_trainingLabels[ ii ];
-				if ( label < 0 )
-					throw std::runtime_error( "multiclass labels must be nonnegative" );
-				if ( label > maximumLabel )
-					maximumLabel = label;
-			}
-			if ( maximumLabel > 65535 )
-				throw std::runtime_error( "multiclass labels cannot exceed 65535" );
+// one nonzero 64-bit word of a row's bitmap of nonzero columns
+struct SVM_DensityWord {
 
-			m_classes = maximumLabel + 1;
+	unsigned int index;
+	boost::uint64_t bits;
+};
 
-			boost::shared_array< bool > present( new bool[ m_classes ] );
-			std::fill( present.get(), present.get() + m_classes, false );
-			for ( unsigned int ii = 0; ii < m_rows; ++ii )
-				present[ m_trainingLabels[ ii ] ] = true;
-			for ( unsigned int ii = 0; ii < m_classes; ++ii )
-				if ( ! present[ ii ] )
-					throw std::runtime_error( "at least one example of each label in {0,1,...,max} must be present in training set" );
-		}
-		else {
 
-			m_classes = 1;
 
-			bool present[ 2 ] = { false, false };
-			for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
 
-				if ( m_trainingLabels[ ii ] > 0 ) {
+//============================================================================
+//    SVM_ClusterCosts helper function
+//============================================================================
 
-					m_trainingLabels[ ii ] = 1;
-					present[ 1 ] = true;
-				}
-				else {
 
-					m_trainingLabels[ ii ] = -1;
-					present[ 0 ] = true;
-				}
-			}
-			if ( ( ! present[ 0 ] ) || ( ! present[ 1 ] ) )
-				throw std::runtime_error( "at least one positive and negative example must be present in training set" );
-		}
+/*
+	Finds the cost of adding a row to each of clusters chunk*chunkSize up to
+	(but not including) min(clusters,(chunk+1)*chunkSize): the number of
+	columns which are nonzero in the cluster but not the row, plus the number
+	which are nonzero in the row but not the cluster, times the size of the
+	cluster. Only the words in which the row is nonzero need to be visited,
+	since clusterNonzeros holds the number of bits set in each cluster.
+*/
+static void SVM_ClusterCosts(
+	unsigned int* const costs,
+	boost::uint64_t const* const* const clusterDensities,
+	unsigned int const* const clusterSizes,
+	unsigned int const* const clusterNonzeros,
+	SVM_DensityWord const* const density,
+	size_t const densitySize,
+	unsigned int const chunkSize,
+	unsigned int const clusters,
+	unsigned int const chunk
+)
+{
+	unsigned int const begin = chunk * chunkSize;
+	unsigned int const end = std::min( clusters, begin + chunkSize );
+	for ( unsigned int ii = begin; ii < end; ++ii ) {
 
-		m_trainingVectorNormsSquared       = boost::shared_array< float >( new float[ m_rows ] );
-		m_trainingVectorKernelNormsSquared = boost::shared_array< float >( new float[ m_rows ] );
+		boost::uint64_t const* const clusterDensity = clusterDensities[ ii ];
 
-		m_trainingResponses = boost::shared_array< double >( new double[ m_rows * m_classes ] );
-		m_trainingAlphas = boost::shared_array< float >( new float[ m_rows * m_classes ] );
+		unsigned int newNonzeros = 0;
+		unsigned int sharedNonzeros = 0;
+		for ( unsigned int jj = 0; jj < densitySize; ++jj ) {
 
-		ClusterTrainingVectors( smallClusters, activeClusters );
+			boost::uint64_t const newDensity = density[ jj ].bits;
+			boost::uint64_t const oldDensity = clusterDensity[ density[ jj ].index ];
 
-		Restart( regularization, kernel, kernelParameter1, kernelParameter2, kernelParameter3, biased );
-	}
-	catch( ... ) {
+			newNonzeros    += CountBits( static_cast< boost::uint64_t >( newDensity & ~oldDensity ) );
+			sharedNonzeros += CountBits( static_cast< boost::uint64_t >( newDensity &  oldDensity ) );
+		}
 
-		Deinitialize();    // try to keep this structure in a valid state, if possible
-		throw;
+		costs[ ii ] = ( clusterNonzeros[ ii ] - sharedNonzeros ) + newNonzeros * clusterSizes[ ii ];
 	}
 }
 
 
-void SVM::InitializeDense(
-	void const* const trainingVectors,    // order depends on columnMajor flag
-	GTSVM_Type trainingVectorsType,
-	void const* const trainingLabels,
-	GTSVM_Type trainingLabelsType,
-	boost::uint32_t const rows,
-	boost::uint32_t const columns,
-	bool const columnMajor,
-	bool const multiclass,
-	float const regularization,
-	GTSVM_Kernel const kernel,
-	float const kernelParameter1,
-	float const kernelParameter2,
-	float const kernelParameter3,
-	bool const biased,
-	bool const smallClusters,
-	unsigned int const activeClusters
+
+/*
+	Finds the costs of adding the row'th of a block of rows (whose density
+	words are concatenated in densities, starting at the given offsets) to
+	each of the clusters, and writes them to the row'th of the block's rows
+	of costs, which are stride apart
+*/
+static void SVM_BlockClusterCosts(
+	unsigned int* const costs,
+	unsigned int const stride,
+	boost::uint64_t const* const* const clusterDensities,
+	unsigned int const* const clusterSizes,
+	unsigned int const* const clusterNonzeros,
+	SVM_DensityWord const* const densities,
+	size_t const* const densityOffsets,
+	unsigned int const clusters,
+	unsigned int const row
 )
 {
-	if ( ! m_constructed )
-		throw std::runtime_error( "SVM has not been successfully constructed" );
-	if ( m_initializedHost )
-		Deinitialize();
-	BOOST_ASSERT( ! m_initializedDevice );
-	BOOST_ASSERT( ! m_initializedHost );
-	m_initializedHost = true;
-
-	try {
+	SVM_ClusterCosts(
+		costs + row * stride,
+		clusterDensities,
+		clusterSizes,
+		clusterNonzeros,
+		densities + densityOffsets[ row ],
+		densityOffsets[ row + 1 ] - densityOffsets[ row ],
+		clusters,
+		clusters,
+		0
+	);
+}
 
-		m_rows = rows;
-		m_columns = columns;
 
-		m_trainingVectors = boost::shared_array< SparseVector >( new SparseVector[ m_rows ] );
-		m_trainingLabels = boost::shared_array< boost::int32_t >( new boost::int32_t[ m_rows ] );
-		SVM_SparseMemcpy2d( m_trainingVectors.get(), trainingVectors, trainingVectorsType, m_rows, m_columns, columnMajor );
-		SVM_Memcpy( m_trainingLabels.get(), trainingLabels, 0, trainingLabelsType, m_rows );
 
-		if ( multiclass ) {
 
-			int maximumLabel = 0;
-			for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+//============================================================================
+//    SVM_ExtractNonzeros helper function
+//============================================================================
 
-				int const label = m_trainingLabels[ ii ];
-				if ( label < 0 )
-					throw std::runtime_error( "multiclass labels must be nonnegative" );
-				if ( label > maximumLabel )
-					maximumLabel = label;
-			}
-			if ( maximumLabel > 65535 )
-				throw std::runtime_error( "multiclass labels cannot exceed 65535" );
 
-			m_classes = maximumLabel + 1;
+// lists the columns set in a cluster's density bitmap, and then clears it
+static void SVM_ExtractNonzeros(
+	std::vector< unsigned int >* const pNonzeros,
+	boost::uint64_t* const density,
+	unsigned int const densitySize,
+	unsigned int const nonzeros
+)
+{
+	pNonzeros->clear();
+	pNonzeros->reserve( nonzeros );
+	for ( unsigned int ii = 0; ii < densitySize; ++ii ) {
 
-			boost::shared_array< bool > present( new bool[ m_classes ] );
-			std::fill( present.get(), present.get() + m_classes, false );
-			for ( unsigned int ii = 0; ii < m_rows; ++ii )
-				present[ m_trainingLabels[ ii ] ] = true;
-			for ( unsigned int ii = 0; ii < m_classes; ++ii )
-				if ( ! present[ ii ] )
-					throw std::runtime_error( "at least one example of each label in {0,1,...,max} must be present in training set" );
-		}
-		else {
+		for ( boost::uint64_t bits = density[ ii ]; bits != 0; bits &= ( bits - 1 ) )
+			pNonzeros->push_back( ( ii << 6 ) + LowBit( bits ) );
+		density[ ii ] = 0;
+	}
+	BOOST_ASSERT( pNonzeros->size() == nonzeros );
+}
 
-			m_classes = 1;
 
-			bool present[ 2 ] = { false, false };
-			for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
 
-				if ( m_trainingLabels[ ii ] > 0 ) {
 
-					m_trainingLabels[ ii ] = 1;
-					present[ 1 ] = true;
-				}
-				else {
+//============================================================================
+//    SVM_MinHashSignature helper structure
+//============================================================================
 
-					m_trainingLabels[ ii ] = -1;
-					present[ 0 ] = true;
-				}
-			}
-			if ( ( ! present[ 0 ] ) || ( ! present[ 1 ] ) )
-				throw std::runtime_error( "at least one positive and negative example must be present in training set" );
-		}
 
-		m_trainingVectorNormsSquared       = boost::shared_array< float >( new float[ m_rows ] );
-		m_trainingVectorKernelNormsSquared = boost::shared_array< float >( new float[ m_rows ] );
+// the minimum, over a row's nonzero columns, of each of four hash functions
+struct SVM_MinHashSignature {
 
-		m_trainingResponses = boost::shared_array< double >( new double[ m_rows * m_classes ] );
-		m_trainingAlphas = boost::shared_array< float >( new float[ m_rows * m_classes ] );
+	boost::uint32_t hashes[ 4 ];
+	unsigned int index;
 
-		ClusterTrainingVectors( smallClusters, activeClusters );
 
-		Restart( regularization, kernel, kernelParameter1, kernelParameter2, kernelParameter3, biased );
-	}
-	catch( ... ) {
+	inline bool const operator<( SVM_MinHashSignature const& other ) const {
 
-		Deinitialize();    // try to keep this structure in a valid state, if possible
-		throw;
+		for ( unsigned int ii = 0; ii < ARRAYLENGTH( hashes ); ++ii )
+			if ( hashes[ ii ] != other.hashes[ ii ] )
+				return( hashes[ ii ] < other.hashes[ ii ] );
+		return( index < other.index );
 	}
-}
-
-
-void SVM::Load(
-	char const* const filename,
-	bool const smallClusters,
-	unsigned int const activeClusters
-)
-{
-	if ( ! m_constructed )
-		throw std::runtime_error( "SVM has not been successfully constructed" );
-	if ( m_initializedHost )
-		Deinitialize();
-	BOOST_ASSERT( ! m_initializedDevice );
-	BOOST_ASSERT( ! m_initializedHost );
-	m_initializedHost = true;
-
-	try {
+};
 
-		{	FILE* file = fopen( filename, "rb" );
-			if ( file == NULL )
-				throw std::runtime_error( "Unable to open file" );
 
-			if ( fread( &m_rows, sizeof( m_rows ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to read rows" );
-			if ( fread( &m_columns, sizeof( m_columns ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to read columns" );
-			if ( fread( &m_classes, sizeof( m_classes ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to read classes" );
 
-			m_trainingVectors = boost::shared_array< SparseVector >( new SparseVector[ m_rows ] );
-			for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
 
-				boost::uint32_t size;
-				if ( fread( &size, sizeof( boost::uint32_t ), 1, file ) != 1 )
-					throw std::runtime_error( "Unable to read training vector size" );
+//============================================================================
+//    SVM_MinHash helper function
+//============================================================================
 
-				for ( unsigned int jj = 0; jj < size; ++jj ) {
 
-					boost::uint32_t index;
-					float value;
-					if ( fread( &index, sizeof( boost::uint32_t ), 1, file ) != 1 )
-						throw std::runtime_error( "Unable to read training vector nonzero index" );
-					if ( fread( &value, sizeof( float ), 1, file ) != 1 )
-						throw std::runtime_error( "Unable to read training vector nonzero value" );
+// the functionth of a family of hash functions of columns (MurmurHash3's finalizer, with a different seed for each)
+static inline boost::uint32_t const SVM_MinHash( boost::uint32_t column, unsigned int const function ) {
 
-					m_trainingVectors[ ii ].push_back( std::pair< unsigned int, float >( index, value ) );
-				}
-			}
+	column ^= 0x9e3779b9u * ( function + 1 );
+	column ^= ( column >> 16 );
+	column *= 0x85ebca6bu;
+	column ^= ( column >> 13 );
+	column *= 0xc2b2ae35u;
+	column ^= ( column >> 16 );
+	return column;
+}
 
-			m_trainingLabels = boost::shared_array< boost::int32_t >( new boost::int32_t[ m_rows ] );
-			if ( fread( m_trainingLabels.get(), sizeof( boost::int32_t ), m_rows, file ) != m_rows )
-				throw std::runtime_error( "Unable to read training labels" );
-
-			m_trainingVectorNormsSquared       = boost::shared_array< float >( new float[ m_rows ] );
-			m_trainingVectorKernelNormsSquared = boost::shared_array< float >( new float[ m_rows ] );
-
-			m_trainingResponses = boost::shared_array< double >( new double[ m_rows * m_classes ] );
-			m_trainingAlphas = boost::shared_array< float >( new float[ m_rows * m_classes ] );
-			if ( fread( m_trainingResponses.get(), sizeof( double ), m_rows * m_classes, file ) != m_rows * m_classes )
-				throw std::runtime_error( "Unable to read training responses" );
-			if ( fread( m_trainingAlphas.get(), sizeof( float ), m_rows * m_classes, file ) != m_rows * m_classes )
-				throw std::runtime_error( "Unable to read training alphas" );
-
-			if ( fread( &m_regularization, sizeof( float ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to read regularization parameter" );
-			{	boost::int32_t kernel;
-				if ( fread( &kernel, sizeof( boost::int32_t ), 1, file ) != 1 )
-					throw std::runtime_error( "Unable to read kernel" );
-				m_kernel = static_cast< GTSVM_Kernel >( kernel );
-			}
-			if ( fread( &m_kernelParameter1, sizeof( float ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to read first kernel parameter" );
-			if ( fread( &m_kernelParameter2, sizeof( float ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to read second kernel parameter" );
-			if ( fread( &m_kernelParameter3, sizeof( float ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to read third kernel parameter" );
-			if ( fread( &m_biased, sizeof( bool ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to read biased flag" );
-			if ( fread( &m_bias, sizeof( float ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to read bias" );
 
-			fclose( file );
-		}
 
-		for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
 
-			double accumulator = 0;
+//============================================================================
+//    SVM_MinHashSignatures helper function
+//============================================================================
 
-			SparseVector::const_iterator jj    = m_trainingVectors[ ii ].begin();
-			SparseVector::const_iterator jjEnd = m_trainingVectors[ ii ].end();
-			for ( ; jj != jjEnd; ++jj )
-				accumulator += Square( jj->second );
 
-			double value = std::numeric_limits< double >::quiet_NaN();
-			switch( m_kernel ) {
-				case GTSVM_KERNEL_GAUSSIAN:   { value = Kernel< GTSVM_KERNEL_GAUSSIAN   >::Calculate( accumulator, accumulator, accumulator, m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
-				case GTSVM_KERNEL_POLYNOMIAL: { value = Kernel< GTSVM_KERNEL_POLYNOMIAL >::Calculate( accumulator, accumulator, accumulator, m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
-				case GTSVM_KERNEL_SIGMOID:    { value = Kernel< GTSVM_KERNEL_SIGMOID    >::Calculate( accumulator, accumulator, accumulator, m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
-				default: throw std::runtime_error( "Unknown kernel" );
-			}
+// finds the MinHash signatures of the given rows, sorted so that rows which share nonzero columns tend to be adjacent
+static void SVM_MinHashSignatures(
+	std::vector< SVM_MinHashSignature >* const pSignatures,
+	SparseMatrix const& vectors,
+	unsigned int const rows
+)
+{
+	// rows with no nonzeros keep the largest possible signature, and so all end up at the end
+	pSignatures->resize( rows );
+	for ( unsigned int ii = 0; ii < rows; ++ii ) {
 
-			m_trainingVectorNormsSquared[       ii ] = accumulator;
-			m_trainingVectorKernelNormsSquared[ ii ] = value;
-		}
+		SVM_MinHashSignature& signature = ( *pSignatures )[ ii ];
+		std::fill( signature.hashes, signature.hashes + ARRAYLENGTH( signature.hashes ), static_cast< boost::uint32_t >( -1 ) );
+		signature.index = ii;
 
-		ClusterTrainingVectors( smallClusters, activeClusters );
+		SparseMatrix::const_iterator jj    = vectors.Begin( ii );
+		SparseMatrix::const_iterator jjEnd = vectors.End( ii );
+		for ( ; jj != jjEnd; ++jj )
+			for ( unsigned int kk = 0; kk < ARRAYLENGTH( signature.hashes ); ++kk )
+				signature.hashes[ kk ] = std::min( signature.hashes[ kk ], SVM_MinHash( jj.Index(), kk ) );
 	}
-	catch( ... ) {
 
-		Deinitialize();    // try to keep this structure in a valid state, if possible
-		throw;
-	}
+	std::sort( pSignatures->begin(), pSignatures->end() );
 }
 
 
-void SVM::Save( char const* const filename ) const {
 
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
 
-	const_cast< SVM* >( this )->UpdateResponses();
-	BOOST_ASSERT( m_updatedResponses );
+//============================================================================
+//    SVM_AppendClusters helper function
+//============================================================================
 
-	FILE* file = fopen( filename, "wb" );
-	if ( file == NULL )
-		throw std::runtime_error( "Unable to open file" );
 
-	if ( fwrite( &m_rows, sizeof( m_rows ), 1, file ) != 1 )
-		throw std::runtime_error( "Unable to write rows" );
-	if ( fwrite( &m_columns, sizeof( m_columns ), 1, file ) != 1 )
-		throw std::runtime_error( "Unable to write columns" );
-	if ( fwrite( &m_classes, sizeof( m_classes ), 1, file ) != 1 )
-		throw std::runtime_error( "Unable to write number of classes" );
+/*
+	cuts the given rows, in order, into clusters of the maximum size, which
+	are appended to *pClusterIndices, and their sorted nonzero columns to
+	*pClusterNonzeroIndices
+*/
+static void SVM_AppendClusters(
+	std::vector< std::vector< unsigned int > >* const pClusterIndices,
+	std::vector< std::vector< unsigned int > >* const pClusterNonzeroIndices,
+	SparseMatrix const& vectors,
+	unsigned int const columns,
+	std::vector< unsigned int > const& rows,
+	unsigned int const logMaximumClusterSize
+)
+{
+	unsigned int const size = rows.size();
+	unsigned int const clusters = ( ( size + ( ( 1u << logMaximumClusterSize ) - 1 ) ) >> logMaximumClusterSize );
 
-	for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+	// the last cluster in which each column was found to be nonzero, plus one
+	std::vector< unsigned int > columnClusters( columns, 0 );
+	for ( unsigned int ii = 0; ii < clusters; ++ii ) {
 
-		boost::uint32_t const size = m_trainingVectors[ ii ].size();
-		if ( fwrite( &size, sizeof( boost::uint32_t ), 1, file ) != 1 )
-			throw std::runtime_error( "Unable to write training vector size" );
+		unsigned int const begin = ( ii << logMaximumClusterSize );
+		unsigned int const end = std::min( size, begin + ( 1u << logMaximumClusterSize ) );
 
-		SparseVector::const_iterator jj    = m_trainingVectors[ ii ].begin();
-		SparseVector::const_iterator jjEnd = m_trainingVectors[ ii ].end();
-		for ( ; jj != jjEnd; ++jj ) {
+		pClusterIndices->push_back( std::vector< unsigned int >() );
+		std::vector< unsigned int >& clusterIndices = pClusterIndices->back();
+		clusterIndices.reserve( end - begin );
 
-			boost::uint32_t const index = jj->first;
-			float const value = jj->second;
-			if ( fwrite( &index, sizeof( boost::uint32_t ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to write training vector nonzero index" );
-			if ( fwrite( &value, sizeof( float ), 1, file ) != 1 )
-				throw std::runtime_error( "Unable to write training vector nonzero value" );
-		}
-	}
+		pClusterNonzeroIndices->push_back( std::vector< unsigned int >() );
+		std::vector< unsigned int >& clusterNonzeroIndices = pClusterNonzeroIndices->back();
 
-	if ( fwrite( m_trainingLabels.get(), sizeof( boost::int32_t ), m_rows, file ) != m_rows )
-		throw std::runtime_error( "Unable to write training labels" );
+		for ( unsigned int jj = begin; jj < end; ++jj ) {
 
-	if ( fwrite( m_trainingResponses.get(), sizeof( double ), m_rows * m_classes, file ) != m_rows * m_classes )
-		throw std::runtime_error( "Unable to write training responses" );
-	if ( fwrite( m_trainingAlphas.get(), sizeof( float ), m_rows * m_classes, file ) != m_rows * m_classes )
-		throw std::runtime_error( "Unable to write training alphas" );
+			unsigned int const index = rows[ jj ];
+			clusterIndices.push_back( index );
 
-	if ( fwrite( &m_regularization, sizeof( float ), 1, file ) != 1 )
-		throw std::runtime_error( "Unable to write regularization parameter" );
-	{	boost::int32_t const kernel = m_kernel;
-		if ( fwrite( &kernel, sizeof( boost::int32_t ), 1, file ) != 1 )
-			throw std::runtime_error( "Unable to write kernel" );
-	}
-	if ( fwrite( &m_kernelParameter1, sizeof( float ), 1, file ) != 1 )
-		throw std::runtime_error( "Unable to write first kernel parameter" );
-	if ( fwrite( &m_kernelParameter2, sizeof( float ), 1, file ) != 1 )
-		throw std::runtime_error( "Unable to write second kernel parameter" );
-	if ( fwrite( &m_kernelParameter3, sizeof( float ), 1, file ) != 1 )
-		throw std::runtime_error( "Unable to write third kernel parameter" );
-	if ( fwrite( &m_biased, sizeof( bool ), 1, file ) != 1 )
-		throw std::runtime_error( "Unable to write biased flag" );
-	if ( fwrite( &m_bias, sizeof( float ), 1, file ) != 1 )
-		throw std::runtime_error( "Unable to write bias" );
+			SparseMatrix::const_iterator kk    = vectors.Begin( index );
+			SparseMatrix::const_iterator kkEnd = vectors.End( index );
+			for ( ; kk != kkEnd; ++kk ) {
 
-	fclose( file );
+				if ( columnClusters[ kk.Index() ] != ii + 1 ) {
+
+					columnClusters[ kk.Index() ] = ii + 1;
+					clusterNonzeroIndices.push_back( kk.Index() );
+				}
+			}
+		}
+		std::sort( clusterNonzeroIndices.begin(), clusterNonzeroIndices.end() );
+	}
 }
 
 
-void SVM::Shrink( bool const smallClusters, unsigned int const activeClusters ) {
 
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
-	DeinitializeDevice();
-	BOOST_ASSERT( m_updatedResponses );
 
-	m_clusterIndices.clear();
-	m_clusterNonzeroIndices.clear();
+//============================================================================
+//    SVM_IdentityIndices helper function
+//============================================================================
 
-	unsigned int rows = 0;
-	for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
 
-		bool zero = true;
-		for ( unsigned int jj = 0; jj < m_classes; ++jj ) {
+static inline boost::shared_array< boost::uint32_t > const SVM_IdentityIndices( size_t const size ) {
 
-			if ( m_trainingAlphas[ ii * m_classes + jj ] != 0 ) {
+	boost::shared_array< boost::uint32_t > result( new boost::uint32_t[ size ] );
+	for ( size_t ii = 0; ii < size; ++ii )
+		result[ ii ] = ii;
+	return result;
+}
 
-				zero = false;
-				break;
-			}
-		}
 
-		if ( ! zero )
-			++rows;
-	}
 
-	boost::shared_array< SparseVector > trainingVectors( new SparseVector[ rows ] );
-	boost::shared_array< boost::int32_t > trainingLabels( new boost::int32_t[ rows ] );
-	boost::shared_array< float > trainingVectorNormsSquared( new float[ rows ] );
-	boost::shared_array< float > trainingVectorKernelNormsSquared( new float[ rows ] );
-	boost::shared_array< double > trainingResponses( new double[ rows * m_classes ] );
-	boost::shared_array< float > trainingAlphas( new float[ rows * m_classes ] );
 
-	{	unsigned int kk = 0;
-		for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+//============================================================================
+//    SVM_InputColumns helper function
+//============================================================================
 
-			bool zero = true;
-			for ( unsigned int jj = 0; jj < m_classes; ++jj ) {
 
-				if ( m_trainingAlphas[ ii * m_classes + jj ] != 0 ) {
+// copies the given rows, with each column index replaced by that of the corresponding input column
+static void SVM_InputColumns(
+	SparseMatrix* const pDestination,
+	SparseMatrix const& source,
+	unsigned int const rows,
+	boost::uint32_t const* const columnInputIndices,
+	unsigned int const columns
+)
+{
+	pDestination->Clear();
+	pDestination->Reserve( rows, source.GetNonzeros() );
+	for ( unsigned int ii = 0; ii < rows; ++ii )
+		pDestination->AppendRow( source, ii );
+	pDestination->Renumber( std::vector< boost::uint32_t >( columnInputIndices, columnInputIndices + columns ) );
+}
 
-					zero = false;
-					break;
-				}
-			}
 
-			if ( ! zero ) {
 
-				trainingVectors[                  kk ] = m_trainingVectors[                  ii ];
-				trainingLabels[                   kk ] = m_trainingLabels[                   ii ];
-				trainingVectorNormsSquared[       kk ] = m_trainingVectorNormsSquared[       ii ];
-				trainingVectorKernelNormsSquared[ kk ] = m_trainingVectorKernelNormsSquared[ ii ];
-				for ( unsigned int jj = 0; jj < m_classes; ++jj ) {
 
-					if ( m_trainingAlphas[ ii * m_classes + jj ] != 0 ) {
+//============================================================================
+//    SVM_WorkSize helper function
+//============================================================================
 
-						trainingResponses[ kk * m_classes + jj ] = m_trainingResponses[ ii * m_classes + jj ];
-						trainingAlphas[    kk * m_classes + jj ] = m_trainingAlphas[    ii * m_classes + jj ];
-					}
-				}
-				++kk;
-			}
-		}
-		BOOST_ASSERT( kk == rows );
-	}
 
-	m_rows = rows;
-	m_trainingVectors                  = trainingVectors;
-	m_trainingLabels                   = trainingLabels;
-	m_trainingVectorNormsSquared       = trainingVectorNormsSquared;
-	m_trainingVectorKernelNormsSquared = trainingVectorKernelNormsSquared;
-	m_trainingResponses                = trainingResponses;
-	m_trainingAlphas                   = trainingAlphas;
+// the size of each of the device work buffers
+static inline size_t SVM_WorkSize( size_t const clusters, size_t const classes, unsigned int const logMaximumClusterSize, unsigned int const logBatchSize ) {
 
-	ClusterTrainingVectors( smallClusters, activeClusters );
+	size_t result = std::max(
+		( ( clusters + 15 ) >> 4 ) * std::max( sizeof( CUDA_FLOAT_DOUBLE ), sizeof( boost::uint32_t ) ),
+		( ( ( clusters + 31 ) >> 5 ) << 9 ) * std::max( sizeof( float ), sizeof( boost::uint32_t ) )
+	);
+	BOOST_ASSERT( ( logMaximumClusterSize == 4 ) || ( logMaximumClusterSize == 8 ) );
+	if ( logMaximumClusterSize == 4 )
+		result = std::max( result, ( clusters << 8 ) * sizeof( CUDA_FLOAT_DOUBLE ) );
+	else if ( logMaximumClusterSize == 8 )
+		result = std::max( result, ( ( clusters * classes ) << 12 ) * sizeof( CUDA_FLOAT_DOUBLE ) );
+	result = std::max( result, ( classes << logBatchSize ) * sizeof( CUDA_FLOAT_DOUBLE ) );
+	return result;
 }
 
 
-void SVM::DeinitializeDevice() {
 
-	if ( m_initializedDevice ) {
 
-		UpdateResponses();
-		BOOST_ASSERT( m_updatedResponses );
+//============================================================================
+//    SVM_ScratchClusters helper function
+//============================================================================
 
-		BOOST_ASSERT( m_initializedHost );
-		m_initializedDevice = false;
 
-		for ( unsigned int ii = 0; ii < ARRAYLENGTH( m_deviceWork ); ++ii ) {
+/*
+	The number of clusters which one batch fills. This many scratch clusters,
+	which contain nothing but alphas, follow the real ones on the device, for
+	the sake of SVM::UpdateShrunkResponses()
+*/
+static inline unsigned int const SVM_ScratchClusters( unsigned int const logMaximumClusterSize, unsigned int const logBatchSize ) {
 
-			if ( m_deviceWork[ ii ] != NULL ) {
+	return( ( ( 1u << logBatchSize ) + ( 1u << logMaximumClusterSize ) - 1 ) >> logMaximumClusterSize );
+}
 
-				CUDA_VERIFY( "Failed to free work on device", cudaFree( m_deviceWork[ ii ] ) );
-				m_deviceWork[ ii ] = NULL;
-			}
-		}
 
-		if ( m_batchVectorsTranspose != NULL ) {
+static inline void SVM_ScratchClusterHeaders(
+	CUDA::SparseKernelClusterHeader* const clusterHeaders,
+	float* const deviceScratchAlphas,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const logBatchSize
+)
+{
+	unsigned int const scratchClusters = SVM_ScratchClusters( logMaximumClusterSize, logBatchSize );
+	for ( unsigned int ii = 0; ii < scratchClusters; ++ii ) {
 
-			CUDA_VERIFY( "Failed to free batch vectors on host", cudaFreeHost( m_batchVectorsTranspose ) );
-			m_batchVectorsTranspose = NULL;
-		}
-		if ( m_deviceBatchVectorsTranspose != NULL ) {
+		std::memset( clusterHeaders + ii, 0, sizeof( CUDA::SparseKernelClusterHeader ) );
+		clusterHeaders[ ii ].alphas = deviceScratchAlphas + ( ii << logMaximumClusterSize );
+	}
+}
 
-			CUDA_VERIFY( "Failed to free batch vectors on device", cudaFree( m_deviceBatchVectorsTranspose ) );
-			m_deviceBatchVectorsTranspose = NULL;
-		}
 
-		if ( m_batchResponses != NULL ) {
 
-			CUDA_VERIFY( "Failed to free batch responses on host", cudaFreeHost( m_batchResponses ) );
-			m_batchResponses = NULL;
-		}
-		if ( m_deviceBatchResponses != NULL ) {
 
-			CUDA_VERIFY( "Failed to free batch responses on device", cudaFree( m_deviceBatchResponses ) );
-			m_deviceBatchResponses = NULL;
-		}
+//============================================================================
+//    SVM_BatchUpdateSize helper function
+//============================================================================
 
-		if ( m_batchAlphas != NULL ) {
 
-			CUDA_VERIFY( "Failed to free batch alphas on host", cudaFreeHost( m_batchAlphas ) );
-			m_batchAlphas = NULL;
-		}
-		if ( m_deviceBatchAlphas != NULL ) {
+/*
+	The number of entries of the batch which may be listed (and uploaded
+	individually) before we give up, and upload the whole thing. This is
+	enough for two batches of the longest training vectors, with room to
+	spare, but no more than half of the batch, since listed entries take
+	twice the space
+*/
+static inline unsigned int const SVM_BatchUpdateSize( SparseMatrix const& vectors, unsigned int const rows, unsigned int const columns, unsigned int const logBatchSize ) {
 
-			CUDA_VERIFY( "Failed to free batch alphas on device", cudaFree( m_deviceBatchAlphas ) );
-			m_deviceBatchAlphas = NULL;
-		}
+	unsigned int maximumSize = 0;
+	for ( unsigned int ii = 0; ii < rows; ++ii )
+		maximumSize = std::max( maximumSize, vectors.GetSize( ii ) );
+	return std::max( 1u, static_cast< unsigned int >( std::min( static_cast< unsigned long long >( maximumSize ) << ( logBatchSize + 2 ), static_cast< unsigned long long >( columns ) << ( logBatchSize - 1 ) ) ) );
+}
 
-		if ( m_batchIndices != NULL ) {
 
-			CUDA_VERIFY( "Failed to free batch indices on host", cudaFreeHost( m_batchIndices ) );
-			m_batchIndices = NULL;
-		}
-		if ( m_deviceBatchIndices != NULL ) {
 
-			CUDA_VERIFY( "Failed to free batch indices on device", cudaFree( m_deviceBatchIndices ) );
-			m_deviceBatchIndices = NULL;
-		}
 
-		if ( m_deviceTrainingLabels != NULL ) {
+//============================================================================
+//    SVM_CheckKernel helper function
+//============================================================================
 
-			CUDA_VERIFY( "Failed to free training labels on device", cudaFree( m_deviceTrainingLabels ) );
-			m_deviceTrainingLabels = NULL;
-		}
-		if ( m_deviceTrainingVectorNormsSquared != NULL ) {
 
-			CUDA_VERIFY( "Failed to free training vector squared norms on device", cudaFree( m_deviceTrainingVectorNormsSquared ) );
-			m_deviceTrainingVectorNormsSquared = NULL;
-		}
-		if ( m_deviceTrainingVectorKernelNormsSquared != NULL ) {
+static void SVM_CheckKernel( GTSVM_Kernel const kernel, float const kernelParameter1, float const kernelParameter2, float const kernelParameter3 ) {
 
-			CUDA_VERIFY( "Failed to free training vector kernel squared norms on device", cudaFree( m_deviceTrainingVectorKernelNormsSquared ) );
-			m_deviceTrainingVectorKernelNormsSquared = NULL;
-		}
-		if ( m_deviceTrainingResponses != NULL ) {
+	switch( kernel ) {
 
-			CUDA_VERIFY( "Failed to free training responses on device", cudaFree( m_deviceTrainingResponses ) );
-			m_deviceTrainingResponses = NULL;
-		}
-		if ( m_deviceTrainingAlphas != NULL ) {
+		case GTSVM_KERNEL_GAUSSIAN: {
 
-			CUDA_VERIFY( "Failed to free training alphas on device", cudaFree( m_deviceTrainingAlphas ) );
-			m_deviceTrainingAlphas = NULL;
+			if ( boost::math::isinf( kernelParameter1 ) )
+				throw std::runtime_error( "The first kernel parameter must be finite" );
+			if ( boost::math::isnan( kernelParameter1 ) )
+				throw std::runtime_error( "The first kernel parameter cannot be NaN" );
+			if ( kernelParameter1 <= 0 )
+				throw std::runtime_error( "The first kernel parameter must be positive" );
+			break;
 		}
-		if ( m_deviceNonzeroIndices != NULL ) {
 
-			CUDA_VERIFY( "Failed to nonzero indices on device", cudaFree( m_deviceNonzeroIndices ) );
-			m_deviceNonzeroIndices = NULL;
-		}
-		if ( m_deviceTrainingVectorsTranspose != NULL ) {
+		case GTSVM_KERNEL_POLYNOMIAL: {
 
-			CUDA_VERIFY( "Failed to free training vectors on device", cudaFree( m_deviceTrainingVectorsTranspose ) );
-			m_deviceTrainingVectorsTranspose = NULL;
+			if ( boost::math::isinf( kernelParameter1 ) )
+				throw std::runtime_error( "The first kernel parameter must be finite" );
+			if ( boost::math::isnan( kernelParameter1 ) )
+				throw std::runtime_error( "The first kernel parameter cannot be NaN" );
+			if ( boost::math::isinf( kernelParameter2 ) )
+				throw std::runtime_error( "The second kernel parameter must be finite" );
+			if ( boost::math::isnan( kernelParameter2 ) )
+				throw std::runtime_error( "The second kernel parameter cannot be NaN" );
+			if ( boost::math::isinf( kernelParameter3 ) )
+				throw std::runtime_error( "The third kernel parameter must be finite" );
+			if ( boost::math::isnan( kernelParameter3 ) )
+				throw std::runtime_error( "The third kernel parameter cannot be NaN" );
+			if ( kernelParameter3 <= 0 )
+				throw std::runtime_error( "The third kernel parameter must be positive" );
+			break;
 		}
-		if ( m_deviceClusterHeaders != NULL ) {
 
-			CUDA_VERIFY( "Failed to free cluster headers on device", cudaFree( m_deviceClusterHeaders ) );
-			m_deviceTrainingAlphas = NULL;
-		}
-		if ( m_deviceClusterSizeSums != NULL ) {
+		case GTSVM_KERNEL_SIGMOID: {
 
-			CUDA_VERIFY( "Failed to free cluster size sums on device", cudaFree( m_deviceClusterSizeSums ) );
-			m_deviceTrainingAlphas = NULL;
+			if ( boost::math::isinf( kernelParameter1 ) )
+				throw std::runtime_error( "The first kernel parameter must be finite" );
+			if ( boost::math::isnan( kernelParameter1 ) )
+				throw std::runtime_error( "The first kernel parameter cannot be NaN" );
+			if ( boost::math::isinf( kernelParameter2 ) )
+				throw std::runtime_error( "The second kernel parameter must be finite" );
+			if ( boost::math::isnan( kernelParameter2 ) )
+				throw std::runtime_error( "The second kernel parameter cannot be NaN" );
+			break;
 		}
+
+		default: throw std::runtime_error( "Unknown kernel" );
 	}
 }
 
 
-void SVM::Deinitialize() {
 
-	DeinitializeDevice();
-	BOOST_ASSERT( ! m_initializedDevice );
 
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
-	m_initializedHost = false;
+//============================================================================
+//    SVM_ShareClusters helper function
+//============================================================================
 
-	m_trainingVectors = boost::shared_array< SparseVector >();
-	m_trainingLabels = boost::shared_array< boost::int32_t >();
-	m_trainingVectorNormsSquared = boost::shared_array< float >();
-	m_trainingVectorKernelNormsSquared = boost::shared_array< float >();
 
-	m_trainingResponses = boost::shared_array< double >();
-	m_trainingAlphas = boost::shared_array< float >();
+/*
+	Moves the contents of the given vector (which is left empty) into a new
+	immutable one. A cluster layout is only ever replaced, never changed in
+	place, so that it may be shared with other contexts
+*/
+static inline boost::shared_ptr< std::vector< std::vector< unsigned int > > const > SVM_ShareClusters( std::vector< std::vector< unsigned int > >* const pClusters ) {
 
-	m_clusterIndices.clear();
-	m_clusterNonzeroIndices.clear();
+	boost::shared_ptr< std::vector< std::vector< unsigned int > > > result( new std::vector< std::vector< unsigned int > > );
+	result->swap( *pClusters );
+	return result;
 }
 
 
-void SVM::GetTrainingVectorsSparse(
-	void* const trainingVectors,    // order depends on the columnMajor flag
-	size_t* const trainingVectorIndices,
-	size_t* const trainingVectorOffsets,
-	GTSVM_Type trainingVectorsType,
-	bool const columnMajor
-) const
-{
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
 
-	SVM_SparseSparseReverseMemcpy2d(
-		trainingVectors,
-		trainingVectorIndices,
-		trainingVectorOffsets,
-		trainingVectorsType,
-		m_trainingVectors.get(),
-		m_rows,
-		m_columns,
-		columnMajor
-	);
-}
 
+//============================================================================
+//    SVM_NextDeviceGeneration helper function
+//============================================================================
 
-void SVM::GetTrainingVectorsDense(
-	void* const trainingVectors,    // order depends on the columnMajor flag
-	GTSVM_Type trainingVectorsType,
-	bool const columnMajor
-) const
-{
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
 
-	SVM_SparseReverseMemcpy2d(
-		trainingVectors,
-		trainingVectorsType,
-		m_trainingVectors.get(),
-		m_rows,
-		m_columns,
-		columnMajor
-	);
-}
+boost::atomic< unsigned int > g_deviceGeneration( 0 );
 
 
-void SVM::GetTrainingLabels(
-	void* const trainingLabels,
-	GTSVM_Type trainingLabelsType
-) const
-{
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
+/*
+	Numbers the initializations of every SVM's device buffers, so that a
+	session can tell whether it was allocated for the current ones, without
+	referring to the SVM which it was last used with
+*/
+static inline unsigned int const SVM_NextDeviceGeneration() {
 
-	SVM_ReverseMemcpy(
-		trainingLabels,
-		0,
-		trainingLabelsType,
-		m_trainingLabels.get(),
-		m_rows
-	);
+	return ++g_deviceGeneration;
 }
 
 
-void SVM::GetTrainingResponses(
-	void* const trainingResponses,
-	GTSVM_Type trainingResponsesType,
-	bool const columnMajor
-) const
-{
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
 
-	const_cast< SVM* >( this )->UpdateResponses();
-	BOOST_ASSERT( m_updatedResponses );
 
-	SVM_ReverseMemcpy2d(
-		trainingResponses,
-		trainingResponsesType,
-		m_trainingResponses.get(),
-		m_rows,
-		m_classes,
-		columnMajor
-	);
-}
+}    // anonymous namespace
 
 
-void SVM::GetAlphas(
-	void* const trainingAlphas,
-	GTSVM_Type trainingAlphasType,
-	bool const columnMajor
-) const
+
+
+//============================================================================
+//    BatchVectors methods
+//============================================================================
+
+
+BatchVectors::BatchVectors() :
+	m_columns( 0 ),
+	m_logBatchSize( 0 ),
+	m_updateSize( 0 ),
+	m_previousUpdates( 0 ),
+	m_untracked( true ),
+	m_uploadAll( true ),
+	m_transpose( NULL ),
+	m_deviceTranspose( NULL ),
+	m_deviceUpdateIndices( NULL ),
+	m_deviceUpdateValues( NULL )
 {
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
+}
 
-	SVM_ReverseMemcpy2d(
-		trainingAlphas,
-		trainingAlphasType,
-		m_trainingAlphas.get(),
-		m_rows,
-		m_classes,
-		columnMajor
-	);
+
+BatchVectors::~BatchVectors() {
+
+	Cleanup();
 }
 
 
-void SVM::SetAlphas(
-	void const* const trainingAlphas,
-	GTSVM_Type trainingAlphasType,
-	bool const columnMajor
+void BatchVectors::Allocate(
+	boost::shared_ptr< Backend > const& backend,
+	boost::uint32_t const columns,
+	unsigned int const logBatchSize,
+	unsigned int const updateSize
 )
 {
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
-	DeinitializeDevice();
+	Cleanup();
 
-	SVM_Memcpy2d(
-		m_trainingAlphas.get(),
-		trainingAlphas,
-		trainingAlphasType,
-		m_rows,
-		m_classes,
-		columnMajor
-	);
+	m_backend = backend;
+	m_columns = columns;
+	m_logBatchSize = logBatchSize;
+	m_updateSize = updateSize;
 
-	Recalculate();
-}
+	// the transpose is uninitialized, so the first batch clears, and uploads, all of it
+	m_previousUpdates = 0;
+	m_untracked = true;
+	m_uploadAll = true;
 
+	try {
 
-void SVM::Recalculate() {
+		m_updateIndices.reserve( m_updateSize + 1 );
 
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
-	if ( ! m_initializedDevice )
-		InitializeDevice();
-	BOOST_ASSERT( m_initializedDevice );
+		m_backend->HostAllocate(
+			"Failed to allocate space for batch vectors on host",
+			&m_transpose, ( m_columns << m_logBatchSize ) * sizeof( float )
+		);
+		m_backend->MirrorAllocate(
+			"Failed to allocate space for batch vectors on device",
+			m_transpose, &m_deviceTranspose, ( m_columns << m_logBatchSize ) * sizeof( float )
+		);
 
-	for ( unsigned int ii = 0; ii < m_rows; ii += 16 ) {
+		// sparse batches are only uploaded entry-by-entry if the device memory is separate
+		if ( ! m_backend->IsHostMemory() ) {
 
-		unsigned int const batchSize = std::min( 16u, m_rows - ii );
+			m_updateValues.reserve( m_updateSize );
 
-		for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
+			m_backend->DeviceAllocate(
+				"Failed to allocate space for batch update indices on device",
+				&m_deviceUpdateIndices, m_updateSize * sizeof( boost::uint32_t )
+			);
+			m_backend->DeviceAllocate(
+				"Failed to allocate space for batch update values on device",
+				&m_deviceUpdateValues, m_updateSize * sizeof( float )
+			);
+		}
+	}
+	catch( ... ) {
 
-			unsigned int ll = 0;
-			SparseVector::const_iterator kk    = m_trainingVectors[ ii + jj ].begin();
-			SparseVector::const_iterator kkEnd = m_trainingVectors[ ii + jj ].end();
-			for ( ; kk != kkEnd; ++kk ) {
+		Cleanup();
+		throw;
+	}
+}
 
-				BOOST_ASSERT( kk->first < m_columns );
-				for ( ; ll < kk->first; ++ll )
-					m_batchVectorsTranspose[ ll * 16 + jj ] = 0;
-				m_batchVectorsTranspose[ ll * 16 + jj ] = kk->second;
-				++ll;
-			}
-			for ( ; ll < m_columns; ++ll )
-				m_batchVectorsTranspose[ ll * 16 + jj ] = 0;
 
-			m_batchVectorNormsSquared[ jj ] = m_trainingVectorNormsSquared[ ii + jj ];
-		}
+void BatchVectors::Cleanup() {
 
-		CUDA_VERIFY(
-			"Failed to copy batch to device",
-			cudaMemcpy(
-				m_deviceBatchVectorsTranspose,
-				m_batchVectorsTranspose,
-				( m_columns << 4 ) * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
-		);
+	if ( m_deviceUpdateValues != NULL ) {
 
-		CUDA_VERIFY(
-			"Failed to copy batch squared norms to device",
-			cudaMemcpy(
-				m_deviceBatchVectorNormsSquared,
-				m_batchVectorNormsSquared,
-				batchSize * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
-		);
+		m_backend->DeviceFree( "Failed to free batch update values on device", m_deviceUpdateValues );
+		m_deviceUpdateValues = NULL;
+	}
+	if ( m_deviceUpdateIndices != NULL ) {
 
-		CUDA_FLOAT_DOUBLE const* const deviceResult = CUDA::SparseEvaluateKernel(
-			m_deviceWork[ 0 ],
-			m_deviceWork[ 1 ],
-			m_deviceBatchVectorsTranspose,
-			m_deviceBatchVectorNormsSquared,
-			m_deviceClusterHeaders,
-			m_logMaximumClusterSize,
-			m_clusters,
-			m_classes,
-			m_workSize,
-			m_kernel,
-			m_kernelParameter1,
-			m_kernelParameter2,
-			m_kernelParameter3
-		);
+		m_backend->DeviceFree( "Failed to free batch update indices on device", m_deviceUpdateIndices );
+		m_deviceUpdateIndices = NULL;
+	}
 
-		CUDA_VERIFY(
-			"Failed to copy responses from device",
-			cudaMemcpy(
-				m_batchResponses,
-				deviceResult,
-				batchSize * m_classes * sizeof( CUDA_FLOAT_DOUBLE ),
-				cudaMemcpyDeviceToHost
-			)
-		);
+	if ( m_deviceTranspose != NULL ) {
 
-		for ( unsigned int jj = 0; jj < batchSize; ++jj )
-			for ( unsigned int kk = 0; kk < m_classes; ++kk )
-				m_trainingResponses[ ( ii + jj ) * m_classes + kk ] = m_batchResponses[ kk * 16 + jj ];
+		m_backend->MirrorFree( "Failed to free batch vectors on device", m_transpose, m_deviceTranspose );
+		m_deviceTranspose = NULL;
 	}
+	if ( m_transpose != NULL ) {
 
-	{	CUDA_FLOAT_DOUBLE* trainingResponses;
-		CUDA_VERIFY(
-			"Failed to allocate space for training responses on host",
-			cudaMallocHost( &trainingResponses, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ) )
-		);
+		m_backend->HostFree( "Failed to free batch vectors on host", m_transpose );
+		m_transpose = NULL;
+	}
 
-		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+	m_updateIndices.clear();
+	m_updateValues.clear();
+}
 
-			unsigned int const size = m_clusterIndices[ ii ].size();
-			for ( unsigned int jj = 0; jj < size; ++jj )
-				for ( unsigned int kk = 0; kk < m_classes; ++kk )
-					trainingResponses[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = m_trainingResponses[ m_clusterIndices[ ii ][ jj ] * m_classes + kk ];
-			for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
-				for ( unsigned int kk = 0; kk < m_classes; ++kk )
-					trainingResponses[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = 0;
-		}
-		CUDA_VERIFY(
-			"Failed to copy training responses to device",
-			cudaMemcpy(
-				m_deviceTrainingResponses,
-				trainingResponses,
-				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ),
-				cudaMemcpyHostToDevice
-			)
-		);
 
-		CUDA_VERIFY( "Failed to free training responses on host", cudaFreeHost( trainingResponses ) );
+void BatchVectors::Begin() {
+
+	BOOST_ASSERT( m_transpose != NULL );
+
+	if ( m_untracked ) {
+
+		std::fill( m_transpose, m_transpose + ( m_columns << m_logBatchSize ), 0.0f );
+		m_updateIndices.clear();
+		m_untracked = false;
+		m_uploadAll = true;
 	}
-	m_updatedResponses = true;
+	else {
 
-	if ( m_biased ) {
+		for ( unsigned int ii = 0; ii < m_updateIndices.size(); ++ii )
+			m_transpose[ m_updateIndices[ ii ] ] = 0;
+	}
+	m_previousUpdates = m_updateIndices.size();
+}
 
-		if ( m_classes != 1 )
-			throw std::runtime_error( "Multiclass is only implemented for problems without an unregularized bias" );
 
-		CUDA_FLOAT_DOUBLE numerator = 0;
-		boost::uint32_t denominator = 0;
-		std::pair< CUDA_FLOAT_DOUBLE const*, boost::uint32_t const* > const deviceResult = CUDA::SparseCalculateBias(
-			m_deviceWork[ 0 ],
-			m_deviceWork[ 1 ],
-			m_deviceWork[ 2 ],
-			m_deviceWork[ 3 ],
-			m_deviceClusterHeaders,
-			m_logMaximumClusterSize,
-			m_clusters,
-			m_workSize,
-			m_regularization
+float* const BatchVectors::BeginDense() {
+
+	BOOST_ASSERT( m_transpose != NULL );
+
+	m_updateIndices.clear();
+	m_previousUpdates = 0;
+	m_untracked = true;
+	m_uploadAll = true;
+
+	return m_transpose;
+}
+
+
+void BatchVectors::Upload() {
+
+	BOOST_ASSERT( m_transpose != NULL );
+
+	if ( m_uploadAll ) {
+
+		m_backend->CopyToDevice(
+			"Failed to copy batch to device",
+			m_deviceTranspose,
+			m_transpose,
+			( m_columns << m_logBatchSize ) * sizeof( float )
 		);
-		CUDA_VERIFY(
-			"Failed to copy bias numerator from device",
-			cudaMemcpy(
-				&numerator,
-				deviceResult.first,
-				sizeof( CUDA_FLOAT_DOUBLE ),
-				cudaMemcpyDeviceToHost
-			)
+		m_uploadAll = false;
+	}
+	else if ( ( m_deviceTranspose != m_transpose ) && ( ! m_updateIndices.empty() ) ) {
+
+		// the entries written by the previous batch are uploaded as zeros
+		unsigned int const updates = m_updateIndices.size();
+		m_updateValues.resize( updates );
+		for ( unsigned int ii = 0; ii < updates; ++ii )
+			m_updateValues[ ii ] = m_transpose[ m_updateIndices[ ii ] ];
+
+		m_backend->CopyToDevice(
+			"Failed to copy batch update indices to device",
+			m_deviceUpdateIndices,
+			&m_updateIndices[ 0 ],
+			updates * sizeof( boost::uint32_t )
 		);
-		CUDA_VERIFY(
-			"Failed to copy bias denominator from device",
-			cudaMemcpy(
-				&denominator,
-				deviceResult.second,
-				sizeof( boost::uint32_t ),
-				cudaMemcpyDeviceToHost
-			)
+
+		m_backend->CopyToDevice(
+			"Failed to copy batch update values to device",
+			m_deviceUpdateValues,
+			&m_updateValues[ 0 ],
+			updates * sizeof( float )
 		);
 
-		m_bias = ( ( denominator != 0 ) ? ( numerator / denominator ) : 0 );
+		m_backend->ArrayUpdate(
+			m_deviceTranspose,
+			m_deviceUpdateValues,
+			m_deviceUpdateIndices,
+			updates
+		);
 	}
+
+	// the device is now up-to-date, so only this batch's entries will need to be cleared
+	m_updateIndices.erase( m_updateIndices.begin(), m_updateIndices.begin() + m_previousUpdates );
+	m_previousUpdates = 0;
 }
 
 
-void SVM::Restart(
-	float const regularization,
-	GTSVM_Kernel const kernel,
-	float const kernelParameter1,
-	float const kernelParameter2,
-	float const kernelParameter3,
-	bool const biased
-)
+
+
+//============================================================================
+//    Session methods
+//============================================================================
+
+
+Session::Session( boost::shared_ptr< Backend > const& backend ) :
+	m_backend( backend ),
+	m_initialized( false ),
+	m_generation( 0 ),
+	m_columns( 0 ),
+	m_classes( 0 ),
+	m_logBatchSize( 0 ),
+	m_batchVectorNormsSquared( NULL ),
+	m_batchResponses( NULL ),
+	m_deviceBatchVectorNormsSquared( NULL )
 {
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
+	for ( unsigned int ii = 0; ii < ARRAYLENGTH( m_deviceWork ); ++ii )
+		m_deviceWork[ ii ] = NULL;
+}
 
-	if ( boost::math::isinf( regularization ) )
-		throw std::runtime_error( "The regularization parameter must be finite" );
-	if ( boost::math::isnan( regularization ) )
-		throw std::runtime_error( "The regularization parameter cannot be NaN" );
-	if ( regularization <= 0 )
-		throw std::runtime_error( "The regularization parameter must be positive" );
 
-	switch( kernel ) {
+Session::~Session() {
 
-		case GTSVM_KERNEL_GAUSSIAN: {
+	Cleanup();
+}
 
-			if ( boost::math::isinf( kernelParameter1 ) )
-				throw std::runtime_error( "The first kernel parameter must be finite" );
-			if ( boost::math::isnan( kernelParameter1 ) )
-				throw std::runtime_error( "The first kernel parameter cannot be NaN" );
-			if ( kernelParameter1 <= 0 )
-				throw std::runtime_error( "The first kernel parameter must be positive" );
-			break;
-		}
 
-		case GTSVM_KERNEL_POLYNOMIAL: {
+void Session::Cleanup() {
 
-			if ( boost::math::isinf( kernelParameter1 ) )
-				throw std::runtime_error( "The first kernel parameter must be finite" );
-			if ( boost::math::isnan( kernelParameter1 ) )
-				throw std::runtime_error( "The first kernel parameter cannot be NaN" );
-			if ( boost::math::isinf( kernelParameter2 ) )
-				throw std::runtime_error( "The second kernel parameter must be finite" );
-			if ( boost::math::isnan( kernelParameter2 ) )
-				throw std::runtime_error( "The second kernel parameter cannot be NaN" );
-			if ( boost::math::isinf( kernelParameter3 ) )
-				throw std::runtime_error( "The third kernel parameter must be finite" );
-			if ( boost::math::isnan( kernelParameter3 ) )
-				throw std::runtime_error( "The third kernel parameter cannot be NaN" );
-			if ( kernelParameter3 <= 0 )
-				throw std::runtime_error( "The third kernel parameter must be positive" );
-			break;
-		}
+	m_initialized = false;
 
-		case GTSVM_KERNEL_SIGMOID: {
+	for ( unsigned int ii = 0; ii < ARRAYLENGTH( m_deviceWork ); ++ii ) {
 
-			if ( boost::math::isinf( kernelParameter1 ) )
-				throw std::runtime_error( "The first kernel parameter must be finite" );
-			if ( boost::math::isnan( kernelParameter1 ) )
-				throw std::runtime_error( "The first kernel parameter cannot be NaN" );
-			if ( boost::math::isinf( kernelParameter2 ) )
-				throw std::runtime_error( "The second kernel parameter must be finite" );
-			if ( boost::math::isnan( kernelParameter2 ) )
-				throw std::runtime_error( "The second kernel parameter cannot be NaN" );
-			break;
-		}
+		if ( m_deviceWork[ ii ] != NULL ) {
 
-		default: throw std::runtime_error( "Unknown kernel" );
+			m_backend->DeviceFree( "Failed to free work on device", m_deviceWork[ ii ] );
+			m_deviceWork[ ii ] = NULL;
+		}
 	}
 
-	m_regularization = regularization;
-	m_kernel = kernel;
-	m_kernelParameter1 = kernelParameter1;
-	m_kernelParameter2 = kernelParameter2;
-	m_kernelParameter3 = kernelParameter3;
-	m_biased = biased;
+	if ( m_batchResponses != NULL ) {
 
-	m_bias = 0;
+		m_backend->HostFree( "Failed to free batch responses on host", m_batchResponses );
+		m_batchResponses = NULL;
+	}
 
-	for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+	if ( m_deviceBatchVectorNormsSquared != NULL ) {
 
-		double accumulator = 0;
+		m_backend->MirrorFree( "Failed to free batch squared norms on device", m_batchVectorNormsSquared, m_deviceBatchVectorNormsSquared );
+		m_deviceBatchVectorNormsSquared = NULL;
+	}
+	if ( m_batchVectorNormsSquared != NULL ) {
 
-		SparseVector::const_iterator jj    = m_trainingVectors[ ii ].begin();
-		SparseVector::const_iterator jjEnd = m_trainingVectors[ ii ].end();
-		for ( ; jj != jjEnd; ++jj )
-			accumulator += Square( jj->second );
+		m_backend->HostFree( "Failed to free batch squared norms on host", m_batchVectorNormsSquared );
+		m_batchVectorNormsSquared = NULL;
+	}
 
-		double value = std::numeric_limits< double >::quiet_NaN();
-		switch( m_kernel ) {
-			case GTSVM_KERNEL_GAUSSIAN:   { value = Kernel< GTSVM_KERNEL_GAUSSIAN   >::Calculate( accumulator, accumulator, accumulator, m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
-			case GTSVM_KERNEL_POLYNOMIAL: { value = Kernel< GTSVM_KERNEL_POLYNOMIAL >::Calculate( accumulator, accumulator, accumulator, m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
-			case GTSVM_KERNEL_SIGMOID:    { value = Kernel< GTSVM_KERNEL_SIGMOID    >::Calculate( accumulator, accumulator, accumulator, m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
-			default: throw std::runtime_error( "Unknown kernel" );
-		}
+	m_batchVectors.Cleanup();
+}
 
-		m_trainingVectorNormsSquared[       ii ] = accumulator;
-		m_trainingVectorKernelNormsSquared[ ii ] = value;
-	}
 
-	std::fill( m_trainingResponses.get(), m_trainingResponses.get() + m_rows * m_classes, 0 );
-	if ( m_initializedDevice ) {
 
-#if 0
-		// CUDA sometimes thinks that we're trying to clear too large a buffer
-		CUDA_VERIFY(
-			"Failed to clear training responses on device",
-			cudaMemset( &m_deviceTrainingResponses, 0, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ) )
-		);
-#else    // 0/1
-		CUDA_FLOAT_DOUBLE* trainingResponses;
-		CUDA_VERIFY(
-			"Failed to allocate space for training responses on host",
-			cudaMallocHost( &trainingResponses, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ) )
-		);
-		std::fill( trainingResponses, trainingResponses + ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ), 0.0f );
-		CUDA_VERIFY(
-			"Failed to copy training responses to device",
-			cudaMemcpy(
-				m_deviceTrainingResponses,
-				trainingResponses,
-				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ),
-				cudaMemcpyHostToDevice
-			)
-		);
-		CUDA_VERIFY( "Failed to free training responses on host", cudaFreeHost( trainingResponses ) );
-#endif    // 0/1
-	}
-	m_updatedResponses = true;
 
-	std::fill( m_trainingAlphas.get(), m_trainingAlphas.get() + m_rows * m_classes, 0.0f );
-	if ( m_initializedDevice ) {
+//============================================================================
+//    SVM methods
+//============================================================================
 
-#if 0
-		// CUDA sometimes thinks that we're trying to clear too large a buffer
-		CUDA_VERIFY(
-			"Failed to clear training alphas on device",
-			cudaMemset( &m_deviceTrainingAlphas, 0, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float ) )
-		);
-#else    // 0/1
-		float* trainingAlphas;
-		CUDA_VERIFY(
-			"Failed to allocate space for training alphas on host",
-			cudaMallocHost( &trainingAlphas, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float ) )
-		);
-		std::fill( trainingAlphas, trainingAlphas + ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ), 0.0f );
+
+SVM::SVM( GTSVM_Backend const backend ) :
+	m_rawBackend( CreateBackend( backend ) ),
+	m_backend( CreateStatisticsBackend( m_rawBackend, &m_statistics ) ),
+	m_constructed( true ),
+	m_initializedHost( false ),
+	m_initializedDevice( false ),
+	m_updatedResponses( true ),
+	m_deviceGeneration( 0 ),
+	m_logBatchSize( 4 ),
+	m_shrinking( false ),
+	m_shrinkingIterations( 0 ),
+	m_shrunkClusters( 0 ),
+	m_foundKeys( NULL ),
+	m_foundValues( NULL ),
+	m_batchVectorNormsSquared( NULL ),
+	m_batchResponses( NULL ),
+	m_batchAlphas( NULL ),
+	m_batchIndices( NULL ),
+	m_batchUpdateSize( 0 ),
+	m_deviceBatchVectorNormsSquared( NULL ),
+	m_deviceBatchResponses( NULL ),
+	m_deviceBatchAlphas( NULL ),
+	m_deviceBatchIndices( NULL ),
+	m_deviceTrainingLabels( NULL ),
+	m_deviceTrainingVectorNormsSquared( NULL ),
+	m_deviceTrainingVectorKernelNormsSquared( NULL ),
+	m_deviceTrainingResponses( NULL ),
+	m_deviceTrainingAlphas( NULL ),
+	m_deviceNonzeroIndices( NULL ),
+	m_deviceTrainingVectorsTranspose( NULL ),
+	m_deviceClusterHeaders( NULL ),
+	m_deviceClusterSizeSums( NULL ),
+	m_deviceScratchAlphas( NULL )
+{
+	GTSVM::ResetStatistics( &m_statistics );
+
+	for ( unsigned int ii = 0; ii < ARRAYLENGTH( m_deviceWork ); ++ii )
+		m_deviceWork[ ii ] = NULL;
+
+	try {
+
+		m_foundSize = 4096;
+		m_backend->HostAllocate(
+			"Failed to allocate space for found keys on host",
+			&m_foundKeys, m_foundSize * sizeof( float )
+		);
+		m_backend->HostAllocate(
+			"Failed to allocate space for found values on host",
+			&m_foundValues, m_foundSize * sizeof( boost::uint32_t )
+		);
+
+		// there's room for the squared norms of the largest batch
+		m_backend->HostAllocate(
+			"Failed to allocate space for batch squared norms on host",
+			&m_batchVectorNormsSquared, 128 * sizeof( float )
+		);
+		m_backend->MirrorAllocate(
+			"Failed to allocate space for batch squared norms on device",
+			m_batchVectorNormsSquared, &m_deviceBatchVectorNormsSquared, 128 * sizeof( float )
+		);
+
+		m_batchSubmatrix = boost::shared_array< double >( new double[ 1u << ( m_logBatchSize << 1 ) ] );
+	}
+	catch( ... ) {
+
+		Cleanup();    // try to keep this structure in a valid state, if possible
+		throw;
+	}
+}
+
+
+SVM::~SVM() {
+
+	Cleanup();
+}
+
+
+void SVM::InitializeSparse(
+	void const* const trainingVectors,    // order depends on columnMajor flag
+	size_t const* const trainingVectorIndices,
+	size_t const* const trainingVectorOffsets,
+	GTSVM_Type trainingVectorsType,
+	void const* const trainingLabels,
+	GTSVM_Type trainingLabelsType,
+	boost::uint32_t const rows,
+	boost::uint32_t const columns,
+	bool const columnMajor,
+	bool const multiclass,
+	float const regularization,
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3,
+	bool const biased,
+	GTSVM_ColumnOrder const columnOrder,
+	GTSVM_Clustering const clustering,
+	bool const smallClusters,
+	unsigned int const activeClusters
+)
+{
+	if ( ! m_constructed )
+		throw std::runtime_error( "SVM has not been successfully constructed" );
+	if ( m_initializedHost )
+		Deinitialize();
+	BOOST_ASSERT( ! m_initializedDevice );
+	BOOST_ASSERT( ! m_initializedHost );
+	m_initializedHost = true;
+
+	try {
+
+		m_rows = rows;
+		m_columns = columns;
+		m_inputColumns = columns;
+		m_columnInputIndices = SVM_IdentityIndices( m_columns );
+
+		SVM_SparseSparseMemcpy2d( &m_trainingVectors, trainingVectors, trainingVectorIndices, trainingVectorOffsets, trainingVectorsType, m_rows, m_columns, columnMajor );
+		CopyLabels( trainingLabels, trainingLabelsType, multiclass );
+
+		m_trainingVectorNormsSquared       = boost::shared_array< float >( new float[ m_rows ] );
+		m_trainingVectorKernelNormsSquared = boost::shared_array< float >( new float[ m_rows ] );
+		CalculateNorms();
+
+		m_trainingResponses = boost::shared_array< double >( new double[ m_rows * m_classes ] );
+		m_trainingAlphas = boost::shared_array< float >( new float[ m_rows * m_classes ] );
+
+		CompactColumns( columnOrder );
+		ClusterTrainingVectors( clustering, smallClusters, activeClusters );
+
+		Restart( regularization, kernel, kernelParameter1, kernelParameter2, kernelParameter3, biased );
+	}
+	catch( ... ) {
+
+		Deinitialize();    // try to keep this structure in a valid state, if possible
+		throw;
+	}
+}
+
+
+void SVM::InitializeDense(
+	void const* const trainingVectors,    // order depends on columnMajor flag
+	GTSVM_Type trainingVectorsType,
+	void const* const trainingLabels,
+	GTSVM_Type trainingLabelsType,
+	boost::uint32_t const rows,
+	boost::uint32_t const columns,
+	bool const columnMajor,
+	bool const multiclass,
+	float const regularization,
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3,
+	bool const biased,
+	GTSVM_ColumnOrder const columnOrder,
+	GTSVM_Clustering const clustering,
+	bool const smallClusters,
+	unsigned int const activeClusters
+)
+{
+	if ( ! m_constructed )
+		throw std::runtime_error( "SVM has not been successfully constructed" );
+	if ( m_initializedHost )
+		Deinitialize();
+	BOOST_ASSERT( ! m_initializedDevice );
+	BOOST_ASSERT( ! m_initializedHost );
+	m_initializedHost = true;
+
+	try {
+
+		m_rows = rows;
+		m_columns = columns;
+		m_inputColumns = columns;
+		m_columnInputIndices = SVM_IdentityIndices( m_columns );
+
+		SVM_SparseMemcpy2d( &m_trainingVectors, trainingVectors, trainingVectorsType, m_rows, m_columns, columnMajor );
+		CopyLabels( trainingLabels, trainingLabelsType, multiclass );
+
+		m_trainingVectorNormsSquared       = boost::shared_array< float >( new float[ m_rows ] );
+		m_trainingVectorKernelNormsSquared = boost::shared_array< float >( new float[ m_rows ] );
+		CalculateNorms();
+
+		m_trainingResponses = boost::shared_array< double >( new double[ m_rows * m_classes ] );
+		m_trainingAlphas = boost::shared_array< float >( new float[ m_rows * m_classes ] );
+
+		CompactColumns( columnOrder );
+		ClusterTrainingVectors( clustering, smallClusters, activeClusters );
+
+		Restart( regularization, kernel, kernelParameter1, kernelParameter2, kernelParameter3, biased );
+	}
+	catch( ... ) {
+
+		Deinitialize();    // try to keep this structure in a valid state, if possible
+		throw;
+	}
+}
+
+
+void SVM::InitializeShared(
+	SVM& source,
+	void const* const trainingLabels,
+	GTSVM_Type trainingLabelsType,
+	bool const multiclass,
+	float const regularization,
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3,
+	bool const biased
+)
+{
+	if ( ! m_constructed )
+		throw std::runtime_error( "SVM has not been successfully constructed" );
+	if ( &source == this )
+		throw std::runtime_error( "An SVM cannot share its own training data" );
+	if ( ! source.m_initializedHost )
+		throw std::runtime_error( "The SVM whose training data is to be shared has not been initialized" );
+	if ( m_initializedHost )
+		Deinitialize();
+	BOOST_ASSERT( ! m_initializedDevice );
+	BOOST_ASSERT( ! m_initializedHost );
+	m_initializedHost = true;
+
+	try {
+
+		m_rows = source.m_rows;
+		m_columns = source.m_columns;
+		m_inputColumns = source.m_inputColumns;
+		m_columnInputIndices = source.m_columnInputIndices;
+		m_inputColumnIndices = source.m_inputColumnIndices;
+
+		source.m_trainingVectors.Share( &m_trainingVectors );
+		if ( trainingLabels != NULL )
+			CopyLabels( trainingLabels, trainingLabelsType, multiclass );
+		else {
+
+			m_trainingLabels = source.m_trainingLabels;
+			m_classes = source.m_classes;
+		}
+
+		m_trainingVectorNormsSquared       = source.m_trainingVectorNormsSquared;
+		m_trainingVectorKernelNormsSquared = boost::shared_array< float >( new float[ m_rows ] );
+
+		m_trainingResponses = boost::shared_array< double >( new double[ m_rows * m_classes ] );
+		m_trainingAlphas = boost::shared_array< float >( new float[ m_rows * m_classes ] );
+
+		// if the source has shrunk, then its layout is still a partition of the rows, but nothing is shrunk here
+		m_clustering = source.m_clustering;
+		m_logMaximumClusterSize = source.m_logMaximumClusterSize;
+		m_activeClusters = source.m_activeClusters;
+		m_clusters = source.m_clusters;
+		m_shrunkClusters = 0;
+		m_clusterIndices = source.m_clusterIndices;
+		m_clusterNonzeroIndices = source.m_clusterNonzeroIndices;
+
+		Restart( regularization, kernel, kernelParameter1, kernelParameter2, kernelParameter3, biased );
+	}
+	catch( ... ) {
+
+		Deinitialize();    // try to keep this structure in a valid state, if possible
+		throw;
+	}
+}
+
+
+void SVM::Load(
+	char const* const filename,
+	GTSVM_Clustering const clustering,
+	bool const smallClusters,
+	unsigned int const activeClusters
+)
+{
+	if ( ! m_constructed )
+		throw std::runtime_error( "SVM has not been successfully constructed" );
+	if ( m_initializedHost )
+		Deinitialize();
+	BOOST_ASSERT( ! m_initializedDevice );
+	BOOST_ASSERT( ! m_initializedHost );
+	m_initializedHost = true;
+
+	TraceSpan span( "Load" );
+
+	try {
+
+		TraceSpan phase( "Load: read" );
+		if ( IsModelFileVersion2( filename ) )
+			LoadVersion2( filename );
+		else
+			LoadVersion1( filename );
+		phase.Stop();
+
+		/*
+			version 2 files remember their clustering, which we keep if it was
+			found with the same settings (MinHash clustering doesn't use the
+			number of active clusters)
+		*/
+		if (
+			( m_clusterIndices.get() == NULL ) ||
+			( m_clustering != clustering ) ||
+			( m_logMaximumClusterSize != ( smallClusters ? 4u : 8u ) ) ||
+			( ( clustering != GTSVM_CLUSTERING_MINHASH ) && ( m_activeClusters != activeClusters ) )
+		)
+		{
+			ClusterTrainingVectors( clustering, smallClusters, activeClusters );
+		}
+	}
+	catch( ... ) {
+
+		Deinitialize();    // try to keep this structure in a valid state, if possible
+		throw;
+	}
+}
+
+
+void SVM::Save( char const* const filename ) const {
+
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+
+	TraceSpan span( "Save" );
+
+	TraceSpan phase( "Save: update responses" );
+	const_cast< SVM* >( this )->UpdateResponses();
+	BOOST_ASSERT( m_updatedResponses );
+
+	phase.Start( "Save: checksum" );
+
+	std::vector< boost::uint32_t > clusterSizes;
+	std::vector< boost::uint32_t > clusterIndices;
+	std::vector< boost::uint32_t > clusterNonzeroSizes;
+	std::vector< boost::uint32_t > clusterNonzeroIndices;
+	clusterSizes.reserve( m_clusters );
+	clusterIndices.reserve( m_rows );
+	clusterNonzeroSizes.reserve( m_clusters );
+	for ( unsigned int ii = 0; ii < m_clusterIndices->size(); ++ii ) {
+
+		clusterSizes.push_back( ( *m_clusterIndices )[ ii ].size() );
+		clusterIndices.insert( clusterIndices.end(), ( *m_clusterIndices )[ ii ].begin(), ( *m_clusterIndices )[ ii ].end() );
+		clusterNonzeroSizes.push_back( ( *m_clusterNonzeroIndices )[ ii ].size() );
+		clusterNonzeroIndices.insert( clusterNonzeroIndices.end(), ( *m_clusterNonzeroIndices )[ ii ].begin(), ( *m_clusterNonzeroIndices )[ ii ].end() );
+	}
+
+	void const* sections[ MODEL_FILE_SECTIONS ];
+	size_t sizes[ MODEL_FILE_SECTIONS ];
+
+	sections[ MODEL_FILE_SECTION_OFFSETS      ] = m_trainingVectors.GetOffsets();
+	sections[ MODEL_FILE_SECTION_SIZES        ] = m_trainingVectors.GetSizes();
+	sections[ MODEL_FILE_SECTION_INDICES      ] = m_trainingVectors.GetAllIndices();
+	sections[ MODEL_FILE_SECTION_VALUES       ] = m_trainingVectors.GetAllValues();
+	sections[ MODEL_FILE_SECTION_LABELS       ] = m_trainingLabels.get();
+	sections[ MODEL_FILE_SECTION_NORMS        ] = m_trainingVectorNormsSquared.get();
+	sections[ MODEL_FILE_SECTION_KERNEL_NORMS ] = m_trainingVectorKernelNormsSquared.get();
+	sections[ MODEL_FILE_SECTION_RESPONSES    ] = m_trainingResponses.get();
+	sections[ MODEL_FILE_SECTION_ALPHAS       ] = m_trainingAlphas.get();
+	SVM_ModelFileSectionSizes( sizes, m_rows, m_classes, m_trainingVectors.GetNonzeros() );
+
+	sections[ MODEL_FILE_SECTION_CLUSTER_SIZES           ] = SVM_VectorData( clusterSizes          );
+	sections[ MODEL_FILE_SECTION_CLUSTER_INDICES         ] = SVM_VectorData( clusterIndices        );
+	sections[ MODEL_FILE_SECTION_CLUSTER_NONZERO_SIZES   ] = SVM_VectorData( clusterNonzeroSizes   );
+	sections[ MODEL_FILE_SECTION_CLUSTER_NONZERO_INDICES ] = SVM_VectorData( clusterNonzeroIndices );
+	sizes[ MODEL_FILE_SECTION_CLUSTER_SIZES           ] = clusterSizes.size()          * sizeof( boost::uint32_t );
+	sizes[ MODEL_FILE_SECTION_CLUSTER_INDICES         ] = clusterIndices.size()        * sizeof( boost::uint32_t );
+	sizes[ MODEL_FILE_SECTION_CLUSTER_NONZERO_SIZES   ] = clusterNonzeroSizes.size()   * sizeof( boost::uint32_t );
+	sizes[ MODEL_FILE_SECTION_CLUSTER_NONZERO_INDICES ] = clusterNonzeroIndices.size() * sizeof( boost::uint32_t );
+
+	sections[ MODEL_FILE_SECTION_COLUMN_INDICES ] = m_columnInputIndices.get();
+	sizes[    MODEL_FILE_SECTION_COLUMN_INDICES ] = m_columns * sizeof( boost::uint32_t );
+
+	ModelFileHeader header;
+	std::memset( &header, 0, sizeof( header ) );
+	std::memcpy( header.magic, MODEL_FILE_MAGIC, sizeof( header.magic ) );
+	header.version   = MODEL_FILE_VERSION;
+	header.byteOrder = MODEL_FILE_BYTE_ORDER;
+
+	header.rows     = m_rows;
+	header.columns  = m_inputColumns;
+	header.classes  = m_classes;
+	header.kernel   = m_kernel;
+	header.nonzeros = m_trainingVectors.GetNonzeros();
+
+	header.regularization   = m_regularization;
+	header.kernelParameter1 = m_kernelParameter1;
+	header.kernelParameter2 = m_kernelParameter2;
+	header.kernelParameter3 = m_kernelParameter3;
+	header.bias             = m_bias;
+	header.biased           = ( m_biased ? 1 : 0 );
+
+	header.clustering     = m_clustering;
+	header.smallClusters  = ( ( m_logMaximumClusterSize == 4 ) ? 1 : 0 );
+	header.activeClusters = m_activeClusters;
+
+	{	boost::uint64_t offset = ModelFileAlign( sizeof( header ) );
+		for ( unsigned int ii = 0; ii < MODEL_FILE_SECTIONS; ++ii ) {
+
+			header.sections[ ii ].offset   = offset;
+			header.sections[ ii ].size     = sizes[ ii ];
+			header.sections[ ii ].checksum = ModelFileChecksum( sections[ ii ], sizes[ ii ] );
+			offset = ModelFileAlign( offset + sizes[ ii ] );
+		}
+	}
+	header.checksum = ModelFileChecksum( &header, offsetof( ModelFileHeader, checksum ) );
+
+	/*
+		we write to a temporary file, and then rename it, since the file we're
+		replacing might be the one which our arrays are mapped from
+	*/
+	std::string const temporaryFilename = std::string( filename ) + ".tmp";
+
+	phase.Start( "Save: write" );
+	FILE* file = fopen( temporaryFilename.c_str(), "wb" );
+	if ( file == NULL )
+		throw std::runtime_error( "Unable to open file" );
+
+	try {
+
+		if ( fwrite( &header, sizeof( header ), 1, file ) != 1 )
+			throw std::runtime_error( "Unable to write model file header" );
+
+		{	boost::uint64_t offset = sizeof( header );
+			for ( unsigned int ii = 0; ii < MODEL_FILE_SECTIONS; ++ii ) {
+
+				BOOST_ASSERT( header.sections[ ii ].offset >= offset );
+				SVM_WriteZeros( file, header.sections[ ii ].offset - offset );
+				if ( fwrite( sections[ ii ], 1, sizes[ ii ], file ) != sizes[ ii ] )
+					throw std::runtime_error( "Unable to write model file section" );
+				offset = header.sections[ ii ].offset + sizes[ ii ];
+			}
+		}
+
+		FILE* const closingFile = file;
+		file = NULL;
+		if ( fclose( closingFile ) != 0 )
+			throw std::runtime_error( "Unable to write model file" );
+		if ( std::rename( temporaryFilename.c_str(), filename ) != 0 )
+			throw std::runtime_error( "Unable to replace model file" );
+	}
+	catch( ... ) {
+
+		// don't leave the file open, or a partial model behind
+		if ( file != NULL )
+			fclose( file );
+		std::remove( temporaryFilename.c_str() );
+		throw;
+	}
+}
+
+
+void SVM::LoadVersion1( char const* const filename ) {
+
+	{	FILE* file = fopen( filename, "rb" );
+		if ( file == NULL )
+			throw std::runtime_error( "Unable to open file" );
+
+		if ( fread( &m_rows, sizeof( m_rows ), 1, file ) != 1 )
+			throw std::runtime_error( "Unable to read rows" );
+		if ( fread( &m_columns, sizeof( m_columns ), 1, file ) != 1 )
+			throw std::runtime_error( "Unable to read columns" );
+		m_inputColumns = m_columns;
+		m_columnInputIndices = SVM_IdentityIndices( m_columns );
+		UpdateInputColumnIndices();
+		if ( fread( &m_classes, sizeof( m_classes ), 1, file ) != 1 )
+			throw std::runtime_error( "Unable to read classes" );
+
+		m_trainingVectors.Clear();
+		m_trainingVectors.Reserve( m_rows, 0 );
+		for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+			boost::uint32_t size;
+			if ( fread( &size, sizeof( boost::uint32_t ), 1, file ) != 1 )
+				throw std::runtime_error( "Unable to read training vector size" );
+
+			for ( unsigned int jj = 0; jj < size; ++jj ) {
+
+				boost::uint32_t index;
+				float value;
+				if ( fread( &index, sizeof( boost::uint32_t ), 1, file ) != 1 )
+					throw std::runtime_error( "Unable to read training vector nonzero index" );
+				if ( fread( &value, sizeof( float ), 1, file ) != 1 )
+					throw std::runtime_error( "Unable to read training vector nonzero value" );
+
+				m_trainingVectors.Append( index, value );
+			}
+			m_trainingVectors.EndRow();
+		}
+		m_trainingVectors.Compact();
+
+		m_trainingLabels = boost::shared_array< boost::int32_t >( new boost::int32_t[ m_rows ] );
+		if ( fread( m_trainingLabels.get(), sizeof( boost::int32_t ), m_rows, file ) != m_rows )
+			throw std::runtime_error( "Unable to read training labels" );
+
+		m_trainingVectorNormsSquared       = boost::shared_array< float >( new float[ m_rows ] );
+		m_trainingVectorKernelNormsSquared = boost::shared_array< float >( new float[ m_rows ] );
+
+		m_trainingResponses = boost::shared_array< double >( new double[ m_rows * m_classes ] );
+		m_trainingAlphas = boost::shared_array< float >( new float[ m_rows * m_classes ] );
+		if ( fread( m_trainingResponses.get(), sizeof( double ), m_rows * m_classes, file ) != m_rows * m_classes )
+			throw std::runtime_error( "Unable to read training responses" );
+		if ( fread( m_trainingAlphas.get(), sizeof( float ), m_rows * m_classes, file ) != m_rows * m_classes )
+			throw std::runtime_error( "Unable to read training alphas" );
+
+		if ( fread( &m_regularization, sizeof( float ), 1, file ) != 1 )
+			throw std::runtime_error( "Unable to read regularization parameter" );
+		{	boost::int32_t kernel;
+			if ( fread( &kernel, sizeof( boost::int32_t ), 1, file ) != 1 )
+				throw std::runtime_error( "Unable to read kernel" );
+			m_kernel = static_cast< GTSVM_Kernel >( kernel );
+		}
+		if ( fread( &m_kernelParameter1, sizeof( float ), 1, file ) != 1 )
+			throw std::runtime_error( "Unable to read first kernel parameter" );
+		if ( fread( &m_kernelParameter2, sizeof( float ), 1, file ) != 1 )
+			throw std::runtime_error( "Unable to read second kernel parameter" );
+		if ( fread( &m_kernelParameter3, sizeof( float ), 1, file ) != 1 )
+			throw std::runtime_error( "Unable to read third kernel parameter" );
+		if ( fread( &m_biased, sizeof( bool ), 1, file ) != 1 )
+			throw std::runtime_error( "Unable to read biased flag" );
+		if ( fread( &m_bias, sizeof( float ), 1, file ) != 1 )
+			throw std::runtime_error( "Unable to read bias" );
+
+		fclose( file );
+	}
+
+	CalculateNorms();
+	CalculateKernelNorms();
+}
+
+
+void SVM::LoadVersion2( char const* const filename ) {
+
+	boost::shared_ptr< MappedFile > file( new MappedFile( filename ) );
+	MappedFileDeleter const deleter( file );
+
+	char* const data = static_cast< char* >( file->GetData() );
+	size_t const dataSize = file->GetSize();
+
+	if ( dataSize < sizeof( ModelFileHeader ) )
+		throw std::runtime_error( "Unable to read model file header" );
+	ModelFileHeader const& header = *reinterpret_cast< ModelFileHeader const* >( data );
+
+	if ( ( header.version < 2 ) || ( header.version > MODEL_FILE_VERSION ) )
+		throw std::runtime_error( "Unsupported model file version" );
+	if ( header.byteOrder != MODEL_FILE_BYTE_ORDER )
+		throw std::runtime_error( "Model file has the wrong byte order" );
+	if ( header.checksum != ModelFileChecksum( &header, offsetof( ModelFileHeader, checksum ) ) )
+		throw std::runtime_error( "Model file header is corrupt" );
+
+	m_rows         = header.rows;
+	m_inputColumns = header.columns;
+	m_classes      = header.classes;
+
+	m_regularization   = header.regularization;
+	m_kernel           = static_cast< GTSVM_Kernel >( header.kernel );
+	m_kernelParameter1 = header.kernelParameter1;
+	m_kernelParameter2 = header.kernelParameter2;
+	m_kernelParameter3 = header.kernelParameter3;
+	m_biased           = ( header.biased != 0 );
+	m_bias             = header.bias;
+
+	size_t sizes[ MODEL_FILE_SECTIONS ];
+	SVM_ModelFileSectionSizes( sizes, m_rows, m_classes, header.nonzeros );
+
+	m_clustering = static_cast< GTSVM_Clustering >( header.clustering );
+	m_logMaximumClusterSize = ( header.smallClusters ? 4 : 8 );
+	m_activeClusters = header.activeClusters;
+	m_clusters = ( ( m_rows + ( ( 1u << m_logMaximumClusterSize ) - 1 ) ) >> m_logMaximumClusterSize );
+	m_shrunkClusters = 0;
+	bool const clustered = ( m_activeClusters != 0 );
+
+	// a model saved after shrinking may have more clusters, some of them partially-full
+	if ( clustered ) {
+
+		boost::uint64_t const clusterSizesSize = header.sections[ MODEL_FILE_SECTION_CLUSTER_SIZES ].size;
+		if ( ( clusterSizesSize % sizeof( boost::uint32_t ) == 0 ) && ( clusterSizesSize / sizeof( boost::uint32_t ) > m_clusters ) && ( clusterSizesSize / sizeof( boost::uint32_t ) <= m_rows ) )
+			m_clusters = clusterSizesSize / sizeof( boost::uint32_t );
+	}
+
+	sizes[ MODEL_FILE_SECTION_CLUSTER_SIZES           ] = ( clustered ? m_clusters * sizeof( boost::uint32_t ) : 0 );
+	sizes[ MODEL_FILE_SECTION_CLUSTER_INDICES         ] = ( clustered ? m_rows     * sizeof( boost::uint32_t ) : 0 );
+	sizes[ MODEL_FILE_SECTION_CLUSTER_NONZERO_SIZES   ] = ( clustered ? m_clusters * sizeof( boost::uint32_t ) : 0 );
+	sizes[ MODEL_FILE_SECTION_CLUSTER_NONZERO_INDICES ] = header.sections[ MODEL_FILE_SECTION_CLUSTER_NONZERO_INDICES ].size;    // checked below
+
+	// if there are no column indices (e.g. in a version 2 file), then every column is used
+	sizes[ MODEL_FILE_SECTION_COLUMN_INDICES ] = header.sections[ MODEL_FILE_SECTION_COLUMN_INDICES ].size;
+	if (
+		( sizes[ MODEL_FILE_SECTION_COLUMN_INDICES ] % sizeof( boost::uint32_t ) != 0 ) ||
+		( sizes[ MODEL_FILE_SECTION_COLUMN_INDICES ] > m_inputColumns * sizeof( boost::uint32_t ) )
+	)
+	{
+		throw std::runtime_error( "Model file section has the wrong size" );
+	}
+	m_columns = ( ( sizes[ MODEL_FILE_SECTION_COLUMN_INDICES ] > 0 ) ? ( sizes[ MODEL_FILE_SECTION_COLUMN_INDICES ] / sizeof( boost::uint32_t ) ) : m_inputColumns );
+
+	char* sections[ MODEL_FILE_SECTIONS ];
+	for ( unsigned int ii = 0; ii < MODEL_FILE_SECTIONS; ++ii ) {
+
+		ModelFileSection const& section = header.sections[ ii ];
+		if ( section.size != sizes[ ii ] )
+			throw std::runtime_error( "Model file section has the wrong size" );
+		if ( ( section.offset % MODEL_FILE_ALIGNMENT != 0 ) || ( section.offset > dataSize ) || ( section.size > dataSize - section.offset ) )
+			throw std::runtime_error( "Model file section is out of bounds" );
+		if ( section.checksum != ModelFileChecksum( data + section.offset, section.size ) )
+			throw std::runtime_error( "Model file section is corrupt" );
+
+		sections[ ii ] = data + section.offset;
+	}
+
+	boost::uint64_t const* const offsets = reinterpret_cast< boost::uint64_t const* >( sections[ MODEL_FILE_SECTION_OFFSETS ] );
+	boost::uint32_t const* const nonzeros = reinterpret_cast< boost::uint32_t const* >( sections[ MODEL_FILE_SECTION_SIZES ] );
+	for ( unsigned int ii = 0; ii < m_rows; ++ii )
+		if ( ( offsets[ ii ] > header.nonzeros ) || ( nonzeros[ ii ] > header.nonzeros - offsets[ ii ] ) )
+			throw std::runtime_error( "Model file training vector is out of bounds" );
+
+	// everything is used in place: the mapping is private, so writes (e.g. to the alphas) never reach the file
+	m_trainingVectors.Map(
+		m_rows,
+		header.nonzeros,
+		offsets,
+		nonzeros,
+		reinterpret_cast< boost::uint32_t const* >( sections[ MODEL_FILE_SECTION_INDICES ] ),
+		reinterpret_cast< float const* >( sections[ MODEL_FILE_SECTION_VALUES ] ),
+		file
+	);
+	m_trainingLabels                   = boost::shared_array< boost::int32_t >( reinterpret_cast< boost::int32_t* >( sections[ MODEL_FILE_SECTION_LABELS       ] ), deleter );
+	m_trainingVectorNormsSquared       = boost::shared_array< float          >( reinterpret_cast< float*          >( sections[ MODEL_FILE_SECTION_NORMS        ] ), deleter );
+	m_trainingVectorKernelNormsSquared = boost::shared_array< float          >( reinterpret_cast< float*          >( sections[ MODEL_FILE_SECTION_KERNEL_NORMS ] ), deleter );
+	m_trainingResponses                = boost::shared_array< double         >( reinterpret_cast< double*         >( sections[ MODEL_FILE_SECTION_RESPONSES    ] ), deleter );
+	m_trainingAlphas                   = boost::shared_array< float          >( reinterpret_cast< float*          >( sections[ MODEL_FILE_SECTION_ALPHAS       ] ), deleter );
+
+	if ( sizes[ MODEL_FILE_SECTION_COLUMN_INDICES ] > 0 )
+		m_columnInputIndices = boost::shared_array< boost::uint32_t >( reinterpret_cast< boost::uint32_t* >( sections[ MODEL_FILE_SECTION_COLUMN_INDICES ] ), deleter );
+	else
+		m_columnInputIndices = SVM_IdentityIndices( m_columns );
+	UpdateInputColumnIndices();
+
+	m_clusterIndices.reset();
+	m_clusterNonzeroIndices.reset();
+	if ( clustered ) {
+
+		boost::uint32_t const* const clusterSizes          = reinterpret_cast< boost::uint32_t const* >( sections[ MODEL_FILE_SECTION_CLUSTER_SIZES           ] );
+		boost::uint32_t const* const clusterIndices        = reinterpret_cast< boost::uint32_t const* >( sections[ MODEL_FILE_SECTION_CLUSTER_INDICES         ] );
+		boost::uint32_t const* const clusterNonzeroSizes   = reinterpret_cast< boost::uint32_t const* >( sections[ MODEL_FILE_SECTION_CLUSTER_NONZERO_SIZES   ] );
+		boost::uint32_t const* const clusterNonzeroIndices = reinterpret_cast< boost::uint32_t const* >( sections[ MODEL_FILE_SECTION_CLUSTER_NONZERO_INDICES ] );
+		size_t const clusterNonzeroIndicesSize = sizes[ MODEL_FILE_SECTION_CLUSTER_NONZERO_INDICES ] / sizeof( boost::uint32_t );
+
+		// the clustering must be a partition of the rows, or InitializeDevice will go badly wrong
+		std::vector< bool > found( m_rows, false );
+		size_t clusterIndicesOffset = 0;
+		size_t clusterNonzeroIndicesOffset = 0;
+		std::vector< std::vector< unsigned int > > layoutIndices( m_clusters );
+		std::vector< std::vector< unsigned int > > layoutNonzeroIndices( m_clusters );
+		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+
+			if ( ( clusterSizes[ ii ] == 0 ) || ( clusterSizes[ ii ] > ( 1u << m_logMaximumClusterSize ) ) || ( clusterSizes[ ii ] > m_rows - clusterIndicesOffset ) )
+				throw std::runtime_error( "Model file clustering is invalid" );
+			if ( clusterNonzeroSizes[ ii ] > clusterNonzeroIndicesSize - clusterNonzeroIndicesOffset )
+				throw std::runtime_error( "Model file clustering is invalid" );
+
+			layoutIndices[ ii ].assign( clusterIndices + clusterIndicesOffset, clusterIndices + clusterIndicesOffset + clusterSizes[ ii ] );
+			clusterIndicesOffset += clusterSizes[ ii ];
+			layoutNonzeroIndices[ ii ].assign( clusterNonzeroIndices + clusterNonzeroIndicesOffset, clusterNonzeroIndices + clusterNonzeroIndicesOffset + clusterNonzeroSizes[ ii ] );
+			clusterNonzeroIndicesOffset += clusterNonzeroSizes[ ii ];
+
+			for ( unsigned int jj = 0; jj < clusterSizes[ ii ]; ++jj ) {
+
+				unsigned int const index = layoutIndices[ ii ][ jj ];
+				if ( ( index >= m_rows ) || found[ index ] )
+					throw std::runtime_error( "Model file clustering is invalid" );
+				found[ index ] = true;
+			}
+			for ( unsigned int jj = 0; jj < clusterNonzeroSizes[ ii ]; ++jj )
+				if ( layoutNonzeroIndices[ ii ][ jj ] >= m_columns )
+					throw std::runtime_error( "Model file clustering is invalid" );
+		}
+		if ( ( clusterIndicesOffset != m_rows ) || ( clusterNonzeroIndicesOffset != clusterNonzeroIndicesSize ) )
+			throw std::runtime_error( "Model file clustering is invalid" );
+
+		m_clusterIndices        = SVM_ShareClusters( &layoutIndices        );
+		m_clusterNonzeroIndices = SVM_ShareClusters( &layoutNonzeroIndices );
+	}
+}
+
+
+void SVM::Shrink(
+	GTSVM_Clustering const clustering,
+	bool const smallClusters,
+	unsigned int const activeClusters
+)
+{
+
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+	DeinitializeDevice();
+	BOOST_ASSERT( m_updatedResponses );
+
+	m_clusterIndices.reset();
+	m_clusterNonzeroIndices.reset();
+
+	unsigned int rows = 0;
+	for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+		bool zero = true;
+		for ( unsigned int jj = 0; jj < m_classes; ++jj ) {
+
+			if ( m_trainingAlphas[ ii * m_classes + jj ] != 0 ) {
+
+				zero = false;
+				break;
+			}
+		}
+
+		if ( ! zero )
+			++rows;
+	}
+
+	SparseMatrix trainingVectors;
+	trainingVectors.Reserve( rows, 0 );
+	boost::shared_array< boost::int32_t > trainingLabels( new boost::int32_t[ rows ] );
+	boost::shared_array< float > trainingVectorNormsSquared( new float[ rows ] );
+	boost::shared_array< float > trainingVectorKernelNormsSquared( new float[ rows ] );
+	boost::shared_array< double > trainingResponses( new double[ rows * m_classes ] );
+	boost::shared_array< float > trainingAlphas( new float[ rows * m_classes ] );
+
+	{	unsigned int kk = 0;
+		for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+			bool zero = true;
+			for ( unsigned int jj = 0; jj < m_classes; ++jj ) {
+
+				if ( m_trainingAlphas[ ii * m_classes + jj ] != 0 ) {
+
+					zero = false;
+					break;
+				}
+			}
+
+			if ( ! zero ) {
+
+				trainingVectors.AppendRow( m_trainingVectors, ii );
+				trainingLabels[                   kk ] = m_trainingLabels[                   ii ];
+				trainingVectorNormsSquared[       kk ] = m_trainingVectorNormsSquared[       ii ];
+				trainingVectorKernelNormsSquared[ kk ] = m_trainingVectorKernelNormsSquared[ ii ];
+				for ( unsigned int jj = 0; jj < m_classes; ++jj ) {
+
+					// a kept row may still have zero alphas for some classes, which must be copied too
+					trainingResponses[ kk * m_classes + jj ] = m_trainingResponses[ ii * m_classes + jj ];
+					trainingAlphas[    kk * m_classes + jj ] = m_trainingAlphas[    ii * m_classes + jj ];
+				}
+				++kk;
+			}
+		}
+		BOOST_ASSERT( kk == rows );
+	}
+	trainingVectors.Compact();
+
+	m_rows = rows;
+	m_trainingVectors.Swap( trainingVectors );
+	m_trainingLabels                   = trainingLabels;
+	m_trainingVectorNormsSquared       = trainingVectorNormsSquared;
+	m_trainingVectorKernelNormsSquared = trainingVectorKernelNormsSquared;
+	m_trainingResponses                = trainingResponses;
+	m_trainingAlphas                   = trainingAlphas;
+
+	// the remaining vectors might not use all of the columns
+	CompactColumns( GTSVM_COLUMN_ORDER_ORIGINAL );
+	ClusterTrainingVectors( clustering, smallClusters, activeClusters );
+}
+
+
+void SVM::DeinitializeDevice() {
+
+	if ( m_initializedDevice ) {
+
+		UpdateResponses();
+		BOOST_ASSERT( m_updatedResponses );
+
+		ReleaseDevice();
+		BOOST_ASSERT( ! m_initializedDevice );
+	}
+}
+
+
+void SVM::Deinitialize() {
+
+	DeinitializeDevice();
+	BOOST_ASSERT( ! m_initializedDevice );
+
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+	m_initializedHost = false;
+
+	m_trainingVectors.Clear();
+	m_trainingLabels = boost::shared_array< boost::int32_t >();
+	m_trainingVectorNormsSquared = boost::shared_array< float >();
+	m_trainingVectorKernelNormsSquared = boost::shared_array< float >();
+
+	m_trainingResponses = boost::shared_array< double >();
+	m_trainingAlphas = boost::shared_array< float >();
+
+	m_columnInputIndices = boost::shared_array< boost::uint32_t >();
+	m_inputColumnIndices = boost::shared_array< boost::uint32_t >();
+
+	m_clusterIndices.reset();
+	m_clusterNonzeroIndices.reset();
+}
+
+
+void SVM::SetBatchSize( unsigned int const batchSize ) {
+
+	unsigned int logBatchSize = 3;
+	for ( ; ( logBatchSize <= 7 ) && ( ( 1u << logBatchSize ) != batchSize ); ++logBatchSize );
+	if ( logBatchSize > 7 )
+		throw std::runtime_error( "Batch size must be 8, 16, 32, 64 or 128" );
+	// refuse here, rather than at the first kernel call
+	if ( ! m_backend->SupportsBatchSize( logBatchSize ) ) {
+
+		if ( m_backend->GetType() == GTSVM_BACKEND_CUDA )
+			throw std::runtime_error( "The CUDA backend only supports a batch size of 16" );
+		throw std::runtime_error( "The backend doesn't support this batch size" );
+	}
+
+	if ( logBatchSize != m_logBatchSize ) {
+
+		// the batch buffers, and work buffers, depend on the batch size
+		DeinitializeDevice();
+		BOOST_ASSERT( ! m_initializedDevice );
+
+		m_logBatchSize = logBatchSize;
+		m_batchSubmatrix = boost::shared_array< double >( new double[ 1u << ( m_logBatchSize << 1 ) ] );
+	}
+}
+
+
+void SVM::SetShrinking( bool const shrinking ) {
+
+	m_shrinking = shrinking;
+	m_shrinkingIterations = 0;
+}
+
+
+void SVM::GetTrainingVectorsSparse(
+	void* const trainingVectors,    // order depends on the columnMajor flag
+	size_t* const trainingVectorIndices,
+	size_t* const trainingVectorOffsets,
+	GTSVM_Type trainingVectorsType,
+	bool const columnMajor
+) const
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+
+	SparseMatrix inputTrainingVectors;
+	SVM_InputColumns( &inputTrainingVectors, m_trainingVectors, m_rows, m_columnInputIndices.get(), m_columns );
+
+	SVM_SparseSparseReverseMemcpy2d(
+		trainingVectors,
+		trainingVectorIndices,
+		trainingVectorOffsets,
+		trainingVectorsType,
+		inputTrainingVectors,
+		m_rows,
+		m_inputColumns,
+		columnMajor
+	);
+}
+
+
+void SVM::GetTrainingVectorsDense(
+	void* const trainingVectors,    // order depends on the columnMajor flag
+	GTSVM_Type trainingVectorsType,
+	bool const columnMajor
+) const
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+
+	SparseMatrix inputTrainingVectors;
+	SVM_InputColumns( &inputTrainingVectors, m_trainingVectors, m_rows, m_columnInputIndices.get(), m_columns );
+
+	SVM_SparseReverseMemcpy2d(
+		trainingVectors,
+		trainingVectorsType,
+		inputTrainingVectors,
+		m_rows,
+		m_inputColumns,
+		columnMajor
+	);
+}
+
+
+void SVM::GetTrainingLabels(
+	void* const trainingLabels,
+	GTSVM_Type trainingLabelsType
+) const
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+
+	SVM_ReverseMemcpy(
+		trainingLabels,
+		0,
+		trainingLabelsType,
+		m_trainingLabels.get(),
+		m_rows
+	);
+}
+
+
+void SVM::GetTrainingResponses(
+	void* const trainingResponses,
+	GTSVM_Type trainingResponsesType,
+	bool const columnMajor
+) const
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+
+	const_cast< SVM* >( this )->UpdateResponses();
+	BOOST_ASSERT( m_updatedResponses );
+
+	SVM_ReverseMemcpy2d(
+		trainingResponses,
+		trainingResponsesType,
+		m_trainingResponses.get(),
+		m_rows,
+		m_classes,
+		columnMajor
+	);
+}
+
+
+void SVM::GetAlphas(
+	void* const trainingAlphas,
+	GTSVM_Type trainingAlphasType,
+	bool const columnMajor
+) const
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+
+	SVM_ReverseMemcpy2d(
+		trainingAlphas,
+		trainingAlphasType,
+		m_trainingAlphas.get(),
+		m_rows,
+		m_classes,
+		columnMajor
+	);
+}
+
+
+void SVM::SetAlphas(
+	void const* const trainingAlphas,
+	GTSVM_Type trainingAlphasType,
+	bool const columnMajor
+)
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+	DeinitializeDevice();
+
+	SVM_Memcpy2d(
+		m_trainingAlphas.get(),
+		trainingAlphas,
+		trainingAlphasType,
+		m_rows,
+		m_classes,
+		columnMajor
+	);
+
+	Recalculate();
+}
+
+
+void SVM::Recalculate() {
+
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+	if ( ! m_initializedDevice )
+		InitializeDevice();
+	BOOST_ASSERT( m_initializedDevice );
+
+	{	std::vector< unsigned int > rows( m_rows );
+		for ( unsigned int ii = 0; ii < m_rows; ++ii )
+			rows[ ii ] = ii;
+		CalculateResponses( rows );
+	}
+	UploadResponses();
+	m_shrunkClusters = 0;
+
+	if ( m_biased ) {
+
+		if ( m_classes != 1 )
+			throw std::runtime_error( "Multiclass is only implemented for problems without an unregularized bias" );
+
+		CUDA_FLOAT_DOUBLE numerator = 0;
+		boost::uint32_t denominator = 0;
+		std::pair< CUDA_FLOAT_DOUBLE const*, boost::uint32_t const* > const deviceResult = m_backend->SparseCalculateBias(
+			m_deviceWork[ 0 ],
+			m_deviceWork[ 1 ],
+			m_deviceWork[ 2 ],
+			m_deviceWork[ 3 ],
+			m_deviceClusterHeaders,
+			m_logMaximumClusterSize,
+			m_clusters,
+			m_workSize,
+			m_regularization
+		);
+		m_backend->CopyFromDevice(
+			"Failed to copy bias numerator from device",
+			&numerator,
+			deviceResult.first,
+			sizeof( CUDA_FLOAT_DOUBLE )
+		);
+		m_backend->CopyFromDevice(
+			"Failed to copy bias denominator from device",
+			&denominator,
+			deviceResult.second,
+			sizeof( boost::uint32_t )
+		);
+
+		m_bias = ( ( denominator != 0 ) ? ( numerator / denominator ) : 0 );
+	}
+}
+
+
+void SVM::Restart(
+	float const regularization,
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3,
+	bool const biased
+)
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+
+	if ( boost::math::isinf( regularization ) )
+		throw std::runtime_error( "The regularization parameter must be finite" );
+	if ( boost::math::isnan( regularization ) )
+		throw std::runtime_error( "The regularization parameter cannot be NaN" );
+	if ( regularization <= 0 )
+		throw std::runtime_error( "The regularization parameter must be positive" );
+
+	SVM_CheckKernel( kernel, kernelParameter1, kernelParameter2, kernelParameter3 );
+
+	m_regularization = regularization;
+	m_kernel = kernel;
+	m_kernelParameter1 = kernelParameter1;
+	m_kernelParameter2 = kernelParameter2;
+	m_kernelParameter3 = kernelParameter3;
+	m_biased = biased;
+
+	m_bias = 0;
+
+	CalculateKernelNorms();
+
+	std::fill( m_trainingResponses.get(), m_trainingResponses.get() + m_rows * m_classes, 0 );
+	if ( m_initializedDevice ) {
+
+#if 0
+		// CUDA sometimes thinks that we're trying to clear too large a buffer
+		CUDA_VERIFY(
+			"Failed to clear training responses on device",
+			cudaMemset( &m_deviceTrainingResponses, 0, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ) )
+		);
+#else    // 0/1
+		CUDA_FLOAT_DOUBLE* const trainingResponses = static_cast< CUDA_FLOAT_DOUBLE* >(
+			m_backend->BeginUpload(
+				"Failed to allocate space for training responses on host",
+				m_deviceTrainingResponses,
+				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+			)
+		);
+		std::fill( trainingResponses, trainingResponses + ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ), 0.0f );
+		m_backend->EndUpload(
+			"Failed to copy training responses to device",
+			m_deviceTrainingResponses,
+			trainingResponses,
+			( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+		);
+#endif    // 0/1
+	}
+	m_updatedResponses = true;
+
+	// every response is now up-to-date, so nothing needs to be unshrunk
+	m_shrunkClusters = 0;
+	m_shrinkingIterations = 0;
+
+	std::fill( m_trainingAlphas.get(), m_trainingAlphas.get() + m_rows * m_classes, 0.0f );
+	if ( m_initializedDevice ) {
+
+#if 0
+		// CUDA sometimes thinks that we're trying to clear too large a buffer
 		CUDA_VERIFY(
+			"Failed to clear training alphas on device",
+			cudaMemset( &m_deviceTrainingAlphas, 0, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float ) )
+		);
+#else    // 0/1
+		float* const trainingAlphas = static_cast< float* >(
+			m_backend->BeginUpload(
+				"Failed to allocate space for training alphas on host",
+				m_deviceTrainingAlphas,
+				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float )
+			)
+		);
+		std::fill( trainingAlphas, trainingAlphas + ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ), 0.0f );
+		m_backend->EndUpload(
 			"Failed to copy training alphas to device",
-			cudaMemcpy(
+			m_deviceTrainingAlphas,
+			trainingAlphas,
+			( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float )
+		);
+#endif    // 0/1
+	}
+}
+
+
+void SVM::SetRegularization( float const regularization ) {
+
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+
+	if ( boost::math::isinf( regularization ) )
+		throw std::runtime_error( "The regularization parameter must be finite" );
+	if ( boost::math::isnan( regularization ) )
+		throw std::runtime_error( "The regularization parameter cannot be NaN" );
+	if ( regularization <= 0 )
+		throw std::runtime_error( "The regularization parameter must be positive" );
+
+	if ( ! m_initializedDevice )
+		InitializeDevice();
+	BOOST_ASSERT( m_initializedDevice );
+
+	// which training vectors are at a bound depends on the regularization parameter
+	Unshrink();
+
+	boost::shared_array< float > alphas( new float[ m_rows * m_classes ] );
+	std::copy( m_trainingAlphas.get(), m_trainingAlphas.get() + m_rows * m_classes, alphas.get() );
+
+	if ( m_classes == 1 ) {
+
+		double imbalance = 0;    // the amount by which clipping decreased sum( y * alpha )
+		for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+			if ( alphas[ ii ] > regularization ) {
+
+				imbalance += ( ( m_trainingLabels[ ii ] > 0 ) ? 1 : -1 ) * ( alphas[ ii ] - regularization );
+				alphas[ ii ] = regularization;
+			}
+		}
+
+		// restore sum( y * alpha ) = 0 by decreasing the alphas of the other class, in order
+		if ( m_biased ) {
+
+			for ( unsigned int ii = 0; ( imbalance != 0 ) && ( ii < m_rows ); ++ii ) {
+
+				bool const positive = ( m_trainingLabels[ ii ] > 0 );
+				if ( positive ? ( imbalance < 0 ) : ( imbalance > 0 ) ) {
+
+					float const alpha = std::max( 0.0, alphas[ ii ] - std::fabs( imbalance ) );
+					imbalance += ( positive ? 1 : -1 ) * ( alphas[ ii ] - alpha );
+					alphas[ ii ] = alpha;
+				}
+			}
+		}
+	}
+	else {
+
+		// scaling a row keeps its alphas summing to zero, and the others nonpositive
+		for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+			unsigned int const label = m_trainingLabels[ ii ];
+			float const alpha = alphas[ ii * m_classes + label ];
+			if ( alpha > regularization ) {
+
+				for ( unsigned int jj = 0; jj < m_classes; ++jj )
+					alphas[ ii * m_classes + jj ] *= regularization / alpha;
+				alphas[ ii * m_classes + label ] = regularization;
+			}
+		}
+	}
+
+	std::vector< unsigned int > changed;
+	for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+		for ( unsigned int jj = 0; jj < m_classes; ++jj ) {
+
+			if ( alphas[ ii * m_classes + jj ] != m_trainingAlphas[ ii * m_classes + jj ] ) {
+
+				changed.push_back( ii );
+				break;
+			}
+		}
+	}
+
+	m_regularization = regularization;
+	if ( changed.empty() )
+		return;
+
+	unsigned int const batchSize = ( 1u << m_logBatchSize );
+	if ( m_rows < batchSize ) {
+
+		// a batch can't be filled, so start from scratch
+		DeinitializeDevice();
+		std::copy( alphas.get(), alphas.get() + m_rows * m_classes, m_trainingAlphas.get() );
+		Recalculate();
+	}
+	else {
+
+		TraceSpan span( "SetRegularization" );
+		PhaseTimer timer( &m_statistics );
+
+		std::vector< unsigned int > positions( m_rows );    // the index of each training vector in the cluster layout
+		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+
+			unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+			for ( unsigned int jj = 0; jj < size; ++jj )
+				positions[ ( *m_clusterIndices )[ ii ][ jj ] ] = ( ii << m_logMaximumClusterSize ) + jj;
+		}
+
+		/*
+			SparseUpdateKernel updates the responses by the change in the
+			alphas from their values on the device, so the last batch can be
+			filled out with any other training vectors
+		*/
+		std::vector< bool > batched( m_rows, false );
+		std::vector< unsigned int > rows;
+		rows.reserve( batchSize );
+		for ( unsigned int ii = 0; ii < changed.size(); ii += batchSize ) {
+
+			timer.Start( GTSVM_PHASE_ASSEMBLY );
+
+			rows.assign( changed.begin() + ii, changed.begin() + std::min< size_t >( ii + batchSize, changed.size() ) );
+			for ( unsigned int jj = 0; jj < rows.size(); ++jj )
+				batched[ rows[ jj ] ] = true;
+			for ( unsigned int jj = 0; rows.size() < batchSize; ++jj )
+				if ( ! batched[ jj ] )
+					rows.push_back( jj );
+
+			m_batchVectors.Begin();
+			for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
+
+				unsigned int const row = rows[ jj ];
+				batched[ row ] = false;
+
+				SetBatchVector( jj, row );
+				m_batchVectorNormsSquared[ jj ] = m_trainingVectorNormsSquared[ row ];
+				m_batchIndices[ jj ] = positions[ row ];
+
+				if ( m_classes == 1 )
+					m_batchAlphas[ jj ] = ( ( m_trainingLabels[ row ] > 0 ) ? alphas[ row ] : -alphas[ row ] );
+				else {
+
+					for ( unsigned int kk = 0; kk < m_classes; ++kk )
+						m_batchAlphas[ ( kk << m_logBatchSize ) + jj ] = alphas[ row * m_classes + kk ];
+				}
+			}
+
+			timer.Stop();
+
+			m_backend->CopyToDevice(
+				"Failed to copy batch alphas to device",
+				m_deviceBatchAlphas,
+				m_batchAlphas,
+				( m_classes << m_logBatchSize ) * sizeof( float )
+			);
+
+			m_batchVectors.Upload();
+
+			m_backend->CopyToDevice(
+				"Failed to copy batch squared norms to device",
+				m_deviceBatchVectorNormsSquared,
+				m_batchVectorNormsSquared,
+				batchSize * sizeof( float )
+			);
+
+			m_backend->CopyToDevice(
+				"Failed to copy batch indices to device",
+				m_deviceBatchIndices,
+				m_batchIndices,
+				batchSize * sizeof( boost::uint32_t )
+			);
+
+			m_backend->SparseUpdateKernel(
+				m_batchVectors.GetDeviceTranspose(),
+				m_deviceBatchVectorNormsSquared,
+				m_deviceBatchAlphas,
+				m_deviceBatchIndices,
+				m_deviceClusterHeaders,
+				m_logMaximumClusterSize,
+				m_logBatchSize,
+				m_clusters,
+				m_classes,
+				m_kernel,
+				m_kernelParameter1,
+				m_kernelParameter2,
+				m_kernelParameter3
+			);
+		}
+
+		std::copy( alphas.get(), alphas.get() + m_rows * m_classes, m_trainingAlphas.get() );
+		m_updatedResponses = false;
+	}
+}
+
+
+void SVM::SetKernel(
+	GTSVM_Kernel const kernel,
+	float const kernelParameter1,
+	float const kernelParameter2,
+	float const kernelParameter3
+)
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+
+	SVM_CheckKernel( kernel, kernelParameter1, kernelParameter2, kernelParameter3 );
+
+	if ( ! m_initializedDevice )
+		InitializeDevice();
+	BOOST_ASSERT( m_initializedDevice );
+
+	m_kernel = kernel;
+	m_kernelParameter1 = kernelParameter1;
+	m_kernelParameter2 = kernelParameter2;
+	m_kernelParameter3 = kernelParameter3;
+
+	/*
+		The alphas remain feasible, since the constraints don't depend on the
+		kernel, but every response changes, so they're calculated from
+		scratch. The training vectors, clusters and squared norms are already
+		on the device, so only the kernel norms need to be uploaded again
+	*/
+	CalculateKernelNorms();
+	UploadKernelNorms();
+	Recalculate();
+}
+
+
+std::pair< CUDA_FLOAT_DOUBLE, CUDA_FLOAT_DOUBLE > const SVM::Optimize( unsigned int const iterations ) {
+
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+	if ( ! m_initializedDevice )
+		InitializeDevice();
+	BOOST_ASSERT( m_initializedDevice );
+
+	// the iterations will change the responses on the device
+	m_updatedResponses = false;
+
+	bool progress = false;
+	if ( m_biased ) {
+
+		if ( m_classes != 1 )
+			throw std::runtime_error( "Multiclass is only implemented for problems without an unregularized bias" );
+
+		progress = true;
+		for ( unsigned int ii = 0; progress && ( ii < iterations ); ii += ( 1u << m_logBatchSize ) ) {
+
+			progress = IterateBiasedBinary();
+			m_statistics.iterations += ( 1u << m_logBatchSize );
+			progress = UpdateActiveSet( progress );
+		}
+
+		CUDA_FLOAT_DOUBLE numerator = 0;
+		boost::uint32_t denominator = 0;
+		std::pair< CUDA_FLOAT_DOUBLE const*, boost::uint32_t const* > const deviceResult = m_backend->SparseCalculateBias(
+			m_deviceWork[ 0 ],
+			m_deviceWork[ 1 ],
+			m_deviceWork[ 2 ],
+			m_deviceWork[ 3 ],
+			m_deviceClusterHeaders,
+			m_logMaximumClusterSize,
+			m_clusters - m_shrunkClusters,
+			m_workSize,
+			m_regularization
+		);
+		m_backend->CopyFromDevice(
+			"Failed to copy bias numerator from device",
+			&numerator,
+			deviceResult.first,
+			sizeof( CUDA_FLOAT_DOUBLE )
+		);
+		m_backend->CopyFromDevice(
+			"Failed to copy bias denominator from device",
+			&denominator,
+			deviceResult.second,
+			sizeof( boost::uint32_t )
+		);
+
+		m_bias = ( ( denominator != 0 ) ? ( numerator / denominator ) : 0 );
+	}
+	else {
+
+		if ( m_classes == 1 ) {
+
+			progress = true;
+			for ( unsigned int ii = 0; progress && ( ii < iterations ); ii += ( 1u << m_logBatchSize ) ) {
+
+				progress = IterateUnbiasedBinary();
+				m_statistics.iterations += ( 1u << m_logBatchSize );
+				progress = UpdateActiveSet( progress );
+			}
+
+			BOOST_ASSERT( m_bias == 0 );
+		}
+		else {
+
+			progress = true;
+			for ( unsigned int ii = 0; progress && ( ii < iterations ); ii += ( 1u << m_logBatchSize ) ) {
+
+				progress = IterateUnbiasedMulticlass();
+				m_statistics.iterations += ( 1u << m_logBatchSize );
+			}
+		}
+	}
+
+	// the objectives are those of the full problem, so need the responses of every training vector
+	UpdateShrunkResponses();
+
+	CUDA_FLOAT_DOUBLE primal =  std::numeric_limits< CUDA_FLOAT_DOUBLE >::infinity();
+	CUDA_FLOAT_DOUBLE dual   = -std::numeric_limits< CUDA_FLOAT_DOUBLE >::infinity();
+
+	std::pair< CUDA_FLOAT_DOUBLE const*, CUDA_FLOAT_DOUBLE const* > const deviceResult = m_backend->SparseCalculateObjectives(
+		m_deviceWork[ 0 ],
+		m_deviceWork[ 1 ],
+		m_deviceWork[ 2 ],
+		m_deviceWork[ 3 ],
+		m_deviceClusterHeaders,
+		m_logMaximumClusterSize,
+		m_clusters,
+		m_classes,
+		m_workSize,
+		m_regularization,
+		m_bias
+	);
+	m_backend->CopyFromDevice(
+		"Failed to copy primal objective value from device",
+		&primal,
+		deviceResult.first,
+		sizeof( CUDA_FLOAT_DOUBLE )
+	);
+	m_backend->CopyFromDevice(
+		"Failed to copy dual objective value from device",
+		&dual,
+		deviceResult.second,
+		sizeof( CUDA_FLOAT_DOUBLE )
+	);
+
+	if ( ! progress ) {
+
+		++m_statistics.progressFailures;
+		throw std::runtime_error( "An iteration made no progress" );
+	}
+
+	return std::pair< CUDA_FLOAT_DOUBLE, CUDA_FLOAT_DOUBLE >( primal, dual );
+}
+
+
+bool const SVM::Unshrink() {
+
+	if ( m_shrunkClusters == 0 )
+		return false;
+
+	// only the device can bring the shrunk responses up-to-date, so it's never released while anything is shrunk
+	BOOST_ASSERT( m_initializedDevice );
+	UpdateShrunkResponses();
+	m_shrunkClusters = 0;
+	++m_statistics.unshrinks;
+
+	return true;
+}
+
+
+void SVM::ClassifySparse(
+	void* const result,
+	GTSVM_Type resultType,
+	void const* const vectors,    // order depends on columnMajor flag
+	size_t const* const vectorIndices,
+	size_t const* const vectorOffsets,
+	GTSVM_Type vectorsType,
+	unsigned int const rows,
+	unsigned int const columns,
+	bool const columnMajor
+)
+{
+	// unlike other sessions, ours counts towards our statistics
+	if ( ! m_session )
+		m_session.reset( new Session( m_backend ) );
+
+	ClassifySparse( *m_session, result, resultType, vectors, vectorIndices, vectorOffsets, vectorsType, rows, columns, columnMajor );
+}
+
+
+void SVM::ClassifyDense(
+	void* const result,
+	GTSVM_Type resultType,
+	void const* const vectors,    // order depends on columnMajor flag
+	GTSVM_Type vectorsType,
+	unsigned int const rows,
+	unsigned int const columns,
+	bool const columnMajor
+)
+{
+	if ( ! m_session )
+		m_session.reset( new Session( m_backend ) );
+
+	ClassifyDense( *m_session, result, resultType, vectors, vectorsType, rows, columns, columnMajor );
+}
+
+
+boost::shared_ptr< Session > const SVM::CreateSession() {
+
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+	if ( ! m_initializedDevice )
+		InitializeDevice();
+	BOOST_ASSERT( m_initializedDevice );
+
+	// the statistics backend would write to our statistics, so the session uses the one inside of it
+	boost::shared_ptr< Session > result( new Session( m_rawBackend ) );
+	PrepareSession( *result );
+	return result;
+}
+
+
+void SVM::ClassifySparse(
+	Session& session,
+	void* const result,
+	GTSVM_Type resultType,
+	void const* const vectors,    // order depends on columnMajor flag
+	size_t const* const vectorIndices,
+	size_t const* const vectorOffsets,
+	GTSVM_Type vectorsType,
+	unsigned int const rows,
+	unsigned int const columns,
+	bool const columnMajor
+)
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+	if ( ! m_initializedDevice )
+		InitializeDevice();
+	BOOST_ASSERT( m_initializedDevice );
+
+	PrepareSession( session );
+
+	// **TODO: it would be nice to not copy all of this
+	SparseMatrix sparseVectors;
+	SVM_SparseSparseMemcpy2d( &sparseVectors, vectors, vectorIndices, vectorOffsets, vectorsType, rows, columns, columnMajor );
+
+	// **TODO: it would be nice to not copy all of this
+	boost::shared_array< CUDA_FLOAT_DOUBLE > classifications( new CUDA_FLOAT_DOUBLE[ rows * m_classes ] );
+
+	for ( unsigned int ii = 0; ii < rows; ii += ( 1u << m_logBatchSize ) ) {
+
+		TraceSpan span( "ClassifySparse batch" );
+
+		unsigned int const batchSize = std::min( 1u << m_logBatchSize, rows - ii );
+
+		session.m_batchVectors.Begin();
+		for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
+
+			double accumulator = 0;
+
+			// input columns which no training vector uses contribute only to the norm
+			SparseMatrix::const_iterator kk    = sparseVectors.Begin( ii + jj );
+			SparseMatrix::const_iterator kkEnd = sparseVectors.End( ii + jj );
+			for ( ; ( kk != kkEnd ) && ( kk.Index() < m_inputColumns ); ++kk ) {
+
+				boost::uint32_t const column = m_inputColumnIndices[ kk.Index() ];
+				if ( column != static_cast< boost::uint32_t >( -1 ) )
+					session.m_batchVectors.SetValue( jj, column, kk.Value() );
+				accumulator += Square( kk.Value() );
+			}
+
+			session.m_batchVectorNormsSquared[ jj ] = accumulator;
+		}
+
+		ClassifyBatch( session, classifications.get() + static_cast< size_t >( ii ) * m_classes, batchSize );
+	}
+
+	SVM_ReverseMemcpy2d( result, resultType, classifications.get(), rows, m_classes, columnMajor );
+}
+
+
+void SVM::ClassifyDense(
+	Session& session,
+	void* const result,
+	GTSVM_Type resultType,
+	void const* const vectors,    // order depends on columnMajor flag
+	GTSVM_Type vectorsType,
+	unsigned int const rows,
+	unsigned int const columns,
+	bool const columnMajor
+)
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+	if ( ! m_initializedDevice )
+		InitializeDevice();
+	BOOST_ASSERT( m_initializedDevice );
+
+	PrepareSession( session );
+
+	// **TODO: it would be nice to not copy all of this
+	boost::shared_array< CUDA_FLOAT_DOUBLE > classifications( new CUDA_FLOAT_DOUBLE[ rows * m_classes ] );
+
+	unsigned int const inputColumns = std::min( columns, m_inputColumns );
+	boost::shared_array< float > vector( new float[ m_inputColumns ] );
+	std::fill( vector.get(), vector.get() + m_inputColumns, 0.0f );
+
+	for ( unsigned int ii = 0; ii < rows; ii += ( 1u << m_logBatchSize ) ) {
+
+		TraceSpan span( "ClassifyDense batch" );
+
+		unsigned int const batchSize = std::min( 1u << m_logBatchSize, rows - ii );
+
+		float* const batchVectorsTranspose = session.m_batchVectors.BeginDense();
+		for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
+
+			if ( columnMajor )
+				SVM_MemcpyStride( vector.get(), 1, vectors, ii + jj, rows, vectorsType, inputColumns );
+			else
+				SVM_MemcpyStride( vector.get(), 1, vectors, static_cast< size_t >( ii + jj ) * columns, 1, vectorsType, inputColumns );
+
+			// input columns which no training vector uses contribute only to the norm
+			double accumulator = 0;
+			for ( unsigned int kk = 0; kk < inputColumns; ++kk )
+				accumulator += Square( vector[ kk ] );
+			session.m_batchVectorNormsSquared[ jj ] = accumulator;
+
+			for ( unsigned int kk = 0; kk < m_columns; ++kk )
+				batchVectorsTranspose[ ( kk << m_logBatchSize ) + jj ] = vector[ m_columnInputIndices[ kk ] ];
+		}
+
+		ClassifyBatch( session, classifications.get() + static_cast< size_t >( ii ) * m_classes, batchSize );
+	}
+
+	SVM_ReverseMemcpy2d( result, resultType, classifications.get(), rows, m_classes, columnMajor );
+}
+
+
+void SVM::GetMemoryUsage( GTSVM_MemoryUsage* const pUsage ) const {
+
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+
+	CalculateMemoryUsage( pUsage, *m_clusterIndices, *m_clusterNonzeroIndices, m_logMaximumClusterSize );
+	pUsage->deviceInitialized = m_initializedDevice;
+}
+
+
+void SVM::PredictMemoryUsage(
+	GTSVM_MemoryUsage* const pUsage,
+	GTSVM_Clustering const clustering,
+	bool const smallClusters,
+	unsigned int const activeClusters
+) const
+{
+	if ( ! m_initializedHost )
+		throw std::runtime_error( "SVM has not been initialized" );
+	if ( activeClusters < 1 )
+		throw std::runtime_error( "Must have at least one active cluster" );
+
+	unsigned int const logMaximumClusterSize = ( smallClusters ? 4 : 8 );
+
+	std::vector< std::vector< unsigned int > > clusterIndices;
+	std::vector< std::vector< unsigned int > > clusterNonzeroIndices;
+	FindClusters( &clusterIndices, &clusterNonzeroIndices, clustering, logMaximumClusterSize, activeClusters );
+
+	CalculateMemoryUsage( pUsage, clusterIndices, clusterNonzeroIndices, logMaximumClusterSize );
+	pUsage->deviceInitialized = false;
+}
+
+
+void SVM::Cleanup() {
+
+	if ( ! m_constructed )
+		throw std::runtime_error( "SVM has not been successfully constructed" );
+	m_constructed = false;
+
+	/*
+		The responses are about to be thrown away, so there's no need to
+		download (or, if anything is shrunk, recalculate) them. This also
+		keeps the destructors of contexts which outlive main() (and perhaps the
+		CPU backend's thread pool) from doing any work
+	*/
+	if ( m_initializedDevice )
+		ReleaseDevice();
+	if ( m_initializedHost )
+		Deinitialize();
+	BOOST_ASSERT( ! m_initializedDevice );
+	BOOST_ASSERT( ! m_initializedHost );
+
+	if ( m_foundKeys != NULL ) {
+
+		m_backend->HostFree( "Failed to free found keys on host", m_foundKeys );
+		m_foundKeys = NULL;
+	}
+	if ( m_foundValues != NULL ) {
+
+		m_backend->HostFree( "Failed to free found values on host", m_foundValues );
+		m_foundValues = NULL;
+	}
+
+	if ( m_deviceBatchVectorNormsSquared != NULL ) {
+
+		m_backend->MirrorFree( "Failed to free batch squared norms on device", m_batchVectorNormsSquared, m_deviceBatchVectorNormsSquared );
+		m_deviceBatchVectorNormsSquared = NULL;
+	}
+	if ( m_batchVectorNormsSquared != NULL ) {
+
+		m_backend->HostFree( "Failed to free batch squared norms on host", m_batchVectorNormsSquared );
+		m_batchVectorNormsSquared = NULL;
+	}
+}
+
+
+void SVM::CalculateNorms() {
+
+	for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+		double accumulator = 0;
+
+		SparseMatrix::const_iterator jj    = m_trainingVectors.Begin( ii );
+		SparseMatrix::const_iterator jjEnd = m_trainingVectors.End( ii );
+		for ( ; jj != jjEnd; ++jj )
+			accumulator += Square( jj.Value() );
+
+		m_trainingVectorNormsSquared[ ii ] = accumulator;
+	}
+}
+
+
+// the kernel functions take single-precision arguments, so the squared norms lose nothing by being stored as floats
+void SVM::CalculateKernelNorms() {
+
+	for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+		float const normSquared = m_trainingVectorNormsSquared[ ii ];
+
+		double value = std::numeric_limits< double >::quiet_NaN();
+		switch( m_kernel ) {
+			case GTSVM_KERNEL_GAUSSIAN:   { value = Kernel< GTSVM_KERNEL_GAUSSIAN   >::Calculate( normSquared, normSquared, normSquared, m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
+			case GTSVM_KERNEL_POLYNOMIAL: { value = Kernel< GTSVM_KERNEL_POLYNOMIAL >::Calculate( normSquared, normSquared, normSquared, m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
+			case GTSVM_KERNEL_SIGMOID:    { value = Kernel< GTSVM_KERNEL_SIGMOID    >::Calculate( normSquared, normSquared, normSquared, m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
+			default: throw std::runtime_error( "Unknown kernel" );
+		}
+
+		m_trainingVectorKernelNormsSquared[ ii ] = value;
+	}
+}
+
+
+void SVM::CopyLabels(
+	void const* const trainingLabels,
+	GTSVM_Type trainingLabelsType,
+	bool const multiclass
+)
+{
+	m_trainingLabels = boost::shared_array< boost::int32_t >( new boost::int32_t[ m_rows ] );
+	SVM_Memcpy( m_trainingLabels.get(), trainingLabels, 0, trainingLabelsType, m_rows );
+
+	if ( multiclass ) {
+
+		int maximumLabel = 0;
+		for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+			int const label = m_trainingLabels[ ii ];
+			if ( label < 0 )
+				throw std::runtime_error( "multiclass labels must be nonnegative" );
+			if ( label > maximumLabel )
+				maximumLabel = label;
+		}
+		if ( maximumLabel > 65535 )
+			throw std::runtime_error( "multiclass labels cannot exceed 65535" );
+
+		m_classes = maximumLabel + 1;
+
+		boost::shared_array< bool > present( new bool[ m_classes ] );
+		std::fill( present.get(), present.get() + m_classes, false );
+		for ( unsigned int ii = 0; ii < m_rows; ++ii )
+			present[ m_trainingLabels[ ii ] ] = true;
+		for ( unsigned int ii = 0; ii < m_classes; ++ii )
+			if ( ! present[ ii ] )
+				throw std::runtime_error( "at least one example of each label in {0,1,...,max} must be present in training set" );
+	}
+	else {
+
+		m_classes = 1;
+
+		bool present[ 2 ] = { false, false };
+		for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+			if ( m_trainingLabels[ ii ] > 0 ) {
+
+				m_trainingLabels[ ii ] = 1;
+				present[ 1 ] = true;
+			}
+			else {
+
+				m_trainingLabels[ ii ] = -1;
+				present[ 0 ] = true;
+			}
+		}
+		if ( ( ! present[ 0 ] ) || ( ! present[ 1 ] ) )
+			throw std::runtime_error( "at least one positive and negative example must be present in training set" );
+	}
+}
+
+
+/*
+	Renumbers the columns which are used by the training vectors 0,1,..., in
+	the given order (GTSVM_COLUMN_ORDER_ORIGINAL keeps the current order),
+	and drops the others. This must be done before clustering, since the
+	clusters' nonzero indices are column indices.
+*/
+void SVM::CompactColumns( GTSVM_ColumnOrder const columnOrder ) {
+
+	TraceSpan span( "CompactColumns" );
+
+	// the new index of each column, or -1 if it isn't used
+	std::vector< boost::uint32_t > columnIndices( m_columns, static_cast< boost::uint32_t >( -1 ) );
+	unsigned int columns = 0;
+
+	if ( columnOrder == GTSVM_COLUMN_ORDER_ORIGINAL ) {
+
+		for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+			SparseMatrix::const_iterator jj    = m_trainingVectors.Begin( ii );
+			SparseMatrix::const_iterator jjEnd = m_trainingVectors.End( ii );
+			for ( ; jj != jjEnd; ++jj ) {
+
+				if ( jj.Index() >= m_columns )
+					throw std::runtime_error( "Training vector column index is out of bounds" );
+				columnIndices[ jj.Index() ] = 0;
+			}
+		}
+		for ( unsigned int ii = 0; ii < m_columns; ++ii )
+			if ( columnIndices[ ii ] != static_cast< boost::uint32_t >( -1 ) )
+				columnIndices[ ii ] = columns++;
+	}
+	else if ( columnOrder == GTSVM_COLUMN_ORDER_COOCCURRENCE ) {
+
+		// columns are numbered as they're first seen, visiting similar rows one after the other
+		std::vector< SVM_MinHashSignature > signatures;
+		SVM_MinHashSignatures( &signatures, m_trainingVectors, m_rows );
+
+		for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+			SparseMatrix::const_iterator jj    = m_trainingVectors.Begin( signatures[ ii ].index );
+			SparseMatrix::const_iterator jjEnd = m_trainingVectors.End( signatures[ ii ].index );
+			for ( ; jj != jjEnd; ++jj ) {
+
+				if ( jj.Index() >= m_columns )
+					throw std::runtime_error( "Training vector column index is out of bounds" );
+				if ( columnIndices[ jj.Index() ] == static_cast< boost::uint32_t >( -1 ) )
+					columnIndices[ jj.Index() ] = columns++;
+			}
+		}
+	}
+	else
+		throw std::runtime_error( "Unknown column order" );
+
+	boost::shared_array< boost::uint32_t > columnInputIndices( new boost::uint32_t[ columns ] );
+	for ( unsigned int ii = 0; ii < m_columns; ++ii )
+		if ( columnIndices[ ii ] != static_cast< boost::uint32_t >( -1 ) )
+			columnInputIndices[ columnIndices[ ii ] ] = m_columnInputIndices[ ii ];
+
+	m_trainingVectors.Renumber( columnIndices );
+	m_columns = columns;
+	m_columnInputIndices = columnInputIndices;
+	UpdateInputColumnIndices();
+}
+
+
+// inverts m_columnInputIndices, which must be distinct input columns
+void SVM::UpdateInputColumnIndices() {
+
+	boost::shared_array< boost::uint32_t > inputColumnIndices( new boost::uint32_t[ m_inputColumns ] );
+	std::fill( inputColumnIndices.get(), inputColumnIndices.get() + m_inputColumns, static_cast< boost::uint32_t >( -1 ) );
+	for ( unsigned int ii = 0; ii < m_columns; ++ii ) {
+
+		boost::uint32_t const inputColumn = m_columnInputIndices[ ii ];
+		if ( ( inputColumn >= m_inputColumns ) || ( inputColumnIndices[ inputColumn ] != static_cast< boost::uint32_t >( -1 ) ) )
+			throw std::runtime_error( "Column indices are invalid" );
+		inputColumnIndices[ inputColumn ] = ii;
+	}
+	m_inputColumnIndices = inputColumnIndices;
+}
+
+
+void SVM::ClusterTrainingVectors(
+	GTSVM_Clustering const clustering,
+	bool const smallClusters,
+	unsigned int const activeClusters
+)
+{
+	PhaseTimer timer( &m_statistics, GTSVM_PHASE_CLUSTERING );
+	TraceSpan span( "ClusterTrainingVectors" );
+
+	m_clustering = clustering;
+	m_logMaximumClusterSize = ( smallClusters ? 4 : 8 );
+	m_activeClusters = activeClusters;
+
+	{	std::vector< std::vector< unsigned int > > clusterIndices;
+		std::vector< std::vector< unsigned int > > clusterNonzeroIndices;
+		FindClusters( &clusterIndices, &clusterNonzeroIndices, m_clustering, m_logMaximumClusterSize, activeClusters );
+		m_clusterIndices        = SVM_ShareClusters( &clusterIndices        );
+		m_clusterNonzeroIndices = SVM_ShareClusters( &clusterNonzeroIndices );
+	}
+	m_clusters = m_clusterIndices->size();
+	m_shrunkClusters = 0;
+
+	// store the training vectors in cluster order, so that InitializeDevice and the batch loops walk memory sequentially
+	TraceSpan phase( "ClusterTrainingVectors: permute" );
+	m_trainingVectors.Permute( *m_clusterIndices );
+}
+
+
+void SVM::FindClusters(
+	std::vector< std::vector< unsigned int > >* const pClusterIndices,
+	std::vector< std::vector< unsigned int > >* const pClusterNonzeroIndices,
+	GTSVM_Clustering const clustering,
+	unsigned int const logMaximumClusterSize,
+	unsigned int const activeClusters
+) const
+{
+	switch( clustering ) {
+		case GTSVM_CLUSTERING_GREEDY:  FindGreedyClusters( pClusterIndices, pClusterNonzeroIndices, logMaximumClusterSize, activeClusters ); break;
+		case GTSVM_CLUSTERING_MINHASH: FindMinHashClusters( pClusterIndices, pClusterNonzeroIndices, logMaximumClusterSize ); break;
+		default: throw std::runtime_error( "Unknown clustering algorithm" );
+	}
+}
+
+
+void SVM::FindGreedyClusters(
+	std::vector< std::vector< unsigned int > >* const pClusterIndices,
+	std::vector< std::vector< unsigned int > >* const pClusterNonzeroIndices,
+	unsigned int const logMaximumClusterSize,
+	unsigned int activeClusters
+) const
+{
+	TraceSpan phase( "ClusterTrainingVectors: shuffle" );
+
+	unsigned int const densitySize = ( m_columns + 63 ) >> 6;
+
+	pClusterIndices->clear();
+	pClusterNonzeroIndices->clear();
+	unsigned int const clusters = ( ( m_rows + ( ( 1u << logMaximumClusterSize ) - 1 ) ) >> logMaximumClusterSize );
+	pClusterIndices->reserve( clusters );
+	pClusterNonzeroIndices->reserve( clusters );
+
+	activeClusters = std::min( activeClusters, clusters );
+	BOOST_ASSERT( activeClusters > 0 );
+
+	boost::shared_array< std::vector< unsigned int > > clusterIndices( new std::vector< unsigned int >[ activeClusters ] );
+	boost::shared_array< boost::shared_array< boost::uint64_t > > clusterDensities( new boost::shared_array< boost::uint64_t >[ activeClusters ] );
+	boost::shared_array< boost::uint64_t const* > clusterDensityPointers( new boost::uint64_t const*[ activeClusters ] );
+	boost::shared_array< unsigned int > clusterSizes( new unsigned int[ activeClusters ] );
+	boost::shared_array< unsigned int > clusterNonzeros( new unsigned int[ activeClusters ] );
+	for ( unsigned int ii = 0; ii < activeClusters; ++ii ) {
+
+		boost::shared_array< boost::uint64_t > clusterDensity( new boost::uint64_t[ densitySize ] );
+		std::fill( clusterDensity.get(), clusterDensity.get() + densitySize, 0 );
+		clusterDensities[ ii ] = clusterDensity;
+		clusterDensityPointers[ ii ] = clusterDensity.get();
+		clusterSizes[ ii ] = 0;
+		clusterNonzeros[ ii ] = 0;
+	}
+
+	unsigned int remainingClusters = clusters;
+	unsigned int currentClusters = std::min( remainingClusters, activeClusters );
+	remainingClusters -= currentClusters;
+
+	boost::shared_array< unsigned int > indices( new unsigned int[ m_rows ] );
+	for ( unsigned int ii = 0; ii < m_rows; ++ii )
+		indices[ ii ] = ii;
+	for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+
+		unsigned int jj = ( rand() % ( m_rows - ii ) ) + ii;
+		if ( ii != jj )
+			std::swap( indices[ ii ], indices[ jj ] );
+	}
+
+	phase.Start( "ClusterTrainingVectors: assign" );
+
+	/*
+		Each row's costs depend on the rows assigned before it, so the rows are
+		assigned in blocks. The costs of adding each of a block's rows to every
+		cluster are found in parallel, one row per task, and the rows are then
+		assigned in order, recalculating only the costs for the clusters to
+		which earlier rows of the block were added. These are recalculated
+		serially, so blocks are kept small relative to the number of clusters.
+		Filling a cluster renumbers the clusters, which ends the block early.
+		The result is the same as that of assigning the rows one at a time.
+	*/
+	boost::shared_ptr< CPU::ThreadPool > const threadPool = CPU::GetThreadPool();
+	unsigned int const blockSize = std::max( 1u, std::min( threadPool->GetThreads(), activeClusters / 8 ) );
+
+	std::vector< SVM_DensityWord > densities;
+	std::vector< size_t > densityOffsets;
+	std::vector< unsigned int > costs( blockSize * activeClusters );
+	std::vector< unsigned int > changedClusters;
+
+	unsigned int ii = 0;
+	while ( ii < m_rows ) {
+
+		unsigned int const blockBegin = ii;
+		unsigned int const blockEnd = std::min( blockBegin + blockSize, m_rows );
+
+		// the nonzero words of the rows' density bitmaps (the indices are sorted)
+		densities.clear();
+		densityOffsets.assign( 1, 0 );
+		for ( unsigned int jj = blockBegin; jj < blockEnd; ++jj ) {
+
+			SparseMatrix::const_iterator kk    = m_trainingVectors.Begin( indices[ jj ] );
+			SparseMatrix::const_iterator kkEnd = m_trainingVectors.End( indices[ jj ] );
+			for ( ; kk != kkEnd; ++kk ) {
+
+				unsigned int const word = ( kk.Index() >> 6 );
+				boost::uint64_t const bit = ( static_cast< boost::uint64_t >( 1 ) << ( kk.Index() & 63 ) );
+				if ( ( densities.size() == densityOffsets.back() ) || ( densities.back().index != word ) ) {
+
+					SVM_DensityWord const densityWord = { word, bit };
+					densities.push_back( densityWord );
+				}
+				else
+					densities.back().bits |= bit;
+			}
+			densityOffsets.push_back( densities.size() );
+		}
+
+		BOOST_ASSERT( currentClusters > 0 );
+
+		bool const parallel = ( ( blockEnd - blockBegin > 1 ) && ( currentClusters * densities.size() >= 16384 ) );
+		if ( parallel ) {
+
+			threadPool->Run(
+				blockEnd - blockBegin,
+				boost::bind(
+					&SVM_BlockClusterCosts,
+					&costs[ 0 ],
+					activeClusters,
+					clusterDensityPointers.get(),
+					clusterSizes.get(),
+					clusterNonzeros.get(),
+					SVM_VectorData( densities ),
+					&densityOffsets[ 0 ],
+					currentClusters,
+					_1
+				)
+			);
+			changedClusters.clear();
+		}
+
+		for ( ; ii < blockEnd; ++ii ) {
+
+			unsigned int const index = indices[ ii ];
+			unsigned int const row = ii - blockBegin;
+
+			unsigned int* const rowCosts = &costs[ row * activeClusters ];
+			SVM_DensityWord const* const density = SVM_VectorData( densities ) + densityOffsets[ row ];
+			size_t const rowDensitySize = densityOffsets[ row + 1 ] - densityOffsets[ row ];
+
+			if ( parallel ) {
+
+				for ( std::vector< unsigned int >::const_iterator jj = changedClusters.begin(); jj != changedClusters.end(); ++jj )
+					SVM_ClusterCosts( rowCosts, clusterDensityPointers.get(), clusterSizes.get(), clusterNonzeros.get(), density, rowDensitySize, 1, currentClusters, *jj );
+			}
+			else
+				SVM_ClusterCosts( rowCosts, clusterDensityPointers.get(), clusterSizes.get(), clusterNonzeros.get(), density, rowDensitySize, currentClusters, currentClusters, 0 );
+
+			unsigned int clusterIndex = 0;
+			unsigned int minimumCost = static_cast< unsigned int >( -1 );
+			for ( unsigned int jj = 0; jj < currentClusters; ++jj ) {
+
+				if ( rowCosts[ jj ] < minimumCost ) {
+
+					clusterIndex = jj;
+					minimumCost = rowCosts[ jj ];
+				}
+			}
+
+			clusterIndices[ clusterIndex ].push_back( index );
+			clusterSizes[ clusterIndex ] = clusterIndices[ clusterIndex ].size();
+			{	boost::uint64_t* const clusterDensity = clusterDensities[ clusterIndex ].get();
+				for ( size_t jj = 0; jj < rowDensitySize; ++jj ) {
+
+					clusterNonzeros[ clusterIndex ] += CountBits( static_cast< boost::uint64_t >( density[ jj ].bits & ~clusterDensity[ density[ jj ].index ] ) );
+					clusterDensity[ density[ jj ].index ] |= density[ jj ].bits;
+				}
+			}
+			if ( parallel && ( std::find( changedClusters.begin(), changedClusters.end(), clusterIndex ) == changedClusters.end() ) )
+				changedClusters.push_back( clusterIndex );
+
+			if ( clusterIndices[ clusterIndex ].size() >= ( 1u << logMaximumClusterSize ) ) {
+
+				pClusterIndices->push_back( std::vector< unsigned int >() );
+				pClusterIndices->back().swap( clusterIndices[ clusterIndex ] );
+				pClusterNonzeroIndices->push_back( std::vector< unsigned int >() );
+				SVM_ExtractNonzeros( &pClusterNonzeroIndices->back(), clusterDensities[ clusterIndex ].get(), densitySize, clusterNonzeros[ clusterIndex ] );
+				clusterSizes[ clusterIndex ] = 0;
+				clusterNonzeros[ clusterIndex ] = 0;
+
+				--currentClusters;
+				clusterIndices[ clusterIndex ].swap( clusterIndices[ currentClusters ] );
+				std::swap( clusterDensities[ clusterIndex ], clusterDensities[ currentClusters ] );
+				std::swap( clusterDensityPointers[ clusterIndex ], clusterDensityPointers[ currentClusters ] );
+				std::swap( clusterSizes[ clusterIndex ], clusterSizes[ currentClusters ] );
+				std::swap( clusterNonzeros[ clusterIndex ], clusterNonzeros[ currentClusters ] );
+
+				if ( remainingClusters > 0 ) {
+
+					++currentClusters;
+					--remainingClusters;
+				}
+
+				// the block's remaining costs are out of date
+				++ii;
+				break;
+			}
+		}
+	}
+	BOOST_ASSERT( remainingClusters == 0 );
+
+	phase.Start( "ClusterTrainingVectors: finish" );
+
+	for ( unsigned int ii = 0; ii < currentClusters; ++ii ) {
+
+		if ( clusterIndices[ ii ].size() > 0 ) {
+
+			pClusterIndices->push_back( std::vector< unsigned int >() );
+			pClusterIndices->back().swap( clusterIndices[ ii ] );
+			pClusterNonzeroIndices->push_back( std::vector< unsigned int >() );
+			SVM_ExtractNonzeros( &pClusterNonzeroIndices->back(), clusterDensities[ ii ].get(), densitySize, clusterNonzeros[ ii ] );
+		}
+	}
+	BOOST_ASSERT( pClusterIndices->size()        == clusters );
+	BOOST_ASSERT( pClusterNonzeroIndices->size() == clusters );
+}
+
+
+/*
+	Sorts the rows by their MinHash signatures, so that rows which share
+	their minimum-hash column (which happens with probability equal to the
+	Jaccard similarity of their sets of nonzero columns) are adjacent, as are
+	rows which also share the next, and so on. The sorted rows are then cut
+	into clusters. Unlike greedy clustering, this never needs a per-cluster
+	bitmap of nonzero columns, so its cost doesn't depend on m_columns.
+*/
+void SVM::FindMinHashClusters(
+	std::vector< std::vector< unsigned int > >* const pClusterIndices,
+	std::vector< std::vector< unsigned int > >* const pClusterNonzeroIndices,
+	unsigned int const logMaximumClusterSize
+) const
+{
+	TraceSpan phase( "ClusterTrainingVectors: signatures" );
+
+	pClusterIndices->clear();
+	pClusterNonzeroIndices->clear();
+	unsigned int const clusters = ( ( m_rows + ( ( 1u << logMaximumClusterSize ) - 1 ) ) >> logMaximumClusterSize );
+	pClusterIndices->reserve( clusters );
+	pClusterNonzeroIndices->reserve( clusters );
+
+	std::vector< SVM_MinHashSignature > signatures;
+	SVM_MinHashSignatures( &signatures, m_trainingVectors, m_rows );
+
+	phase.Start( "ClusterTrainingVectors: assign" );
+
+	std::vector< unsigned int > rows( m_rows );
+	for ( unsigned int ii = 0; ii < m_rows; ++ii )
+		rows[ ii ] = signatures[ ii ].index;
+	SVM_AppendClusters( pClusterIndices, pClusterNonzeroIndices, m_trainingVectors, m_columns, rows, logMaximumClusterSize );
+	BOOST_ASSERT( pClusterIndices->size()        == clusters );
+	BOOST_ASSERT( pClusterNonzeroIndices->size() == clusters );
+}
+
+
+/*
+	This must agree with the allocations made by the constructor and
+	InitializeDevice
+*/
+void SVM::CalculateMemoryUsage(
+	GTSVM_MemoryUsage* const pUsage,
+	std::vector< std::vector< unsigned int > > const& clusterIndices,
+	std::vector< std::vector< unsigned int > > const& clusterNonzeroIndices,
+	unsigned int const logMaximumClusterSize
+) const
+{
+	std::memset( pUsage, 0, sizeof( GTSVM_MemoryUsage ) );
+
+	unsigned long long const rows = m_rows;
+	unsigned long long const classes = m_classes;
+	unsigned long long const nonzeros = m_trainingVectors.GetNonzeros();
+	unsigned long long const clusters = clusterIndices.size();
+	unsigned long long const paddedRows = ( clusters << logMaximumClusterSize );
+	unsigned long long const batchUpdateSize = SVM_BatchUpdateSize( m_trainingVectors, m_rows, m_columns, m_logBatchSize );
+	unsigned long long const scratchClusters = SVM_ScratchClusters( logMaximumClusterSize, m_logBatchSize );
+	BOOST_ASSERT( paddedRows >= rows );
+
+	unsigned long long totalClusterSize        = 0;
+	unsigned long long totalAlignedClusterSize = 0;
+	for ( unsigned int ii = 0; ii < clusters; ++ii ) {
+
+		unsigned long long const dimension = clusterNonzeroIndices[ ii ].size();
+		totalClusterSize += dimension;
+		pUsage->maximumClusterNonzeros = std::max( pUsage->maximumClusterNonzeros, dimension );
+		totalAlignedClusterSize += ( ( dimension + 15 ) & ~15ull );
+	}
+
+	pUsage->clusters        = clusters;
+	pUsage->clusterNonzeros = totalClusterSize;
+
+	unsigned long long* const hostBytes    = pUsage->hostBytes;
+	unsigned long long* const deviceBytes  = pUsage->deviceBytes;
+	unsigned long long* const paddingBytes = pUsage->paddingBytes;
+
+	hostBytes[ GTSVM_BUFFER_TRAINING_VECTORS ] = rows * ( sizeof( boost::uint64_t ) + sizeof( boost::uint32_t ) ) + nonzeros * ( sizeof( boost::uint32_t ) + sizeof( float ) );
+	hostBytes[ GTSVM_BUFFER_NONZERO_INDICES  ] = totalClusterSize * sizeof( unsigned int );
+	hostBytes[ GTSVM_BUFFER_CLUSTERS         ] = rows * sizeof( unsigned int );
+	hostBytes[ GTSVM_BUFFER_LABELS           ] = rows * sizeof( boost::int32_t );
+	hostBytes[ GTSVM_BUFFER_NORMS            ] = 2 * rows * sizeof( float );
+	hostBytes[ GTSVM_BUFFER_RESPONSES        ] = rows * classes * sizeof( double );
+	hostBytes[ GTSVM_BUFFER_ALPHAS           ] = rows * classes * sizeof( float );
+	hostBytes[ GTSVM_BUFFER_COLUMNS          ] = ( static_cast< unsigned long long >( m_columns ) + m_inputColumns ) * sizeof( boost::uint32_t );
+	hostBytes[ GTSVM_BUFFER_BATCH            ] =
+		m_foundSize * ( sizeof( float ) + sizeof( boost::uint32_t ) ) +
+		( 1ull << ( m_logBatchSize << 1 ) ) * sizeof( double ) +
+		128 * sizeof( float ) +
+		( static_cast< unsigned long long >( m_columns ) << m_logBatchSize ) * sizeof( float ) +
+		batchUpdateSize * ( sizeof( boost::uint32_t ) + sizeof( float ) ) +
+		( classes << m_logBatchSize ) * ( sizeof( CUDA_FLOAT_DOUBLE ) + sizeof( float ) + sizeof( boost::uint32_t ) );
+
+	deviceBytes[  GTSVM_BUFFER_TRAINING_VECTORS ] = ( totalClusterSize << logMaximumClusterSize ) * sizeof( float );
+	paddingBytes[ GTSVM_BUFFER_TRAINING_VECTORS ] = ( std::max( totalClusterSize << logMaximumClusterSize, nonzeros ) - nonzeros ) * sizeof( float );
+	deviceBytes[  GTSVM_BUFFER_NONZERO_INDICES  ] = totalAlignedClusterSize * sizeof( boost::uint32_t );
+	paddingBytes[ GTSVM_BUFFER_NONZERO_INDICES  ] = ( totalAlignedClusterSize - totalClusterSize ) * sizeof( boost::uint32_t );
+	deviceBytes[  GTSVM_BUFFER_CLUSTERS         ] = ( clusters + scratchClusters ) * sizeof( CUDA::SparseKernelClusterHeader ) + ( clusters + 1 ) * sizeof( boost::uint32_t ) + ( scratchClusters << logMaximumClusterSize ) * sizeof( float );
+	deviceBytes[  GTSVM_BUFFER_LABELS           ] = paddedRows * sizeof( boost::int32_t );
+	paddingBytes[ GTSVM_BUFFER_LABELS           ] = ( paddedRows - rows ) * sizeof( boost::int32_t );
+	deviceBytes[  GTSVM_BUFFER_NORMS            ] = 2 * paddedRows * sizeof( float );
+	paddingBytes[ GTSVM_BUFFER_NORMS            ] = 2 * ( paddedRows - rows ) * sizeof( float );
+	deviceBytes[  GTSVM_BUFFER_RESPONSES        ] = paddedRows * classes * sizeof( CUDA_FLOAT_DOUBLE );
+	paddingBytes[ GTSVM_BUFFER_RESPONSES        ] = ( paddedRows - rows ) * classes * sizeof( CUDA_FLOAT_DOUBLE );
+	deviceBytes[  GTSVM_BUFFER_ALPHAS           ] = paddedRows * classes * sizeof( float );
+	paddingBytes[ GTSVM_BUFFER_ALPHAS           ] = ( paddedRows - rows ) * classes * sizeof( float );
+	deviceBytes[  GTSVM_BUFFER_WORK             ] = ARRAYLENGTH( m_deviceWork ) * SVM_WorkSize( clusters, classes, logMaximumClusterSize, m_logBatchSize );
+
+	// the batch buffers are mirrored, so only take up device memory if it's separate from host memory
+	if ( ! m_backend->IsHostMemory() ) {
+
+		deviceBytes[ GTSVM_BUFFER_BATCH ] =
+			128 * sizeof( float ) +
+			( static_cast< unsigned long long >( m_columns ) << m_logBatchSize ) * sizeof( float ) +
+			batchUpdateSize * ( sizeof( boost::uint32_t ) + sizeof( float ) ) +
+			( classes << m_logBatchSize ) * ( sizeof( CUDA_FLOAT_DOUBLE ) + sizeof( float ) + sizeof( boost::uint32_t ) );
+	}
+}
+
+
+void SVM::InitializeDevice() {
+
+	if ( m_initializedDevice )
+		throw std::runtime_error( "SVM has already been initialized" );
+	m_initializedDevice = true;
+
+	TraceSpan span( "InitializeDevice" );
+
+	m_deviceGeneration = SVM_NextDeviceGeneration();
+
+	TraceSpan phase( "InitializeDevice: batch" );
+	m_batchUpdateSize = SVM_BatchUpdateSize( m_trainingVectors, m_rows, m_columns, m_logBatchSize );
+	m_batchVectors.Allocate( m_backend, m_columns, m_logBatchSize, m_batchUpdateSize );
+
+	m_backend->HostAllocate(
+		"Failed to allocate space for batch responses on host",
+		&m_batchResponses, ( m_classes << m_logBatchSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+	);
+	m_backend->MirrorAllocate(
+		"Failed to allocate space for batch responses on device",
+		m_batchResponses, &m_deviceBatchResponses, ( m_classes << m_logBatchSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+	);
+
+	m_backend->HostAllocate(
+		"Failed to allocate space for batch alphas on host",
+		&m_batchAlphas, ( m_classes << m_logBatchSize ) * sizeof( float )
+	);
+	m_backend->MirrorAllocate(
+		"Failed to allocate space for batch alphas on device",
+		m_batchAlphas, &m_deviceBatchAlphas, ( m_classes << m_logBatchSize ) * sizeof( float )
+	);
+
+	m_backend->HostAllocate(
+		"Failed to allocate space for batch indices on host",
+		&m_batchIndices, ( m_classes << m_logBatchSize ) * sizeof( boost::uint32_t )
+	);
+	m_backend->MirrorAllocate(
+		"Failed to allocate space for batch indices on device",
+		m_batchIndices, &m_deviceBatchIndices, ( m_classes << m_logBatchSize ) * sizeof( boost::uint32_t )
+	);
+
+	phase.Start( "InitializeDevice: labels" );
+	m_backend->DeviceAllocate(
+		"Failed to allocate space for training labels on device",
+		&m_deviceTrainingLabels, ( m_clusters << m_logMaximumClusterSize ) * sizeof( boost::int32_t )
+	);
+	{	boost::int32_t* const trainingLabels = static_cast< boost::int32_t* >(
+			m_backend->BeginUpload(
+				"Failed to allocate space for training labels on host",
+				m_deviceTrainingLabels,
+				( m_clusters << m_logMaximumClusterSize ) * sizeof( boost::int32_t )
+			)
+		);
+
+		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+
+			unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+			for ( unsigned int jj = 0; jj < size; ++jj )
+				trainingLabels[ ( ii << m_logMaximumClusterSize ) + jj ] = m_trainingLabels[ ( *m_clusterIndices )[ ii ][ jj ] ];
+			for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
+				trainingLabels[ ( ii << m_logMaximumClusterSize ) + jj ] = 0;
+		}
+		m_backend->EndUpload(
+			"Failed to copy training labels to device",
+			m_deviceTrainingLabels,
+			trainingLabels,
+			( m_clusters << m_logMaximumClusterSize ) * sizeof( boost::int32_t )
+		);
+	}
+
+	phase.Start( "InitializeDevice: norms" );
+	m_backend->DeviceAllocate(
+		"Failed to allocate space for training vector squared norms on device",
+		&m_deviceTrainingVectorNormsSquared, ( m_clusters << m_logMaximumClusterSize ) * sizeof( float )
+	);
+	{	float* const trainingVectorNormsSquared = static_cast< float* >(
+			m_backend->BeginUpload(
+				"Failed to allocate space for training vector squared norms on host",
+				m_deviceTrainingVectorNormsSquared,
+				( m_clusters << m_logMaximumClusterSize ) * sizeof( float )
+			)
+		);
+
+		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+
+			unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+			for ( unsigned int jj = 0; jj < size; ++jj )
+				trainingVectorNormsSquared[ ( ii << m_logMaximumClusterSize ) + jj ] = m_trainingVectorNormsSquared[ ( *m_clusterIndices )[ ii ][ jj ] ];
+			for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
+				trainingVectorNormsSquared[ ( ii << m_logMaximumClusterSize ) + jj ] = 0;
+		}
+		m_backend->EndUpload(
+			"Failed to copy training vector squared norms to device",
+			m_deviceTrainingVectorNormsSquared,
+			trainingVectorNormsSquared,
+			( m_clusters << m_logMaximumClusterSize ) * sizeof( float )
+		);
+	}
+
+	phase.Start( "InitializeDevice: kernel norms" );
+	m_backend->DeviceAllocate(
+		"Failed to allocate space for training vector kernel squared norms on device",
+		&m_deviceTrainingVectorKernelNormsSquared, ( m_clusters << m_logMaximumClusterSize ) * sizeof( float )
+	);
+	UploadKernelNorms();
+
+	phase.Start( "InitializeDevice: responses" );
+	m_backend->DeviceAllocate(
+		"Failed to allocate space for training responses on device",
+		&m_deviceTrainingResponses, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+	);
+	{	CUDA_FLOAT_DOUBLE* const trainingResponses = static_cast< CUDA_FLOAT_DOUBLE* >(
+			m_backend->BeginUpload(
+				"Failed to allocate space for training responses on host",
+				m_deviceTrainingResponses,
+				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+			)
+		);
+
+		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+
+			unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+			for ( unsigned int jj = 0; jj < size; ++jj )
+				for ( unsigned int kk = 0; kk < m_classes; ++kk )
+					trainingResponses[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = m_trainingResponses[ ( *m_clusterIndices )[ ii ][ jj ] * m_classes + kk ];
+			for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
+				for ( unsigned int kk = 0; kk < m_classes; ++kk )
+					trainingResponses[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = 0;
+		}
+		m_backend->EndUpload(
+			"Failed to copy training responses to device",
+			m_deviceTrainingResponses,
+			trainingResponses,
+			( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+		);
+	}
+	m_updatedResponses = true;
+
+	phase.Start( "InitializeDevice: alphas" );
+	m_backend->DeviceAllocate(
+		"Failed to allocate space for training alphas on device",
+		&m_deviceTrainingAlphas, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float )
+	);
+	{	if ( m_classes == 1 ) {
+
+			for ( unsigned int ii = 0; ii < m_rows; ++ii )
+				if ( ! ( m_trainingLabels[ ii ] > 0 ) )
+					m_trainingAlphas[ ii ] = -m_trainingAlphas[ ii ];
+		}
+
+		float* const trainingAlphas = static_cast< float* >(
+			m_backend->BeginUpload(
+				"Failed to allocate space for training alphas on host",
 				m_deviceTrainingAlphas,
-				trainingAlphas,
-				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float ),
-				cudaMemcpyHostToDevice
+				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float )
+			)
+		);
+
+		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+
+			unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+			for ( unsigned int jj = 0; jj < size; ++jj )
+				for ( unsigned int kk = 0; kk < m_classes; ++kk )
+					trainingAlphas[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = m_trainingAlphas[ ( *m_clusterIndices )[ ii ][ jj ] * m_classes + kk ];
+			for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
+				for ( unsigned int kk = 0; kk < m_classes; ++kk )
+					trainingAlphas[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = 0;
+		}
+		m_backend->EndUpload(
+			"Failed to copy training alphas to device",
+			m_deviceTrainingAlphas,
+			trainingAlphas,
+			( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float )
+		);
+
+		if ( m_classes == 1 ) {
+
+			for ( unsigned int ii = 0; ii < m_rows; ++ii )
+				if ( ! ( m_trainingLabels[ ii ] > 0 ) )
+					m_trainingAlphas[ ii ] = -m_trainingAlphas[ ii ];
+		}
+	}
+
+	phase.Start( "InitializeDevice: clusters" );
+	unsigned int const scratchClusters = SVM_ScratchClusters( m_logMaximumClusterSize, m_logBatchSize );
+	m_backend->DeviceAllocate(
+		"Failed to allocate space for scratch alphas on device",
+		&m_deviceScratchAlphas, ( scratchClusters << m_logMaximumClusterSize ) * sizeof( float )
+	);
+	m_backend->DeviceAllocate(
+		"Failed to allocate space for cluster headers on device",
+		&m_deviceClusterHeaders, ( m_clusters + scratchClusters ) * sizeof( CUDA::SparseKernelClusterHeader )
+	);
+	m_backend->DeviceAllocate(
+		"Failed to allocate space for cluster size sums on device",
+		&m_deviceClusterSizeSums, ( m_clusters + 1 ) * sizeof( boost::uint32_t )
+	);
+	{	unsigned int totalClusterSize        = 0;
+		unsigned int totalAlignedClusterSize = 0;
+		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+
+			unsigned int const dimension = ( *m_clusterNonzeroIndices )[ ii ].size();
+			unsigned int const alignedDimension = ( ( dimension + 15 ) & ~15 );
+
+			totalClusterSize += dimension;
+			totalAlignedClusterSize += ( ( alignedDimension + 15 ) & ~15 );
+		}
+
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for nonzero indices on device",
+			&m_deviceNonzeroIndices, totalAlignedClusterSize * sizeof( boost::uint32_t )
+		);
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for training vectors on device",
+			&m_deviceTrainingVectorsTranspose, ( totalClusterSize << m_logMaximumClusterSize ) * sizeof( float )
+		);
+		boost::uint32_t* pDeviceNonzeroIndices           = m_deviceNonzeroIndices;
+		float*    pDeviceTrainingVectorsTranspose = m_deviceTrainingVectorsTranspose;
+
+		CUDA::SparseKernelClusterHeader* const clusterHeaders = static_cast< CUDA::SparseKernelClusterHeader* >(
+			m_backend->BeginUpload(
+				"Failed to allocate space for cluster headers on host",
+				m_deviceClusterHeaders,
+				( m_clusters + scratchClusters ) * sizeof( CUDA::SparseKernelClusterHeader )
+			)
+		);
+
+		boost::uint32_t* const clusterSizeSums = static_cast< boost::uint32_t* >(
+			m_backend->BeginUpload(
+				"Failed to allocate space for cluster size sums on host",
+				m_deviceClusterSizeSums,
+				( m_clusters + 1 ) * sizeof( boost::uint32_t )
 			)
 		);
-		CUDA_VERIFY( "Failed to free training alphas on host", cudaFreeHost( trainingAlphas ) );
-#endif    // 0/1
+
+		// if the backend works in host memory, we write each cluster in place
+		boost::uint32_t* nonzeroIndicesBuffer = NULL;
+		float* trainingVectorsTransposeBuffer = NULL;
+		if ( ! m_backend->IsHostMemory() ) {
+
+			m_backend->HostAllocate(
+				"Failed to allocate space for nonzero indices on host",
+				&nonzeroIndicesBuffer, ( ( m_columns + 15 ) & ~15 ) * sizeof( boost::uint32_t )
+			);
+			m_backend->HostAllocate(
+				"Failed to allocate space for transposed training vectors on host",
+				&trainingVectorsTransposeBuffer, ( m_columns << m_logMaximumClusterSize ) * sizeof( float )
+			);
+		}
+
+		clusterSizeSums[ 0 ] = 0;
+		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+
+			unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+
+			unsigned int const dimension = ( *m_clusterNonzeroIndices )[ ii ].size();
+			unsigned int const alignedDimension = ( ( dimension + 15 ) & ~15 );
+
+			boost::uint32_t* const nonzeroIndices = ( m_backend->IsHostMemory() ? pDeviceNonzeroIndices : nonzeroIndicesBuffer );
+			float* const trainingVectorsTranspose = ( m_backend->IsHostMemory() ? pDeviceTrainingVectorsTranspose : trainingVectorsTransposeBuffer );
+
+			for ( unsigned int jj = 0; jj < dimension; ++jj )
+				nonzeroIndices[ jj ] = ( *m_clusterNonzeroIndices )[ ii ][ jj ];
+			for ( unsigned int jj = dimension; jj < alignedDimension; ++jj )
+				nonzeroIndices[ jj ] = 0;
+			m_backend->CopyToDevice(
+				"Failed to copy nonzero indices to device",
+				pDeviceNonzeroIndices,
+				nonzeroIndices,
+				alignedDimension * sizeof( boost::uint32_t )
+			);
+
+			for ( unsigned int jj = 0; jj < size; ++jj ) {
+
+				unsigned int const index = ( *m_clusterIndices )[ ii ][ jj ];
+
+				unsigned int mm = 0;
+
+				SparseMatrix::const_iterator kk    = m_trainingVectors.Begin( index );
+				SparseMatrix::const_iterator kkEnd = m_trainingVectors.End( index );
+
+				std::vector< unsigned int >::const_iterator ll    = ( *m_clusterNonzeroIndices )[ ii ].begin();
+				std::vector< unsigned int >::const_iterator llEnd = ( *m_clusterNonzeroIndices )[ ii ].end();
+
+				while ( ( kk != kkEnd ) && ( ll != llEnd ) ) {
+
+					BOOST_ASSERT( *ll <= kk.Index() );
+					if ( *ll < kk.Index() ) {
+
+						trainingVectorsTranspose[ ( mm << m_logMaximumClusterSize ) + jj ] = 0;
+						++mm;
+						++ll;
+					}
+					else {
+
+						trainingVectorsTranspose[ ( mm << m_logMaximumClusterSize ) + jj ] = kk.Value();
+						++mm;
+						++ll;
+						++kk;
+					}
+				}
+				for ( ; ll != llEnd; ++mm, ++ll )
+					trainingVectorsTranspose[ ( mm << m_logMaximumClusterSize ) + jj ] = 0;
+			}
+			m_backend->CopyToDevice(
+				"Failed to copy transposed training vectors to device",
+				pDeviceTrainingVectorsTranspose,
+				trainingVectorsTranspose,
+				( dimension << m_logMaximumClusterSize ) * sizeof( float )
+			);
+
+			clusterHeaders[ ii ].size = size;
+			clusterHeaders[ ii ].nonzeros = ( *m_clusterNonzeroIndices )[ ii ].size();
+
+			clusterHeaders[ ii ].responses = m_deviceTrainingResponses + ( ( ii * m_classes ) << m_logMaximumClusterSize );
+			clusterHeaders[ ii ].labels = m_deviceTrainingLabels + ( ii << m_logMaximumClusterSize );
+			clusterHeaders[ ii ].alphas = m_deviceTrainingAlphas + ( ( ii * m_classes ) << m_logMaximumClusterSize );
+
+			clusterHeaders[ ii ].nonzeroIndices = pDeviceNonzeroIndices;
+			clusterHeaders[ ii ].vectorsTranspose = pDeviceTrainingVectorsTranspose;
+			clusterHeaders[ ii ].vectorNormsSquared = m_deviceTrainingVectorNormsSquared + ( ii << m_logMaximumClusterSize );
+			clusterHeaders[ ii ].vectorKernelNormsSquared = m_deviceTrainingVectorKernelNormsSquared + ( ii << m_logMaximumClusterSize );
+
+			clusterSizeSums[ ii + 1 ] = clusterSizeSums[ ii ] + size;
+
+			pDeviceNonzeroIndices += alignedDimension;
+			pDeviceTrainingVectorsTranspose += ( dimension << m_logMaximumClusterSize );;
+		}
+		SVM_ScratchClusterHeaders( clusterHeaders + m_clusters, m_deviceScratchAlphas, m_logMaximumClusterSize, m_logBatchSize );
+
+		m_backend->EndUpload(
+			"Failed to copy cluster headers to device",
+			m_deviceClusterHeaders,
+			clusterHeaders,
+			( m_clusters + scratchClusters ) * sizeof( CUDA::SparseKernelClusterHeader )
+		);
+
+		m_backend->EndUpload(
+			"Failed to copy cluster size sums to device",
+			m_deviceClusterSizeSums,
+			clusterSizeSums,
+			( m_clusters + 1 ) * sizeof( boost::uint32_t )
+		);
+
+		if ( nonzeroIndicesBuffer != NULL )
+			m_backend->HostFree( "Failed to free nonzero indices on host", nonzeroIndicesBuffer );
+		if ( trainingVectorsTransposeBuffer != NULL )
+			m_backend->HostFree( "Failed to free transposed training vectors on host", trainingVectorsTransposeBuffer );
+	}
+
+	phase.Start( "InitializeDevice: work" );
+	m_workSize = SVM_WorkSize( m_clusters, m_classes, m_logMaximumClusterSize, m_logBatchSize );
+	for ( unsigned int ii = 0; ii < ARRAYLENGTH( m_deviceWork ); ++ii ) {
+
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for work on device",
+			&m_deviceWork[ ii ],
+			m_workSize
+		);
 	}
 }
 
 
-std::pair< CUDA_FLOAT_DOUBLE, CUDA_FLOAT_DOUBLE > const SVM::Optimize( unsigned int const iterations ) {
+void SVM::ReleaseDevice() {
 
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
-	if ( ! m_initializedDevice )
-		InitializeDevice();
+	BOOST_ASSERT( m_initializedHost );
 	BOOST_ASSERT( m_initializedDevice );
+	m_initializedDevice = false;
 
-	bool progress = false;
-	if ( m_biased ) {
+	// our session's buffers are sized for the device buffers which we're about to free
+	if ( m_session )
+		m_session->Cleanup();
 
-		if ( m_classes != 1 )
-			throw std::runtime_error( "Multiclass is only implemented for problems without an unregularized bias" );
+	for ( unsigned int ii = 0; ii < ARRAYLENGTH( m_deviceWork ); ++ii ) {
 
-		progress = true;
-		for ( unsigned int ii = 0; progress && ( ii < iterations ); ii += 16 )
-			progress = IterateBiasedBinary();
+		if ( m_deviceWork[ ii ] != NULL ) {
 
-		CUDA_FLOAT_DOUBLE numerator = 0;
-		boost::uint32_t denominator = 0;
-		std::pair< CUDA_FLOAT_DOUBLE const*, boost::uint32_t const* > const deviceResult = CUDA::SparseCalculateBias(
-			m_deviceWork[ 0 ],
-			m_deviceWork[ 1 ],
-			m_deviceWork[ 2 ],
-			m_deviceWork[ 3 ],
-			m_deviceClusterHeaders,
-			m_logMaximumClusterSize,
-			m_clusters,
-			m_workSize,
-			m_regularization
-		);
-		CUDA_VERIFY(
-			"Failed to copy bias numerator from device",
-			cudaMemcpy(
-				&numerator,
-				deviceResult.first,
-				sizeof( CUDA_FLOAT_DOUBLE ),
-				cudaMemcpyDeviceToHost
-			)
-		);
-		CUDA_VERIFY(
-			"Failed to copy bias denominator from device",
-			cudaMemcpy(
-				&denominator,
-				deviceResult.second,
-				sizeof( boost::uint32_t ),
-				cudaMemcpyDeviceToHost
-			)
-		);
+			m_backend->DeviceFree( "Failed to free work on device", m_deviceWork[ ii ] );
+			m_deviceWork[ ii ] = NULL;
+		}
+	}
 
-		m_bias = ( ( denominator != 0 ) ? ( numerator / denominator ) : 0 );
+	m_batchVectors.Cleanup();
+
+	if ( m_deviceBatchResponses != NULL ) {
+
+		m_backend->MirrorFree( "Failed to free batch responses on device", m_batchResponses, m_deviceBatchResponses );
+		m_deviceBatchResponses = NULL;
 	}
-	else {
+	if ( m_batchResponses != NULL ) {
 
-		if ( m_classes == 1 ) {
+		m_backend->HostFree( "Failed to free batch responses on host", m_batchResponses );
+		m_batchResponses = NULL;
+	}
 
-			progress = true;
-			for ( unsigned int ii = 0; progress && ( ii < iterations ); ii += 16 )
-				progress = IterateUnbiasedBinary();
+	if ( m_deviceBatchAlphas != NULL ) {
 
-			BOOST_ASSERT( m_bias == 0 );
-		}
-		else {
+		m_backend->MirrorFree( "Failed to free batch alphas on device", m_batchAlphas, m_deviceBatchAlphas );
+		m_deviceBatchAlphas = NULL;
+	}
+	if ( m_batchAlphas != NULL ) {
 
-			progress = true;
-			for ( unsigned int ii = 0; progress && ( ii < iterations ); ii += 16 )
-				progress = IterateUnbiasedMulticlass();
-		}
+		m_backend->HostFree( "Failed to free batch alphas on host", m_batchAlphas );
+		m_batchAlphas = NULL;
 	}
 
-	CUDA_FLOAT_DOUBLE primal =  std::numeric_limits< CUDA_FLOAT_DOUBLE >::infinity();
-	CUDA_FLOAT_DOUBLE dual   = -std::numeric_limits< CUDA_FLOAT_DOUBLE >::infinity();
+	if ( m_deviceBatchIndices != NULL ) {
 
-	std::pair< CUDA_FLOAT_DOUBLE const*, CUDA_FLOAT_DOUBLE const* > const deviceResult = CUDA::SparseCalculateObjectives(
-		m_deviceWork[ 0 ],
-		m_deviceWork[ 1 ],
-		m_deviceWork[ 2 ],
-		m_deviceWork[ 3 ],
-		m_deviceClusterHeaders,
-		m_logMaximumClusterSize,
-		m_clusters,
-		m_classes,
-		m_workSize,
-		m_regularization,
-		m_bias
-	);
-	CUDA_VERIFY(
-		"Failed to copy primal objective value from device",
-		cudaMemcpy(
-			&primal,
-			deviceResult.first,
-			sizeof( CUDA_FLOAT_DOUBLE ),
-			cudaMemcpyDeviceToHost
-		)
-	);
-	CUDA_VERIFY(
-		"Failed to copy dual objective value from device",
-		cudaMemcpy(
-			&dual,
-			deviceResult.second,
-			sizeof( CUDA_FLOAT_DOUBLE ),
-			cudaMemcpyDeviceToHost
-		)
-	);
+		m_backend->MirrorFree( "Failed to free batch indices on device", m_batchIndices, m_deviceBatchIndices );
+		m_deviceBatchIndices = NULL;
+	}
+	if ( m_batchIndices != NULL ) {
 
-	m_updatedResponses = false;
+		m_backend->HostFree( "Failed to free batch indices on host", m_batchIndices );
+		m_batchIndices = NULL;
+	}
 
-	if ( ! progress )
-		throw std::runtime_error( "An iteration made no progress" );
+	if ( m_deviceTrainingLabels != NULL ) {
 
-	return std::pair< CUDA_FLOAT_DOUBLE, CUDA_FLOAT_DOUBLE >( primal, dual );
+		m_backend->DeviceFree( "Failed to free training labels on device", m_deviceTrainingLabels );
+		m_deviceTrainingLabels = NULL;
+	}
+	if ( m_deviceTrainingVectorNormsSquared != NULL ) {
+
+		m_backend->DeviceFree( "Failed to free training vector squared norms on device", m_deviceTrainingVectorNormsSquared );
+		m_deviceTrainingVectorNormsSquared = NULL;
+	}
+	if ( m_deviceTrainingVectorKernelNormsSquared != NULL ) {
+
+		m_backend->DeviceFree( "Failed to free training vector kernel squared norms on device", m_deviceTrainingVectorKernelNormsSquared );
+		m_deviceTrainingVectorKernelNormsSquared = NULL;
+	}
+	if ( m_deviceTrainingResponses != NULL ) {
+
+		m_backend->DeviceFree( "Failed to free training responses on device", m_deviceTrainingResponses );
+		m_deviceTrainingResponses = NULL;
+	}
+	if ( m_deviceTrainingAlphas != NULL ) {
+
+		m_backend->DeviceFree( "Failed to free training alphas on device", m_deviceTrainingAlphas );
+		m_deviceTrainingAlphas = NULL;
+	}
+	if ( m_deviceNonzeroIndices != NULL ) {
+
+		m_backend->DeviceFree( "Failed to nonzero indices on device", m_deviceNonzeroIndices );
+		m_deviceNonzeroIndices = NULL;
+	}
+	if ( m_deviceTrainingVectorsTranspose != NULL ) {
+
+		m_backend->DeviceFree( "Failed to free training vectors on device", m_deviceTrainingVectorsTranspose );
+		m_deviceTrainingVectorsTranspose = NULL;
+	}
+	if ( m_deviceClusterHeaders != NULL ) {
+
+		m_backend->DeviceFree( "Failed to free cluster headers on device", m_deviceClusterHeaders );
+		m_deviceClusterHeaders = NULL;
+	}
+	if ( m_deviceClusterSizeSums != NULL ) {
+
+		m_backend->DeviceFree( "Failed to free cluster size sums on device", m_deviceClusterSizeSums );
+		m_deviceClusterSizeSums = NULL;
+	}
+	if ( m_deviceScratchAlphas != NULL ) {
+
+		m_backend->DeviceFree( "Failed to free scratch alphas on device", m_deviceScratchAlphas );
+		m_deviceScratchAlphas = NULL;
+	}
 }
 
 
-void SVM::ClassifySparse(
-	void* const result,
-	GTSVM_Type resultType,
-	void const* const vectors,    // order depends on columnMajor flag
-	size_t const* const vectorIndices,
-	size_t const* const vectorOffsets,
-	GTSVM_Type vectorsType,
-	unsigned int const rows,
-	unsigned int const columns,
-	bool const columnMajor
-)
-{
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
-	if ( ! m_initializedDevice )
-		InitializeDevice();
+/*
+	The new layout is allocated alongside the old one, and everything but the
+	nonzero indices and cluster headers is gathered from the old layout on the
+	device (so nothing needs to be downloaded, and only the layout itself
+	uploaded), after which the old layout is freed. The work buffers are
+	replaced too, if the new layout needs larger ones. If anything fails, the
+	old layout and work buffers are left in place. The batch buffers don't
+	depend on the layout, so are kept
+*/
+void SVM::RepackDevice( std::vector< boost::uint32_t > const& sources ) {
+
 	BOOST_ASSERT( m_initializedDevice );
+	BOOST_ASSERT( sources.size() == ( m_clusters << m_logMaximumClusterSize ) );
 
-	// **TODO: it would be nice to not copy all of this
-	boost::shared_array< SparseVector > sparseVectors( new SparseVector[ rows ] );
-	SVM_SparseSparseMemcpy2d( sparseVectors.get(), vectors, vectorIndices, vectorOffsets, vectorsType, rows, columns, columnMajor );
+	TraceSpan span( "RepackDevice" );
 
-	// **TODO: it would be nice to not copy all of this
-	boost::shared_array< CUDA_FLOAT_DOUBLE > classifications( new CUDA_FLOAT_DOUBLE[ rows * m_classes ] );
+	unsigned int const scratchClusters = SVM_ScratchClusters( m_logMaximumClusterSize, m_logBatchSize );
 
-	for ( unsigned int ii = 0; ii < rows; ii += 16 ) {
+	boost::int32_t* deviceTrainingLabels = NULL;
+	float* deviceTrainingVectorNormsSquared = NULL;
+	float* deviceTrainingVectorKernelNormsSquared = NULL;
+	CUDA_FLOAT_DOUBLE* deviceTrainingResponses = NULL;
+	float* deviceTrainingAlphas = NULL;
+	boost::uint32_t* deviceNonzeroIndices = NULL;
+	float* deviceTrainingVectorsTranspose = NULL;
+	CUDA::SparseKernelClusterHeader* deviceClusterHeaders = NULL;
+	boost::uint32_t* deviceClusterSizeSums = NULL;
+	boost::uint32_t* deviceSources = NULL;
 
-		unsigned int const batchSize = std::min( 16u, rows - ii );
+	// the work buffers (and so those of sessions) only need to grow if there are more clusters
+	size_t const workSize = SVM_WorkSize( m_clusters, m_classes, m_logMaximumClusterSize, m_logBatchSize );
+	void* deviceWork[ ARRAYLENGTH( m_deviceWork ) ] = { NULL };
 
-		for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
+	try {
 
-			double accumulator = 0;
+		if ( workSize > m_workSize ) {
 
-			unsigned int ll = 0;
-			SparseVector::const_iterator kk    = sparseVectors[ ii + jj ].begin();
-			SparseVector::const_iterator kkEnd = sparseVectors[ ii + jj ].end();
-			for ( ; ( kk != kkEnd ) && ( kk->first < m_columns ); ++kk ) {
+			for ( unsigned int ii = 0; ii < ARRAYLENGTH( deviceWork ); ++ii ) {
 
-				for ( ; ll < kk->first; ++ll )
-					m_batchVectorsTranspose[ ll * 16 + jj ] = 0;
-				m_batchVectorsTranspose[ ll * 16 + jj ] = kk->second;
-				accumulator += Square( kk->second );
-				++ll;
+				m_backend->DeviceAllocate(
+					"Failed to allocate space for work on device",
+					&deviceWork[ ii ],
+					workSize
+				);
 			}
-			for ( ; ll < m_columns; ++ll )
-				m_batchVectorsTranspose[ ll * 16 + jj ] = 0;
-
-			m_batchVectorNormsSquared[ jj ] = accumulator;
 		}
 
-		CUDA_VERIFY(
-			"Failed to copy batch to device",
-			cudaMemcpy(
-				m_deviceBatchVectorsTranspose,
-				m_batchVectorsTranspose,
-				( m_columns << 4 ) * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for training labels on device",
+			&deviceTrainingLabels, ( m_clusters << m_logMaximumClusterSize ) * sizeof( boost::int32_t )
 		);
-
-		CUDA_VERIFY(
-			"Failed to copy batch squared norms to device",
-			cudaMemcpy(
-				m_deviceBatchVectorNormsSquared,
-				m_batchVectorNormsSquared,
-				batchSize * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for training vector squared norms on device",
+			&deviceTrainingVectorNormsSquared, ( m_clusters << m_logMaximumClusterSize ) * sizeof( float )
 		);
-
-		CUDA_FLOAT_DOUBLE const* const deviceResult = CUDA::SparseEvaluateKernel(
-			m_deviceWork[ 0 ],
-			m_deviceWork[ 1 ],
-			m_deviceBatchVectorsTranspose,
-			m_deviceBatchVectorNormsSquared,
-			m_deviceClusterHeaders,
-			m_logMaximumClusterSize,
-			m_clusters,
-			m_classes,
-			m_workSize,
-			m_kernel,
-			m_kernelParameter1,
-			m_kernelParameter2,
-			m_kernelParameter3
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for training vector kernel squared norms on device",
+			&deviceTrainingVectorKernelNormsSquared, ( m_clusters << m_logMaximumClusterSize ) * sizeof( float )
+		);
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for training responses on device",
+			&deviceTrainingResponses, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+		);
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for training alphas on device",
+			&deviceTrainingAlphas, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float )
 		);
 
-		CUDA_VERIFY(
-			"Failed to copy classifications from device",
-			cudaMemcpy(
-				m_batchResponses,
-				deviceResult,
-				batchSize * m_classes * sizeof( CUDA_FLOAT_DOUBLE ),
-				cudaMemcpyDeviceToHost
-			)
+		unsigned int totalClusterSize        = 0;
+		unsigned int totalAlignedClusterSize = 0;
+		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+
+			unsigned int const dimension = ( *m_clusterNonzeroIndices )[ ii ].size();
+			totalClusterSize += dimension;
+			totalAlignedClusterSize += ( ( dimension + 15 ) & ~15 );
+		}
+
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for nonzero indices on device",
+			&deviceNonzeroIndices, totalAlignedClusterSize * sizeof( boost::uint32_t )
+		);
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for training vectors on device",
+			&deviceTrainingVectorsTranspose, ( totalClusterSize << m_logMaximumClusterSize ) * sizeof( float )
+		);
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for cluster headers on device",
+			&deviceClusterHeaders, ( m_clusters + scratchClusters ) * sizeof( CUDA::SparseKernelClusterHeader )
+		);
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for cluster size sums on device",
+			&deviceClusterSizeSums, ( m_clusters + 1 ) * sizeof( boost::uint32_t )
 		);
 
-		for ( unsigned int jj = 0; jj < batchSize; ++jj )
-			for ( unsigned int kk = 0; kk < m_classes; ++kk )
-				classifications[ ( ii + jj ) * m_classes + kk ] = m_batchResponses[ kk * 16 + jj ];
-	}
+		{	boost::uint32_t* const nonzeroIndices = static_cast< boost::uint32_t* >(
+				m_backend->BeginUpload(
+					"Failed to allocate space for nonzero indices on host",
+					deviceNonzeroIndices,
+					totalAlignedClusterSize * sizeof( boost::uint32_t )
+				)
+			);
+			CUDA::SparseKernelClusterHeader* const clusterHeaders = static_cast< CUDA::SparseKernelClusterHeader* >(
+				m_backend->BeginUpload(
+					"Failed to allocate space for cluster headers on host",
+					deviceClusterHeaders,
+					( m_clusters + scratchClusters ) * sizeof( CUDA::SparseKernelClusterHeader )
+				)
+			);
+			boost::uint32_t* const clusterSizeSums = static_cast< boost::uint32_t* >(
+				m_backend->BeginUpload(
+					"Failed to allocate space for cluster size sums on host",
+					deviceClusterSizeSums,
+					( m_clusters + 1 ) * sizeof( boost::uint32_t )
+				)
+			);
 
-	if ( m_biased ) {
+			unsigned int nonzeroIndicesOffset = 0;
+			unsigned int trainingVectorsTransposeOffset = 0;
 
-		CUDA_FLOAT_DOUBLE* ii    = classifications.get();
-		CUDA_FLOAT_DOUBLE* iiEnd = ii + rows * m_classes;
-		for ( ; ii != iiEnd; ++ii )
-			*ii += m_bias;
-	}
+			clusterSizeSums[ 0 ] = 0;
+			for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
 
-	SVM_ReverseMemcpy2d( result, resultType, classifications.get(), rows, m_classes, columnMajor );
-}
+				unsigned int const size = ( *m_clusterIndices )[ ii ].size();
 
+				unsigned int const dimension = ( *m_clusterNonzeroIndices )[ ii ].size();
+				unsigned int const alignedDimension = ( ( dimension + 15 ) & ~15 );
 
-void SVM::ClassifyDense(
-	void* const result,
-	GTSVM_Type resultType,
-	void const* const vectors,    // order depends on columnMajor flag
-	GTSVM_Type vectorsType,
-	unsigned int const rows,
-	unsigned int const columns,
-	bool const columnMajor
-)
-{
-	if ( ! m_initializedHost )
-		throw std::runtime_error( "SVM has not been initialized" );
-	if ( ! m_initializedDevice )
-		InitializeDevice();
-	BOOST_ASSERT( m_initializedDevice );
+				for ( unsigned int jj = 0; jj < dimension; ++jj )
+					nonzeroIndices[ nonzeroIndicesOffset + jj ] = ( *m_clusterNonzeroIndices )[ ii ][ jj ];
+				for ( unsigned int jj = dimension; jj < alignedDimension; ++jj )
+					nonzeroIndices[ nonzeroIndicesOffset + jj ] = 0;
 
-	// **TODO: it would be nice to not copy all of this
-	boost::shared_array< CUDA_FLOAT_DOUBLE > classifications( new CUDA_FLOAT_DOUBLE[ rows * m_classes ] );
+				clusterHeaders[ ii ].size = size;
+				clusterHeaders[ ii ].nonzeros = dimension;
 
-	for ( unsigned int ii = 0; ii < rows; ii += 16 ) {
+				clusterHeaders[ ii ].responses = deviceTrainingResponses + ( ( ii * m_classes ) << m_logMaximumClusterSize );
+				clusterHeaders[ ii ].labels = deviceTrainingLabels + ( ii << m_logMaximumClusterSize );
+				clusterHeaders[ ii ].alphas = deviceTrainingAlphas + ( ( ii * m_classes ) << m_logMaximumClusterSize );
 
-		unsigned int const batchSize = std::min( 16u, rows - ii );
+				clusterHeaders[ ii ].nonzeroIndices = deviceNonzeroIndices + nonzeroIndicesOffset;
+				clusterHeaders[ ii ].vectorsTranspose = deviceTrainingVectorsTranspose + trainingVectorsTransposeOffset;
+				clusterHeaders[ ii ].vectorNormsSquared = deviceTrainingVectorNormsSquared + ( ii << m_logMaximumClusterSize );
+				clusterHeaders[ ii ].vectorKernelNormsSquared = deviceTrainingVectorKernelNormsSquared + ( ii << m_logMaximumClusterSize );
 
-		for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
+				clusterSizeSums[ ii + 1 ] = clusterSizeSums[ ii ] + size;
 
-			if ( columnMajor )
-				SVM_MemcpyStride( m_batchVectorsTranspose + jj, 16, vectors, ii + jj, rows, vectorsType, std::min( columns, m_columns ) );
-			else
-				SVM_MemcpyStride( m_batchVectorsTranspose + jj, 16, vectors, ( ii + jj ) * m_columns, 1, vectorsType, std::min( columns, m_columns ) );
-			for ( unsigned int kk = columns; kk < m_columns; ++kk )
-				m_batchVectorsTranspose[ ( kk << 4 ) + jj ] = 0;
+				nonzeroIndicesOffset += alignedDimension;
+				trainingVectorsTransposeOffset += ( dimension << m_logMaximumClusterSize );
+			}
+			SVM_ScratchClusterHeaders( clusterHeaders + m_clusters, m_deviceScratchAlphas, m_logMaximumClusterSize, m_logBatchSize );
 
-			double accumulator = 0;
-			for ( unsigned int kk = 0; kk < m_columns; ++kk )
-				accumulator += Square( m_batchVectorsTranspose[ ( kk << 4 ) + jj ] );
-			m_batchVectorNormsSquared[ jj ] = accumulator;
+			m_backend->EndUpload(
+				"Failed to copy nonzero indices to device",
+				deviceNonzeroIndices,
+				nonzeroIndices,
+				totalAlignedClusterSize * sizeof( boost::uint32_t )
+			);
+			m_backend->EndUpload(
+				"Failed to copy cluster headers to device",
+				deviceClusterHeaders,
+				clusterHeaders,
+				( m_clusters + scratchClusters ) * sizeof( CUDA::SparseKernelClusterHeader )
+			);
+			m_backend->EndUpload(
+				"Failed to copy cluster size sums to device",
+				deviceClusterSizeSums,
+				clusterSizeSums,
+				( m_clusters + 1 ) * sizeof( boost::uint32_t )
+			);
 		}
 
-		CUDA_VERIFY(
-			"Failed to copy batch to device",
-			cudaMemcpy(
-				m_deviceBatchVectorsTranspose,
-				m_batchVectorsTranspose,
-				( m_columns << 4 ) * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
+		m_backend->DeviceAllocate(
+			"Failed to allocate space for repacking sources on device",
+			&deviceSources, sources.size() * sizeof( boost::uint32_t )
 		);
-
-		CUDA_VERIFY(
-			"Failed to copy batch squared norms to device",
-			cudaMemcpy(
-				m_deviceBatchVectorNormsSquared,
-				m_batchVectorNormsSquared,
-				batchSize * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
+		m_backend->CopyToDevice(
+			"Failed to copy repacking sources to device",
+			deviceSources,
+			&sources[ 0 ],
+			sources.size() * sizeof( boost::uint32_t )
 		);
 
-		CUDA_FLOAT_DOUBLE const* const deviceResult = CUDA::SparseEvaluateKernel(
-			m_deviceWork[ 0 ],
-			m_deviceWork[ 1 ],
-			m_deviceBatchVectorsTranspose,
-			m_deviceBatchVectorNormsSquared,
+		m_backend->SparseRepackClusters(
+			deviceClusterHeaders,
 			m_deviceClusterHeaders,
+			deviceSources,
 			m_logMaximumClusterSize,
 			m_clusters,
-			m_classes,
-			m_workSize,
-			m_kernel,
-			m_kernelParameter1,
-			m_kernelParameter2,
-			m_kernelParameter3
-		);
-
-		CUDA_VERIFY(
-			"Failed to copy classifications from device",
-			cudaMemcpy(
-				m_batchResponses,
-				deviceResult,
-				batchSize * m_classes * sizeof( CUDA_FLOAT_DOUBLE ),
-				cudaMemcpyDeviceToHost
-			)
+			m_classes
 		);
-
-		for ( unsigned int jj = 0; jj < batchSize; ++jj )
-			for ( unsigned int kk = 0; kk < m_classes; ++kk )
-				classifications[ ( ii + jj ) * m_classes + kk ] = m_batchResponses[ kk * 16 + jj ];
-	}
-
-	if ( m_biased ) {
-
-		CUDA_FLOAT_DOUBLE* ii    = classifications.get();
-		CUDA_FLOAT_DOUBLE* iiEnd = ii + rows * m_classes;
-		for ( ; ii != iiEnd; ++ii )
-			*ii += m_bias;
 	}
+	catch( ... ) {
 
-	SVM_ReverseMemcpy2d( result, resultType, classifications.get(), rows, m_classes, columnMajor );
-}
-
-
-void SVM::Cleanup() {
-
-	if ( ! m_constructed )
-		throw std::runtime_error( "SVM has not been successfully constructed" );
-	m_constructed = false;
-
-	if ( m_initializedHost )
-		Deinitialize();
-	BOOST_ASSERT( ! m_initializedDevice );
-	BOOST_ASSERT( ! m_initializedHost );
-
-	if ( m_foundKeys != NULL ) {
-
-		CUDA_VERIFY( "Failed to free found keys on host", cudaFreeHost( m_foundKeys ) );
-		m_foundKeys = NULL;
+		void* const buffers[] = {
+			deviceTrainingLabels,
+			deviceTrainingVectorNormsSquared,
+			deviceTrainingVectorKernelNormsSquared,
+			deviceTrainingResponses,
+			deviceTrainingAlphas,
+			deviceNonzeroIndices,
+			deviceTrainingVectorsTranspose,
+			deviceClusterHeaders,
+			deviceClusterSizeSums,
+			deviceSources
+		};
+		for ( unsigned int ii = 0; ii < ARRAYLENGTH( buffers ); ++ii )
+			if ( buffers[ ii ] != NULL )
+				m_backend->DeviceFree( "Failed to free repacked clusters on device", buffers[ ii ] );
+		for ( unsigned int ii = 0; ii < ARRAYLENGTH( deviceWork ); ++ii )
+			if ( deviceWork[ ii ] != NULL )
+				m_backend->DeviceFree( "Failed to free work on device", deviceWork[ ii ] );
+		throw;
 	}
-	if ( m_foundValues != NULL ) {
 
-		CUDA_VERIFY( "Failed to free found values on host", cudaFreeHost( m_foundValues ) );
-		m_foundValues = NULL;
+	{	void* const buffers[] = {
+			m_deviceTrainingLabels,
+			m_deviceTrainingVectorNormsSquared,
+			m_deviceTrainingVectorKernelNormsSquared,
+			m_deviceTrainingResponses,
+			m_deviceTrainingAlphas,
+			m_deviceNonzeroIndices,
+			m_deviceTrainingVectorsTranspose,
+			m_deviceClusterHeaders,
+			m_deviceClusterSizeSums,
+			deviceSources
+		};
+		for ( unsigned int ii = 0; ii < ARRAYLENGTH( buffers ); ++ii )
+			m_backend->DeviceFree( "Failed to free old clusters on device", buffers[ ii ] );
 	}
 
-	if ( m_batchVectorNormsSquared != NULL ) {
+	m_deviceTrainingLabels = deviceTrainingLabels;
+	m_deviceTrainingVectorNormsSquared = deviceTrainingVectorNormsSquared;
+	m_deviceTrainingVectorKernelNormsSquared = deviceTrainingVectorKernelNormsSquared;
+	m_deviceTrainingResponses = deviceTrainingResponses;
+	m_deviceTrainingAlphas = deviceTrainingAlphas;
+	m_deviceNonzeroIndices = deviceNonzeroIndices;
+	m_deviceTrainingVectorsTranspose = deviceTrainingVectorsTranspose;
+	m_deviceClusterHeaders = deviceClusterHeaders;
+	m_deviceClusterSizeSums = deviceClusterSizeSums;
 
-		CUDA_VERIFY( "Failed to free batch squared norms on host", cudaFreeHost( m_batchVectorNormsSquared ) );
-		m_batchVectorNormsSquared = NULL;
-	}
-	if ( m_deviceBatchVectorNormsSquared != NULL ) {
+	if ( workSize > m_workSize ) {
 
-		CUDA_VERIFY( "Failed to free batch squared norms on device", cudaFree( m_deviceBatchVectorNormsSquared ) );
-		m_deviceBatchVectorNormsSquared = NULL;
+		m_deviceGeneration = SVM_NextDeviceGeneration();
+
+		for ( unsigned int ii = 0; ii < ARRAYLENGTH( m_deviceWork ); ++ii ) {
+
+			m_backend->DeviceFree( "Failed to free work on device", m_deviceWork[ ii ] );
+			m_deviceWork[ ii ] = deviceWork[ ii ];
+		}
+		m_workSize = workSize;
 	}
 }
 
 
-void SVM::ClusterTrainingVectors(
-	bool const smallClusters,
-	unsigned int activeClusters
-)
-{
-	m_logMaximumClusterSize = ( smallClusters ? 4 : 8 );
-
-	unsigned int const densitySize = ( m_columns + ( 8 * sizeof( unsigned int ) - 1 ) ) / ( 8 * sizeof( unsigned int ) );
+void SVM::UploadKernelNorms() {
 
-	m_clusterIndices.clear();
-	m_clusterNonzeroIndices.clear();
-	m_clusters = ( ( m_rows + ( ( 1u << m_logMaximumClusterSize ) - 1 ) ) >> m_logMaximumClusterSize );
+	BOOST_ASSERT( m_deviceTrainingVectorKernelNormsSquared != NULL );
 
-	activeClusters = std::min( activeClusters, m_clusters );
-	BOOST_ASSERT( activeClusters > 0 );
+	float* const trainingVectorKernelNormsSquared = static_cast< float* >(
+		m_backend->BeginUpload(
+			"Failed to allocate space for training vector kernel squared norms on host",
+			m_deviceTrainingVectorKernelNormsSquared,
+			( m_clusters << m_logMaximumClusterSize ) * sizeof( float )
+		)
+	);
 
-	boost::shared_array< std::vector< unsigned int > > clusterIndices( new std::vector< unsigned int >[ activeClusters ] );
-	boost::shared_array< boost::shared_array< unsigned int > > clusterDensities( new boost::shared_array< unsigned int >[ activeClusters ] );
-	for ( unsigned int ii = 0; ii < activeClusters; ++ii ) {
+	for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
 
-		boost::shared_array< unsigned int > clusterDensity( new unsigned int[ densitySize ] );
-		std::fill( clusterDensity.get(), clusterDensity.get() + densitySize, 0 );
-		clusterDensities[ ii ] = clusterDensity;
+		unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+		for ( unsigned int jj = 0; jj < size; ++jj )
+			trainingVectorKernelNormsSquared[ ( ii << m_logMaximumClusterSize ) + jj ] = m_trainingVectorKernelNormsSquared[ ( *m_clusterIndices )[ ii ][ jj ] ];
+		for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
+			trainingVectorKernelNormsSquared[ ( ii << m_logMaximumClusterSize ) + jj ] = 0;
 	}
+	m_backend->EndUpload(
+		"Failed to copy training vector kernel squared norms to device",
+		m_deviceTrainingVectorKernelNormsSquared,
+		trainingVectorKernelNormsSquared,
+		( m_clusters << m_logMaximumClusterSize ) * sizeof( float )
+	);
+}
 
-	unsigned int remainingClusters = m_clusters;
-	unsigned int currentClusters = std::min( remainingClusters, activeClusters );
-	remainingClusters -= currentClusters;
 
-	boost::shared_array< unsigned int > density( new unsigned int[ densitySize ] );
+void SVM::PrepareSession( Session& session ) const {
 
-	boost::shared_array< unsigned int > indices( new unsigned int[ m_rows ] );
-	for ( unsigned int ii = 0; ii < m_rows; ++ii )
-		indices[ ii ] = ii;
-	for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+	BOOST_ASSERT( m_initializedDevice );
 
-		unsigned int jj = ( rand() % ( m_rows - ii ) ) + ii;
-		if ( ii != jj )
-			std::swap( indices[ ii ], indices[ jj ] );
-	}
+	if ( session.m_initialized && ( session.m_generation == m_deviceGeneration ) )
+		return;
 
-	for ( unsigned int ii = 0; ii < m_rows; ++ii ) {
+	// the device has been reinitialized since the session was last used (perhaps with a different SVM)
+	session.Cleanup();
+	BOOST_ASSERT( ! session.m_initialized );
+
+	try {
 
-		unsigned int const index = indices[ ii ];
+		session.m_generation = m_deviceGeneration;
+		session.m_columns = m_columns;
+		session.m_classes = m_classes;
+		session.m_logBatchSize = m_logBatchSize;
 
-		BOOST_ASSERT( currentClusters > 0 );
+		session.m_batchVectors.Allocate( session.m_backend, m_columns, m_logBatchSize, m_batchUpdateSize );
 
-		std::fill( density.get(), density.get() + densitySize, 0 );
+		session.m_backend->HostAllocate(
+			"Failed to allocate space for batch squared norms on host",
+			&session.m_batchVectorNormsSquared, ( 1u << m_logBatchSize ) * sizeof( float )
+		);
+		session.m_backend->MirrorAllocate(
+			"Failed to allocate space for batch squared norms on device",
+			session.m_batchVectorNormsSquared, &session.m_deviceBatchVectorNormsSquared, ( 1u << m_logBatchSize ) * sizeof( float )
+		);
 
-		{	SparseVector::const_iterator jj    = m_trainingVectors[ index ].begin();
-			SparseVector::const_iterator jjEnd = m_trainingVectors[ index ].end();
-			for ( ; jj != jjEnd; ++jj )
-				density[ jj->first / ( 8 * sizeof( unsigned int ) ) ] |= ( 1u << ( jj->first & ( 8 * sizeof( unsigned int ) - 1 ) ) );
+		session.m_backend->HostAllocate(
+			"Failed to allocate space for batch responses on host",
+			&session.m_batchResponses, ( m_classes << m_logBatchSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+		);
+
+		for ( unsigned int ii = 0; ii < ARRAYLENGTH( session.m_deviceWork ); ++ii ) {
+
+			session.m_backend->DeviceAllocate(
+				"Failed to allocate space for work on device",
+				&session.m_deviceWork[ ii ],
+				m_workSize
+			);
 		}
+	}
+	catch( ... ) {
+
+		session.Cleanup();
+		throw;
+	}
 
-		unsigned int clusterIndex = 0;
-		unsigned int minimumCost = static_cast< unsigned int >( -1 );
-		for ( unsigned int jj = 0; jj < currentClusters; ++jj ) {
+	session.m_initialized = true;
+}
 
-			unsigned int newNonzeros = 0;
-			unsigned int oldNonzeros = 0;
 
-			for ( unsigned int kk = 0; kk < densitySize; ++kk ) {
+void SVM::ClassifyBatch(
+	Session& session,
+	CUDA_FLOAT_DOUBLE* const classifications,
+	unsigned int const batchSize
+) const
+{
+	BOOST_ASSERT( m_initializedDevice );
+	BOOST_ASSERT( session.m_initialized );
+	BOOST_ASSERT( session.m_generation == m_deviceGeneration );
 
-				unsigned int newDensity = density[ kk ];
-				unsigned int oldDensity = clusterDensities[ jj ][ kk ];
+	session.m_batchVectors.Upload();
 
-				newNonzeros += CountBits( ( newDensity ^ oldDensity ) & ~oldDensity );
-				oldNonzeros += CountBits( ( newDensity ^ oldDensity ) & ~newDensity );
-			}
+	session.m_backend->CopyToDevice(
+		"Failed to copy batch squared norms to device",
+		session.m_deviceBatchVectorNormsSquared,
+		session.m_batchVectorNormsSquared,
+		batchSize * sizeof( float )
+	);
 
-			unsigned int const cost = oldNonzeros + newNonzeros * clusterIndices[ jj ].size();
-			if ( cost < minimumCost ) {
+	CUDA_FLOAT_DOUBLE const* const deviceResult = session.m_backend->SparseEvaluateKernel(
+		session.m_deviceWork[ 0 ],
+		session.m_deviceWork[ 1 ],
+		session.m_batchVectors.GetDeviceTranspose(),
+		session.m_deviceBatchVectorNormsSquared,
+		m_deviceClusterHeaders,
+		m_logMaximumClusterSize,
+		m_logBatchSize,
+		m_clusters,
+		m_classes,
+		m_workSize,
+		m_kernel,
+		m_kernelParameter1,
+		m_kernelParameter2,
+		m_kernelParameter3
+	);
 
-				clusterIndex = jj;
-				minimumCost = cost;
-			}
-		}
+	session.m_backend->CopyFromDevice(
+		"Failed to copy classifications from device",
+		session.m_batchResponses,
+		deviceResult,
+		( m_classes << m_logBatchSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+	);
 
-		clusterIndices[ clusterIndex ].push_back( index );
-		for ( unsigned int kk = 0; kk < densitySize; ++kk )
-			clusterDensities[ clusterIndex ][ kk ] |= density[ kk ];
+	for ( unsigned int ii = 0; ii < batchSize; ++ii )
+		for ( unsigned int jj = 0; jj < m_classes; ++jj )
+			classifications[ ii * m_classes + jj ] = session.m_batchResponses[ ( jj << m_logBatchSize ) + ii ];
 
-		if ( clusterIndices[ clusterIndex ].size() >= ( 1u << m_logMaximumClusterSize ) ) {
+	if ( m_biased ) {
 
-			m_clusterIndices.push_back( clusterIndices[ clusterIndex ] );
-			{	std::vector< unsigned int > nonzeros;
-				for ( unsigned int jj = 0; jj < densitySize; ++jj ) {
+		CUDA_FLOAT_DOUBLE* ii    = classifications;
+		CUDA_FLOAT_DOUBLE* iiEnd = ii + batchSize * m_classes;
+		for ( ; ii != iiEnd; ++ii )
+			*ii += m_bias;
+	}
+}
 
-					for ( unsigned int kk = 0; kk < 8 * sizeof( unsigned int ); ++kk ) {
 
-						if ( clusterDensities[ clusterIndex ][ jj ] & ( 1u << kk ) )
-							nonzeros.push_back( jj * 8 * sizeof( unsigned int ) + kk );
-					}
-				}
-				m_clusterNonzeroIndices.push_back( nonzeros );
-			}
+void SVM::SetBatchVector( unsigned int const index, unsigned int const row ) {
 
-			clusterIndices[ clusterIndex ].clear();
-			std::fill( clusterDensities[ clusterIndex ].get(), clusterDensities[ clusterIndex ].get() + densitySize, 0 );
-			--currentClusters;
-			clusterIndices[ clusterIndex ].swap( clusterIndices[ currentClusters ] );
-			std::swap( clusterDensities[ clusterIndex ], clusterDensities[ currentClusters ] );
+	BOOST_ASSERT( row < m_rows );
 
-			if ( remainingClusters > 0 ) {
+	SparseMatrix::const_iterator ii    = m_trainingVectors.Begin( row );
+	SparseMatrix::const_iterator iiEnd = m_trainingVectors.End( row );
+	for ( ; ii != iiEnd; ++ii )
+		m_batchVectors.SetValue( index, ii.Index(), ii.Value() );
+}
 
-				++currentClusters;
-				--remainingClusters;
-			}
-		}
-	}
-	BOOST_ASSERT( remainingClusters == 0 );
 
-	for ( unsigned int ii = 0; ii < currentClusters; ++ii ) {
+void SVM::CalculateResponses( std::vector< unsigned int > const& rows ) {
 
-		if ( clusterIndices[ ii ].size() > 0 ) {
+	unsigned int const size = rows.size();
+	for ( unsigned int ii = 0; ii < size; ii += ( 1u << m_logBatchSize ) ) {
 
-			m_clusterIndices.push_back( clusterIndices[ ii ] );
-			{	std::vector< unsigned int > nonzeros;
-				for ( unsigned int jj = 0; jj < densitySize; ++jj ) {
+		unsigned int const batchSize = std::min( 1u << m_logBatchSize, size - ii );
 
-					for ( unsigned int kk = 0; kk < 8 * sizeof( unsigned int ); ++kk ) {
+		m_batchVectors.Begin();
+		for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
 
-						if ( clusterDensities[ ii ][ jj ] & ( 1u << kk ) )
-							nonzeros.push_back( jj * 8 * sizeof( unsigned int ) + kk );
-					}
-				}
-				m_clusterNonzeroIndices.push_back( nonzeros );
-			}
+			SetBatchVector( jj, rows[ ii + jj ] );
+			m_batchVectorNormsSquared[ jj ] = m_trainingVectorNormsSquared[ rows[ ii + jj ] ];
 		}
+		m_batchVectors.Upload();
+
+		m_backend->CopyToDevice(
+			"Failed to copy batch squared norms to device",
+			m_deviceBatchVectorNormsSquared,
+			m_batchVectorNormsSquared,
+			batchSize * sizeof( float )
+		);
+
+		CUDA_FLOAT_DOUBLE const* const deviceResult = m_backend->SparseEvaluateKernel(
+			m_deviceWork[ 0 ],
+			m_deviceWork[ 1 ],
+			m_batchVectors.GetDeviceTranspose(),
+			m_deviceBatchVectorNormsSquared,
+			m_deviceClusterHeaders,
+			m_logMaximumClusterSize,
+			m_logBatchSize,
+			m_clusters,
+			m_classes,
+			m_workSize,
+			m_kernel,
+			m_kernelParameter1,
+			m_kernelParameter2,
+			m_kernelParameter3
+		);
+
+		m_backend->CopyFromDevice(
+			"Failed to copy responses from device",
+			m_batchResponses,
+			deviceResult,
+			( m_classes << m_logBatchSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+		);
+
+		for ( unsigned int jj = 0; jj < batchSize; ++jj )
+			for ( unsigned int kk = 0; kk < m_classes; ++kk )
+				m_trainingResponses[ rows[ ii + jj ] * m_classes + kk ] = m_batchResponses[ ( kk << m_logBatchSize ) + jj ];
 	}
-	BOOST_ASSERT( m_clusterIndices.size()        == m_clusters );
-	BOOST_ASSERT( m_clusterNonzeroIndices.size() == m_clusters );
 }
 
 
-void SVM::InitializeDevice() {
-
-	if ( m_initializedDevice )
-		throw std::runtime_error( "SVM has already been initialized" );
-	m_initializedDevice = true;
+void SVM::UploadResponses() {
 
-	CUDA_VERIFY(
-		"Failed to allocate space for batch vectors on host",
-		cudaMallocHost( &m_batchVectorsTranspose, ( m_columns << 4 ) * sizeof( float ) )
-	);
-	CUDA_VERIFY(
-		"Failed to allocate space for batch vectors on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceBatchVectorsTranspose ), ( m_columns << 4 ) * sizeof( float ) )
+	CUDA_FLOAT_DOUBLE* const trainingResponses = static_cast< CUDA_FLOAT_DOUBLE* >(
+		m_backend->BeginUpload(
+			"Failed to allocate space for training responses on host",
+			m_deviceTrainingResponses,
+			( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+		)
 	);
 
-	CUDA_VERIFY(
-		"Failed to allocate space for batch responses on host",
-		cudaMallocHost( &m_batchResponses, 16 * m_classes * sizeof( CUDA_FLOAT_DOUBLE ) )
-	);
-	CUDA_VERIFY(
-		"Failed to allocate space for batch responses on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceBatchResponses ), 16 * m_classes * sizeof( CUDA_FLOAT_DOUBLE ) )
-	);
+	for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
 
-	CUDA_VERIFY(
-		"Failed to allocate space for batch alphas on host",
-		cudaMallocHost( &m_batchAlphas, 16 * m_classes * sizeof( float ) )
-	);
-	CUDA_VERIFY(
-		"Failed to allocate space for batch alphas on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceBatchAlphas ), 16 * m_classes * sizeof( float ) )
+		unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+		for ( unsigned int jj = 0; jj < size; ++jj )
+			for ( unsigned int kk = 0; kk < m_classes; ++kk )
+				trainingResponses[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = m_trainingResponses[ ( *m_clusterIndices )[ ii ][ jj ] * m_classes + kk ];
+		for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
+			for ( unsigned int kk = 0; kk < m_classes; ++kk )
+				trainingResponses[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = 0;
+	}
+	m_backend->EndUpload(
+		"Failed to copy training responses to device",
+		m_deviceTrainingResponses,
+		trainingResponses,
+		( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE )
 	);
+	m_updatedResponses = true;
+}
 
-	CUDA_VERIFY(
-		"Failed to allocate space for batch indices on host",
-		cudaMallocHost( &m_batchIndices, 16 * m_classes * sizeof( boost::uint32_t ) )
-	);
-	CUDA_VERIFY(
-		"Failed to allocate space for batch indices on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceBatchIndices ), 16 * m_classes * sizeof( boost::uint32_t ) )
-	);
 
-	CUDA_VERIFY(
-		"Failed to allocate space for training labels on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceTrainingLabels ), ( m_clusters << m_logMaximumClusterSize ) * sizeof( boost::int32_t ) )
-	);
-	{	boost::int32_t* trainingLabels;
-		CUDA_VERIFY(
-			"Failed to allocate space for training labels on host",
-			cudaMallocHost( &trainingLabels, ( m_clusters << m_logMaximumClusterSize ) * sizeof( boost::int32_t ) )
-		);
+void SVM::DownloadResponses() {
 
+	if ( m_initializedDevice && ( ! m_updatedResponses ) ) {
+
+		CUDA_FLOAT_DOUBLE const* const trainingResponses = static_cast< CUDA_FLOAT_DOUBLE const* >(
+			m_backend->BeginDownload(
+				"Failed to copy training responses from device",
+				m_deviceTrainingResponses,
+				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE )
+			)
+		);
 		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
 
-			unsigned int const size = m_clusterIndices[ ii ].size();
+			unsigned int const size = ( *m_clusterIndices )[ ii ].size();
 			for ( unsigned int jj = 0; jj < size; ++jj )
-				trainingLabels[ ( ii << m_logMaximumClusterSize ) + jj ] = m_trainingLabels[ m_clusterIndices[ ii ][ jj ] ];
-			for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
-				trainingLabels[ ( ii << m_logMaximumClusterSize ) + jj ] = 0;
+				for ( unsigned int kk = 0; kk < m_classes; ++kk )
+					m_trainingResponses[ ( *m_clusterIndices )[ ii ][ jj ] * m_classes + kk ] = trainingResponses[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ];
 		}
-		CUDA_VERIFY(
-			"Failed to copy training labels to device",
-			cudaMemcpy(
-				m_deviceTrainingLabels,
-				trainingLabels,
-				( m_clusters << m_logMaximumClusterSize ) * sizeof( boost::int32_t ),
-				cudaMemcpyHostToDevice
-			)
-		);
 
-		CUDA_VERIFY( "Failed to free training labels on host", cudaFreeHost( trainingLabels ) );
+		m_backend->EndDownload( "Failed to free training responses on host", m_deviceTrainingResponses, trainingResponses );
+
+		m_updatedResponses = true;
 	}
+}
 
-	CUDA_VERIFY(
-		"Failed to allocate space for training vector squared norms on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceTrainingVectorNormsSquared ), ( m_clusters << m_logMaximumClusterSize ) * sizeof( float ) )
-	);
-	{	float* trainingVectorNormsSquared;
-		CUDA_VERIFY(
-			"Failed to allocate space for training vector squared norms on host",
-			cudaMallocHost( &trainingVectorNormsSquared, ( m_clusters << m_logMaximumClusterSize ) * sizeof( float ) )
-		);
 
-		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+void SVM::UpdateResponses() {
 
-			unsigned int const size = m_clusterIndices[ ii ].size();
-			for ( unsigned int jj = 0; jj < size; ++jj )
-				trainingVectorNormsSquared[ ( ii << m_logMaximumClusterSize ) + jj ] = m_trainingVectorNormsSquared[ m_clusterIndices[ ii ][ jj ] ];
-			for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
-				trainingVectorNormsSquared[ ( ii << m_logMaximumClusterSize ) + jj ] = 0;
-		}
-		CUDA_VERIFY(
-			"Failed to copy training vector squared norms to device",
-			cudaMemcpy(
-				m_deviceTrainingVectorNormsSquared,
-				trainingVectorNormsSquared,
-				( m_clusters << m_logMaximumClusterSize ) * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
-		);
+	// the responses of shrunk training vectors might be out-of-date
+	Unshrink();
 
-		CUDA_VERIFY( "Failed to free training vector squared norms on host", cudaFreeHost( trainingVectorNormsSquared ) );
-	}
+	DownloadResponses();
+	BOOST_ASSERT( m_updatedResponses );
+}
 
-	CUDA_VERIFY(
-		"Failed to allocate space for training vector kernel squared norms on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceTrainingVectorKernelNormsSquared ), ( m_clusters << m_logMaximumClusterSize ) * sizeof( float ) )
-	);
-	{	float* trainingVectorKernelNormsSquared;
-		CUDA_VERIFY(
-			"Failed to allocate space for training vector kernel squared norms on host",
-			cudaMallocHost( &trainingVectorKernelNormsSquared, ( m_clusters << m_logMaximumClusterSize ) * sizeof( float ) )
-		);
 
-		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+/*
+	SparseUpdateKernel updates the responses by the change in the alphas from
+	those in the cluster headers at the batch indices. Here, the batch indices
+	point into the scratch clusters (which follow the shrunk clusters), whose
+	alphas are set to those as of the last call, so only the shrunk responses
+	are changed
+*/
+void SVM::UpdateShrunkResponses() {
 
-			unsigned int const size = m_clusterIndices[ ii ].size();
-			for ( unsigned int jj = 0; jj < size; ++jj )
-				trainingVectorKernelNormsSquared[ ( ii << m_logMaximumClusterSize ) + jj ] = m_trainingVectorKernelNormsSquared[ m_clusterIndices[ ii ][ jj ] ];
-			for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
-				trainingVectorKernelNormsSquared[ ( ii << m_logMaximumClusterSize ) + jj ] = 0;
-		}
-		CUDA_VERIFY(
-			"Failed to copy training vector kernel squared norms to device",
-			cudaMemcpy(
-				m_deviceTrainingVectorKernelNormsSquared,
-				trainingVectorKernelNormsSquared,
-				( m_clusters << m_logMaximumClusterSize ) * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
-		);
+	BOOST_ASSERT( m_initializedDevice );
 
-		CUDA_VERIFY( "Failed to free training vector kernel squared norms on host", cudaFreeHost( trainingVectorKernelNormsSquared ) );
-	}
+	if ( ( m_shrunkClusters > 0 ) && ( ! m_shrunkChangedRows.empty() ) ) {
 
-	CUDA_VERIFY(
-		"Failed to allocate space for training responses on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceTrainingResponses ), ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ) )
-	);
-	{	CUDA_FLOAT_DOUBLE* trainingResponses;
-		CUDA_VERIFY(
-			"Failed to allocate space for training responses on host",
-			cudaMallocHost( &trainingResponses, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ) )
-		);
+		BOOST_ASSERT( m_classes == 1 );
 
-		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+		TraceSpan span( "UpdateShrunkResponses" );
+		PhaseTimer timer( &m_statistics );
 
-			unsigned int const size = m_clusterIndices[ ii ].size();
-			for ( unsigned int jj = 0; jj < size; ++jj )
-				for ( unsigned int kk = 0; kk < m_classes; ++kk )
-					trainingResponses[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = m_trainingResponses[ m_clusterIndices[ ii ][ jj ] * m_classes + kk ];
-			for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
-				for ( unsigned int kk = 0; kk < m_classes; ++kk )
-					trainingResponses[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = 0;
-		}
-		CUDA_VERIFY(
-			"Failed to copy training responses to device",
-			cudaMemcpy(
-				m_deviceTrainingResponses,
-				trainingResponses,
-				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ),
-				cudaMemcpyHostToDevice
-			)
-		);
+		unsigned int const batchSize = ( 1u << m_logBatchSize );
+		unsigned int const activeClusters = m_clusters - m_shrunkClusters;
+		unsigned int const size = m_shrunkChangedRows.size();
 
-		CUDA_VERIFY( "Failed to free training responses on host", cudaFreeHost( trainingResponses ) );
-	}
-	m_updatedResponses = true;
+		std::vector< float > scratchAlphas( batchSize );
+		for ( unsigned int ii = 0; ii < size; ii += batchSize ) {
 
-	CUDA_VERIFY(
-		"Failed to allocate space for training alphas on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceTrainingAlphas ), ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float ) )
-	);
-	{	if ( m_classes == 1 ) {
+			timer.Start( GTSVM_PHASE_ASSEMBLY );
 
-			for ( unsigned int ii = 0; ii < m_rows; ++ii )
-				if ( ! ( m_trainingLabels[ ii ] > 0 ) )
-					m_trainingAlphas[ ii ] = -m_trainingAlphas[ ii ];
-		}
+			m_batchVectors.Begin();
+			for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
 
-		float* trainingAlphas;
-		CUDA_VERIFY(
-			"Failed to allocate space for training alphas on host",
-			cudaMallocHost( &trainingAlphas, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float ) )
-		);
+				// the last batch is filled out with a training vector whose alpha doesn't change
+				unsigned int row = m_shrunkChangedRows[ ii ];
+				float alpha = m_trainingAlphas[ row ];
+				if ( ii + jj < size ) {
 
-		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+					row = m_shrunkChangedRows[ ii + jj ];
+					alpha = m_shrunkChangedAlphas[ ii + jj ];
+				}
+				float const sign = ( ( m_trainingLabels[ row ] > 0 ) ? 1.0f : -1.0f );
 
-			unsigned int const size = m_clusterIndices[ ii ].size();
-			for ( unsigned int jj = 0; jj < size; ++jj )
-				for ( unsigned int kk = 0; kk < m_classes; ++kk )
-					trainingAlphas[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = m_trainingAlphas[ m_clusterIndices[ ii ][ jj ] * m_classes + kk ];
-			for ( unsigned int jj = size; jj < ( 1u << m_logMaximumClusterSize ); ++jj )
-				for ( unsigned int kk = 0; kk < m_classes; ++kk )
-					trainingAlphas[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ] = 0;
-		}
-		CUDA_VERIFY(
-			"Failed to copy training alphas to device",
-			cudaMemcpy(
-				m_deviceTrainingAlphas,
-				trainingAlphas,
-				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
-		);
+				SetBatchVector( jj, row );
+				m_batchVectorNormsSquared[ jj ] = m_trainingVectorNormsSquared[ row ];
+				m_batchIndices[ jj ] = ( m_shrunkClusters << m_logMaximumClusterSize ) + jj;
+				m_batchAlphas[ jj ] = sign * m_trainingAlphas[ row ];
+				scratchAlphas[ jj ] = sign * alpha;
+			}
 
-		CUDA_VERIFY( "Failed to free training alphas on host", cudaFreeHost( trainingAlphas ) );
+			timer.Stop();
 
-		if ( m_classes == 1 ) {
+			m_backend->CopyToDevice(
+				"Failed to copy scratch alphas to device",
+				m_deviceScratchAlphas,
+				&scratchAlphas[ 0 ],
+				batchSize * sizeof( float )
+			);
+
+			m_backend->CopyToDevice(
+				"Failed to copy batch alphas to device",
+				m_deviceBatchAlphas,
+				m_batchAlphas,
+				batchSize * sizeof( float )
+			);
+
+			m_batchVectors.Upload();
+
+			m_backend->CopyToDevice(
+				"Failed to copy batch squared norms to device",
+				m_deviceBatchVectorNormsSquared,
+				m_batchVectorNormsSquared,
+				batchSize * sizeof( float )
+			);
+
+			m_backend->CopyToDevice(
+				"Failed to copy batch indices to device",
+				m_deviceBatchIndices,
+				m_batchIndices,
+				batchSize * sizeof( boost::uint32_t )
+			);
 
-			for ( unsigned int ii = 0; ii < m_rows; ++ii )
-				if ( ! ( m_trainingLabels[ ii ] > 0 ) )
-					m_trainingAlphas[ ii ] = -m_trainingAlphas[ ii ];
+			m_backend->SparseUpdateKernel(
+				m_batchVectors.GetDeviceTranspose(),
+				m_deviceBatchVectorNormsSquared,
+				m_deviceBatchAlphas,
+				m_deviceBatchIndices,
+				m_deviceClusterHeaders + activeClusters,
+				m_logMaximumClusterSize,
+				m_logBatchSize,
+				m_shrunkClusters,
+				1,
+				m_kernel,
+				m_kernelParameter1,
+				m_kernelParameter2,
+				m_kernelParameter3
+			);
 		}
+
+		m_updatedResponses = false;
 	}
 
-	CUDA_VERIFY(
-		"Failed to allocate space for cluster headers on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceClusterHeaders ), m_clusters * sizeof( CUDA::SparseKernelClusterHeader ) )
-	);
-	CUDA_VERIFY(
-		"Failed to allocate space for cluster size sums on device",
-		cudaMalloc( reinterpret_cast< void** >( &m_deviceClusterSizeSums ), ( m_clusters + 1 ) * sizeof( boost::uint32_t ) )
-	);
-	{	unsigned int totalClusterSize        = 0;
-		unsigned int totalAlignedClusterSize = 0;
-		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+	for ( std::vector< unsigned int >::const_iterator ii = m_shrunkChangedRows.begin(); ii != m_shrunkChangedRows.end(); ++ii )
+		m_shrunkChanged[ *ii ] = false;
+	m_shrunkChangedRows.clear();
+	m_shrunkChangedAlphas.clear();
+}
 
-			unsigned int const dimension = m_clusterNonzeroIndices[ ii ].size();
-			unsigned int const alignedDimension = ( ( dimension + 15 ) & ~15 );
 
-			totalClusterSize += dimension;
-			totalAlignedClusterSize += ( ( alignedDimension + 15 ) & ~15 );
-		}
+/*
+	Following LIBSVM, a training vector is shrunk if it's at a bound, and its
+	gradient points further out of the feasible region than that of any
+	training vector which could move in the opposite direction. The active set
+	is only re-packed if this removes a reasonable fraction of it, since
+	re-packing copies every training vector on the device.
+*/
+void SVM::ShrinkActiveSet() {
 
-		CUDA_VERIFY(
-			"Failed to allocate space for nonzero indices on device",
-			cudaMalloc( reinterpret_cast< void** >( &m_deviceNonzeroIndices ), totalAlignedClusterSize * sizeof( boost::uint32_t ) )
-		);
-		CUDA_VERIFY(
-			"Failed to allocate space for training vectors on device",
-			cudaMalloc( reinterpret_cast< void** >( &m_deviceTrainingVectorsTranspose ), ( totalClusterSize << m_logMaximumClusterSize ) * sizeof( float ) )
-		);
-		boost::uint32_t* pDeviceNonzeroIndices           = m_deviceNonzeroIndices;
-		float*    pDeviceTrainingVectorsTranspose = m_deviceTrainingVectorsTranspose;
+	BOOST_ASSERT( m_classes == 1 );
+	BOOST_ASSERT( m_initializedDevice );
 
-		CUDA::SparseKernelClusterHeader* clusterHeaders;
-		CUDA_VERIFY(
-			"Failed to allocate space for cluster headers on host",
-			cudaMallocHost( &clusterHeaders, m_clusters * sizeof( CUDA::SparseKernelClusterHeader ) )
-		);
+	DownloadResponses();
+	PhaseTimer timer( &m_statistics, GTSVM_PHASE_SHRINKING );
 
-		boost::uint32_t* clusterSizeSums;
-		CUDA_VERIFY(
-			"Failed to allocate space for cluster size sums on host",
-			cudaMallocHost( &clusterSizeSums, ( m_clusters + 1 ) * sizeof( boost::uint32_t ) )
-		);
+	unsigned int const activeClusters = m_clusters - m_shrunkClusters;
 
-		boost::uint32_t* nonzeroIndices;
-		CUDA_VERIFY(
-			"Failed to allocate space for nonzero indices on host",
-			cudaMallocHost( &nonzeroIndices, ( ( m_columns + 15 ) & ~15 ) * sizeof( boost::uint32_t ) )
-		);
+	/*
+		In terms of the gradients g = 1 - y * f of the dual (which we
+		maximize), maximumUp is the largest increase in the dual available
+		from moving a training vector in the direction which increases
+		sum( y * alpha ), and maximumDown in the direction which decreases it
+	*/
+	double maximumUp   = -std::numeric_limits< double >::infinity();
+	double maximumDown = -std::numeric_limits< double >::infinity();
+	for ( unsigned int ii = 0; ii < activeClusters; ++ii ) {
 
-		float* trainingVectorsTranspose;
-		CUDA_VERIFY(
-			"Failed to allocate space for transposed training vectors on host",
-			cudaMallocHost( &trainingVectorsTranspose, ( m_columns << m_logMaximumClusterSize ) * sizeof( float ) )
-		);
+		unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+		for ( unsigned int jj = 0; jj < size; ++jj ) {
 
-		clusterSizeSums[ 0 ] = 0;
-		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+			unsigned int const index = ( *m_clusterIndices )[ ii ][ jj ];
+			float const alpha = m_trainingAlphas[ index ];
+			bool const positive = ( m_trainingLabels[ index ] > 0 );
+			double const gradient = 1 - ( positive ? 1 : -1 ) * m_trainingResponses[ index ];
 
-			unsigned int const size = m_clusterIndices[ ii ].size();
+			if ( positive ? ( alpha < m_regularization ) : ( alpha > 0 ) )
+				maximumUp = std::max( maximumUp, ( positive ? gradient : -gradient ) );
+			if ( positive ? ( alpha > 0 ) : ( alpha < m_regularization ) )
+				maximumDown = std::max( maximumDown, ( positive ? -gradient : gradient ) );
+		}
+	}
+	// without a bias, there is no equality constraint to couple the two directions
+	if ( ! m_biased ) {
 
-			unsigned int const dimension = m_clusterNonzeroIndices[ ii ].size();
-			unsigned int const alignedDimension = ( ( dimension + 15 ) & ~15 );
+		maximumUp   = std::max( maximumUp, maximumDown );
+		maximumDown = maximumUp;
+	}
 
-			for ( unsigned int jj = 0; jj < dimension; ++jj )
-				nonzeroIndices[ jj ] = m_clusterNonzeroIndices[ ii ][ jj ];
-			for ( unsigned int jj = dimension; jj < alignedDimension; ++jj )
-				nonzeroIndices[ jj ] = 0;
-			CUDA_VERIFY(
-				"Failed to copy nonzero indices to device",
-				cudaMemcpy(
-					pDeviceNonzeroIndices,
-					nonzeroIndices,
-					alignedDimension * sizeof( boost::uint32_t ),
-					cudaMemcpyHostToDevice
-				)
-			);
+	std::vector< unsigned int > activeRows;
+	std::vector< unsigned int > shrunkRows;
+	for ( unsigned int ii = 0; ii < activeClusters; ++ii ) {
 
-			for ( unsigned int jj = 0; jj < size; ++jj ) {
+		unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+		for ( unsigned int jj = 0; jj < size; ++jj ) {
 
-				unsigned int const index = m_clusterIndices[ ii ][ jj ];
+			unsigned int const index = ( *m_clusterIndices )[ ii ][ jj ];
+			float const alpha = m_trainingAlphas[ index ];
+			bool const positive = ( m_trainingLabels[ index ] > 0 );
+			double const gradient = 1 - ( positive ? 1 : -1 ) * m_trainingResponses[ index ];
 
-				unsigned int mm = 0;
+			bool shrink = false;
+			if ( ! ( alpha < m_regularization ) )
+				shrink = ( gradient > ( positive ? maximumUp : maximumDown ) );
+			else if ( ! ( alpha > 0 ) )
+				shrink = ( -gradient > ( positive ? maximumDown : maximumUp ) );
 
-				SparseVector::const_iterator kk    = m_trainingVectors[ index ].begin();
-				SparseVector::const_iterator kkEnd = m_trainingVectors[ index ].end();
+			( shrink ? shrunkRows : activeRows ).push_back( index );
+		}
+	}
 
-				std::vector< unsigned int >::const_iterator ll    = m_clusterNonzeroIndices[ ii ].begin();
-				std::vector< unsigned int >::const_iterator llEnd = m_clusterNonzeroIndices[ ii ].end();
+	unsigned int const minimumRows = std::max( 1u << m_logBatchSize, 1u << m_logMaximumClusterSize );
+	if ( ( shrunkRows.size() * 4 < activeRows.size() + shrunkRows.size() ) || ( activeRows.size() < minimumRows ) )
+		return;
+
+	// the previously-shrunk training vectors stay at the end
+	for ( unsigned int ii = activeClusters; ii < m_clusters; ++ii )
+		shrunkRows.insert( shrunkRows.end(), ( *m_clusterIndices )[ ii ].begin(), ( *m_clusterIndices )[ ii ].end() );
+
+	/*
+		from here on, only the changes in the alphas after the re-packing are
+		tracked. If the backend can't re-pack the device in place, then it's
+		re-initialized from the host, whose responses must be up-to-date
+	*/
+	bool const repack = m_backend->CanRepackClusters();
+	timer.Stop();
+	UpdateShrunkResponses();
+	if ( ! repack ) {
+
+		DownloadResponses();
+		ReleaseDevice();
+	}
+	timer.Start( GTSVM_PHASE_SHRINKING );
 
-				while ( ( kk != kkEnd ) && ( ll != llEnd ) ) {
+	std::vector< boost::uint32_t > positions;    // the index of each training vector in the old cluster layout
+	if ( repack ) {
 
-					BOOST_ASSERT( *ll <= kk->first );
-					if ( *ll < kk->first ) {
+		positions.resize( m_rows );
+		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
 
-						trainingVectorsTranspose[ ( mm << m_logMaximumClusterSize ) + jj ] = 0;
-						++mm;
-						++ll;
-					}
-					else {
+			unsigned int const size = ( *m_clusterIndices )[ ii ].size();
+			for ( unsigned int jj = 0; jj < size; ++jj )
+				positions[ ( *m_clusterIndices )[ ii ][ jj ] ] = ( ii << m_logMaximumClusterSize ) + jj;
+		}
+	}
 
-						trainingVectorsTranspose[ ( mm << m_logMaximumClusterSize ) + jj ] = kk->second;
-						++mm;
-						++ll;
-						++kk;
-					}
-				}
-				for ( ; ll != llEnd; ++mm, ++ll )
-					trainingVectorsTranspose[ ( mm << m_logMaximumClusterSize ) + jj ] = 0;
-			}
-			CUDA_VERIFY(
-				"Failed to copy transposed training vectors to device",
-				cudaMemcpy(
-					pDeviceTrainingVectorsTranspose,
-					trainingVectorsTranspose,
-					( dimension << m_logMaximumClusterSize ) * sizeof( float ),
-					cudaMemcpyHostToDevice
-				)
-			);
+	std::vector< std::vector< unsigned int > > clusterIndices;
+	std::vector< std::vector< unsigned int > > clusterNonzeroIndices;
+	SVM_AppendClusters( &clusterIndices, &clusterNonzeroIndices, m_trainingVectors, m_columns, activeRows, m_logMaximumClusterSize );
+	unsigned int const newActiveClusters = clusterIndices.size();
+	SVM_AppendClusters( &clusterIndices, &clusterNonzeroIndices, m_trainingVectors, m_columns, shrunkRows, m_logMaximumClusterSize );
 
-			clusterHeaders[ ii ].size = size;
-			clusterHeaders[ ii ].nonzeros = m_clusterNonzeroIndices[ ii ].size();
+	std::vector< boost::uint32_t > sources;
+	if ( repack ) {
 
-			clusterHeaders[ ii ].responses = m_deviceTrainingResponses + ( ( ii * m_classes ) << m_logMaximumClusterSize );
-			clusterHeaders[ ii ].labels = m_deviceTrainingLabels + ( ii << m_logMaximumClusterSize );
-			clusterHeaders[ ii ].alphas = m_deviceTrainingAlphas + ( ( ii * m_classes ) << m_logMaximumClusterSize );
+		sources.assign( clusterIndices.size() << m_logMaximumClusterSize, 0 );
+		for ( unsigned int ii = 0; ii < clusterIndices.size(); ++ii ) {
 
-			clusterHeaders[ ii ].nonzeroIndices = pDeviceNonzeroIndices;
-			clusterHeaders[ ii ].vectorsTranspose = pDeviceTrainingVectorsTranspose;
-			clusterHeaders[ ii ].vectorNormsSquared = m_deviceTrainingVectorNormsSquared + ( ii << m_logMaximumClusterSize );
-			clusterHeaders[ ii ].vectorKernelNormsSquared = m_deviceTrainingVectorKernelNormsSquared + ( ii << m_logMaximumClusterSize );
+			unsigned int const size = clusterIndices[ ii ].size();
+			for ( unsigned int jj = 0; jj < size; ++jj )
+				sources[ ( ii << m_logMaximumClusterSize ) + jj ] = positions[ clusterIndices[ ii ][ jj ] ];
+		}
+	}
 
-			clusterSizeSums[ ii + 1 ] = clusterSizeSums[ ii ] + size;
+	boost::shared_ptr< std::vector< std::vector< unsigned int > > const > const previousClusterIndices        = m_clusterIndices;
+	boost::shared_ptr< std::vector< std::vector< unsigned int > > const > const previousClusterNonzeroIndices = m_clusterNonzeroIndices;
+	unsigned int const previousClusters       = m_clusters;
+	unsigned int const previousShrunkClusters = m_shrunkClusters;
 
-			pDeviceNonzeroIndices += alignedDimension;
-			pDeviceTrainingVectorsTranspose += ( dimension << m_logMaximumClusterSize );;
-		}
+	// contexts sharing our training data keep the old layout
+	m_clusterIndices        = SVM_ShareClusters( &clusterIndices        );
+	m_clusterNonzeroIndices = SVM_ShareClusters( &clusterNonzeroIndices );
+	m_clusters = m_clusterIndices->size();
+	m_shrunkClusters = m_clusters - newActiveClusters;
+	m_shrunkChanged.assign( m_rows, false );
 
-		CUDA_VERIFY(
-			"Failed to copy cluster headers to device",
-			cudaMemcpy(
-				m_deviceClusterHeaders,
-				clusterHeaders,
-				m_clusters * sizeof( CUDA::SparseKernelClusterHeader ),
-				cudaMemcpyHostToDevice
-			)
-		);
+	timer.Stop();
+	if ( repack ) {
 
-		CUDA_VERIFY(
-			"Failed to copy cluster size sums to device",
-			cudaMemcpy(
-				m_deviceClusterSizeSums,
-				clusterSizeSums,
-				( m_clusters + 1 ) * sizeof( boost::uint32_t ),
-				cudaMemcpyHostToDevice
-			)
-		);
+		try {
 
-		CUDA_VERIFY( "Failed to free cluster headers on host", cudaFreeHost( clusterHeaders ) );
-		CUDA_VERIFY( "Failed to free cluster size sums on host", cudaFreeHost( clusterSizeSums ) );
-		CUDA_VERIFY( "Failed to free nonzero indices on host", cudaFreeHost( nonzeroIndices ) );
-		CUDA_VERIFY( "Failed to free transposed training vectors on host", cudaFreeHost( trainingVectorsTranspose ) );
+			RepackDevice( sources );
+		}
+		catch( ... ) {
+
+			// the device still has the old layout
+			m_clusterIndices        = previousClusterIndices;
+			m_clusterNonzeroIndices = previousClusterNonzeroIndices;
+			m_clusters       = previousClusters;
+			m_shrunkClusters = previousShrunkClusters;
+			throw;
+		}
+		m_trainingVectors.Permute( *m_clusterIndices );
 	}
+	else {
 
-	m_workSize = std::max(
-		( ( m_clusters + 15 ) >> 4 ) * std::max( sizeof( CUDA_FLOAT_DOUBLE ), sizeof( boost::uint32_t ) ),
-		( ( ( m_clusters + 31 ) >> 5 ) << 9 ) * std::max( sizeof( float ), sizeof( boost::uint32_t ) )
-	);
-	BOOST_ASSERT( ( m_logMaximumClusterSize == 4 ) || ( m_logMaximumClusterSize == 8 ) );
-	if ( m_logMaximumClusterSize == 4 )
-		m_workSize = std::max( m_workSize, ( m_clusters << 8 ) * sizeof( CUDA_FLOAT_DOUBLE ) );
-	else if ( m_logMaximumClusterSize == 8 )
-		m_workSize = std::max( m_workSize, ( ( m_clusters * m_classes ) << 12 ) * sizeof( CUDA_FLOAT_DOUBLE ) );
-	for ( unsigned int ii = 0; ii < ARRAYLENGTH( m_deviceWork ); ++ii ) {
-
-		CUDA_VERIFY(
-			"Failed to allocate space for work on device",
-			cudaMalloc(
-				&m_deviceWork[ ii ],
-				m_workSize
-			)
-		);
+		m_trainingVectors.Permute( *m_clusterIndices );
+		InitializeDevice();
 	}
+	++m_statistics.shrinks;
 }
 
 
-void SVM::UpdateResponses() {
+bool const SVM::UpdateActiveSet( bool const progress ) {
 
-	if ( m_initializedDevice && ( ! m_updatedResponses ) ) {
+	bool result = true;
+	if ( ! progress ) {
 
-		CUDA_FLOAT_DOUBLE* trainingResponses;
-		CUDA_VERIFY(
-			"Failed to allocate space for training responses on host",
-			cudaMallocHost( &trainingResponses, ( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ) )
-		);
+		// the active set has converged, but the full problem might not have
+		result = Unshrink();
+	}
+	else if ( m_shrinking && ( m_classes == 1 ) ) {
 
-		CUDA_VERIFY(
-			"Failed to copy training responses from device",
-			cudaMemcpy(
-				trainingResponses,
-				m_deviceTrainingResponses,
-				( ( m_clusters * m_classes ) << m_logMaximumClusterSize ) * sizeof( CUDA_FLOAT_DOUBLE ),
-				cudaMemcpyDeviceToHost
-			)
-		);
-		for ( unsigned int ii = 0; ii < m_clusters; ++ii ) {
+		m_shrinkingIterations += ( 1u << m_logBatchSize );
+		if ( m_shrinkingIterations >= std::min( m_rows, 1024u ) ) {
 
-			unsigned int const size = m_clusterIndices[ ii ].size();
-			for ( unsigned int jj = 0; jj < size; ++jj )
-				for ( unsigned int kk = 0; kk < m_classes; ++kk )
-					m_trainingResponses[ m_clusterIndices[ ii ][ jj ] * m_classes + kk ] = trainingResponses[ ( ( ii * m_classes + kk ) << m_logMaximumClusterSize ) + jj ];
+			m_shrinkingIterations = 0;
+			ShrinkActiveSet();
 		}
+	}
 
-		CUDA_VERIFY( "Failed to free training responses on host", cudaFreeHost( trainingResponses ) );
+	// the next iteration will change the responses on the device
+	m_updatedResponses = false;
 
-		m_updatedResponses = true;
-	}
+	return result;
 }
 
 
@@ -2728,9 +5038,13 @@ bool const SVM::IterateUnbiasedBinary() {
 
 	BOOST_ASSERT( m_classes == 1 );
 
+	unsigned int const batchSize = ( 1u << m_logBatchSize );
+	unsigned int const activeClusters = m_clusters - m_shrunkClusters;
 	bool progress = false;
+	TraceSpan span( "IterateUnbiasedBinary" );
+	PhaseTimer timer( &m_statistics );
 
-	CUDA::SparseKernelFindLargestScore(
+	m_backend->SparseKernelFindLargestScore(
 		m_foundKeys,
 		m_foundValues,
 		m_deviceWork[ 0 ],
@@ -2739,19 +5053,22 @@ bool const SVM::IterateUnbiasedBinary() {
 		m_deviceWork[ 3 ],
 		m_deviceClusterHeaders,
 		m_logMaximumClusterSize,
-		m_clusters,
+		activeClusters,
 		1,
 		m_workSize,
-		16,
+		batchSize,
 		m_foundSize,
 		m_regularization
 	);
-	std::copy( m_foundValues, m_foundValues + 16, m_foundIndices );
+	std::copy( m_foundValues, m_foundValues + batchSize, m_foundIndices );
+
+	timer.Start( GTSVM_PHASE_ASSEMBLY );
 
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	m_batchVectors.Begin();
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
 		unsigned int const batchIndex = m_foundIndices[ ii ];
-		unsigned int const unclusteredIndex = m_clusterIndices[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+		unsigned int const unclusteredIndex = ( *m_clusterIndices )[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		BOOST_ASSERT( unclusteredIndex < m_rows );
 
 		for ( unsigned int jj = 0; jj < ii; ++jj )
@@ -2759,84 +5076,60 @@ bool const SVM::IterateUnbiasedBinary() {
 
 		m_batchIndices[ ii ] = batchIndex;
 
-		unsigned int kk = 0;
-		SparseVector::const_iterator jj    = m_trainingVectors[ unclusteredIndex ].begin();
-		SparseVector::const_iterator jjEnd = m_trainingVectors[ unclusteredIndex ].end();
-		for ( ; jj != jjEnd; ++jj ) {
-
-			BOOST_ASSERT( jj->first < m_columns );
-			for ( ; kk < jj->first; ++kk )
-				m_batchVectorsTranspose[ kk * 16 + ii ] = 0;
-			m_batchVectorsTranspose[ kk * 16 + ii ] = jj->second;
-			++kk;
-		}
-		for ( ; kk < m_columns; ++kk )
-			m_batchVectorsTranspose[ kk * 16 + ii ] = 0;
-
+		SetBatchVector( ii, unclusteredIndex );
 		m_batchVectorNormsSquared[ ii ] = m_trainingVectorNormsSquared[ unclusteredIndex ];
 	}
 
-	CUDA_VERIFY(
-		"Failed to copy batch indices to device",
-		cudaMemcpy(
-			m_deviceBatchIndices,
-			m_batchIndices,
-			16 * sizeof( boost::uint32_t ),
-			cudaMemcpyHostToDevice
-		)
-	);
+	timer.Stop();
 
-#ifdef CUDA_USE_DOUBLE
-	CUDA::DArrayRead(
-		m_deviceBatchResponses,
-		m_deviceTrainingResponses,
+	m_backend->CopyToDevice(
+		"Failed to copy batch indices to device",
 		m_deviceBatchIndices,
-		16
+		m_batchIndices,
+		batchSize * sizeof( boost::uint32_t )
 	);
-#else    // CUDA_USE_DOUBLE
-	CUDA::FArrayRead(
+
+	m_backend->ArrayRead(
 		m_deviceBatchResponses,
 		m_deviceTrainingResponses,
 		m_deviceBatchIndices,
-		16
+		batchSize
 	);
-#endif    // CUDA_USE_DOUBLE
 
-	CUDA_VERIFY(
+	m_backend->CopyFromDevice(
 		"Failed to copy batch responses from device",
-		cudaMemcpy(
-			m_batchResponses,
-			m_deviceBatchResponses,
-			16 * sizeof( CUDA_FLOAT_DOUBLE ),
-			cudaMemcpyDeviceToHost
-		)
+		m_batchResponses,
+		m_deviceBatchResponses,
+		batchSize * sizeof( CUDA_FLOAT_DOUBLE )
 	);
 
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	timer.Start( GTSVM_PHASE_ASSEMBLY );
 
-		unsigned int const iiUnclusteredIndex = m_clusterIndices[ m_batchIndices[ ii ] >> m_logMaximumClusterSize ][ m_batchIndices[ ii ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
+
+		unsigned int const iiUnclusteredIndex = ( *m_clusterIndices )[ m_batchIndices[ ii ] >> m_logMaximumClusterSize ][ m_batchIndices[ ii ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		BOOST_ASSERT( iiUnclusteredIndex < m_rows );
 
 		for ( unsigned int jj = 0; jj < ii; ++jj ) {
 
-			unsigned int const jjUnclusteredIndex = m_clusterIndices[ m_batchIndices[ jj ] >> m_logMaximumClusterSize ][ m_batchIndices[ jj ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+			unsigned int const jjUnclusteredIndex = ( *m_clusterIndices )[ m_batchIndices[ jj ] >> m_logMaximumClusterSize ][ m_batchIndices[ jj ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 			BOOST_ASSERT( jjUnclusteredIndex < m_rows );
 
 			double accumulator = 0;
 
-			SparseVector::const_iterator kk    = m_trainingVectors[ iiUnclusteredIndex ].begin();
-			SparseVector::const_iterator kkEnd = m_trainingVectors[ iiUnclusteredIndex ].end();
-			SparseVector::const_iterator ll    = m_trainingVectors[ jjUnclusteredIndex ].begin();
-			SparseVector::const_iterator llEnd = m_trainingVectors[ jjUnclusteredIndex ].end();
+			SparseMatrix::const_iterator kk    = m_trainingVectors.Begin( iiUnclusteredIndex );
+			SparseMatrix::const_iterator kkEnd = m_trainingVectors.End( iiUnclusteredIndex );
+			SparseMatrix::const_iterator ll    = m_trainingVectors.Begin( jjUnclusteredIndex );
+			SparseMatrix::const_iterator llEnd = m_trainingVectors.End( jjUnclusteredIndex );
 			while ( ( kk != kkEnd ) && ( ll != llEnd ) ) {
 
-				if ( kk->first < ll->first )
+				if ( kk.Index() < ll.Index() )
 					++kk;
-				else if ( kk->first > ll->first )
+				else if ( kk.Index() > ll.Index() )
 					++ll;
 				else {
 
-					accumulator += kk->second * ll->second;
+					accumulator += kk.Value() * ll.Value();
 					++kk;
 					++ll;
 				}
@@ -2849,7 +5142,7 @@ bool const SVM::IterateUnbiasedBinary() {
 				case GTSVM_KERNEL_SIGMOID:    { value = Kernel< GTSVM_KERNEL_SIGMOID    >::Calculate( accumulator, m_batchVectorNormsSquared[ ii ], m_batchVectorNormsSquared[ jj ], m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
 				default: throw std::runtime_error( "Unknown kernel" );
 			}
-			m_batchSubmatrix[ ( ii << 4 ) + jj ] = m_batchSubmatrix[ ( jj << 4 ) + ii ] = value;
+			m_batchSubmatrix[ ( ii << m_logBatchSize ) + jj ] = m_batchSubmatrix[ ( jj << m_logBatchSize ) + ii ] = value;
 		}
 		double value = std::numeric_limits< double >::quiet_NaN();
 		switch( m_kernel ) {
@@ -2858,28 +5151,30 @@ bool const SVM::IterateUnbiasedBinary() {
 			case GTSVM_KERNEL_SIGMOID:    { value = Kernel< GTSVM_KERNEL_SIGMOID    >::Calculate( m_batchVectorNormsSquared[ ii ], m_batchVectorNormsSquared[ ii ], m_batchVectorNormsSquared[ ii ], m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
 			default: throw std::runtime_error( "Unknown kernel" );
 		}
-		m_batchSubmatrix[ ( ii << 4 ) + ii ] = value;
+		m_batchSubmatrix[ ( ii << m_logBatchSize ) + ii ] = value;
 	}
 
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	timer.Start( GTSVM_PHASE_SOLVE );
+
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
 		unsigned int const batchIndex = m_batchIndices[ ii ];
-		unsigned int const unclusteredIndex = m_clusterIndices[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+		unsigned int const unclusteredIndex = ( *m_clusterIndices )[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		m_batchAlphas[ ii ] = m_trainingAlphas[ unclusteredIndex ];
 	}
-	for ( unsigned int ii = 0; ii < 32; ++ii ) {
+	for ( unsigned int ii = 0; ii < 2 * batchSize; ++ii ) {
 
 		double alpha = std::numeric_limits< double >::quiet_NaN();
 
 		unsigned int bestIndex = 0;
 		{	double bestScore = -std::numeric_limits< double >::infinity();
-			for ( unsigned int jj = 0; jj < 16; ++jj ) {
+			for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
 
 				unsigned int const batchIndex = m_batchIndices[ jj ];
-				unsigned int const unclusteredIndex = m_clusterIndices[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+				unsigned int const unclusteredIndex = ( *m_clusterIndices )[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 				float const sign = ( ( m_trainingLabels[ unclusteredIndex ] > 0 ) ? 1.0f : -1.0f );
 				double const gradient = 1 - sign * m_batchResponses[ jj ];
-				double const scale = m_batchSubmatrix[ ( jj << 4 ) + jj ];
+				double const scale = m_batchSubmatrix[ ( jj << m_logBatchSize ) + jj ];
 
 				double newAlpha = m_batchAlphas[ jj ] + gradient / scale;
 				if ( newAlpha > m_regularization )
@@ -2902,69 +5197,68 @@ bool const SVM::IterateUnbiasedBinary() {
 		}
 
 		unsigned int const batchIndex = m_batchIndices[ bestIndex ];
-		unsigned int const unclusteredIndex = m_clusterIndices[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+		unsigned int const unclusteredIndex = ( *m_clusterIndices )[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		float const sign = ( ( m_trainingLabels[ unclusteredIndex ] > 0 ) ? 1.0f : -1.0f );
 
 		if ( alpha != m_batchAlphas[ bestIndex ] ) {
 
-			for ( unsigned int jj = 0; jj < 16; ++jj )
-				m_batchResponses[ jj ] += ( alpha - m_batchAlphas[ bestIndex ] ) * sign * m_batchSubmatrix[ ( bestIndex << 4 ) + jj ];
+			for ( unsigned int jj = 0; jj < batchSize; ++jj )
+				m_batchResponses[ jj ] += ( alpha - m_batchAlphas[ bestIndex ] ) * sign * m_batchSubmatrix[ ( bestIndex << m_logBatchSize ) + jj ];
 			m_batchAlphas[ bestIndex ] = alpha;
 		}
 	}
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
 		unsigned int const batchIndex = m_batchIndices[ ii ];
-		unsigned int const unclusteredIndex = m_clusterIndices[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+		unsigned int const unclusteredIndex = ( *m_clusterIndices )[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		float const sign = ( ( m_trainingLabels[ unclusteredIndex ] > 0 ) ? 1.0f : -1.0f );
 
-		if ( m_trainingAlphas[ unclusteredIndex ] != m_batchAlphas[ ii ] )
+		if ( m_trainingAlphas[ unclusteredIndex ] != m_batchAlphas[ ii ] ) {
+
 			progress = true;
 
+			// the responses of the shrunk training vectors will need to be updated
+			if ( ( m_shrunkClusters > 0 ) && ( ! m_shrunkChanged[ unclusteredIndex ] ) ) {
+
+				m_shrunkChanged[ unclusteredIndex ] = true;
+				m_shrunkChangedRows.push_back( unclusteredIndex );
+				m_shrunkChangedAlphas.push_back( m_trainingAlphas[ unclusteredIndex ] );
+			}
+		}
+
 		m_trainingAlphas[ unclusteredIndex ] = m_batchAlphas[ ii ];
 		m_batchAlphas[ ii ] *= sign;
 	}
 
+	timer.Stop();
+
 	if ( progress ) {
 
-		CUDA_VERIFY(
+		m_backend->CopyToDevice(
 			"Failed to copy batch alphas to device",
-			cudaMemcpy(
-				m_deviceBatchAlphas,
-				m_batchAlphas,
-				16 * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
+			m_deviceBatchAlphas,
+			m_batchAlphas,
+			batchSize * sizeof( float )
 		);
 
-		CUDA_VERIFY(
-			"Failed to copy batch to device",
-			cudaMemcpy(
-				m_deviceBatchVectorsTranspose,
-				m_batchVectorsTranspose,
-				( m_columns << 4 ) * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
-		);
+		m_batchVectors.Upload();
 
-		CUDA_VERIFY(
+		m_backend->CopyToDevice(
 			"Failed to copy batch squared norms to device",
-			cudaMemcpy(
-				m_deviceBatchVectorNormsSquared,
-				m_batchVectorNormsSquared,
-				16 * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
+			m_deviceBatchVectorNormsSquared,
+			m_batchVectorNormsSquared,
+			batchSize * sizeof( float )
 		);
 
-		CUDA::SparseUpdateKernel(
-			m_deviceBatchVectorsTranspose,
+		m_backend->SparseUpdateKernel(
+			m_batchVectors.GetDeviceTranspose(),
 			m_deviceBatchVectorNormsSquared,
 			m_deviceBatchAlphas,
 			m_deviceBatchIndices,
 			m_deviceClusterHeaders,
 			m_logMaximumClusterSize,
-			m_clusters,
+			m_logBatchSize,
+			activeClusters,
 			1,
 			m_kernel,
 			m_kernelParameter1,
@@ -2981,9 +5275,13 @@ bool const SVM::IterateBiasedBinary() {
 
 	BOOST_ASSERT( m_classes == 1 );
 
+	unsigned int const batchSize = ( 1u << m_logBatchSize );
+	unsigned int const activeClusters = m_clusters - m_shrunkClusters;
 	bool progress = false;
+	TraceSpan span( "IterateBiasedBinary" );
+	PhaseTimer timer( &m_statistics );
 
-	CUDA::SparseKernelFindLargestPositiveGradient(
+	m_backend->SparseKernelFindLargestPositiveGradient(
 		m_foundKeys,
 		m_foundValues,
 		m_deviceWork[ 0 ],
@@ -2992,14 +5290,14 @@ bool const SVM::IterateBiasedBinary() {
 		m_deviceWork[ 3 ],
 		m_deviceClusterHeaders,
 		m_logMaximumClusterSize,
-		m_clusters,
+		activeClusters,
 		m_workSize,
-		16,
+		batchSize,
 		m_foundSize,
 		m_regularization
 	);
-	std::copy( m_foundValues, m_foundValues + 16, m_foundIndices );
-	CUDA::SparseKernelFindLargestNegativeGradient(
+	std::copy( m_foundValues, m_foundValues + batchSize, m_foundIndices );
+	m_backend->SparseKernelFindLargestNegativeGradient(
 		m_foundKeys,
 		m_foundValues,
 		m_deviceWork[ 0 ],
@@ -3008,19 +5306,22 @@ bool const SVM::IterateBiasedBinary() {
 		m_deviceWork[ 3 ],
 		m_deviceClusterHeaders,
 		m_logMaximumClusterSize,
-		m_clusters,
+		activeClusters,
 		m_workSize,
-		16,
+		batchSize,
 		m_foundSize,
 		m_regularization
 	);
-	std::copy( m_foundValues, m_foundValues + 16, m_foundIndices + 16 );
+	std::copy( m_foundValues, m_foundValues + batchSize, m_foundIndices + batchSize );
+
+	timer.Start( GTSVM_PHASE_ASSEMBLY );
 
+	m_batchVectors.Begin();
 	{	unsigned int ii = 0;
-		for ( unsigned int jj = 0; jj < 32; ++jj ) {
+		for ( unsigned int jj = 0; jj < 2 * batchSize; ++jj ) {
 
-			unsigned int const batchIndex = m_foundIndices[ ( ( jj & 1 ) ? 31 : 15 ) - ( jj >> 1 ) ];
-			unsigned int const unclusteredIndex = m_clusterIndices[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+			unsigned int const batchIndex = m_foundIndices[ ( ( jj & 1 ) ? ( 2 * batchSize - 1 ) : ( batchSize - 1 ) ) - ( jj >> 1 ) ];
+			unsigned int const unclusteredIndex = ( *m_clusterIndices )[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 			BOOST_ASSERT( unclusteredIndex < m_rows );
 
 			bool duplicate = false;
@@ -3035,94 +5336,70 @@ bool const SVM::IterateBiasedBinary() {
 
 			if ( ! duplicate ) {
 
-				BOOST_ASSERT( ii < 16 );
+				BOOST_ASSERT( ii < batchSize );
 
 				m_batchIndices[ ii ] = batchIndex;
 
-				unsigned int ll = 0;
-				SparseVector::const_iterator kk    = m_trainingVectors[ unclusteredIndex ].begin();
-				SparseVector::const_iterator kkEnd = m_trainingVectors[ unclusteredIndex ].end();
-				for ( ; kk != kkEnd; ++kk ) {
-
-					BOOST_ASSERT( kk->first < m_columns );
-					for ( ; ll < kk->first; ++ll )
-						m_batchVectorsTranspose[ ll * 16 + ii ] = 0;
-					m_batchVectorsTranspose[ ll * 16 + ii ] = kk->second;
-					++ll;
-				}
-				for ( ; ll < m_columns; ++ll )
-					m_batchVectorsTranspose[ ll * 16 + ii ] = 0;
-
+				SetBatchVector( ii, unclusteredIndex );
 				m_batchVectorNormsSquared[ ii ] = m_trainingVectorNormsSquared[ unclusteredIndex ];
 
-				if ( ++ii >= 16 )
+				if ( ++ii >= batchSize )
 					break;
 			}
 		}
-		BOOST_ASSERT( ii == 16 );
+		BOOST_ASSERT( ii == batchSize );
 	}
 
-	CUDA_VERIFY(
-		"Failed to copy batch indices to device",
-		cudaMemcpy(
-			m_deviceBatchIndices,
-			m_batchIndices,
-			16 * sizeof( boost::uint32_t ),
-			cudaMemcpyHostToDevice
-		)
-	);
+	timer.Stop();
 
-#ifdef CUDA_USE_DOUBLE
-	CUDA::DArrayRead(
-		m_deviceBatchResponses,
-		m_deviceTrainingResponses,
+	m_backend->CopyToDevice(
+		"Failed to copy batch indices to device",
 		m_deviceBatchIndices,
-		16
+		m_batchIndices,
+		batchSize * sizeof( boost::uint32_t )
 	);
-#else    // CUDA_USE_DOUBLE
-	CUDA::FArrayRead(
+
+	m_backend->ArrayRead(
 		m_deviceBatchResponses,
 		m_deviceTrainingResponses,
 		m_deviceBatchIndices,
-		16
+		batchSize
 	);
-#endif    // CUDA_USE_DOUBLE
 
-	CUDA_VERIFY(
+	m_backend->CopyFromDevice(
 		"Failed to copy batch responses from device",
-		cudaMemcpy(
-			m_batchResponses,
-			m_deviceBatchResponses,
-			16 * sizeof( CUDA_FLOAT_DOUBLE ),
-			cudaMemcpyDeviceToHost
-		)
+		m_batchResponses,
+		m_deviceBatchResponses,
+		batchSize * sizeof( CUDA_FLOAT_DOUBLE )
 	);
 
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	timer.Start( GTSVM_PHASE_ASSEMBLY );
+
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
-		unsigned int const iiUnclusteredIndex = m_clusterIndices[ m_batchIndices[ ii ] >> m_logMaximumClusterSize ][ m_batchIndices[ ii ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+		unsigned int const iiUnclusteredIndex = ( *m_clusterIndices )[ m_batchIndices[ ii ] >> m_logMaximumClusterSize ][ m_batchIndices[ ii ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		BOOST_ASSERT( iiUnclusteredIndex < m_rows );
 
 		for ( unsigned int jj = 0; jj < ii; ++jj ) {
 
-			unsigned int const jjUnclusteredIndex = m_clusterIndices[ m_batchIndices[ jj ] >> m_logMaximumClusterSize ][ m_batchIndices[ jj ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+			unsigned int const jjUnclusteredIndex = ( *m_clusterIndices )[ m_batchIndices[ jj ] >> m_logMaximumClusterSize ][ m_batchIndices[ jj ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 			BOOST_ASSERT( jjUnclusteredIndex < m_rows );
 
 			double accumulator = 0;
 
-			SparseVector::const_iterator kk    = m_trainingVectors[ iiUnclusteredIndex ].begin();
-			SparseVector::const_iterator kkEnd = m_trainingVectors[ iiUnclusteredIndex ].end();
-			SparseVector::const_iterator ll    = m_trainingVectors[ jjUnclusteredIndex ].begin();
-			SparseVector::const_iterator llEnd = m_trainingVectors[ jjUnclusteredIndex ].end();
+			SparseMatrix::const_iterator kk    = m_trainingVectors.Begin( iiUnclusteredIndex );
+			SparseMatrix::const_iterator kkEnd = m_trainingVectors.End( iiUnclusteredIndex );
+			SparseMatrix::const_iterator ll    = m_trainingVectors.Begin( jjUnclusteredIndex );
+			SparseMatrix::const_iterator llEnd = m_trainingVectors.End( jjUnclusteredIndex );
 			while ( ( kk != kkEnd ) && ( ll != llEnd ) ) {
 
-				if ( kk->first < ll->first )
+				if ( kk.Index() < ll.Index() )
 					++kk;
-				else if ( kk->first > ll->first )
+				else if ( kk.Index() > ll.Index() )
 					++ll;
 				else {
 
-					accumulator += kk->second * ll->second;
+					accumulator += kk.Value() * ll.Value();
 					++kk;
 					++ll;
 				}
@@ -3135,7 +5412,7 @@ bool const SVM::IterateBiasedBinary() {
 				case GTSVM_KERNEL_SIGMOID:    { value = Kernel< GTSVM_KERNEL_SIGMOID    >::Calculate( accumulator, m_batchVectorNormsSquared[ ii ], m_batchVectorNormsSquared[ jj ], m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
 				default: throw std::runtime_error( "Unknown kernel" );
 			}
-			m_batchSubmatrix[ ( ii << 4 ) + jj ] = m_batchSubmatrix[ ( jj << 4 ) + ii ] = value;
+			m_batchSubmatrix[ ( ii << m_logBatchSize ) + jj ] = m_batchSubmatrix[ ( jj << m_logBatchSize ) + ii ] = value;
 		}
 		double value = std::numeric_limits< double >::quiet_NaN();
 		switch( m_kernel ) {
@@ -3144,23 +5421,25 @@ bool const SVM::IterateBiasedBinary() {
 			case GTSVM_KERNEL_SIGMOID:    { value = Kernel< GTSVM_KERNEL_SIGMOID    >::Calculate( m_batchVectorNormsSquared[ ii ], m_batchVectorNormsSquared[ ii ], m_batchVectorNormsSquared[ ii ], m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
 			default: throw std::runtime_error( "Unknown kernel" );
 		}
-		m_batchSubmatrix[ ( ii << 4 ) + ii ] = value;
+		m_batchSubmatrix[ ( ii << m_logBatchSize ) + ii ] = value;
 	}
 
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	timer.Start( GTSVM_PHASE_SOLVE );
+
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
 		unsigned int const batchIndex = m_batchIndices[ ii ];
-		unsigned int const unclusteredIndex = m_clusterIndices[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+		unsigned int const unclusteredIndex = ( *m_clusterIndices )[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		m_batchAlphas[ ii ] = m_trainingAlphas[ unclusteredIndex ];
 	}
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
 		unsigned int bestIndex1 = 0;
 		{	double bestScore = -std::numeric_limits< double >::infinity();
-			for ( unsigned int jj = 0; jj < 16; ++jj ) {
+			for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
 
 				unsigned int const batchIndex = m_batchIndices[ jj ];
-				unsigned int const unclusteredIndex = m_clusterIndices[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+				unsigned int const unclusteredIndex = ( *m_clusterIndices )[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 				float const sign = ( ( m_trainingLabels[ unclusteredIndex ] > 0 ) ? 1.0f : -1.0f );
 				double const gradient = 1 - sign * m_batchResponses[ jj ];
 
@@ -3178,7 +5457,7 @@ bool const SVM::IterateBiasedBinary() {
 			}
 		}
 		unsigned int const batchIndex1 = m_batchIndices[ bestIndex1 ];
-		unsigned int const unclusteredIndex1 = m_clusterIndices[ batchIndex1 >> m_logMaximumClusterSize ][ batchIndex1 & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+		unsigned int const unclusteredIndex1 = ( *m_clusterIndices )[ batchIndex1 >> m_logMaximumClusterSize ][ batchIndex1 & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		float const sign1 = ( ( m_trainingLabels[ unclusteredIndex1 ] > 0 ) ? 1.0f : -1.0f );
 
 		double alpha1 = std::numeric_limits< double >::quiet_NaN();
@@ -3186,17 +5465,17 @@ bool const SVM::IterateBiasedBinary() {
 
 		unsigned int bestIndex2 = 0;
 		{	double bestScore = -std::numeric_limits< double >::infinity();
-			for ( unsigned int jj = 0; jj < 16; ++jj ) {
+			for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
 
 				if ( jj != bestIndex1 ) {
 
 					unsigned int const batchIndex = m_batchIndices[ jj ];
-					unsigned int const unclusteredIndex = m_clusterIndices[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+					unsigned int const unclusteredIndex = ( *m_clusterIndices )[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 					float const sign = ( ( m_trainingLabels[ unclusteredIndex ] > 0 ) ? 1.0f : -1.0f );
 
-					double const k11 = m_batchSubmatrix[ ( bestIndex1 << 4 ) + bestIndex1 ];
-					double const k22 = m_batchSubmatrix[ ( jj << 4 ) + jj ];
-					double const k12 = m_batchSubmatrix[ ( bestIndex1 << 4 ) + jj ];
+					double const k11 = m_batchSubmatrix[ ( bestIndex1 << m_logBatchSize ) + bestIndex1 ];
+					double const k22 = m_batchSubmatrix[ ( jj << m_logBatchSize ) + jj ];
+					double const k12 = m_batchSubmatrix[ ( bestIndex1 << m_logBatchSize ) + jj ];
 					double delta = (
 						( ( sign1 - sign ) - ( m_batchResponses[ bestIndex1 ] - m_batchResponses[ jj ] ) ) /
 						std::max( k11 + k22 - 2 * k12, static_cast< double >( std::numeric_limits< float >::epsilon() ) )
@@ -3253,75 +5532,74 @@ bool const SVM::IterateBiasedBinary() {
 		}
 
 		unsigned int const batchIndex2 = m_batchIndices[ bestIndex2 ];
-		unsigned int const unclusteredIndex2 = m_clusterIndices[ batchIndex2 >> m_logMaximumClusterSize ][ batchIndex2 & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+		unsigned int const unclusteredIndex2 = ( *m_clusterIndices )[ batchIndex2 >> m_logMaximumClusterSize ][ batchIndex2 & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		float const sign2 = ( ( m_trainingLabels[ unclusteredIndex2 ] > 0 ) ? 1.0f : -1.0f );
 
 		if ( alpha1 != m_batchAlphas[ bestIndex1 ] ) {
 
-			for ( unsigned int jj = 0; jj < 16; ++jj )
-				m_batchResponses[ jj ] += ( alpha1 - m_batchAlphas[ bestIndex1 ] ) * sign1 * m_batchSubmatrix[ ( bestIndex1 << 4 ) + jj ];
+			for ( unsigned int jj = 0; jj < batchSize; ++jj )
+				m_batchResponses[ jj ] += ( alpha1 - m_batchAlphas[ bestIndex1 ] ) * sign1 * m_batchSubmatrix[ ( bestIndex1 << m_logBatchSize ) + jj ];
 			m_batchAlphas[ bestIndex1 ] = alpha1;
 		}
 		if ( alpha2 != m_batchAlphas[ bestIndex2 ] ) {
 
-			for ( unsigned int jj = 0; jj < 16; ++jj )
-				m_batchResponses[ jj ] += ( alpha2 - m_batchAlphas[ bestIndex2 ] ) * sign2 * m_batchSubmatrix[ ( bestIndex2 << 4 ) + jj ];
+			for ( unsigned int jj = 0; jj < batchSize; ++jj )
+				m_batchResponses[ jj ] += ( alpha2 - m_batchAlphas[ bestIndex2 ] ) * sign2 * m_batchSubmatrix[ ( bestIndex2 << m_logBatchSize ) + jj ];
 			m_batchAlphas[ bestIndex2 ] = alpha2;
 		}
 	}
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
 		unsigned int const batchIndex = m_batchIndices[ ii ];
-		unsigned int const unclusteredIndex = m_clusterIndices[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+		unsigned int const unclusteredIndex = ( *m_clusterIndices )[ batchIndex >> m_logMaximumClusterSize ][ batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		float const sign = ( ( m_trainingLabels[ unclusteredIndex ] > 0 ) ? 1.0f : -1.0f );
 
-		if ( m_trainingAlphas[ unclusteredIndex ] != m_batchAlphas[ ii ] )
+		if ( m_trainingAlphas[ unclusteredIndex ] != m_batchAlphas[ ii ] ) {
+
 			progress = true;
 
+			// the responses of the shrunk training vectors will need to be updated
+			if ( ( m_shrunkClusters > 0 ) && ( ! m_shrunkChanged[ unclusteredIndex ] ) ) {
+
+				m_shrunkChanged[ unclusteredIndex ] = true;
+				m_shrunkChangedRows.push_back( unclusteredIndex );
+				m_shrunkChangedAlphas.push_back( m_trainingAlphas[ unclusteredIndex ] );
+			}
+		}
+
 		m_trainingAlphas[ unclusteredIndex ] = m_batchAlphas[ ii ];
 		m_batchAlphas[ ii ] *= sign;
 	}
 
+	timer.Stop();
+
 	if ( progress ) {
 
-		CUDA_VERIFY(
+		m_backend->CopyToDevice(
 			"Failed to copy batch alphas to device",
-			cudaMemcpy(
-				m_deviceBatchAlphas,
-				m_batchAlphas,
-				16 * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
+			m_deviceBatchAlphas,
+			m_batchAlphas,
+			batchSize * sizeof( float )
 		);
 
-		CUDA_VERIFY(
-			"Failed to copy batch to device",
-			cudaMemcpy(
-				m_deviceBatchVectorsTranspose,
-				m_batchVectorsTranspose,
-				( m_columns << 4 ) * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
-		);
+		m_batchVectors.Upload();
 
-		CUDA_VERIFY(
+		m_backend->CopyToDevice(
 			"Failed to copy batch squared norms to device",
-			cudaMemcpy(
-				m_deviceBatchVectorNormsSquared,
-				m_batchVectorNormsSquared,
-				16 * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
+			m_deviceBatchVectorNormsSquared,
+			m_batchVectorNormsSquared,
+			batchSize * sizeof( float )
 		);
 
-		CUDA::SparseUpdateKernel(
-			m_deviceBatchVectorsTranspose,
+		m_backend->SparseUpdateKernel(
+			m_batchVectors.GetDeviceTranspose(),
 			m_deviceBatchVectorNormsSquared,
 			m_deviceBatchAlphas,
 			m_deviceBatchIndices,
 			m_deviceClusterHeaders,
 			m_logMaximumClusterSize,
-			m_clusters,
+			m_logBatchSize,
+			activeClusters,
 			1,
 			m_kernel,
 			m_kernelParameter1,
@@ -3338,9 +5616,12 @@ bool const SVM::IterateUnbiasedMulticlass() {
 
 	BOOST_ASSERT( m_classes > 1 );
 
+	unsigned int const batchSize = ( 1u << m_logBatchSize );
 	bool progress = false;
+	TraceSpan span( "IterateUnbiasedMulticlass" );
+	PhaseTimer timer( &m_statistics );
 
-	CUDA::SparseKernelFindLargestScore(
+	m_backend->SparseKernelFindLargestScore(
 		m_foundKeys,
 		m_foundValues,
 		m_deviceWork[ 0 ],
@@ -3352,108 +5633,87 @@ bool const SVM::IterateUnbiasedMulticlass() {
 		m_clusters,
 		m_classes,
 		m_workSize,
-		16,
+		batchSize,
 		m_foundSize,
 		m_regularization
 	);
-	std::copy( m_foundValues, m_foundValues + 16, m_foundIndices );
+	std::copy( m_foundValues, m_foundValues + batchSize, m_foundIndices );
 
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	timer.Start( GTSVM_PHASE_ASSEMBLY );
+
+	m_batchVectors.Begin();
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
 		unsigned int const batchIndex = m_foundIndices[ ii ];
 
 		unsigned int const cluster = ( batchIndex >> m_logMaximumClusterSize );
 		unsigned int const index = ( batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) );
 		BOOST_ASSERT( cluster < m_clusters );
-		BOOST_ASSERT( index < m_clusterIndices[ cluster ].size() );
+		BOOST_ASSERT( index < ( *m_clusterIndices )[ cluster ].size() );
 
-		unsigned int const unclusteredIndex = m_clusterIndices[ cluster ][ index ];
+		unsigned int const unclusteredIndex = ( *m_clusterIndices )[ cluster ][ index ];
 		BOOST_ASSERT( unclusteredIndex < m_rows );
 
 		for ( unsigned int jj = 0; jj < ii; ++jj )
 			BOOST_ASSERT( m_foundIndices[ jj ] != batchIndex );
 
 		for ( unsigned int jj = 0; jj < m_classes; ++jj )
-			m_batchIndices[ jj * 16 + ii ] = ( ( cluster * m_classes + jj ) << m_logMaximumClusterSize ) + index;
-
-		unsigned int kk = 0;
-		SparseVector::const_iterator jj    = m_trainingVectors[ unclusteredIndex ].begin();
-		SparseVector::const_iterator jjEnd = m_trainingVectors[ unclusteredIndex ].end();
-		for ( ; jj != jjEnd; ++jj ) {
-
-			BOOST_ASSERT( jj->first < m_columns );
-			for ( ; kk < jj->first; ++kk )
-				m_batchVectorsTranspose[ kk * 16 + ii ] = 0;
-			m_batchVectorsTranspose[ kk * 16 + ii ] = jj->second;
-			++kk;
-		}
-		for ( ; kk < m_columns; ++kk )
-			m_batchVectorsTranspose[ kk * 16 + ii ] = 0;
+			m_batchIndices[ ( jj << m_logBatchSize ) + ii ] = ( ( cluster * m_classes + jj ) << m_logMaximumClusterSize ) + index;
 
+		SetBatchVector( ii, unclusteredIndex );
 		m_batchVectorNormsSquared[ ii ] = m_trainingVectorNormsSquared[ unclusteredIndex ];
 	}
 
-	CUDA_VERIFY(
-		"Failed to copy batch indices to device",
-		cudaMemcpy(
-			m_deviceBatchIndices,
-			m_batchIndices,
-			16 * m_classes * sizeof( boost::uint32_t ),
-			cudaMemcpyHostToDevice
-		)
-	);
+	timer.Stop();
 
-#ifdef CUDA_USE_DOUBLE
-	CUDA::DArrayRead(
-		m_deviceBatchResponses,
-		m_deviceTrainingResponses,
+	m_backend->CopyToDevice(
+		"Failed to copy batch indices to device",
 		m_deviceBatchIndices,
-		16 * m_classes
+		m_batchIndices,
+		( m_classes << m_logBatchSize ) * sizeof( boost::uint32_t )
 	);
-#else    // CUDA_USE_DOUBLE
-	CUDA::FArrayRead(
+
+	m_backend->ArrayRead(
 		m_deviceBatchResponses,
 		m_deviceTrainingResponses,
 		m_deviceBatchIndices,
-		16 * m_classes
+		( m_classes << m_logBatchSize )
 	);
-#endif    // CUDA_USE_DOUBLE
 
-	CUDA_VERIFY(
+	m_backend->CopyFromDevice(
 		"Failed to copy batch responses from device",
-		cudaMemcpy(
-			m_batchResponses,
-			m_deviceBatchResponses,
-			16 * m_classes * sizeof( CUDA_FLOAT_DOUBLE ),
-			cudaMemcpyDeviceToHost
-		)
+		m_batchResponses,
+		m_deviceBatchResponses,
+		( m_classes << m_logBatchSize ) * sizeof( CUDA_FLOAT_DOUBLE )
 	);
 
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	timer.Start( GTSVM_PHASE_ASSEMBLY );
+
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
-		unsigned int const iiUnclusteredIndex = m_clusterIndices[ m_foundIndices[ ii ] >> m_logMaximumClusterSize ][ m_foundIndices[ ii ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+		unsigned int const iiUnclusteredIndex = ( *m_clusterIndices )[ m_foundIndices[ ii ] >> m_logMaximumClusterSize ][ m_foundIndices[ ii ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 		BOOST_ASSERT( iiUnclusteredIndex < m_rows );
 
 		for ( unsigned int jj = 0; jj < ii; ++jj ) {
 
-			unsigned int const jjUnclusteredIndex = m_clusterIndices[ m_foundIndices[ jj ] >> m_logMaximumClusterSize ][ m_foundIndices[ jj ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
+			unsigned int const jjUnclusteredIndex = ( *m_clusterIndices )[ m_foundIndices[ jj ] >> m_logMaximumClusterSize ][ m_foundIndices[ jj ] & ( ( 1u << m_logMaximumClusterSize ) - 1 ) ];
 			BOOST_ASSERT( jjUnclusteredIndex < m_rows );
 
 			double accumulator = 0;
 
-			SparseVector::const_iterator kk    = m_trainingVectors[ iiUnclusteredIndex ].begin();
-			SparseVector::const_iterator kkEnd = m_trainingVectors[ iiUnclusteredIndex ].end();
-			SparseVector::const_iterator ll    = m_trainingVectors[ jjUnclusteredIndex ].begin();
-			SparseVector::const_iterator llEnd = m_trainingVectors[ jjUnclusteredIndex ].end();
+			SparseMatrix::const_iterator kk    = m_trainingVectors.Begin( iiUnclusteredIndex );
+			SparseMatrix::const_iterator kkEnd = m_trainingVectors.End( iiUnclusteredIndex );
+			SparseMatrix::const_iterator ll    = m_trainingVectors.Begin( jjUnclusteredIndex );
+			SparseMatrix::const_iterator llEnd = m_trainingVectors.End( jjUnclusteredIndex );
 			while ( ( kk != kkEnd ) && ( ll != llEnd ) ) {
 
-				if ( kk->first < ll->first )
+				if ( kk.Index() < ll.Index() )
 					++kk;
-				else if ( kk->first > ll->first )
+				else if ( kk.Index() > ll.Index() )
 					++ll;
 				else {
 
-					accumulator += kk->second * ll->second;
+					accumulator += kk.Value() * ll.Value();
 					++kk;
 					++ll;
 				}
@@ -3466,7 +5726,7 @@ bool const SVM::IterateUnbiasedMulticlass() {
 				case GTSVM_KERNEL_SIGMOID:    { value = Kernel< GTSVM_KERNEL_SIGMOID    >::Calculate( accumulator, m_batchVectorNormsSquared[ ii ], m_batchVectorNormsSquared[ jj ], m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
 				default: throw std::runtime_error( "Unknown kernel" );
 			}
-			m_batchSubmatrix[ ( ii << 4 ) + jj ] = m_batchSubmatrix[ ( jj << 4 ) + ii ] = value;
+			m_batchSubmatrix[ ( ii << m_logBatchSize ) + jj ] = m_batchSubmatrix[ ( jj << m_logBatchSize ) + ii ] = value;
 		}
 		double value = std::numeric_limits< double >::quiet_NaN();
 		switch( m_kernel ) {
@@ -3475,25 +5735,27 @@ bool const SVM::IterateUnbiasedMulticlass() {
 			case GTSVM_KERNEL_SIGMOID:    { value = Kernel< GTSVM_KERNEL_SIGMOID    >::Calculate( m_batchVectorNormsSquared[ ii ], m_batchVectorNormsSquared[ ii ], m_batchVectorNormsSquared[ ii ], m_kernelParameter1, m_kernelParameter2, m_kernelParameter3 ); break; }
 			default: throw std::runtime_error( "Unknown kernel" );
 		}
-		m_batchSubmatrix[ ( ii << 4 ) + ii ] = value;
+		m_batchSubmatrix[ ( ii << m_logBatchSize ) + ii ] = value;
 	}
 
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	timer.Start( GTSVM_PHASE_SOLVE );
+
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
 		unsigned int const batchIndex = m_foundIndices[ ii ];
 
 		unsigned int const cluster = ( batchIndex >> m_logMaximumClusterSize );
 		unsigned int const index = ( batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) );
 		BOOST_ASSERT( cluster < m_clusters );
-		BOOST_ASSERT( index < m_clusterIndices[ cluster ].size() );
+		BOOST_ASSERT( index < ( *m_clusterIndices )[ cluster ].size() );
 
-		unsigned int const unclusteredIndex = m_clusterIndices[ cluster ][ index ];
+		unsigned int const unclusteredIndex = ( *m_clusterIndices )[ cluster ][ index ];
 		BOOST_ASSERT( unclusteredIndex < m_rows );
 
 		for ( unsigned int jj = 0; jj < m_classes; ++jj )
-			m_batchAlphas[ jj * 16 + ii ] = m_trainingAlphas[ unclusteredIndex * m_classes + jj ];
+			m_batchAlphas[ ( jj << m_logBatchSize ) + ii ] = m_trainingAlphas[ unclusteredIndex * m_classes + jj ];
 	}
-	for ( unsigned int ii = 0; ii < 16 * m_classes; ++ii ) {
+	for ( unsigned int ii = 0; ii < ( m_classes << m_logBatchSize ); ++ii ) {
 
 		unsigned int bestIndex = 0;
 		double bestScore = -std::numeric_limits< double >::infinity();
@@ -3501,16 +5763,16 @@ bool const SVM::IterateUnbiasedMulticlass() {
 		unsigned int bestMinimumIndex = 0;
 		float bestMaximumAlpha = 0;
 		float bestMinimumAlpha = 0;
-		for ( unsigned int jj = 0; jj < 16; ++jj ) {
+		for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
 
 			unsigned int const batchIndex = m_foundIndices[ jj ];
 
 			unsigned int const cluster = ( batchIndex >> m_logMaximumClusterSize );
 			unsigned int const index = ( batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) );
 			BOOST_ASSERT( cluster < m_clusters );
-			BOOST_ASSERT( index < m_clusterIndices[ cluster ].size() );
+			BOOST_ASSERT( index < ( *m_clusterIndices )[ cluster ].size() );
 
-			unsigned int const unclusteredIndex = m_clusterIndices[ cluster ][ index ];
+			unsigned int const unclusteredIndex = ( *m_clusterIndices )[ cluster ][ index ];
 			BOOST_ASSERT( unclusteredIndex < m_rows );
 
 			unsigned int const label = m_trainingLabels[ unclusteredIndex ];
@@ -3520,7 +5782,7 @@ bool const SVM::IterateUnbiasedMulticlass() {
 
 			for ( unsigned int kk = 0; kk < m_classes; ++kk ) {
 
-				double gradient = -m_batchResponses[ kk * 16 + jj ];
+				double gradient = -m_batchResponses[ ( kk << m_logBatchSize ) + jj ];
 				if ( kk == label )
 					gradient += 1;
 
@@ -3533,7 +5795,7 @@ bool const SVM::IterateUnbiasedMulticlass() {
 
 			for ( unsigned int kk = 0; kk < m_classes; ++kk ) {
 
-				double gradient = -m_batchResponses[ kk * 16 + jj ];
+				double gradient = -m_batchResponses[ ( kk << m_logBatchSize ) + jj ];
 				float bound = 0;
 				if ( kk == label ) {
 
@@ -3541,22 +5803,22 @@ bool const SVM::IterateUnbiasedMulticlass() {
 					bound = m_regularization;
 				}
 
-				if ( m_batchAlphas[ kk * 16 + jj ] < bound ) {
+				if ( m_batchAlphas[ ( kk << m_logBatchSize ) + jj ] < bound ) {
 
-					double delta = 0.5 * ( gradient - minimumGradient ) / m_batchSubmatrix[ ( jj << 4 ) + jj ];
+					double delta = 0.5 * ( gradient - minimumGradient ) / m_batchSubmatrix[ ( jj << m_logBatchSize ) + jj ];
 					if ( delta > 0 ) {
 
 						BOOST_ASSERT( kk != minimumIndex );
 
-						float maximumAlpha = m_batchAlphas[ kk * 16 + jj ] + delta;
+						float maximumAlpha = m_batchAlphas[ ( kk << m_logBatchSize ) + jj ] + delta;
 						if ( maximumAlpha >= bound ) {
 
 							maximumAlpha = bound;
-							delta = bound - m_batchAlphas[ kk * 16 + jj ];
+							delta = bound - m_batchAlphas[ ( kk << m_logBatchSize ) + jj ];
 						}
-						float minimumAlpha = m_batchAlphas[ minimumIndex * 16 + jj ] - delta;
+						float minimumAlpha = m_batchAlphas[ ( minimumIndex << m_logBatchSize ) + jj ] - delta;
 
-						double const score = ( ( gradient - minimumGradient ) - delta * m_batchSubmatrix[ ( jj << 4 ) + jj ] ) * delta;
+						double const score = ( ( gradient - minimumGradient ) - delta * m_batchSubmatrix[ ( jj << m_logBatchSize ) + jj ] ) * delta;
 						if ( score > bestScore ) {
 
 							bestIndex = jj;
@@ -3573,84 +5835,70 @@ bool const SVM::IterateUnbiasedMulticlass() {
 		if ( bestScore <= 0 )
 			break;
 
-		for ( unsigned int jj = 0; jj < 16; ++jj ) {
+		for ( unsigned int jj = 0; jj < batchSize; ++jj ) {
 
-			m_batchResponses[ bestMaximumIndex * 16 + jj ] += ( bestMaximumAlpha - m_batchAlphas[ bestMaximumIndex * 16 + bestIndex ] ) * m_batchSubmatrix[ ( bestIndex << 4 ) + jj ];
-			m_batchResponses[ bestMinimumIndex * 16 + jj ] += ( bestMinimumAlpha - m_batchAlphas[ bestMinimumIndex * 16 + bestIndex ] ) * m_batchSubmatrix[ ( bestIndex << 4 ) + jj ];
+			m_batchResponses[ ( bestMaximumIndex << m_logBatchSize ) + jj ] += ( bestMaximumAlpha - m_batchAlphas[ ( bestMaximumIndex << m_logBatchSize ) + bestIndex ] ) * m_batchSubmatrix[ ( bestIndex << m_logBatchSize ) + jj ];
+			m_batchResponses[ ( bestMinimumIndex << m_logBatchSize ) + jj ] += ( bestMinimumAlpha - m_batchAlphas[ ( bestMinimumIndex << m_logBatchSize ) + bestIndex ] ) * m_batchSubmatrix[ ( bestIndex << m_logBatchSize ) + jj ];
 		}
-		m_batchAlphas[ bestMaximumIndex * 16 + bestIndex ] = bestMaximumAlpha;
-		m_batchAlphas[ bestMinimumIndex * 16 + bestIndex ] = bestMinimumAlpha;
+		m_batchAlphas[ ( bestMaximumIndex << m_logBatchSize ) + bestIndex ] = bestMaximumAlpha;
+		m_batchAlphas[ ( bestMinimumIndex << m_logBatchSize ) + bestIndex ] = bestMinimumAlpha;
 	}
-	for ( unsigned int ii = 0; ii < 16; ++ii ) {
+	for ( unsigned int ii = 0; ii < batchSize; ++ii ) {
 
 		unsigned int const batchIndex = m_foundIndices[ ii ];
 
 		unsigned int const cluster = ( batchIndex >> m_logMaximumClusterSize );
 		unsigned int const index = ( batchIndex & ( ( 1u << m_logMaximumClusterSize ) - 1 ) );
 		BOOST_ASSERT( cluster < m_clusters );
-		BOOST_ASSERT( index < m_clusterIndices[ cluster ].size() );
+		BOOST_ASSERT( index < ( *m_clusterIndices )[ cluster ].size() );
 
-		unsigned int const unclusteredIndex = m_clusterIndices[ cluster ][ index ];
+		unsigned int const unclusteredIndex = ( *m_clusterIndices )[ cluster ][ index ];
 		BOOST_ASSERT( unclusteredIndex < m_rows );
 
 		for ( unsigned int jj = 0; jj < m_classes; ++jj ) {
 
-			if ( m_trainingAlphas[ unclusteredIndex * m_classes + jj ] != m_batchAlphas[ jj * 16 + ii ] )
+			if ( m_trainingAlphas[ unclusteredIndex * m_classes + jj ] != m_batchAlphas[ ( jj << m_logBatchSize ) + ii ] )
 				progress = true;
 
-			m_trainingAlphas[ unclusteredIndex * m_classes + jj ] = m_batchAlphas[ jj * 16 + ii ];
+			m_trainingAlphas[ unclusteredIndex * m_classes + jj ] = m_batchAlphas[ ( jj << m_logBatchSize ) + ii ];
 		}
 	}
 
+	timer.Stop();
+
 	if ( progress ) {
 
-		CUDA_VERIFY(
+		m_backend->CopyToDevice(
 			"Failed to copy batch alphas to device",
-			cudaMemcpy(
-				m_deviceBatchAlphas,
-				m_batchAlphas,
-				16 * m_classes * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
+			m_deviceBatchAlphas,
+			m_batchAlphas,
+			( m_classes << m_logBatchSize ) * sizeof( float )
 		);
 
-		CUDA_VERIFY(
-			"Failed to copy batch to device",
-			cudaMemcpy(
-				m_deviceBatchVectorsTranspose,
-				m_batchVectorsTranspose,
-				( m_columns << 4 ) * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
-		);
+		m_batchVectors.Upload();
 
-		CUDA_VERIFY(
+		m_backend->CopyToDevice(
 			"Failed to copy batch squared norms to device",
-			cudaMemcpy(
-				m_deviceBatchVectorNormsSquared,
-				m_batchVectorNormsSquared,
-				16 * sizeof( float ),
-				cudaMemcpyHostToDevice
-			)
+			m_deviceBatchVectorNormsSquared,
+			m_batchVectorNormsSquared,
+			batchSize * sizeof( float )
 		);
 
-		CUDA_VERIFY(
+		m_backend->CopyToDevice(
 			"Failed to copy batch indices to device",
-			cudaMemcpy(
-				m_deviceBatchIndices,
-				m_foundIndices,
-				16 * sizeof( boost::uint32_t ),
-				cudaMemcpyHostToDevice
-			)
+			m_deviceBatchIndices,
+			m_foundIndices,
+			batchSize * sizeof( boost::uint32_t )
 		);
 
-		CUDA::SparseUpdateKernel(
-			m_deviceBatchVectorsTranspose,
+		m_backend->SparseUpdateKernel(
+			m_batchVectors.GetDeviceTranspose(),
 			m_deviceBatchVectorNormsSquared,
 			m_deviceBatchAlphas,
 			m_deviceBatchIndices,
 			m_deviceClusterHeaders,
 			m_logMaximumClusterSize,
+			m_logBatchSize,
 			m_clusters,
 			m_classes,
 			m_kernel,
@@ -31,9 +31,14 @@
 
 
 #include "gtsvm.h"
+#include "backend.hpp"
+#include "statistics.hpp"
+#include "sparse_matrix.hpp"
+#include "model_file.hpp"
 #include "cuda.hpp"
 #include "helpers.hpp"
 
+#include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
 #include <boost/assert.hpp>
 #include <boost/static_assert.hpp>
@@ -53,6 +58,128 @@ namespace GTSVM {
 
 
 
+//============================================================================
+//    BatchVectors class
+//============================================================================
+
+
+/*
+	The transposed vectors of a batch, on the host and on the device. A batch
+	is assembled by calling Begin(), followed by SetValue() for the nonzeros
+	(or by filling in every entry of the buffer returned by BeginDense()), and
+	copied to the device by Upload(). Only the entries which were written are
+	cleared and uploaded, so the cost of a sparse batch does not depend on the
+	number of columns.
+
+	The entries listed in m_updateIndices (the first m_previousUpdates of
+	which were written by the previous batch, and are now zero) are the only
+	ones which might be nonzero, or differ from those on the device, unless
+	m_untracked or m_uploadAll is set
+*/
+struct BatchVectors {
+
+	BatchVectors();
+	~BatchVectors();
+
+
+	void Allocate(
+		boost::shared_ptr< Backend > const& backend,
+		boost::uint32_t const columns,
+		unsigned int const logBatchSize,
+		unsigned int const updateSize    // the number of entries which may be listed, before we upload everything instead
+	);
+	void Cleanup();
+
+	void Begin();
+	float* const BeginDense();    // the whole of the result is uploaded, so should be written
+	inline void SetValue( unsigned int const index, unsigned int const column, float const value );
+	void Upload();
+
+	inline float const* GetDeviceTranspose() const;
+
+
+private:
+
+	boost::shared_ptr< Backend > m_backend;
+
+	boost::uint32_t m_columns;
+	unsigned int m_logBatchSize;
+
+	unsigned int m_updateSize;
+	std::vector< boost::uint32_t > m_updateIndices;
+	std::vector< float > m_updateValues;
+	unsigned int m_previousUpdates;
+	bool m_untracked;    // are there nonzeros which aren't listed in m_updateIndices?
+	bool m_uploadAll;    // might the device differ from the host at entries which aren't listed?
+
+	float* m_transpose;
+	float* m_deviceTranspose;
+	boost::uint32_t* m_deviceUpdateIndices;
+	float* m_deviceUpdateValues;
+
+
+	BatchVectors( BatchVectors const& other );
+	BatchVectors const& operator=( BatchVectors const& other );
+};
+
+
+
+
+//============================================================================
+//    Session class
+//============================================================================
+
+
+/*
+	The buffers used to classify a batch: the transposed batch vectors, their
+	squared norms, the responses, and the kernel's work space. Each SVM has
+	one of its own, but classifying with a separate session (which belongs to
+	the caller, not to the SVM) doesn't modify the SVM, so any number of
+	threads, each with its own session, may classify with one SVM at once.
+
+	A session doesn't refer to the SVM which created it, and only allocates
+	(or reallocates, if the SVM's device buffers have been reinitialized
+	since) its buffers when it's first used. Transfers made through a session
+	aren't charged to the SVM's statistics, since they may be concurrent
+*/
+struct Session {
+
+	explicit Session( boost::shared_ptr< Backend > const& backend );
+	~Session();
+
+
+private:
+
+	void Cleanup();
+
+
+	boost::shared_ptr< Backend > m_backend;
+
+	bool m_initialized;
+	unsigned int m_generation;    // that of the SVM's device buffers, for which these were allocated
+
+	boost::uint32_t m_columns;
+	unsigned int m_classes;
+	unsigned int m_logBatchSize;
+
+	BatchVectors m_batchVectors;
+	float* m_batchVectorNormsSquared;
+	CUDA_FLOAT_DOUBLE* m_batchResponses;
+
+	float* m_deviceBatchVectorNormsSquared;
+
+	void* m_deviceWork[ 2 ];
+
+
+	Session( Session const& other );
+	Session const& operator=( Session const& other );
+
+	friend struct SVM;
+};
+
+
+
+
 //============================================================================
 //    SVM class
 //============================================================================
@@ -64,7 +191,7 @@ struct SVM {
 	BOOST_STATIC_ASSERT( sizeof( char ) == 1 );
 
 
-	SVM();
+	explicit SVM( GTSVM_Backend const backend = GTSVM_BACKEND_DEFAULT );
 	~SVM();
 
 
@@ -85,6 +212,8 @@ struct SVM {
 		float const kernelParameter2,
 		float const kernelParameter3,
 		bool const biased,
+		GTSVM_ColumnOrder const columnOrder,
+		GTSVM_Clustering const clustering,
 		bool const smallClusters,
 		unsigned int const activeClusters
 	);
@@ -104,24 +233,63 @@ struct SVM {
 		float const kernelParameter2,
 		float const kernelParameter3,
 		bool const biased,
+		GTSVM_ColumnOrder const columnOrder,
+		GTSVM_Clustering const clustering,
 		bool const smallClusters,
 		unsigned int const activeClusters
 	);
 
+	/*
+		Uses the training vectors, squared norms, columns and clustering of
+		source, which are shared, rather than copied. So are its labels, unless
+		trainingLabels is non-NULL, in which case they're replaced (e.g. for
+		one-versus-rest training). Everything else, including the kernel and
+		alphas, is separate
+	*/
+	void InitializeShared(
+		SVM& source,
+		void const* const trainingLabels,
+		GTSVM_Type trainingLabelsType,
+		bool const multiclass,
+		float const regularization,
+		GTSVM_Kernel const kernel,
+		float const kernelParameter1,
+		float const kernelParameter2,
+		float const kernelParameter3,
+		bool const biased
+	);
+
 	void Load(
 		char const* const filename,
+		GTSVM_Clustering const clustering,
 		bool const smallClusters,
 		unsigned int const activeClusters
 	);
 
 	void Save( char const* const filename ) const;
 
-	void Shrink( bool const smallClusters, unsigned int const activeClusters );
+	void Shrink(
+		GTSVM_Clustering const clustering,
+		bool const smallClusters,
+		unsigned int const activeClusters
+	);
 
 	void DeinitializeDevice();
 	void Deinitialize();
 
 
+	/*
+		The number of training vectors optimized over at each iteration: 8,
+		16, 32, 64 or 128 (the CUDA backend only supports 16). Changing it
+		deinitializes the device, so it's best done right after
+		initialization
+	*/
+	void SetBatchSize( unsigned int const batchSize );
+	inline unsigned int const GetBatchSize() const;
+
+
+	inline GTSVM_Backend const GetBackend() const;
+
 	inline unsigned int const GetRows()     const;
 	inline unsigned int const GetColumns()  const;
 	inline unsigned int const GetClasses()  const;
@@ -136,6 +304,17 @@ struct SVM {
 
 	inline CUDA_FLOAT_DOUBLE const GetBias() const;
 
+	inline GTSVM_Statistics const& GetStatistics() const;
+	inline void ResetStatistics();
+
+	void GetMemoryUsage( GTSVM_MemoryUsage* const pUsage ) const;
+	void PredictMemoryUsage(
+		GTSVM_MemoryUsage* const pUsage,
+		GTSVM_Clustering const clustering,
+		bool const smallClusters,
+		unsigned int const activeClusters
+	) const;
+
 
 	void GetTrainingVectorsSparse(
 		void* const trainingVectors,    // order depends on the columnMajor flag
@@ -187,9 +366,42 @@ struct SVM {
 		bool const biased
 	);
 
+	/*
+		Unlike Restart(), this keeps the current solution as a warm start: the
+		alphas are projected onto the new constraints, and the responses are
+		only updated for the training vectors whose alphas changed
+	*/
+	void SetRegularization( float const regularization );
+
+	/*
+		Also a warm start: the alphas are kept (they're feasible for any
+		kernel), and only the responses and bias are recalculated, reusing the
+		clustering and everything already on the device
+	*/
+	void SetKernel(
+		GTSVM_Kernel const kernel,
+		float const kernelParameter1,
+		float const kernelParameter2,
+		float const kernelParameter3
+	);
+
 	std::pair< CUDA_FLOAT_DOUBLE, CUDA_FLOAT_DOUBLE > const Optimize( unsigned int const iterations );
 
 
+	/*
+		With shrinking enabled, Optimize() periodically removes training
+		vectors which are at a bound, and are unlikely to move, from the active
+		set (binary problems only). The responses of the shrunk training
+		vectors are brought up-to-date before Optimize() calculates the
+		objectives, so these are those of the full problem. Unshrink() restores
+		the full problem, and returns whether anything had been shrunk
+	*/
+	void SetShrinking( bool const shrinking );
+	inline bool const GetShrinking() const;
+
+	bool const Unshrink();
+
+
 	void ClassifySparse(
 		void* const result,
 		GTSVM_Type resultType,
@@ -212,19 +424,121 @@ struct SVM {
 		bool const columnMajor
 	);
 
+	/*
+		Sessions use the device buffers of the SVM, so classifying with one
+		only leaves the SVM untouched if IsInitializedDevice() (otherwise, it
+		initializes the device first, just like the methods above). The
+		session is (re)allocated as necessary. CreateSession() also
+		initializes the device, and returns a session which doesn't count
+		towards the SVM's statistics
+	*/
+	boost::shared_ptr< Session > const CreateSession();
+	inline bool const IsInitializedDevice() const;
+
+	void ClassifySparse(
+		Session& session,
+		void* const result,
+		GTSVM_Type resultType,
+		void const* const vectors,    // order depends on columnMajor flag
+		size_t const* const vectorIndices,
+		size_t const* const vectorOffsets,
+		GTSVM_Type vectorsType,
+		unsigned int const rows,
+		unsigned int const columns,
+		bool const columnMajor
+	);
+
+	void ClassifyDense(
+		Session& session,
+		void* const result,
+		GTSVM_Type resultType,
+		void const* const vectors,    // order depends on columnMajor flag
+		GTSVM_Type vectorsType,
+		unsigned int const rows,
+		unsigned int const columns,
+		bool const columnMajor
+	);
+
 
 private:
 
 	void Cleanup();
 
+	void LoadVersion1( char const* const filename );
+	void LoadVersion2( char const* const filename );
+
+	void CompactColumns( GTSVM_ColumnOrder const columnOrder );
+	void UpdateInputColumnIndices();
+	void CopyLabels(
+		void const* const trainingLabels,
+		GTSVM_Type trainingLabelsType,
+		bool const multiclass
+	);
+	void CalculateNorms();
+	void CalculateKernelNorms();    // from the squared norms
+
 	void ClusterTrainingVectors(
+		GTSVM_Clustering const clustering,
 		bool const smallClusters,
-		unsigned int activeClusters
+		unsigned int const activeClusters
 	);
 
+	void FindClusters(
+		std::vector< std::vector< unsigned int > >* const pClusterIndices,
+		std::vector< std::vector< unsigned int > >* const pClusterNonzeroIndices,
+		GTSVM_Clustering const clustering,
+		unsigned int const logMaximumClusterSize,
+		unsigned int const activeClusters
+	) const;
+
+	void FindGreedyClusters(
+		std::vector< std::vector< unsigned int > >* const pClusterIndices,
+		std::vector< std::vector< unsigned int > >* const pClusterNonzeroIndices,
+		unsigned int const logMaximumClusterSize,
+		unsigned int activeClusters
+	) const;
+
+	void FindMinHashClusters(
+		std::vector< std::vector< unsigned int > >* const pClusterIndices,
+		std::vector< std::vector< unsigned int > >* const pClusterNonzeroIndices,
+		unsigned int const logMaximumClusterSize
+	) const;
+
+	void CalculateMemoryUsage(
+		GTSVM_MemoryUsage* const pUsage,
+		std::vector< std::vector< unsigned int > > const& clusterIndices,
+		std::vector< std::vector< unsigned int > > const& clusterNonzeroIndices,
+		unsigned int const logMaximumClusterSize
+	) const;
+
 	void InitializeDevice();
+	void ReleaseDevice();    // like DeinitializeDevice(), but doesn't download the responses
+	/*
+		Moves everything on the device to the current cluster layout: the
+		training vector in slot ii of the layout is copied from slot
+		sources[ ii ] of the layout on the device
+	*/
+	void RepackDevice( std::vector< boost::uint32_t > const& sources );
+	void UploadKernelNorms();
+
+	void PrepareSession( Session& session ) const;
+	void ClassifyBatch(
+		Session& session,
+		CUDA_FLOAT_DOUBLE* const classifications,
+		unsigned int const batchSize
+	) const;
+
+	// writes a training vector into m_batchVectors, between Begin() and Upload()
+	void SetBatchVector( unsigned int const index, unsigned int const row );
+
+	void CalculateResponses( std::vector< unsigned int > const& rows );
+	void UploadResponses();
+	void DownloadResponses();
+	void UpdateResponses();    // downloads and unshrinks
+	void UpdateShrunkResponses();
 
-	void UpdateResponses();
+	void ShrinkActiveSet();
+	bool const UpdateActiveSet( bool const progress );    // called after each iteration, returns whether to continue
 
 
 	bool const IterateUnbiasedBinary();
@@ -232,19 +546,38 @@ private:
 	bool const IterateUnbiasedMulticlass();
 
 
-	typedef std::vector< std::pair< unsigned int, float > > SparseVector;
-
+	GTSVM_Statistics m_statistics;
+	boost::shared_ptr< Backend > m_rawBackend;    // m_backend charges everything to m_statistics, this doesn't
+	boost::shared_ptr< Backend > m_backend;
 
 	bool m_constructed;
 	bool m_initializedHost;
 	bool m_initializedDevice;
 	bool m_updatedResponses;
 
+	unsigned int m_deviceGeneration;    // incremented whenever the device is initialized, for the sake of sessions
+	boost::shared_ptr< Session > m_session;
+
+	unsigned int m_logBatchSize;
+
+	bool m_shrinking;
+	unsigned int m_shrinkingIterations;    // since the last attempt to shrink
+
 	boost::uint32_t m_rows;
-	boost::uint32_t m_columns;
+	boost::uint32_t m_columns;         // the number of columns used by the training vectors
+	boost::uint32_t m_inputColumns;    // the number of columns of the vectors which we were given
 	boost::uint32_t m_classes;
 
-	boost::shared_array< SparseVector > m_trainingVectors;
+	/*
+		The training data (the vectors, labels, squared norms, columns and
+		cluster layout, but not the kernel norms) may be shared with other
+		contexts by InitializeShared(), so it's only ever replaced, never
+		changed in place
+	*/
+	boost::shared_array< boost::uint32_t > m_columnInputIndices;    // for each column, the input column
+	boost::shared_array< boost::uint32_t > m_inputColumnIndices;    // for each input column, the column, or -1 if it isn't used
+
+	SparseMatrix m_trainingVectors;
 	boost::shared_array< boost::int32_t > m_trainingLabels;
 	boost::shared_array< float > m_trainingVectorNormsSquared;
 	boost::shared_array< float > m_trainingVectorKernelNormsSquared;
@@ -260,17 +593,29 @@ private:
 	boost::shared_array< double > m_trainingResponses;
 	boost::shared_array< float > m_trainingAlphas;
 
+	GTSVM_Clustering m_clustering;
 	unsigned int m_logMaximumClusterSize;
+	unsigned int m_activeClusters;    // as requested, not limited to m_clusters
 	unsigned int m_clusters;
-	std::vector< std::vector< unsigned int > > m_clusterIndices;
-	std::vector< std::vector< unsigned int > > m_clusterNonzeroIndices;
+	unsigned int m_shrunkClusters;    // the trailing clusters which contain only shrunk training vectors
+
+	/*
+		While anything is shrunk, the iterations only update the responses of
+		the active training vectors. UpdateShrunkResponses() updates the rest,
+		from the alphas which have changed since it was last called
+	*/
+	std::vector< unsigned int > m_shrunkChangedRows;
+	std::vector< float > m_shrunkChangedAlphas;    // as of the last call to UpdateShrunkResponses()
+	std::vector< bool > m_shrunkChanged;           // is each training vector in m_shrunkChangedRows?
+	boost::shared_ptr< std::vector< std::vector< unsigned int > > const > m_clusterIndices;
+	boost::shared_ptr< std::vector< std::vector< unsigned int > > const > m_clusterNonzeroIndices;
 
 	size_t m_foundSize;
-	boost::uint32_t m_foundIndices[ 32 ];
+	boost::uint32_t m_foundIndices[ 256 ];    // twice the largest batch
 	float* m_foundKeys;
 	boost::uint32_t* m_foundValues;
 
-	float* m_batchVectorsTranspose;
+	BatchVectors m_batchVectors;
 	float* m_batchVectorNormsSquared;
 	CUDA_FLOAT_DOUBLE* m_batchResponses;
 	float* m_batchAlphas;
@@ -278,7 +623,8 @@ private:
 
 	boost::shared_array< double > m_batchSubmatrix;
 
-	float* m_deviceBatchVectorsTranspose;
+	unsigned int m_batchUpdateSize;    // that of m_batchVectors, and of sessions' batches
+
 	float* m_deviceBatchVectorNormsSquared;
 	CUDA_FLOAT_DOUBLE* m_deviceBatchResponses;
 	float* m_deviceBatchAlphas;
@@ -291,8 +637,9 @@ private:
 
 	boost::uint32_t* m_deviceNonzeroIndices;
 	float* m_deviceTrainingVectorsTranspose;
-	CUDA::SparseKernelClusterHeader* m_deviceClusterHeaders;
+	CUDA::SparseKernelClusterHeader* m_deviceClusterHeaders;    // followed by the scratch clusters
 	boost::uint32_t* m_deviceClusterSizeSums;
+	float* m_deviceScratchAlphas;    // the alphas of the scratch clusters
 
 	size_t m_workSize;
 	void* m_deviceWork[ 4 ];
@@ -301,11 +648,66 @@ private:
 
 
 
+//============================================================================
+//    BatchVectors inline methods
+//============================================================================
+
+
+void BatchVectors::SetValue( unsigned int const index, unsigned int const column, float const value ) {
+
+	BOOST_ASSERT( m_transpose != NULL );
+	BOOST_ASSERT( index < ( 1u << m_logBatchSize ) );
+	BOOST_ASSERT( column < m_columns );
+
+	boost::uint32_t const position = ( column << m_logBatchSize ) + index;
+	m_transpose[ position ] = value;
+
+	if ( ! m_untracked ) {
+
+		// if there are too many to upload individually, then we'll clear and upload everything instead
+		m_updateIndices.push_back( position );
+		if ( m_updateIndices.size() > m_updateSize ) {
+
+			m_untracked = true;
+			m_uploadAll = true;
+			m_updateIndices.clear();
+			m_previousUpdates = 0;
+		}
+	}
+}
+
+
+float const* BatchVectors::GetDeviceTranspose() const {
+
+	return m_deviceTranspose;
+}
+
+
+
+
 //============================================================================
 //    SVM inline methods
 //============================================================================
 
 
+GTSVM_Backend const SVM::GetBackend() const {
+
+	return m_backend->GetType();
+}
+
+
+unsigned int const SVM::GetBatchSize() const {
+
+	return( 1u << m_logBatchSize );
+}
+
+
+bool const SVM::GetShrinking() const {
+
+	return m_shrinking;
+}
+
+
 unsigned int const SVM::GetRows() const {
 
 	if ( ! m_initializedHost )
@@ -320,7 +722,7 @@ unsigned int const SVM::GetColumns() const {
 	if ( ! m_initializedHost )
 		throw std::runtime_error( "SVM has not been initialized" );
 
-	return m_columns;
+	return m_inputColumns;
 }
 
 
@@ -338,11 +740,7 @@ unsigned int const SVM::GetNonzeros() const {
 	if ( ! m_initializedHost )
 		throw std::runtime_error( "SVM has not been initialized" );
 
-	unsigned int nonzeros = 0;
-	for ( unsigned int ii = 0; ii < m_rows; ++ii )
-		nonzeros += m_trainingVectors[ ii ].size();
-
-	return nonzeros;
+	return m_trainingVectors.GetNonzeros();
 }
 
 
@@ -409,6 +807,24 @@ CUDA_FLOAT_DOUBLE const SVM::GetBias() const {
 }
 
 
+bool const SVM::IsInitializedDevice() const {
+
+	return m_initializedDevice;
+}
+
+
+GTSVM_Statistics const& SVM::GetStatistics() const {
+
+	return m_statistics;
+}
+
+
+void SVM::ResetStatistics() {
+
+	GTSVM::ResetStatistics( &m_statistics );
+}
+
+
 
 
 }    // namespace GTSVM
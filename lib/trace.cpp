@@ -0,0 +1,380 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file trace.cpp
+	\brief implementation of tracing functions
+*/
+
+
+
+
+#include "headers.hpp"
+
+
+
+
+namespace GTSVM {
+
+
+
+
+//============================================================================
+//    Tracing globals
+//============================================================================
+
+
+boost::atomic< bool > g_tracing( false );
+
+
+
+
+namespace {
+
+
+
+
+//============================================================================
+//    TraceBuffer structure
+//============================================================================
+
+
+struct TraceRecord {
+
+	char const* name;
+	double start;
+	double finish;
+};
+
+
+/*
+	A ring buffer of the spans recorded on one thread. The thread which owns
+	it advances head, and the Tracer's writer thread advances tail as it
+	drains records to the trace file.
+*/
+struct TraceBuffer {
+
+	unsigned int thread;
+
+	boost::atomic< boost::uint64_t > head;
+	boost::uint64_t tail;
+
+	TraceRecord records[ TRACE_BUFFER_SIZE ];
+};
+
+
+// buffers belong to the Tracer, and outlive the threads which filled them
+void TraceBuffer_Release( TraceBuffer* const buffer ) {
+}
+
+
+
+
+//============================================================================
+//    Tracer class
+//============================================================================
+
+
+// how often the writer thread drains the buffers to the trace file
+unsigned int const g_drainMilliseconds = 10;
+
+
+/*
+	While a trace file is open, a writer thread drains every thread's buffer
+	to it every g_drainMilliseconds, so a buffer only overflows if its
+	thread records more than TRACE_BUFFER_SIZE spans in that time.
+*/
+struct Tracer {
+
+	Tracer();
+	~Tracer();
+
+
+	void SetFile( char const* const filename );
+
+	TraceBuffer* const GetBuffer();
+
+
+private:
+
+	void Run();
+
+	// m_mutex must be held
+	void Drain();
+
+
+	boost::mutex m_fileMutex;    // serializes SetFile
+
+	boost::mutex m_mutex;
+	boost::condition_variable m_wake;
+	bool m_stopping;
+	boost::thread m_writer;
+
+	FILE* m_file;
+	double m_origin;
+	boost::uint64_t m_dropped;
+	bool m_first;
+	size_t m_namedBuffers;
+
+	std::vector< boost::shared_ptr< TraceBuffer > > m_buffers;
+	boost::thread_specific_ptr< TraceBuffer > m_buffer;
+
+	std::vector< TraceRecord > m_records;
+
+
+	Tracer( Tracer const& other );
+	Tracer const& operator=( Tracer const& other );
+};
+
+
+Tracer::Tracer() :
+	m_stopping( false ),
+	m_file( NULL ),
+	m_origin( 0 ),
+	m_dropped( 0 ),
+	m_first( true ),
+	m_namedBuffers( 0 ),
+	m_buffer( &TraceBuffer_Release )
+{
+	char const* const filename = std::getenv( "GTSVM_TRACE_FILE" );
+	if ( ( filename != NULL ) && ( filename[ 0 ] != '\0' ) ) {
+
+		try {
+
+			SetFile( filename );
+		}
+		catch( std::exception& error ) {
+
+			std::fprintf( stderr, "GTSVM: %s \"%s\"\n", error.what(), filename );
+		}
+	}
+}
+
+
+Tracer::~Tracer() {
+
+	try {
+
+		SetFile( NULL );
+	}
+	catch( ... ) {}
+}
+
+
+void Tracer::SetFile( char const* const filename ) {
+
+	boost::lock_guard< boost::mutex > fileLock( m_fileMutex );
+
+	if ( m_file != NULL ) {
+
+		g_tracing.store( false );
+
+		boost::unique_lock< boost::mutex > lock( m_mutex );
+		m_stopping = true;
+		m_wake.notify_one();
+		lock.unlock();
+		m_writer.join();
+		lock.lock();
+
+		Drain();
+		std::fprintf(
+			m_file,
+			"\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%llu}}\n",
+			static_cast< unsigned long long >( m_dropped )
+		);
+		std::fclose( m_file );
+		m_file = NULL;
+	}
+
+	if ( ( filename != NULL ) && ( filename[ 0 ] != '\0' ) ) {
+
+		boost::lock_guard< boost::mutex > lock( m_mutex );
+
+		FILE* const file = std::fopen( filename, "w" );
+		if ( file == NULL )
+			throw std::runtime_error( "Unable to open trace file" );
+		std::fprintf( file, "{\"traceEvents\":[\n" );
+		m_file = file;
+
+		// spans recorded before now belong to no trace
+		for ( std::vector< boost::shared_ptr< TraceBuffer > >::const_iterator ii = m_buffers.begin(); ii != m_buffers.end(); ++ii )
+			( *ii )->tail = ( *ii )->head.load( boost::memory_order_acquire );
+		m_origin = MonotonicSeconds();
+		m_dropped = 0;
+		m_first = true;
+		m_namedBuffers = 0;
+
+		m_stopping = false;
+		boost::thread( boost::bind( &Tracer::Run, this ) ).swap( m_writer );
+
+		g_tracing.store( true );
+	}
+}
+
+
+TraceBuffer* const Tracer::GetBuffer() {
+
+	TraceBuffer* result = m_buffer.get();
+	if ( result == NULL ) {
+
+		boost::shared_ptr< TraceBuffer > buffer( new TraceBuffer );
+		buffer->head.store( 0 );
+		buffer->tail = 0;
+
+		boost::lock_guard< boost::mutex > lock( m_mutex );
+		buffer->thread = m_buffers.size() + 1;
+		m_buffers.push_back( buffer );
+
+		result = buffer.get();
+		m_buffer.reset( result );
+	}
+	return result;
+}
+
+
+void Tracer::Run() {
+
+	boost::unique_lock< boost::mutex > lock( m_mutex );
+	while ( ! m_stopping ) {
+
+		m_wake.timed_wait( lock, boost::posix_time::milliseconds( g_drainMilliseconds ) );
+		Drain();
+	}
+}
+
+
+/*
+	Spans still being recorded while this runs may be written out, or left
+	for the next pass. The records are copied out of each buffer before
+	they're written, and any which its thread might have overwritten in the
+	meantime are discarded, and counted as dropped.
+*/
+void Tracer::Drain() {
+
+	BOOST_ASSERT( m_file != NULL );
+
+	int const process = getpid();
+
+	for ( ; m_namedBuffers < m_buffers.size(); ++m_namedBuffers ) {
+
+		unsigned int const thread = m_buffers[ m_namedBuffers ]->thread;
+		std::fprintf(
+			m_file,
+			"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"GTSVM thread %u\"}}",
+			( m_first ? "" : ",\n" ),
+			process,
+			thread,
+			thread
+		);
+		m_first = false;
+	}
+
+	for ( std::vector< boost::shared_ptr< TraceBuffer > >::const_iterator ii = m_buffers.begin(); ii != m_buffers.end(); ++ii ) {
+
+		TraceBuffer& buffer = **ii;
+
+		boost::uint64_t const head = buffer.head.load( boost::memory_order_acquire );
+		if ( head - buffer.tail > TRACE_BUFFER_SIZE ) {
+
+			m_dropped += head - buffer.tail - TRACE_BUFFER_SIZE;
+			buffer.tail = head - TRACE_BUFFER_SIZE;
+		}
+
+		m_records.clear();
+		for ( boost::uint64_t jj = buffer.tail; jj < head; ++jj )
+			m_records.push_back( buffer.records[ jj & ( TRACE_BUFFER_SIZE - 1 ) ] );
+
+		/*
+			While the head is h, the owning thread may be writing record h,
+			which is stored over record h - TRACE_BUFFER_SIZE, so only the
+			records after that one are certainly intact
+		*/
+		boost::atomic_thread_fence( boost::memory_order_acquire );
+		boost::uint64_t const overwrittenHead = buffer.head.load( boost::memory_order_relaxed );
+		boost::uint64_t begin = buffer.tail;
+		if ( overwrittenHead >= begin + TRACE_BUFFER_SIZE ) {
+
+			begin = std::min( overwrittenHead - TRACE_BUFFER_SIZE + 1, head );
+			m_dropped += begin - buffer.tail;
+		}
+
+		for ( boost::uint64_t jj = begin; jj < head; ++jj ) {
+
+			TraceRecord const& record = m_records[ jj - buffer.tail ];
+			if ( record.start >= m_origin ) {
+
+				std::fprintf(
+					m_file,
+					"%s{\"name\":\"%s\",\"cat\":\"gtsvm\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					( m_first ? "" : ",\n" ),
+					record.name,
+					process,
+					buffer.thread,
+					( record.start - m_origin ) * 1e6,
+					( record.finish - record.start ) * 1e6
+				);
+				m_first = false;
+			}
+		}
+		buffer.tail = head;
+	}
+
+	// so that the trace is usable (if truncated) even if the process dies
+	std::fflush( m_file );
+}
+
+
+
+
+Tracer g_tracer;
+
+
+
+
+}    // anonymous namespace
+
+
+
+
+//============================================================================
+//    Tracing functions
+//============================================================================
+
+
+void SetTraceFile( char const* const filename ) {
+
+	g_tracer.SetFile( filename );
+}
+
+
+void RecordTraceSpan( char const* const name, double const start, double const finish ) {
+
+	TraceBuffer* const buffer = g_tracer.GetBuffer();
+
+	boost::uint64_t const head = buffer->head.load( boost::memory_order_relaxed );
+	TraceRecord& record = buffer->records[ head & ( TRACE_BUFFER_SIZE - 1 ) ];
+	record.name   = name;
+	record.start  = start;
+	record.finish = finish;
+	buffer->head.store( head + 1, boost::memory_order_release );
+}
+
+
+
+
+}    // namespace GTSVM
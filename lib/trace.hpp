@@ -0,0 +1,184 @@
+/*
+	Copyright (C) 2011  Andrew Cotter
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+	\file trace.hpp
+	\brief definition of TraceSpan class, and tracing functions
+*/
+
+
+
+
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+#ifdef __cplusplus
+
+
+
+
+#include "statistics.hpp"
+
+#include <boost/atomic.hpp>
+
+#include <cstddef>
+
+
+
+
+namespace GTSVM {
+
+
+
+
+//============================================================================
+//    Tracing functions
+//============================================================================
+
+
+/*
+	Starts writing a Chrome trace (the JSON format read by chrome://tracing
+	and Perfetto) to the given file, or stops tracing if it's NULL or empty.
+	Spans are buffered per thread, and a background thread drains them to
+	the file as tracing runs. The trace is completed when tracing stops, or
+	the process exits. If the GTSVM_TRACE_FILE environment variable is set,
+	then tracing starts, to that file, when the library is loaded.
+*/
+void SetTraceFile( char const* const filename );
+
+
+extern boost::atomic< bool > g_tracing;
+
+inline bool const IsTracing();
+
+
+/*
+	Records a completed span on the calling thread's ring buffer. Only the
+	calling thread writes to its buffer, so this takes no lock. If more than
+	TRACE_BUFFER_SIZE spans are recorded on one thread between two drains of
+	the buffers, then the oldest are dropped. The name must be a string
+	literal.
+*/
+void RecordTraceSpan( char const* const name, double const start, double const finish );
+
+
+#define TRACE_BUFFER_SIZE ( 1u << 16 )
+
+
+
+
+//============================================================================
+//    TraceSpan class
+//============================================================================
+
+
+/*
+	Records the time between Start() and Stop() (or destruction, if it's still
+	running) as a span with the given name, if tracing is enabled. Starting a
+	running span stops it first, so one TraceSpan can time a sequence of
+	phases.
+*/
+struct TraceSpan {
+
+	inline TraceSpan();
+	inline explicit TraceSpan( char const* const name );
+	inline ~TraceSpan();
+
+
+	inline void Start( char const* const name );
+	inline void Stop();
+
+
+private:
+
+	char const* m_name;
+	double m_start;
+
+
+	TraceSpan( TraceSpan const& other );
+	TraceSpan const& operator=( TraceSpan const& other );
+};
+
+
+
+
+//============================================================================
+//    Tracing inline functions
+//============================================================================
+
+
+bool const IsTracing() {
+
+	return g_tracing.load( boost::memory_order_relaxed );
+}
+
+
+
+
+//============================================================================
+//    TraceSpan inline methods
+//============================================================================
+
+
+TraceSpan::TraceSpan() : m_name( NULL ), m_start( 0 ) {
+}
+
+
+TraceSpan::TraceSpan( char const* const name ) : m_name( NULL ), m_start( 0 ) {
+
+	Start( name );
+}
+
+
+TraceSpan::~TraceSpan() {
+
+	Stop();
+}
+
+
+void TraceSpan::Start( char const* const name ) {
+
+	Stop();
+	if ( IsTracing() ) {
+
+		m_name = name;
+		m_start = MonotonicSeconds();
+	}
+}
+
+
+void TraceSpan::Stop() {
+
+	if ( m_name != NULL ) {
+
+		RecordTraceSpan( m_name, m_start, MonotonicSeconds() );
+		m_name = NULL;
+	}
+}
+
+
+
+
+}    // namespace GTSVM
+
+
+
+
+#endif    /* __cplusplus */
+
+#endif    /* __TRACE_HPP__ */
@@ -71,25 +71,15 @@ class ClassifyGtsvm(BaseEstimator, ClassifierMixin):
         self.model_fname =self.train_fname + '.model'
         dump_svmlight_file(X,Y,self.train_fname ,zero_based=False)
         if self.multiclass:
-            command_line=path_to_train_program+'gtsvm_initialize {0} -f {1} -o {2}  -m 1 '.format(self.param_str, self.train_fname , self.model_fname )
+            multiclass_str=' -m 1'
         else:
-            command_line=path_to_train_program+'gtsvm_initialize -f {1} -o {2} {0}'.format(self.param_str, self.train_fname , self.model_fname )
-        args = shlex.split(command_line)
-        p = subprocess.Popen(args)
-        p.wait()
-        command_line=path_to_train_program+'gtsvm_optimize -i {0} -o {1} -e {2} -n {3}'.format(self.model_fname,self.model_fname,self.tol,self.max_iter)    
+            multiclass_str=''
+        command_line=path_to_train_program+'gtsvm_train -f {1} -o {2} {0}{3} -e {4} -n {5} --shrink 1 --cache 0'.format(self.param_str, self.train_fname , self.model_fname , multiclass_str , self.tol , self.max_iter )
         args = shlex.split(command_line)
         p = subprocess.Popen(args,stderr=subprocess.PIPE)
         p.wait()
         opt_err_str=p.stderr.read() ##gtsvm is too buggy
-        if len(opt_err_str) < 1: 
-            command_line=path_to_train_program+'gtsvm_shrink -i {0}  -o {1}'.format(self.model_fname,self.model_fname)
-            args = shlex.split(command_line)
-            p = subprocess.Popen(args)
-            p.wait()
-            self.train_fail=False
-        else :
-            self.train_fail=True
+        self.train_fail = ( len(opt_err_str) > 0 )
             
         
         return self
@@ -103,7 +93,7 @@ class ClassifyGtsvm(BaseEstimator, ClassifierMixin):
         self.test_fname =self.base_str +'-svmcmd-test' +  '.dat'
         self.predict_fname =self.base_str +'-svmcmd-predict' +  '.dat'
         dump_svmlight_file(X,Y,self.test_fname ,zero_based=False)
-        command_line=path_to_train_program+'gtsvm_classify -f {0}  -i {1} -o {2}'.format(self.test_fname , self.model_fname, self.predict_fname )
+        command_line=path_to_train_program+'gtsvm_classify -f {0}  -i {1} -o {2} --cache 0'.format(self.test_fname , self.model_fname, self.predict_fname )
         args = shlex.split(command_line)
         p = subprocess.Popen(args)
         p.wait()